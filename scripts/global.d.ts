@@ -634,6 +634,15 @@ declare class noisemap {
      */
     is_highest(pos: vector_3d, check_radius: number): boolean
     set(x: number, y: number, value: number): void;
+
+    /**
+     * Returns the values at every vertex of a selection, in the same
+     * order as selection.heights(), multiplied by scale.
+     *
+     * @param sel
+     * @param scale - defaults to 1
+     */
+    sample(sel: selection, scale?: number): number[];
     width(): number;
     height(): number;
 }
@@ -723,6 +732,53 @@ declare class selection {
      * Creates and returns an iterator for all chunks inside this selection
      */
     chunks(): chunk[];
+
+    /**
+     * Returns the height of every vertex inside this selection,
+     * in the same order as verts().
+     */
+    heights(): number[];
+
+    /**
+     * Sets the height of every vertex inside this selection
+     * from a table in the order of heights().
+     */
+    set_heights(values: number[]): void;
+
+    /**
+     * Returns the vertex colors inside this selection, three
+     * values (r, g, b) per vertex in the order of verts().
+     */
+    colors(): number[];
+
+    /**
+     * Sets the vertex colors inside this selection from a table
+     * in the order of colors().
+     */
+    set_colors(values: number[]): void;
+
+    /**
+     * Returns the alpha of a texture layer for every texture unit
+     * inside this selection, in the same order as tex().
+     */
+    alphas(layer: number): number[];
+
+    /**
+     * Sets the alpha of a texture layer for every texture unit
+     * inside this selection from a table in the order of alphas().
+     */
+    set_alphas(layer: number, values: number[]): void;
+
+    /**
+     * Calls fun once per chunk of this selection, with the heights and
+     * positions of the chunk's vertices inside it. fun changes the heights
+     * table in place. Chunks are processed in parallel on separate lua
+     * states, so fun can only use the lua standard library and can't use
+     * local variables declared outside of it.
+     *
+     * @param fun
+     */
+    transform_heights(fun: (heights: number[], xs: number[], zs: number[]) => void): void;
     
     /**
      * Applies all changes made inside this selection. 
@@ -348,3 +348,10 @@ void Png2Blp::load(const void* rawData, uint32_t pngSize) {
     mColors = PngReader()(pngData, pngSize, mWidth, mHeight);
 }
 
+void Png2Blp::loadRgba(const void* rgbaData, uint32_t width, uint32_t height) {
+    mWidth = width;
+    mHeight = height;
+    mColors.resize(width * height);
+    memcpy(mColors.data(), rgbaData, sizeof(uint32_t) * width * height);
+}
+
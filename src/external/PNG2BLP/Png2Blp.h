@@ -35,6 +35,8 @@ class Png2Blp {
 public:
     Png2Blp();
     void load(const void* pngData, uint32_t pngSize);
+    // rows of RGBA8 pixels, as read back from OpenGL, without going through a png
+    void loadRgba(const void* rgbaData, uint32_t width, uint32_t height);
 
     void* createBlpPalettedInMemory(bool generateMipMaps, uint8_t alphaDepth, uint8_t minQuality, uint8_t maxQuality, uint32_t& fileSize);
     void* createBlpUncompressedInMemory(bool generateMipMaps, uint32_t &fileSize);
@@ -0,0 +1,123 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/triangle_bvh.hpp>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace math
+{
+  void triangle_bvh::add_triangle(glm::vec3 const& v0, glm::vec3 const& v1, glm::vec3 const& v2, std::uint32_t id)
+  {
+    _triangles.push_back({{v0, v1, v2}, id});
+  }
+
+  void triangle_bvh::clear()
+  {
+    _triangles.clear();
+    _nodes.clear();
+  }
+
+  void triangle_bvh::build()
+  {
+    _nodes.clear();
+
+    if (_triangles.empty())
+    {
+      return;
+    }
+
+    std::vector<glm::vec3> centers;
+    centers.reserve(_triangles.size());
+
+    for (auto const& tri : _triangles)
+    {
+      centers.push_back((tri.vertices[0] + tri.vertices[1] + tri.vertices[2]) / 3.f);
+    }
+
+    // a balanced tree has at most 2 * leaves - 1 nodes
+    _nodes.reserve(2 * (_triangles.size() / max_triangles_per_leaf + 1));
+    std::vector<std::uint32_t> order(_triangles.size());
+    for (std::uint32_t i = 0; i < order.size(); ++i)
+    {
+      order[i] = i;
+    }
+
+    _nodes.emplace_back();
+    build_node(0, 0, static_cast<std::uint32_t>(order.size()), order, centers, 1);
+
+    // leaves reference contiguous ranges of the sorted triangles
+    std::vector<triangle> triangles;
+    triangles.reserve(order.size());
+    for (std::uint32_t index : order)
+    {
+      triangles.push_back(_triangles[index]);
+    }
+    _triangles = std::move(triangles);
+
+    _nodes.shrink_to_fit();
+  }
+
+  void triangle_bvh::build_node(std::uint32_t node_index, std::uint32_t first, std::uint32_t count, std::vector<std::uint32_t>& order, std::vector<glm::vec3> const& centers, std::size_t depth)
+  {
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    glm::vec3 center_min(std::numeric_limits<float>::max());
+    glm::vec3 center_max(std::numeric_limits<float>::lowest());
+
+    for (std::uint32_t i = first; i < first + count; ++i)
+    {
+      for (auto const& vertex : _triangles[order[i]].vertices)
+      {
+        min = glm::min(min, vertex);
+        max = glm::max(max, vertex);
+      }
+
+      center_min = glm::min(center_min, centers[order[i]]);
+      center_max = glm::max(center_max, centers[order[i]]);
+    }
+
+    _nodes[node_index].min = min;
+    _nodes[node_index].max = max;
+
+    glm::vec3 const center_extents = center_max - center_min;
+
+    // stack depth of the traversal is bounded by the tree depth
+    if (count <= max_triangles_per_leaf || depth + 1 >= max_depth
+      || (center_extents.x <= 0.f && center_extents.y <= 0.f && center_extents.z <= 0.f))
+    {
+      _nodes[node_index].first = first;
+      _nodes[node_index].count = count;
+      return;
+    }
+
+    int axis = 0;
+    if (center_extents.y > center_extents[axis])
+    {
+      axis = 1;
+    }
+    if (center_extents.z > center_extents[axis])
+    {
+      axis = 2;
+    }
+
+    std::uint32_t const half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](std::uint32_t a, std::uint32_t b)
+    {
+      return centers[a][axis] < centers[b][axis];
+    });
+
+    std::uint32_t const left = static_cast<std::uint32_t>(_nodes.size());
+    _nodes.emplace_back();
+    build_node(left, first, half, order, centers, depth + 1);
+
+    std::uint32_t const right = static_cast<std::uint32_t>(_nodes.size());
+    _nodes.emplace_back();
+    build_node(right, first + half, count - half, order, centers, depth + 1);
+
+    _nodes[node_index].first = right;
+    _nodes[node_index].count = 0;
+  }
+}
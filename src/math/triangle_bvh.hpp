@@ -0,0 +1,109 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/ray.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math
+{
+  //! Bounding volume hierarchy over a static triangle soup, to ray test meshes
+  //! without going through all of their triangles. Triangles are copied in, each
+  //! with an id given back on hits (an index offset, a triangle number...).
+  class triangle_bvh
+  {
+  public:
+    void add_triangle(glm::vec3 const& v0, glm::vec3 const& v1, glm::vec3 const& v2, std::uint32_t id);
+    //! to call once every triangle was added, before any intersect()
+    void build();
+    void clear();
+
+    [[nodiscard]]
+    bool empty() const { return _triangles.empty(); }
+
+    [[nodiscard]]
+    std::size_t memory_usage() const
+    {
+      return _triangles.capacity() * sizeof(triangle) + _nodes.capacity() * sizeof(node);
+    }
+
+    //! calls fun(id, distance) for every triangle hit by the ray, in no particular order
+    template<typename Fun>
+      void intersect(ray const& ray, Fun&& fun) const
+    {
+      if (_nodes.empty())
+      {
+        return;
+      }
+
+      std::array<std::uint32_t, max_depth> stack;
+      std::size_t stack_size = 0;
+      std::uint32_t current = 0;
+
+      while (true)
+      {
+        node const& n = _nodes[current];
+
+        if (ray.intersect_bounds(n.min, n.max))
+        {
+          if (n.count)
+          {
+            for (std::uint32_t i = n.first; i < n.first + n.count; ++i)
+            {
+              triangle const& tri = _triangles[i];
+
+              if (auto distance = ray.intersect_triangle(tri.vertices[0], tri.vertices[1], tri.vertices[2]))
+              {
+                fun(tri.id, *distance);
+              }
+            }
+          }
+          else
+          {
+            // left child is stored right after its parent
+            stack[stack_size++] = n.first;
+            current = current + 1;
+            continue;
+          }
+        }
+
+        if (!stack_size)
+        {
+          return;
+        }
+
+        current = stack[--stack_size];
+      }
+    }
+
+  private:
+    static constexpr std::uint32_t max_triangles_per_leaf = 4;
+    static constexpr std::size_t max_depth = 64;
+
+    struct triangle
+    {
+      std::array<glm::vec3, 3> vertices;
+      std::uint32_t id;
+    };
+
+    //! leaf when count != 0, otherwise first is the index of the right child
+    struct node
+    {
+      glm::vec3 min;
+      std::uint32_t first;
+      glm::vec3 max;
+      std::uint32_t count;
+    };
+
+    void build_node(std::uint32_t node_index, std::uint32_t first, std::uint32_t count, std::vector<std::uint32_t>& order, std::vector<glm::vec3> const& centers, std::size_t depth);
+
+    std::vector<triangle> _triangles;
+    std::vector<node> _nodes;
+  };
+}
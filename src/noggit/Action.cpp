@@ -11,6 +11,75 @@
 
 #include <cstring>
 
+namespace
+{
+  std::vector<std::uint8_t> copy_bytes(void const* data, std::size_t size)
+  {
+    auto const bytes = static_cast<std::uint8_t const*>(data);
+    return {bytes, bytes + size};
+  }
+
+  // which alphamaps and temporary values exist (padded to a word), then their values
+  std::vector<std::uint8_t> alphamaps_state(TextureSet* texture_set)
+  {
+    auto const& alphamaps = *texture_set->getAlphamaps();
+    auto const& tmp_edit_values = texture_set->getTempAlphamaps();
+
+    std::vector<std::uint8_t> state(4, 0);
+
+    for (std::size_t i = 0; i < MAX_ALPHAMAPS; ++i)
+    {
+      state[i] = alphamaps[i] ? 1 : 0;
+    }
+    state[3] = tmp_edit_values ? 1 : 0;
+
+    for (auto const& alphamap : alphamaps)
+    {
+      if (alphamap)
+      {
+        unsigned char const* values = alphamap->getAlpha();
+        state.insert(state.end(), values, values + 64 * 64);
+      }
+    }
+
+    if (tmp_edit_values)
+    {
+      auto const values = reinterpret_cast<std::uint8_t const*>(tmp_edit_values->map.data());
+      state.insert(state.end(), values, values + sizeof(tmp_edit_values->map));
+    }
+
+    return state;
+  }
+
+  void restore_alphamaps_state(TextureSet* texture_set, std::vector<std::uint8_t>& state)
+  {
+    std::array<std::unique_ptr<Alphamap>, MAX_ALPHAMAPS> alphamaps;
+    std::size_t offset = 4;
+
+    for (std::size_t i = 0; i < MAX_ALPHAMAPS; ++i)
+    {
+      if (state[i])
+      {
+        alphamaps[i] = std::make_unique<Alphamap>();
+        alphamaps[i]->setAlpha(state.data() + offset);
+        offset += 64 * 64;
+      }
+    }
+
+    texture_set->setAlphamaps(alphamaps);
+
+    if (state[3])
+    {
+      auto values = std::make_unique<tmp_edit_alpha_values>();
+      std::memcpy(values->map.data(), state.data() + offset, sizeof(values->map));
+      texture_set->getTempAlphamaps() = std::move(values);
+    }
+    else
+    {
+      texture_set->getTempAlphamaps().reset();
+    }
+  }
+}
 
 Noggit::Action::Action(MapView* map_view)
 : QObject()
@@ -57,32 +126,31 @@ void Noggit::Action::undo(bool redo)
 
   if (_flags & ActionFlags::eCHUNKS_TERRAIN)
   {
-    for (auto& pair : redo ? _chunk_terrain_post : _chunk_terrain_pre)
+    for (auto& delta : _chunk_terrain)
     {
-      std::memcpy(&pair.first->mVertices, pair.second.data(), 145 * 3 * sizeof(float));
+      std::memcpy(&delta.chunk()->mVertices, delta.state(redo).data(), 145 * 3 * sizeof(float));
 
-      pair.first->registerChunkUpdate(ChunkUpdateFlags::VERTEX);
+      delta.chunk()->registerChunkUpdate(ChunkUpdateFlags::VERTEX);
 
     }
-    for (auto& pair : redo ? _chunk_terrain_post : _chunk_terrain_pre)
+    for (auto& delta : _chunk_terrain)
     {
-      _map_view->getWorld()->recalc_norms(pair.first);
-      pair.first->registerChunkUpdate(ChunkUpdateFlags::NORMALS);
+      _map_view->getWorld()->recalc_norms(delta.chunk());
+      delta.chunk()->registerChunkUpdate(ChunkUpdateFlags::NORMALS);
     }
     _map_view->getWorld()->updateVertexCenter();
   }
   if (_flags & ActionFlags::eCHUNKS_TEXTURE)
   {
-    for (auto& pair : redo ? _chunk_texture_post : _chunk_texture_pre)
+    auto& texture_caches = redo ? _chunk_texture_post : _chunk_texture_pre;
+
+    for (std::size_t i = 0; i < texture_caches.size(); ++i)
     {
+      auto& pair = texture_caches[i];
       auto texture_set = pair.first->getTextureSet();
 
-      texture_set->setAlphamaps(pair.second.alphamaps);
-
-      if (pair.second.tmp_edit_values)
-        texture_set->getTempAlphamaps() = std::make_unique<tmp_edit_alpha_values>(*pair.second.tmp_edit_values);
-      else
-        texture_set->getTempAlphamaps().reset();
+      auto alphamaps = _chunk_alphamaps[i].state(redo);
+      restore_alphamaps_state(texture_set, alphamaps);
 
       std::memcpy(texture_set->getMCLYEntries(), &pair.second.layers_info, sizeof(layer_info) * 4);
       texture_set->setNTextures(pair.second.n_textures);
@@ -103,10 +171,10 @@ void Noggit::Action::undo(bool redo)
   }
   if (_flags & ActionFlags::eCHUNKS_VERTEX_COLOR)
   {
-    for (auto& pair : redo ? _chunk_vertex_color_post : _chunk_vertex_color_pre)
+    for (auto& delta : _chunk_vertex_color)
     {
-      std::memcpy(&pair.first->mccv, pair.second.data(), 145 * 3 * sizeof(float));
-      pair.first->registerChunkUpdate(ChunkUpdateFlags::MCCV);;
+      std::memcpy(delta.chunk()->getVertexColors(), delta.state(redo).data(), 145 * 3 * sizeof(float));
+      delta.chunk()->registerChunkUpdate(ChunkUpdateFlags::MCCV);;
     }
   }
   if (_flags & ActionFlags::eOBJECTS_ADDED
@@ -205,10 +273,10 @@ void Noggit::Action::undo(bool redo)
   }
   if (_flags & ActionFlags::eCHUNK_SHADOWS)
   {
-    for (auto& pair : redo ? _chunk_shadow_map_post : _chunk_shadow_map_pre)
+    for (auto& delta : _chunk_shadow_map)
     {
-      std::memcpy(&pair.first->_shadow_map, pair.second.data(), 64 * 64 * sizeof(uint8_t));
-      pair.first->registerChunkUpdate(ChunkUpdateFlags::SHADOW);
+      std::memcpy(delta.chunk()->shadow_map(), delta.state(redo).data(), 64 * 64 * sizeof(uint8_t));
+      delta.chunk()->registerChunkUpdate(ChunkUpdateFlags::SHADOW);
       // pair.first->update_shadows();
     }
   }
@@ -411,15 +479,11 @@ void Noggit::Action::finish()
 {
   if (_flags & ActionFlags::eCHUNKS_TERRAIN)
   {
-    _chunk_terrain_post.resize(_chunk_terrain_pre.size());
-
-    for (int i = 0; i < _chunk_terrain_pre.size(); ++i)
+    for (auto& delta : _chunk_terrain)
     {
-      auto& post =_chunk_terrain_post.at(i);
-      auto& pre = _chunk_terrain_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->mVertices, 145 * 3 * sizeof(float));
+      delta.finish(copy_bytes(&delta.chunk()->mVertices, 145 * 3 * sizeof(float)));
     }
+    _chunk_terrain_index.clear();
   }
   if (_flags & ActionFlags::eCHUNKS_TEXTURE)
   {
@@ -434,19 +498,7 @@ void Noggit::Action::finish()
 
       cache.n_textures = texture_set->num();
 
-      const auto& sourceAlphamaps = *texture_set->getAlphamaps();
-      for (size_t i = 0; i < MAX_ALPHAMAPS; ++i) {
-        if (sourceAlphamaps[i])
-          cache.alphamaps[i] = std::make_unique<Alphamap>(*sourceAlphamaps[i]);
-        else
-          cache.alphamaps[i].reset();
-      }
-
-      const auto& source_temp_alphas = texture_set->getTempAlphamaps();
-      if (source_temp_alphas)
-          cache.tmp_edit_values = std::make_unique<tmp_edit_alpha_values>(*source_temp_alphas);
-      else
-          cache.tmp_edit_values.reset();
+      _chunk_alphamaps.at(i).finish(alphamaps_state(texture_set));
 
       std::memcpy(&cache.layers_info, texture_set->getMCLYEntries(), sizeof(layer_info) * 4);
 
@@ -460,14 +512,9 @@ void Noggit::Action::finish()
   }
   if (_flags & ActionFlags::eCHUNKS_VERTEX_COLOR)
   {
-    _chunk_vertex_color_post.resize(_chunk_vertex_color_pre.size());
-
-    for (int i = 0; i < _chunk_vertex_color_pre.size(); ++i)
+    for (auto& delta : _chunk_vertex_color)
     {
-      auto& post =_chunk_vertex_color_post.at(i);
-      auto& pre = _chunk_vertex_color_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->mccv, 145 * 3 * sizeof(float));
+      delta.finish(copy_bytes(delta.chunk()->getVertexColors(), 145 * 3 * sizeof(float)));
     }
   }
   if (_flags & ActionFlags::eOBJECTS_TRANSFORMED)
@@ -552,14 +599,9 @@ void Noggit::Action::finish()
   }
   if (_flags & ActionFlags::eCHUNK_SHADOWS)
   {
-    _chunk_shadow_map_post.resize(_chunk_shadow_map_pre.size());
-
-    for (int i = 0; i < _chunk_shadow_map_pre.size(); ++i)
+    for (auto& delta : _chunk_shadow_map)
     {
-      auto& post =_chunk_shadow_map_post.at(i);
-      auto& pre = _chunk_shadow_map_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->_shadow_map, 64 * 64 * sizeof(std::uint8_t));
+      delta.finish(copy_bytes(delta.chunk()->shadow_map(), 64 * 64 * sizeof(std::uint8_t)));
     }
   }
   if (_flags & ActionFlags::eAREA_TRIGGER_TRANSFORMED)
@@ -583,18 +625,76 @@ void Noggit::Action::finish()
     }
   }
 
+  _memory_usage = computeMemoryUsage();
+
   if (_post)
       _post();
 }
 
 float* Noggit::Action::getChunkTerrainOriginalData(MapChunk* chunk)
 {
-  for (auto& pair : _chunk_terrain_pre)
+  auto it = _chunk_terrain_index.find(chunk);
+
+  if (it == _chunk_terrain_index.end())
+    return nullptr;
+
+  return reinterpret_cast<float*>(_chunk_terrain[it->second].pre_data());
+}
+
+std::size_t Noggit::Action::memoryUsage() const
+{
+  return _memory_usage;
+}
+
+std::size_t Noggit::Action::computeMemoryUsage() const
+{
+  std::size_t size = sizeof(Action);
+
+  for (auto const* deltas : {&_chunk_terrain, &_chunk_alphamaps, &_chunk_vertex_color, &_chunk_shadow_map})
+  {
+    for (auto const& delta : *deltas)
+    {
+      size += delta.memory_usage();
+    }
+  }
+
+  for (auto const* caches : {&_chunk_texture_pre, &_chunk_texture_post})
+  {
+    for (auto const& pair : *caches)
+    {
+      size += sizeof(pair);
+      for (auto const& texture : pair.second.textures)
+      {
+        size += sizeof(texture) + texture.capacity();
+      }
+    }
+  }
+
+  for (auto const* liquids : {&_chunk_liquid_pre, &_chunk_liquid_post})
+  {
+    for (auto const& pair : *liquids)
+    {
+      size += sizeof(pair) + pair.second.capacity() * sizeof(liquid_layer);
+    }
+  }
+
+  for (auto const* selection : {&_vertex_selection_pre, &_vertex_selection_post})
   {
-    if (pair.first == chunk)
-      return pair.second.data();
+    size += (selection->vertex_tiles.size() + selection->vertex_chunks.size()
+           + selection->vertex_border_chunks.size() + selection->vertices_selected.size()) * 2 * sizeof(void*);
   }
-  return nullptr;
+
+  size += (_transformed_objects_pre.capacity() + _transformed_objects_post.capacity()
+         + _removed_objects_pre.capacity() + _added_objects_pre.capacity()) * sizeof(std::pair<unsigned, ObjectInstanceCache>);
+  size += (_chunk_holes_pre.capacity() + _chunk_holes_post.capacity()
+         + _chunk_area_id_pre.capacity() + _chunk_area_id_post.capacity()) * sizeof(std::pair<MapChunk*, int>);
+  size += (_chunk_layerinfos_pre.capacity() + _chunk_layerinfos_post.capacity()) * sizeof(std::pair<MapChunk*, std::array<layer_info, 4>>);
+  size += (_chunk_detaildoodad_exclusion_pre.capacity() + _chunk_detaildoodad_exclusion_post.capacity()) * sizeof(std::pair<MapChunk*, std::array<std::uint8_t, 8>>);
+  size += (_chunk_flags_pre.capacity() + _chunk_flags_post.capacity()) * sizeof(std::pair<MapChunk*, mcnk_flags>);
+  size += (_transformed_area_trigger_pre.capacity() + _transformed_area_trigger_post.capacity()) * sizeof(std::pair<uint32_t, area_trigger>);
+  size += _registered_chunks.size() * sizeof(std::pair<MapChunk*, unsigned>);
+
+  return size;
 }
 
 void Noggit::Action::setDelta(float delta)
@@ -648,52 +748,39 @@ void Noggit::Action::setPostCallback(std::function<void()> function)
 /* Registrators */
 /* ============ */
 
-void Noggit::Action::registerChunkTerrainChange(MapChunk* chunk)
+bool Noggit::Action::registerChunk(MapChunk* chunk, ActionFlags flag)
 {
-  _flags |= ActionFlags::eCHUNKS_TERRAIN;
+  _flags |= flag;
 
-  for (auto& pair : _chunk_terrain_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  unsigned& registered = _registered_chunks[chunk];
+
+  if (registered & flag)
+    return false;
+
+  registered |= flag;
+  return true;
+}
+
+void Noggit::Action::registerChunkTerrainChange(MapChunk* chunk)
+{
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_TERRAIN))
+    return;
 
-  std::array<float, 145 * 3> data{};
-  std::memcpy(data.data(), &chunk->mVertices, 145 * 3 * sizeof(float));
-  _chunk_terrain_pre.emplace_back(std::make_pair(chunk, data));
+  _chunk_terrain_index[chunk] = _chunk_terrain.size();
+  _chunk_terrain.emplace_back(chunk, copy_bytes(&chunk->mVertices, 145 * 3 * sizeof(float)));
   //LogDebug << "Chunk: " << chunk->px << "_" << chunk->py << "on tile: " << chunk->mt->index.x << "_" << chunk->mt->index.z << std::endl;
 }
 
 void Noggit::Action::registerChunkTextureChange(MapChunk* chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_TEXTURE;
-
-  for (auto& pair : _chunk_texture_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_TEXTURE))
+    return;
 
   TextureChangeCache cache;
   auto texture_set = chunk->getTextureSet();
 
   cache.n_textures = texture_set->num();
-  // cache.alphamaps = *texture_set->getAlphamaps();
-  // cache.tmp_edit_values = *texture_set->getTempAlphamaps();
-  const auto& sourceAlphamaps = *texture_set->getAlphamaps();
-  for (size_t i = 0; i < MAX_ALPHAMAPS; ++i) 
-  {
-      if (sourceAlphamaps[i])
-          cache.alphamaps[i] = std::make_unique<Alphamap>(*sourceAlphamaps[i]);
-      else
-          cache.alphamaps[i].reset();
-  }
-
-  const auto& source_temp_alphas = texture_set->getTempAlphamaps();
-  if (source_temp_alphas)
-      cache.tmp_edit_values = std::make_unique<tmp_edit_alpha_values>(*source_temp_alphas);
-  else
-      cache.tmp_edit_values.reset();
+  _chunk_alphamaps.emplace_back(chunk, alphamaps_state(texture_set));
 
   std::memcpy(&cache.layers_info, texture_set->getMCLYEntries(), sizeof(layer_info) * 4);
 
@@ -709,17 +796,10 @@ void Noggit::Action::registerChunkTextureChange(MapChunk* chunk)
 
 void Noggit::Action::registerChunkVertexColorChange(MapChunk* chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_VERTEX_COLOR;
-
-  for (auto& pair : _chunk_vertex_color_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_VERTEX_COLOR))
+    return;
 
-  std::array<float, 145 * 3> data{};
-  std::memcpy(data.data(), &chunk->mccv, 145 * 3 * sizeof(float));
-  _chunk_vertex_color_pre.emplace_back(std::make_pair(chunk, data));
+  _chunk_vertex_color.emplace_back(chunk, copy_bytes(chunk->getVertexColors(), 145 * 3 * sizeof(float)));
 }
 
 void Noggit::Action::registerObjectTransformed(SceneObject* obj)
@@ -789,49 +869,33 @@ void Noggit::Action::registerObjectRemoved(SceneObject* obj)
 
 void Noggit::Action::registerChunkHoleChange(MapChunk* chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_HOLES;
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_HOLES))
+    return;
 
-  for (auto& pair : _chunk_holes_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
   _chunk_holes_pre.emplace_back(std::make_pair(chunk, chunk->holes));
 }
 
 void Noggit::Action::registerChunkAreaIDChange(MapChunk* chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_AREAID;
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_AREAID))
+    return;
 
-  for (auto& pair : _chunk_area_id_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
   _chunk_area_id_pre.emplace_back(std::make_pair(chunk, chunk->areaID));
 }
 
 void Noggit::Action::registerChunkFlagChange(MapChunk *chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_FLAGS;
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_FLAGS))
+    return;
 
-  for (auto& pair : _chunk_flags_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
   _chunk_flags_pre.emplace_back(std::make_pair(chunk, chunk->header_flags));
 }
 
 void Noggit::Action::registerChunkLiquidChange(MapChunk* chunk)
 {
-  _flags |= ActionFlags::eCHUNKS_WATER;
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_WATER))
+    return;
 
-  for (auto& pair : _chunk_liquid_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
   _chunk_liquid_pre.emplace_back(std::make_pair(chunk, *chunk->liquid_chunk()->getLayers()));
 }
 
@@ -848,28 +912,17 @@ void Noggit::Action::registerVertexSelectionChange()
 
 void Noggit::Action::registerChunkShadowChange(MapChunk *chunk)
 {
-  _flags |= ActionFlags::eCHUNK_SHADOWS;
-
-  for (auto& pair : _chunk_shadow_map_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNK_SHADOWS))
+    return;
 
-  std::array<uint8_t, 64 * 64> data;
-  std::memcpy(data.data(), &chunk->_shadow_map, 64 * 64 * sizeof(std::uint8_t));
-  _chunk_shadow_map_pre.emplace_back(std::make_pair(chunk, std::move(data)));
+  _chunk_shadow_map.emplace_back(chunk, copy_bytes(chunk->shadow_map(), 64 * 64 * sizeof(std::uint8_t)));
 }
 
 void Noggit::Action::registerChunkLayerInfoChange(MapChunk* chunk)
 {
-    _flags |= ActionFlags::eCHUNKS_LAYERINFO;
+    if (!registerChunk(chunk, ActionFlags::eCHUNKS_LAYERINFO))
+        return;
 
-    for (auto& pair : _chunk_layerinfos_pre)
-    {
-        if (pair.first == chunk)
-            return;
-    }
     std::array<layer_info, 4> layer_infos{};
     std::memcpy(&layer_infos, chunk->texture_set->getMCLYEntries(), sizeof(layer_info) * 4);
 
@@ -878,13 +931,9 @@ void Noggit::Action::registerChunkLayerInfoChange(MapChunk* chunk)
 
 void Noggit::Action::registerChunkDetailDoodadExclusionChange(MapChunk* chunk)
 {
-    _flags |= ActionFlags::eCHUNK_DOODADS_EXCLUSION;
+    if (!registerChunk(chunk, ActionFlags::eCHUNK_DOODADS_EXCLUSION))
+        return;
 
-    for (auto& pair : _chunk_detaildoodad_exclusion_pre)
-    {
-        if (pair.first == chunk)
-            return;
-    }
     std::array<std::uint8_t, 8> data{};
     std::memcpy(&data, chunk->texture_set->getDoodadStencilBase(), sizeof(std::uint8_t) * 8);
 
@@ -7,6 +7,7 @@
 #include <array>
 #include <string>
 #include <external/tsl/robin_map.h>
+#include <noggit/ActionDelta.hpp>
 #include <noggit/area_trigger.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/liquid_layer.hpp>
@@ -65,12 +66,11 @@ namespace Noggit
       M2
     };
 
+    //! the alphamaps are stored in Action::_chunk_alphamaps
     struct TextureChangeCache
     {
       size_t n_textures;
       std::vector<std::string> textures;
-      std::array<std::unique_ptr<Alphamap>, MAX_ALPHAMAPS> alphamaps;
-      std::unique_ptr<tmp_edit_alpha_values> tmp_edit_values;
       layer_info layers_info[4];
     };
 
@@ -120,8 +120,13 @@ namespace Noggit
         bool checkAdressTag(std::uintptr_t address);
         void tagAdress(std::uintptr_t address);
 
+        //! heights of the chunk before the action, only available until finish()
         float* getChunkTerrainOriginalData(MapChunk* chunk);
 
+        //! approximate size of the recorded states, computed by finish()
+        [[nodiscard]]
+        std::size_t memoryUsage() const;
+
         // Registrators
         void registerChunkTerrainChange(MapChunk* chunk);
         void registerChunkTextureChange(MapChunk* chunk);
@@ -142,6 +147,10 @@ namespace Noggit
 
 
     private:
+        //! \returns false if the change was already recorded for that chunk
+        bool registerChunk(MapChunk* chunk, ActionFlags flag);
+        std::size_t computeMemoryUsage() const;
+
         bool _tag = false;
         std::vector<std::uintptr_t> _address_tag;
 
@@ -150,12 +159,17 @@ namespace Noggit
         unsigned _flags;
         unsigned _modality_controls = ActionModalityControllers::eNONE;
         MapView* _map_view;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_terrain_pre;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_terrain_post;
+        //! ActionFlags of the changes already recorded per chunk
+        tsl::robin_map<MapChunk*, unsigned> _registered_chunks;
+        tsl::robin_map<MapChunk*, std::size_t> _chunk_terrain_index;
+        std::size_t _memory_usage = 0;
+
+        std::vector<ActionDelta> _chunk_terrain;
         std::vector<std::pair<MapChunk*, TextureChangeCache>> _chunk_texture_pre;
         std::vector<std::pair<MapChunk*, TextureChangeCache>> _chunk_texture_post;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_vertex_color_pre;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_vertex_color_post;
+        //! in the same order as _chunk_texture_pre
+        std::vector<ActionDelta> _chunk_alphamaps;
+        std::vector<ActionDelta> _chunk_vertex_color;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _transformed_objects_pre;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _transformed_objects_post;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _removed_objects_pre;
@@ -178,8 +192,7 @@ namespace Noggit
         VertexSelectionCache _vertex_selection_pre;
         VertexSelectionCache _vertex_selection_post;
 
-        std::vector<std::pair<MapChunk*, std::array<std::uint8_t, 64 * 64>>> _chunk_shadow_map_pre;
-        std::vector<std::pair<MapChunk*, std::array<std::uint8_t, 64 * 64>>> _chunk_shadow_map_post;
+        std::vector<ActionDelta> _chunk_shadow_map;
 
         bool _vertex_selection_recorded = false;
 
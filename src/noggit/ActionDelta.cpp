@@ -0,0 +1,184 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/ActionDelta.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace Noggit
+{
+  namespace
+  {
+    // control byte < 128 : c + 1 literal words follow
+    // control byte >= 128 : the next word is repeated c - 126 times
+    constexpr std::size_t max_literals = 128;
+    constexpr std::size_t max_repeats = 129;
+
+    std::uint32_t read_word(std::uint8_t const* data, std::size_t word)
+    {
+      std::uint32_t value;
+      std::memcpy(&value, data + word * 4, 4);
+      return value;
+    }
+
+    void append_word(std::vector<std::uint8_t>& out, std::uint32_t value)
+    {
+      std::uint8_t bytes[4];
+      std::memcpy(bytes, &value, 4);
+      out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    //! reference may be shorter than data, missing words count as zeros
+    std::vector<std::uint8_t> pack(std::uint8_t const* data, std::size_t size, std::uint8_t const* reference, std::size_t reference_size)
+    {
+      assert(size % 4 == 0 && reference_size % 4 == 0);
+
+      std::size_t const words = size / 4;
+      std::size_t const reference_words = reference ? reference_size / 4 : 0;
+
+      auto word_at = [&] (std::size_t i)
+      {
+        std::uint32_t value = read_word(data, i);
+        return i < reference_words ? value ^ read_word(reference, i) : value;
+      };
+
+      std::vector<std::uint8_t> out;
+      std::size_t literal_start = 0;
+      std::size_t i = 0;
+
+      auto flush_literals = [&] (std::size_t end)
+      {
+        while (literal_start < end)
+        {
+          std::size_t const count = std::min(max_literals, end - literal_start);
+          out.push_back(static_cast<std::uint8_t>(count - 1));
+          for (std::size_t j = literal_start; j < literal_start + count; ++j)
+          {
+            append_word(out, word_at(j));
+          }
+          literal_start += count;
+        }
+      };
+
+      while (i < words)
+      {
+        std::uint32_t const value = word_at(i);
+        std::size_t run = 1;
+
+        while (i + run < words && run < max_repeats && word_at(i + run) == value)
+        {
+          ++run;
+        }
+
+        if (run >= 2)
+        {
+          flush_literals(i);
+          out.push_back(static_cast<std::uint8_t>(run + 126));
+          append_word(out, value);
+          i += run;
+          literal_start = i;
+        }
+        else
+        {
+          ++i;
+        }
+      }
+
+      flush_literals(words);
+
+      out.shrink_to_fit();
+      return out;
+    }
+
+    std::vector<std::uint8_t> unpack(std::vector<std::uint8_t> const& packed, std::size_t size, std::uint8_t const* reference, std::size_t reference_size)
+    {
+      std::vector<std::uint8_t> out(size);
+      std::size_t const reference_words = reference ? reference_size / 4 : 0;
+      std::size_t word = 0;
+      std::size_t pos = 0;
+
+      auto write = [&] (std::uint32_t value)
+      {
+        if (word < reference_words)
+        {
+          value ^= read_word(reference, word);
+        }
+        std::memcpy(out.data() + word * 4, &value, 4);
+        ++word;
+      };
+
+      while (pos < packed.size())
+      {
+        std::uint8_t const control = packed[pos++];
+
+        if (control < max_literals)
+        {
+          for (std::size_t j = 0; j <= control; ++j, pos += 4)
+          {
+            write(read_word(packed.data() + pos, 0));
+          }
+        }
+        else
+        {
+          std::uint32_t const value = read_word(packed.data() + pos, 0);
+          pos += 4;
+
+          for (std::size_t j = 0; j < static_cast<std::size_t>(control) - 126; ++j)
+          {
+            write(value);
+          }
+        }
+      }
+
+      assert(word * 4 == size);
+      return out;
+    }
+  }
+
+  ActionDelta::ActionDelta(MapChunk* chunk, std::vector<std::uint8_t> pre)
+    : _chunk(chunk)
+    , _pre(std::move(pre))
+    , _pre_size(_pre.size())
+  {
+  }
+
+  std::uint8_t* ActionDelta::pre_data()
+  {
+    assert(!_finished);
+    return _pre.data();
+  }
+
+  void ActionDelta::finish(std::vector<std::uint8_t> const& post)
+  {
+    assert(!_finished);
+
+    _post_size = post.size();
+    _post = pack(post.data(), post.size(), _pre.data(), _pre.size());
+    _pre = pack(_pre.data(), _pre.size(), nullptr, 0);
+    _finished = true;
+  }
+
+  std::vector<std::uint8_t> ActionDelta::state(bool post) const
+  {
+    if (!_finished)
+    {
+      // finish() is always called before undo, this is only reached for an interrupted action
+      return _pre;
+    }
+
+    std::vector<std::uint8_t> pre = unpack(_pre, _pre_size, nullptr, 0);
+
+    if (!post)
+    {
+      return pre;
+    }
+
+    return unpack(_post, _post_size, pre.data(), pre.size());
+  }
+
+  std::size_t ActionDelta::memory_usage() const
+  {
+    return sizeof(ActionDelta) + _pre.capacity() + _post.capacity();
+  }
+}
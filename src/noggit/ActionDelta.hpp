@@ -0,0 +1,46 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MapChunk;
+
+namespace Noggit
+{
+  //! Pre/post snapshot of a block of chunk data (heights, colors, alphamaps...) kept by an Action.
+  //! The pre state is stored as is while the action runs so it can be read back by brushes,
+  //! finish() then run-length packs it and stores the post state as a packed xor against it,
+  //! which is mostly zeros outside of what the action touched.
+  //! Data is handled as 32 bits words, sizes must be multiples of 4.
+  class ActionDelta
+  {
+  public:
+    ActionDelta(MapChunk* chunk, std::vector<std::uint8_t> pre);
+
+    [[nodiscard]]
+    MapChunk* chunk() const { return _chunk; }
+
+    //! the unpacked pre state, only available until finish()
+    [[nodiscard]]
+    std::uint8_t* pre_data();
+
+    void finish(std::vector<std::uint8_t> const& post);
+
+    [[nodiscard]]
+    std::vector<std::uint8_t> state(bool post) const;
+
+    [[nodiscard]]
+    std::size_t memory_usage() const;
+
+  private:
+    MapChunk* _chunk;
+    std::vector<std::uint8_t> _pre;
+    std::vector<std::uint8_t> _post;
+    std::size_t _pre_size;
+    std::size_t _post_size = 0;
+    bool _finished = false;
+  };
+}
@@ -2,10 +2,18 @@
 
 #include "ActionManager.hpp"
 #include <noggit/MapView.h>
+#include <QSettings>
+#include <algorithm>
 #include <cmath>
 
 using namespace Noggit;
 
+ActionManager::ActionManager() : QObject()
+{
+  QSettings settings;
+  _memory_budget = static_cast<std::size_t>(std::max(settings.value("undo_memory_budget", 512).toInt(), 0)) * 1024 * 1024;
+}
+
 std::deque<Action*>* ActionManager::getActionStack()
 {
   return &_action_stack;
@@ -36,14 +44,39 @@ void ActionManager::setCurrentAction(unsigned index)
 }
 
 
-void ActionManager::setLimit(unsigned limit)
+void ActionManager::setMemoryBudget(std::size_t budget)
+{
+  _memory_budget = budget;
+  enforceMemoryBudget();
+}
+
+std::size_t ActionManager::memoryBudget() const
+{
+  return _memory_budget;
+}
+
+std::size_t ActionManager::memoryUsage() const
 {
-  _limit = limit;
+  return _memory_usage;
 }
 
-unsigned ActionManager::limit() const
+void ActionManager::deleteAction(Action* action)
 {
-  return _limit;
+  _memory_usage -= action->memoryUsage();
+  delete action;
+}
+
+void ActionManager::enforceMemoryBudget()
+{
+  // always keep the last action, and never drop one that can still be redone or is running
+  while (_memory_usage > _memory_budget
+    && _action_stack.size() > _undo_index + 1
+    && _action_stack.front() != _cur_action)
+  {
+    deleteAction(_action_stack.front());
+    _action_stack.pop_front();
+    emit popFront();
+  }
 }
 
 void ActionManager::purge()
@@ -53,6 +86,7 @@ void ActionManager::purge()
     delete action;
   }
   _action_stack.clear();
+  _memory_usage = 0;
   _undo_index = 0;
   emit purged();
 }
@@ -71,21 +105,12 @@ Action* ActionManager::beginAction(MapView* map_view
     {
       for (unsigned i = 0; i < _undo_index; ++i)
       {
-        delete _action_stack.back();
+        deleteAction(_action_stack.back());
         _action_stack.pop_back();
         emit popBack();
       }
       _undo_index = 0;
     }
-
-    // prevent undo stack overflow
-    if (_action_stack.size() == _limit)
-    {
-      Action* old_action = _action_stack.front();
-      delete old_action;
-      _action_stack.pop_front();
-      emit popFront();
-    }
   }
 
   auto action = new Action(map_view);
@@ -108,6 +133,7 @@ void ActionManager::endAction()
   _cur_action->finish();
   if (!(_cur_action->getFlags() & eDO_NOT_WRITE_HISTORY))
   {
+    _memory_usage += _cur_action->memoryUsage();
     emit addedAction(_cur_action);
   }
   else
@@ -117,6 +143,7 @@ void ActionManager::endAction()
 
   emit onActionEnd(_cur_action);
   _cur_action = nullptr;
+  enforceMemoryBudget();
   emit currentActionChanged(_undo_index);
 }
 
@@ -133,6 +160,7 @@ void ActionManager::endActionOnModalityMismatch(unsigned modality_controls)
     _cur_action->finish();
     if (!(_cur_action->getFlags() & eDO_NOT_WRITE_HISTORY))
     {
+      _memory_usage += _cur_action->memoryUsage();
       emit addedAction(_cur_action);
     }
     else
@@ -140,6 +168,7 @@ void ActionManager::endActionOnModalityMismatch(unsigned modality_controls)
       _action_stack.pop_back();
     }
     _cur_action = nullptr;
+    enforceMemoryBudget();
     emit currentActionChanged(_undo_index);
   }
 }
@@ -4,6 +4,7 @@
 #define NOGGITQT_ACTIONMANAGER_HPP
 
 #include <QObject>
+#include <cstddef>
 #include <deque>
 #include <stdexcept>
 #include <noggit/Action.hpp>
@@ -40,12 +41,16 @@ namespace Noggit
 
         void endActionOnModalityMismatch(unsigned modality_controls);
 
-        void setLimit(unsigned limit);
+        //! the oldest actions are dropped once the history takes more than budget bytes
+        void setMemoryBudget(std::size_t budget);
 
         void purge();
 
         [[nodiscard]]
-        unsigned limit() const;
+        std::size_t memoryBudget() const;
+
+        [[nodiscard]]
+        std::size_t memoryUsage() const;
 
         void undo();
         void redo();
@@ -63,10 +68,14 @@ namespace Noggit
 
 
     private:
-        ActionManager() : QObject() {}
+        ActionManager();
+
+        void enforceMemoryBudget();
+        void deleteAction(Action* action);
 
         std::deque<Action*> _action_stack;
-        unsigned _limit = 30;
+        std::size_t _memory_budget; // bytes
+        std::size_t _memory_usage = 0;
         Action* _cur_action = nullptr;
         unsigned _undo_index = 0;
 
@@ -6,6 +6,8 @@
 #include <opengl/context.inl>
 #include <ClientFile.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <optional>
 
 Alphamap::Alphamap()
@@ -14,9 +16,8 @@ Alphamap::Alphamap()
 }
 
 Alphamap::Alphamap(BlizzardArchive::ClientFile *f, unsigned int flags, bool use_big_alphamaps, bool do_not_fix_alpha_map)
+  : _do_not_fix_alpha_map(do_not_fix_alpha_map)
 {
-  createNew();
-
   if (use_big_alphamaps)
   {
     // can only compress big alpha
@@ -31,10 +32,16 @@ Alphamap::Alphamap(BlizzardArchive::ClientFile *f, unsigned int flags, bool use_
   }    
   else
   {
-    readNotCompressed(f, do_not_fix_alpha_map);
+    readNotCompressed(f);
   }
 }
 
+Alphamap::Alphamap(Alphamap const& other)
+  : _decoded(true)
+  , _amap(std::make_unique<std::array<uint8_t, 64 * 64>>(other.values()))
+{
+}
+
 namespace
 {
   struct compressed_mcal_entry
@@ -53,9 +60,53 @@ namespace
 
 void Alphamap::readCompressed(BlizzardArchive::ClientFile *f)
 {
-  // compressed
+  // compressed, only the size of the layer is looked for here
+  char const* begin = f->getPointer();
+  char const* input = begin;
+
+  for (std::size_t offset_output(0); offset_output < 4096;)
+  {
+    compressed_mcal_entry const* e = reinterpret_cast<compressed_mcal_entry const*>(input);
+
+    int count = std::min(static_cast<int>(e->count), static_cast<int>(4096 - offset_output));
+
+    ++input;
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    input += e->mode == compressed_mcal_entry::fill ? 1 : count;
+    offset_output += count;
+  }
+
+  _encoding = encoding::compressed;
+  _encoded.assign(begin, input);
+}
+
+void Alphamap::readBigAlpha(BlizzardArchive::ClientFile *f)
+{
+  // already the decoded values, nothing to save by waiting
+  _amap = std::make_unique<std::array<uint8_t, 64 * 64>>();
+  memcpy(_amap->data(), f->getPointer(), 64 * 64);
+  _decoded = true;
+  f->seekRelative(0x1000);
+}
+
+void Alphamap::readNotCompressed(BlizzardArchive::ClientFile *f)
+{
   char const* input = f->getPointer();
 
+  _encoding = encoding::not_compressed;
+  _encoded.assign(input, input + 0x800);
+  f->seekRelative(0x800);
+}
+
+void Alphamap::decodeCompressed(uint8_t* amap) const
+{
+  uint8_t const* input = _encoded.data();
+
   for (std::size_t offset_output(0); offset_output < 4096;)
   {
     compressed_mcal_entry const* e = reinterpret_cast<compressed_mcal_entry const*>(input);
@@ -90,12 +141,6 @@ void Alphamap::readCompressed(BlizzardArchive::ClientFile *f)
   }
 }
 
-void Alphamap::readBigAlpha(BlizzardArchive::ClientFile *f)
-{
-  memcpy(amap, f->getPointer(), 64 * 64);
-  f->seekRelative(0x1000);
-}
-
 namespace
 {
     struct alpha_4_4
@@ -106,9 +151,9 @@ namespace
 }
 
 
-void Alphamap::readNotCompressed(BlizzardArchive::ClientFile *f, bool do_not_fix_alpha_map)
+void Alphamap::decodeNotCompressed(uint8_t* amap) const
 {
-  alpha_4_4 const* abuf = reinterpret_cast<alpha_4_4 const*>(f->getPointer());
+  alpha_4_4 const* abuf = reinterpret_cast<alpha_4_4 const*>(_encoded.data());
 
   for (std::size_t x(0); x < 64; ++x)
   {
@@ -120,7 +165,7 @@ void Alphamap::readNotCompressed(BlizzardArchive::ClientFile *f, bool do_not_fix
     }
   }
 
-  if (!do_not_fix_alpha_map)
+  if (!_do_not_fix_alpha_map)
   {
     for (std::size_t i(0); i < 64; ++i)
     {
@@ -129,37 +174,80 @@ void Alphamap::readNotCompressed(BlizzardArchive::ClientFile *f, bool do_not_fix
     }
     amap[63 * 64 + 63] = amap[62 * 64 + 62];
   }
-  f->seekRelative(0x800);
 }
 
 void Alphamap::createNew()
 {
-  memset(amap, 0, 64 * 64);
+  _amap = std::make_unique<std::array<uint8_t, 64 * 64>>();
+  _amap->fill(0);
+  _decoded = true;
+}
+
+std::array<uint8_t, 64 * 64>& Alphamap::values() const
+{
+  if (_decoded.load(std::memory_order_acquire))
+  {
+    return *_amap;
+  }
+
+  std::lock_guard<std::mutex> const lock(_decode_mutex);
+
+  if (!_amap)
+  {
+    auto amap = std::make_unique<std::array<uint8_t, 64 * 64>>();
+    amap->fill(0);
+
+    if (_encoding == encoding::compressed)
+    {
+      decodeCompressed(amap->data());
+    }
+    else
+    {
+      decodeNotCompressed(amap->data());
+    }
+
+    _amap = std::move(amap);
+
+    // the decoded values are the only source of truth from now on
+    _encoded.clear();
+    _encoded.shrink_to_fit();
+
+    _decoded.store(true, std::memory_order_release);
+  }
+
+  return *_amap;
 }
 
 void Alphamap::setAlpha(size_t offset, unsigned char value)
 {
-  amap[offset] = value;
+  values()[offset] = value;
 }
 
 void Alphamap::setAlpha(unsigned char *pAmap)
 {
-  memcpy(amap, pAmap, 64*64);
+  memcpy(values().data(), pAmap, 64*64);
 }
 
 unsigned char Alphamap::getAlpha(size_t offset) const
 {
-  return amap[offset];
+  return values()[offset];
 }
 
 const unsigned char *Alphamap::getAlpha()
 {
-  return amap;
+  return values().data();
+}
+
+std::size_t Alphamap::memoryUsage() const
+{
+  std::lock_guard<std::mutex> const lock(_decode_mutex);
+  return sizeof(Alphamap) + _encoded.capacity() + (_amap ? sizeof(*_amap) : 0);
 }
 
 std::vector<uint8_t> Alphamap::compress() const
 {
-  std::vector<uint8_t> data(amap, amap+4096);
+  auto const& amap = values();
+  std::vector<uint8_t> data(amap.begin(), amap.end());
   auto current (data.begin());
   auto const end (data.end());
   int column_pos = 0;
@@ -2,7 +2,11 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace BlizzardArchive
@@ -16,7 +20,11 @@ class Alphamap
 {
 public:
   Alphamap();
+  //! Keeps the MCAL of the layer as read from the file, it's only decoded the
+  //! first time the values are needed (rendering, editing or saving).
   Alphamap(BlizzardArchive::ClientFile* f, unsigned int flags, bool use_big_alphamaps, bool do_not_fix_alpha_map);
+  Alphamap(Alphamap const& other);
+  Alphamap& operator= (Alphamap const&) = delete;
 
   void setAlpha(size_t offset, unsigned char value);
   void setAlpha(unsigned char *pAmap);
@@ -29,12 +37,34 @@ public:
   [[nodiscard]]
   std::vector<uint8_t> compress() const;
 
+  //! bytes of the encoded or decoded values
+  std::size_t memoryUsage() const;
+
 private:
+  enum class encoding
+  {
+    compressed,
+    not_compressed,
+  };
+
   void readCompressed(BlizzardArchive::ClientFile *f);
   void readBigAlpha(BlizzardArchive::ClientFile *f);
-  void readNotCompressed(BlizzardArchive::ClientFile *f, bool do_not_fix_alpha_map);
+  void readNotCompressed(BlizzardArchive::ClientFile *f);
+
+  void decodeCompressed(uint8_t* amap) const;
+  void decodeNotCompressed(uint8_t* amap) const;
 
   void createNew(); 
 
-  uint8_t amap[64 * 64];
+  //! decodes the values the first time, safe to call from several threads
+  std::array<uint8_t, 64 * 64>& values() const;
+
+  // chunks are saved and exported on worker threads, the first access can come from any of them
+  std::atomic<bool> mutable _decoded = false;
+  std::mutex mutable _decode_mutex;
+  // MCAL as read from the file, empty once decoded
+  std::vector<uint8_t> mutable _encoded;
+  encoding _encoding = encoding::compressed;
+  bool _do_not_fix_alpha_map = false;
+  std::unique_ptr<std::array<uint8_t, 64 * 64>> mutable _amap;
 };
@@ -3,8 +3,8 @@
 #pragma once
 #include <noggit/ModelHeaders.h>
 #include <math/interpolation.hpp>
+#include <algorithm>
 #include <cassert>
-#include <map>
 #include <vector>
 #include <memory>
 #include <type_traits>
@@ -58,6 +58,10 @@ namespace Animation
   //! \note AnimatedType is the type of data getting animated.
   //! \note DataType is the type of data stored.
   //! \note The conversion from DataType to AnimatedType is done via Animation::Conversion.
+  //! \note The tracks of every animation are baked at load into flat arrays, keyframes
+  //! are found with a binary search unless the one of the previous lookup still applies.
+  //! Looking up a value moves that cursor, a value must not be evaluated from two
+  //! threads at once.
   template<class AnimatedType, class DataType = AnimatedType>
   class M2Value
   {
@@ -65,9 +69,6 @@ namespace Animation
     typedef uint32_t TimestampType;
     typedef uint32_t AnimationIdType;
 
-    typedef std::vector<AnimatedType> AnimatedTypeVectorType;
-    typedef std::vector<TimestampType> TimestampTypeVectorType;
-
     Animation::Conversion<DataType, AnimatedType> _conversion;
 
     static const int32_t NO_GLOBAL_SEQUENCE = -1;
@@ -76,22 +77,73 @@ namespace Animation
 
     Animation::Interpolation::Type::Type_t _interpolationType;
 
-    std::map<AnimationIdType, TimestampTypeVectorType> times;
-    std::map<AnimationIdType, AnimatedTypeVectorType> data;
-
-    // for nonlinear interpolations:
-    std::map<AnimationIdType, AnimatedTypeVectorType> in;
-    std::map<AnimationIdType, AnimatedTypeVectorType> out;
-
-  public:
-    bool uses(AnimationIdType anim)
+    //! slices of the flat arrays holding the keyframes of one animation
+    struct Track
+    {
+      uint32_t firstTime = 0;
+      uint32_t timeCount = 0;
+      uint32_t firstKey = 0;
+      uint32_t keyCount = 0;
+    };
+
+    std::vector<Track> _tracks;
+    std::vector<TimestampType> _times;
+    std::vector<AnimatedType> _data;
+
+    // for nonlinear interpolations, indexed like _data:
+    std::vector<AnimatedType> _in;
+    std::vector<AnimatedType> _out;
+
+    // keyframe found by the last lookup, animations rarely skip
+    // more than one keyframe between two frames
+    AnimationIdType _cursorAnimation = 0;
+    uint32_t _cursor = 0;
+
+    Track const* track(AnimationIdType anim) const
     {
       if (_globalSequenceID != NO_GLOBAL_SEQUENCE)
       {
         anim = AnimationIdType();
       }
 
-      return !data[anim].empty();
+      return anim < _tracks.size() ? &_tracks[anim] : nullptr;
+    }
+
+    //! \returns the last keyframe at or before time, the first one when there is none
+    uint32_t keyframe(AnimationIdType anim, TimestampType const* timestamps, uint32_t count, TimestampType time)
+    {
+      auto const covers = [&] (uint32_t pos)
+      {
+        return timestamps[pos] <= time && (pos + 1 == count || time < timestamps[pos + 1]);
+      };
+
+      if (_cursorAnimation == anim && _cursor < count)
+      {
+        if (covers(_cursor))
+        {
+          return _cursor;
+        }
+
+        if (_cursor + 1 < count && covers(_cursor + 1))
+        {
+          return ++_cursor;
+        }
+      }
+
+      TimestampType const* next = std::upper_bound(timestamps, timestamps + count, time);
+
+      _cursorAnimation = anim;
+      _cursor = next == timestamps ? 0 : static_cast<uint32_t>(next - timestamps - 1);
+
+      return _cursor;
+    }
+
+  public:
+    bool uses(AnimationIdType anim) const
+    {
+      Track const* t = track(anim);
+
+      return t && t->keyCount;
     }
 
     AnimatedType getValue (AnimationIdType anim, TimestampType time, int animtime)
@@ -109,86 +161,82 @@ namespace Animation
         anim = AnimationIdType();
       }
 
-      TimestampTypeVectorType& timestampVector = times[anim];
-      AnimatedTypeVectorType& dataVector = data[anim];
-      AnimatedTypeVectorType& inVector = in[anim];
-      AnimatedTypeVectorType& outVector = out[anim];
+      Track const* t = track(anim);
 
-      if (dataVector.empty())
+      if (!t || !t->keyCount)
       {
         return AnimatedType();
       }
 
-      AnimatedType result = dataVector[0];
+      AnimatedType const* keys = _data.data() + t->firstKey;
 
-      if (!timestampVector.empty())
+      if (!t->timeCount)
       {
-        TimestampType max_time = timestampVector.back();
-        if (max_time > 0)
-        {
-          time %= max_time;
-        }
-        else
-        {
-          time = TimestampType();
-        }
+        return keys[0];
+      }
 
-        size_t pos = 0;
-        for (size_t i = 0; i < timestampVector.size() - 1; ++i)
-        {
-          if (time >= timestampVector[i] && time < timestampVector[i + 1])
-          {
-            pos = i;
-            break;
-          }
-        }
+      TimestampType const* timestamps = _times.data() + t->firstTime;
+      TimestampType const max_time = timestamps[t->timeCount - 1];
+
+      if (max_time > 0)
+      {
+        time %= max_time;
+      }
+      else
+      {
+        time = TimestampType();
+      }
+
+      uint32_t const count = std::min(t->timeCount, t->keyCount);
+      uint32_t const pos = keyframe(anim, timestamps, count, time);
+
+      if ( pos + 1 >= count
+        || time < timestamps[pos]
+        || _interpolationType == Animation::Interpolation::Type::NONE
+         )
+      {
+        return keys[pos];
+      }
 
-        if (pos == timestampVector.size() - 1 || _interpolationType == Animation::Interpolation::Type::NONE)
+      TimestampType t1 = timestamps[pos];
+      TimestampType t2 = timestamps[pos + 1];
+      const float percentage = (time - t1) / static_cast<float>(t2 - t1);
+
+      switch (_interpolationType)
+      {
+      case Animation::Interpolation::Type::LINEAR:
+      {
+        //return math::interpolation::linear (percentage, keys[pos], keys[pos + 1]);
+        if constexpr (std::is_same_v<AnimatedType, glm::quat>)
         {
-          result = dataVector[pos];
+          return glm::slerp(keys[pos], keys[pos + 1], percentage);
         }
         else
         {
-
-          TimestampType t1 = timestampVector[pos];
-          TimestampType t2 = timestampVector[pos + 1];
-          const float percentage = (time - t1) / static_cast<float>(t2 - t1);
-
-          switch (_interpolationType)
-          {
-          case Animation::Interpolation::Type::LINEAR:
-          {
-            //result = math::interpolation::linear (percentage, dataVector[pos], dataVector[pos + 1]);
-            if constexpr (std::is_same_v<AnimatedType, glm::quat>)
-            {
-              result = glm::slerp(dataVector[pos], dataVector[pos + 1], percentage);
-            }
-            else
-            {
-              result = glm::mix(dataVector[pos], dataVector[pos + 1], percentage);
-            }
-           
-          }
-            break;
-
-          case Animation::Interpolation::Type::HERMITE:
-          {
-            result = math::interpolation::hermite(percentage, dataVector[pos], dataVector[pos + 1], inVector[pos], outVector[pos]);
-          }
-            break;
-          }
+          return glm::mix(keys[pos], keys[pos + 1], percentage);
         }
       }
 
-      return result;
+      case Animation::Interpolation::Type::HERMITE:
+      {
+        return math::interpolation::hermite ( percentage, keys[pos], keys[pos + 1]
+                                            , _in[t->firstKey + pos], _out[t->firstKey + pos]
+                                            );
+      }
+      }
+
+      return keys[pos];
     }
 
     //! \todo Use a vector of BlizzardArchive::ClientFile& for the anim files instead for safety.
+    //! \note File is BlizzardArchive::ClientFile, or anything with the same get<T>(offset),
+    //! the animation-tracks benchmark reads its synthetic tracks from memory.
+    template<class File>
     M2Value (const AnimationBlock& animationBlock
-             , const BlizzardArchive::ClientFile& file
+             , const File& file
              , int32_t* globalSequences
-             , const std::vector<std::unique_ptr<BlizzardArchive::ClientFile>>& animation_files
-             = std::vector<std::unique_ptr<BlizzardArchive::ClientFile>>())
+             , const std::vector<std::unique_ptr<File>>& animation_files
+             = std::vector<std::unique_ptr<File>>())
     {
       assert(animationBlock.nTimes == animationBlock.nKeys);
 
@@ -201,26 +249,51 @@ namespace Animation
         assert(_globalSequences && "Animation said to have global sequence, but pointer to global sequence data is nullptr");
       }
 
-      const AnimationBlockHeader* timestampHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsTimes);
-      const AnimationBlockHeader* keyHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsKeys);
+      const AnimationBlockHeader* timestampHeaders = file.template get<AnimationBlockHeader>(animationBlock.ofsTimes);
+      const AnimationBlockHeader* keyHeaders = file.template get<AnimationBlockHeader>(animationBlock.ofsKeys);
+
+      _tracks.resize(std::max(animationBlock.nTimes, animationBlock.nKeys));
+
+      std::size_t time_total = 0;
+      std::size_t key_total = 0;
+
+      for (std::uint32_t j = 0; j < animationBlock.nTimes; ++j)
+      {
+        time_total += timestampHeaders[j].nEntries;
+      }
+      for (std::uint32_t j = 0; j < animationBlock.nKeys; ++j)
+      {
+        key_total += keyHeaders[j].nEntries;
+      }
+
+      _times.reserve(time_total);
+      _data.reserve(key_total);
+
+      if (_interpolationType == Animation::Interpolation::Type::HERMITE)
+      {
+        _in.reserve(key_total);
+        _out.reserve(key_total);
+      }
 
       for (std::uint32_t j = 0; j < animationBlock.nTimes; ++j)
       {
         const TimestampType* timestamps = j < animation_files.size() && animation_files[j] ?
-          animation_files[j]->get<TimestampType>(timestampHeaders[j].ofsEntries) :
-          file.get<TimestampType>(timestampHeaders[j].ofsEntries);
+          animation_files[j]->template get<TimestampType>(timestampHeaders[j].ofsEntries) :
+          file.template get<TimestampType>(timestampHeaders[j].ofsEntries);
 
-        for (std::uint32_t i = 0; i < timestampHeaders[j].nEntries; ++i)
-        {
-          times[j].push_back(timestamps[i]);
-        }
+        _tracks[j].firstTime = static_cast<uint32_t>(_times.size());
+        _tracks[j].timeCount = timestampHeaders[j].nEntries;
+        _times.insert(_times.end(), timestamps, timestamps + timestampHeaders[j].nEntries);
       }
 
       for (std::uint32_t j = 0; j < animationBlock.nKeys; ++j)
       {
         const DataType* keys = j < animation_files.size() && animation_files[j] ?
-          animation_files[j]->get<DataType>(keyHeaders[j].ofsEntries) :
-          file.get<DataType>(keyHeaders[j].ofsEntries);
+          animation_files[j]->template get<DataType>(keyHeaders[j].ofsEntries) :
+          file.template get<DataType>(keyHeaders[j].ofsEntries);
+
+        _tracks[j].firstKey = static_cast<uint32_t>(_data.size());
+        _tracks[j].keyCount = keyHeaders[j].nEntries;
 
         switch (_interpolationType)
         {
@@ -228,16 +301,16 @@ namespace Animation
         case Animation::Interpolation::Type::LINEAR:
           for (std::uint32_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i]));
+            _data.push_back(_conversion(keys[i]));
           }
           break;
 
         case Animation::Interpolation::Type::HERMITE:
           for (std::uint32_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i * 3]));
-            in[j].push_back(_conversion(keys[i * 3 + 1]));
-            out[j].push_back(_conversion(keys[i * 3 + 2]));
+            _data.push_back(_conversion(keys[i * 3]));
+            _in.push_back(_conversion(keys[i * 3 + 1]));
+            _out.push_back(_conversion(keys[i * 3 + 2]));
           }
           break;
         }
@@ -246,30 +319,18 @@ namespace Animation
 
     void apply(AnimatedType function(const AnimatedType))
     {
-      switch (_interpolationType)
+      for (AnimatedType& value : _data)
       {
-      case Animation::Interpolation::Type::NONE:
-      case Animation::Interpolation::Type::LINEAR:
-        for (std::uint32_t i = 0; i < data.size(); ++i)
-        {
-          for (std::uint32_t j = 0; j < data[i].size(); ++j)
-          {
-            data[i][j] = function(data[i][j]);
-          }
-        }
-        break;
+        value = function(value);
+      }
 
-      case Animation::Interpolation::Type::HERMITE:
-        for (std::uint32_t i = 0; i < data.size(); ++i)
+      if (_interpolationType == Animation::Interpolation::Type::HERMITE)
+      {
+        for (std::size_t i = 0; i < _in.size(); ++i)
         {
-          for (std::uint32_t j = 0; j < data[i].size(); ++j)
-          {
-            data[i][j] = function(data[i][j]);
-            in[i][j] = function(in[i][j]);
-            out[i][j] = function(out[i][j]);
-          }
+          _in[i] = function(_in[i]);
+          _out[i] = function(_out[i]);
         }
-        break;
       }
     }
   };
@@ -6,14 +6,22 @@
 #include <noggit/AsyncObject.h>
 #include <noggit/errorHandling.h>
 #include <noggit/Log.h>
+#include <external/tracy/Tracy.hpp>
 
 #include <QtCore/QSettings>
 
 #include <algorithm>
+#include <chrono>
 #include <list>
 
 AsyncLoader* AsyncLoader::instance;
 
+namespace
+{
+  // job currently being loaded by this thread, used to attach children to their parent
+  thread_local async_job* current_job = nullptr;
+}
+
 void AsyncLoader::setup(int threads)
 {
   // make sure there's always at least one thread otherwise nothing can load
@@ -22,157 +30,349 @@ void AsyncLoader::setup(int threads)
 
 bool AsyncLoader::is_loading()
 {
-  std::lock_guard<std::mutex> const lock (_guard);
-  return !_currently_loading.empty();
+  return _currently_loading.load() != 0;
 }
 
-void AsyncLoader::process()
+AsyncLoader::job_ptr AsyncLoader::pop_job(std::size_t worker)
 {
-  AsyncObject* object = nullptr;
-
-  QSettings settings;
-  bool additional_log = settings.value("additional_file_loading_log", false).toBool();
+  std::size_t const n_queues = _queues.size();
 
-  while (!_stop)
+  for (std::size_t priority = 0; priority < (size_t)async_priority::count; ++priority)
   {
-    {    
-      std::unique_lock<std::mutex> lock (_guard);
-
-      _state_changed.wait 
-      ( lock
-      , [&]
-        {
-          return !!_stop || std::any_of ( _to_load.begin(), _to_load.end()
-                                        , [](auto const& to_load) { return !to_load.empty(); }
-                                        );
-        }
-      );
-
-      if (_stop)
-      {
-        return;
-      }
+    {
+      auto& own = *_queues[worker];
+      std::lock_guard<std::mutex> const lock (own.guard);
+      auto& jobs = own.jobs[priority];
 
-      for (auto& to_load : _to_load)
+      if (!jobs.empty())
       {
-        if (to_load.empty())
-        {
-          continue;
-        }
-
-        object = to_load.front();
-        _currently_loading.emplace_back (object);
-        to_load.pop_front();
-
-        break;
+        job_ptr job = std::move(jobs.front());
+        jobs.pop_front();
+        return job;
       }
     }
 
-    try
+    for (std::size_t i = 1; i < n_queues; ++i)
     {
-      if (additional_log)
+      auto& victim = *_queues[(worker + i) % n_queues];
+      std::lock_guard<std::mutex> const lock (victim.guard);
+      auto& jobs = victim.jobs[priority];
+
+      if (!jobs.empty())
       {
-        std::lock_guard<std::mutex> const lock(_guard);
-        LogDebug << "Loading file '" << (object->file_key().hasFilepath() ? object->file_key().filepath()
-          : std::to_string(object->file_key().fileDataID()))<< "'" << std::endl;
+        job_ptr job = std::move(jobs.front());
+        jobs.pop_front();
+        _stolen++;
+        return job;
       }
+    }
+  }
 
-      object->finishLoading();
+  return nullptr;
+}
 
-      if (additional_log)
-      {
-        std::lock_guard<std::mutex> const lock(_guard);
-        LogDebug << "Loaded  file '" << (object->file_key().hasFilepath() ? object->file_key().filepath()
-        : std::to_string(object->file_key().fileDataID())) << "'" << std::endl;
-      }
+void AsyncLoader::push_job(job_ptr job)
+{
+  auto& queue = *_queues[_next_queue.fetch_add(1, std::memory_order_relaxed) % _queues.size()];
 
-      {
-        std::lock_guard<std::mutex> const lock (_guard);
-        _currently_loading.remove (object);
-        _state_changed.notify_all();
-      }
+  _queued++;
+
+  {
+    std::lock_guard<std::mutex> const lock (queue.guard);
+    queue.jobs[(size_t)job->priority].emplace_back(std::move(job));
+  }
+
+  _pending.fetch_add(1);
+  _pending.notify_one();
+  _queues_changed = true;
+
+  update_plots();
+}
+
+void AsyncLoader::process(std::size_t worker)
+{
+  QSettings settings;
+  bool additional_log = settings.value("additional_file_loading_log", false).toBool();
+
+  while (!_stop)
+  {
+    std::size_t const pending = _pending.load();
+
+    if (!pending)
+    {
+      _pending.wait(0);
+      continue;
     }
-    catch (BlizzardArchive::Exceptions::FileReadFailedError const&)
+
+    job_ptr job = pop_job(worker);
+
+    if (!job)
     {
-      std::lock_guard<std::mutex> const lock(_guard);
+      // another worker took the job between our load of _pending and the pop
+      std::this_thread::yield();
+      continue;
+    }
 
-      object->error_on_loading();
+    _pending.fetch_sub(1);
+    _queued--;
 
-      if (object->is_required_when_saving())
-      {
-        _important_object_failed_loading = true;
-      }
+    auto expected = async_job_state::queued;
 
-      _currently_loading.remove(object);
-    }
-    catch (...)
+    // the job was cancelled through ensure_deletable, its object may already be gone
+    if (!job->state.compare_exchange_strong(expected, async_job_state::loading))
     {
-      std::lock_guard<std::mutex> const lock(_guard);
+      continue;
+    }
 
-      object->error_on_loading();
-      LogError << "Caught unknown error." << std::endl;
+    _currently_loading++;
 
-      if (object->is_required_when_saving())
-      {
-        _important_object_failed_loading = true;
-      }
+    load(*job, additional_log);
+  }
+}
+
+void AsyncLoader::load(async_job& job, bool additional_log)
+{
+  ZoneScopedN("AsyncLoader::load()");
+
+  AsyncObject* object = job.object;
+  current_job = &job;
+
+  try
+  {
+    if (additional_log)
+    {
+      std::lock_guard<std::mutex> const lock(_log_guard);
+      LogDebug << "Loading file '" << (object->file_key().hasFilepath() ? object->file_key().filepath()
+        : std::to_string(object->file_key().fileDataID()))<< "'" << std::endl;
+    }
+
+    object->finishLoading();
 
-      _currently_loading.remove(object);
+    if (additional_log)
+    {
+      std::lock_guard<std::mutex> const lock(_log_guard);
+      LogDebug << "Loaded  file '" << (object->file_key().hasFilepath() ? object->file_key().filepath()
+      : std::to_string(object->file_key().fileDataID())) << "'" << std::endl;
     }
+
+    current_job = nullptr;
+    finish_job(job, false);
+  }
+  catch (BlizzardArchive::Exceptions::FileReadFailedError const&)
+  {
+    current_job = nullptr;
+    object->error_on_loading();
+    finish_job(job, true);
+  }
+  catch (...)
+  {
+    current_job = nullptr;
+    object->error_on_loading();
+    LogError << "Caught unknown error." << std::endl;
+    finish_job(job, true);
+  }
+}
+
+void AsyncLoader::finish_job(async_job& job, bool failed)
+{
+  if (failed && job.object->is_required_when_saving())
+  {
+    _important_object_failed_loading = true;
   }
+
+  auto const latency = std::chrono::duration_cast<std::chrono::microseconds>
+    (std::chrono::steady_clock::now() - job.queued_at).count();
+
+  _total_latency_us += static_cast<std::uint64_t>(latency);
+  _loaded++;
+  _currently_loading--;
+
+  TracyPlot("AsyncLoader latency (ms)", static_cast<double>(latency) / 1000.0);
+  update_plots();
+
+  // the object may be destroyed as soon as the state leaves `loading`
+  job.state = async_job_state::done;
+  job.state.notify_all();
+  job.complete();
+}
+
+void AsyncLoader::update_plots() const
+{
+  TracyPlot("AsyncLoader queued", static_cast<int64_t>(_queued.load()));
+  TracyPlot("AsyncLoader loading", static_cast<int64_t>(_currently_loading.load()));
 }
 
 void AsyncLoader::queue_for_load (AsyncObject* object)
 {
-  std::lock_guard<std::mutex> const lock (_guard);
-  _to_load[(size_t)object->loading_priority()].push_back (object);
-  _state_changed.notify_one();
+  auto job = std::make_shared<async_job>(object, object->loading_priority());
+
+  {
+    std::lock_guard<std::mutex> const lock (object->_mutex);
+    object->_job = job;
+  }
+
+  if (current_job)
+  {
+    job->score.store(current_job->score.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    job->add_dependent(current_job->children);
+  }
+
+  push_job(std::move(job));
+}
+
+void AsyncLoader::add_child_to_current_job (AsyncObject* object)
+{
+  if (!current_job)
+  {
+    return;
+  }
+
+  std::shared_ptr<async_job> job;
+
+  {
+    std::lock_guard<std::mutex> const lock (object->_mutex);
+    job = object->_job;
+  }
+
+  if (job)
+  {
+    job->add_dependent(current_job->children);
+  }
 }
 
 void AsyncLoader::ensure_deletable (AsyncObject* object)
 {
-  std::unique_lock<std::mutex> lock (_guard);
-  _state_changed.wait
-  ( lock
-  , [&]
+  std::shared_ptr<async_job> job;
+
+  {
+    std::lock_guard<std::mutex> const lock (object->_mutex);
+    job = object->_job;
+  }
+
+  if (!job)
+  {
+    return;
+  }
+
+  // don't load it if it's just to delete it afterward
+  if (job->cancel())
+  {
+    _cancelled++;
+    _queues_changed = true;
+    update_plots();
+    return;
+  }
+
+  job->wait_while_loading();
+}
+
+bool AsyncLoader::cancel (AsyncObject* object)
+{
+  std::shared_ptr<async_job> job;
+
+  {
+    std::lock_guard<std::mutex> const lock (object->_mutex);
+    job = object->_job;
+  }
+
+  if (!job)
+  {
+    return !object->finishedLoading();
+  }
+
+  if (job->cancel())
+  {
+    _cancelled++;
+    _queues_changed = true;
+    return true;
+  }
+
+  return false;
+}
+
+void AsyncLoader::reprioritize(bool rescored)
+{
+  if (!_queues_changed.exchange(false) && !rescored)
+  {
+    return;
+  }
+
+  ZoneScopedN("AsyncLoader::reprioritize()");
+
+  auto const by_score = [] (job_ptr const& a, job_ptr const& b)
+  {
+    return a->score.load(std::memory_order_relaxed) < b->score.load(std::memory_order_relaxed);
+  };
+
+  std::size_t purged = 0;
+
+  for (auto& queue : _queues)
+  {
+    std::lock_guard<std::mutex> const lock (queue->guard);
+
+    for (auto& jobs : queue->jobs)
     {
-      auto& to_load = _to_load[(size_t)object->loading_priority()];
-      auto const& it = std::find (to_load.begin(), to_load.end(), object);
-      
-      // don't load it if it's just to delete it afterward
-      if (it != to_load.end())
+      auto const end = std::remove_if ( jobs.begin(), jobs.end()
+                                      , [] (job_ptr const& job)
+                                        {
+                                          return job->state.load() != async_job_state::queued;
+                                        }
+                                      );
+      purged += static_cast<std::size_t>(std::distance(end, jobs.end()));
+      jobs.erase(end, jobs.end());
+
+      if (!std::is_sorted(jobs.begin(), jobs.end(), by_score))
       {
-        to_load.erase(it);
-        return true;
-      }
-      else
-      {
-        return std::find (_currently_loading.begin(), _currently_loading.end(), object) == _currently_loading.end();
+        std::stable_sort(jobs.begin(), jobs.end(), by_score);
       }
     }
-  );
+  }
+
+  if (purged)
+  {
+    _queued -= purged;
+    _pending -= purged;
+    update_plots();
+  }
+}
+
+AsyncLoader::statistics AsyncLoader::stats() const
+{
+  statistics stats;
+  stats.queued = _queued.load();
+  stats.loading = _currently_loading.load();
+  stats.loaded = _loaded.load();
+  stats.cancelled = _cancelled.load();
+  stats.stolen = _stolen.load();
+  stats.average_latency_ms = stats.loaded ? static_cast<double>(_total_latency_us.load()) / stats.loaded / 1000.0 : 0.0;
+  return stats;
 }
 
 AsyncLoader::AsyncLoader(int numThreads)
   : _stop (false)
 {
   // use half of the available threads
-  // unsigned int maxThreads = std::thread::hardware_concurrency() / 2; 
+  // unsigned int maxThreads = std::thread::hardware_concurrency() / 2;
   // numThreads = maxThreads > numThreads ? maxThreads : numThreads;
 
   for (int i = 0; i < numThreads; ++i)
   {
-    _threads.emplace_back (&AsyncLoader::process, this);
+    _queues.emplace_back(std::make_unique<worker_queue>());
+  }
+
+  for (int i = 0; i < numThreads; ++i)
+  {
+    _threads.emplace_back (&AsyncLoader::process, this, static_cast<std::size_t>(i));
   }
 }
 
 AsyncLoader::~AsyncLoader()
 {
-  {
-    std::unique_lock<std::mutex> lock(_guard);
-    _stop = true;
-  }
-  _state_changed.notify_all();
+  _stop = true;
+
+  // wake up sleeping workers
+  _pending.fetch_add(1);
+  _pending.notify_all();
 
   for (auto& thread : _threads)
   {
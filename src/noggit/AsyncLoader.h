@@ -2,14 +2,18 @@
 
 #pragma once
 
+#include <noggit/async_job.hpp>
 #include <noggit/async_priority.hpp>
 
 #include <array>
 #include <atomic>
-#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 class AsyncObject;
 
@@ -28,12 +32,27 @@ public:
 
   static void setup(int threads);
 
-  //! Ownership is _not_ transferred. Call ensure_deletable to ensure 
+  //! Ownership is _not_ transferred. Call ensure_deletable to ensure
   //! that a previously enqueued object can be destroyed.
+  //! When called while another object is being loaded, the new object
+  //! becomes a child of it (see AsyncObject::wait_for_children).
   void queue_for_load (AsyncObject*);
-  
+
+  //! Registers an already queued object as a child of the object currently
+  //! being loaded on this thread, if any.
+  void add_child_to_current_job (AsyncObject*);
+
   void ensure_deletable (AsyncObject*);
 
+  //! Drops the object from the queues if no worker started loading it yet.
+  //! Never blocks. \returns true if the object will not be loaded.
+  bool cancel (AsyncObject*);
+
+  //! Re-sorts the queued jobs by their current score and purges cancelled ones.
+  //! Meant to be called once per frame after updating the scores, does nothing
+  //! when no score changed and no job was queued or cancelled since last time.
+  void reprioritize(bool rescored);
+
   bool is_loading();
 
   AsyncLoader(int numThreads);
@@ -42,14 +61,54 @@ public:
   bool important_object_failed_loading() const;
   void reset_object_fail();
 
+  struct statistics
+  {
+    std::size_t queued = 0;
+    std::size_t loading = 0;
+    std::uint64_t loaded = 0;
+    std::uint64_t cancelled = 0;
+    std::uint64_t stolen = 0;
+    double average_latency_ms = 0.0;
+  };
+
+  statistics stats() const;
+
 private:
-  void process();
+  using job_ptr = std::shared_ptr<async_job>;
+
+  // each worker owns one queue per priority, it pops from its own queues and
+  // steals from the others' when they are empty. Queues are kept sorted by score
+  // (see reprioritize) so both owner and thieves take the front.
+  struct worker_queue
+  {
+    std::mutex guard;
+    std::array<std::deque<job_ptr>, (size_t)async_priority::count> jobs;
+  };
+
+  void process(std::size_t worker);
+  job_ptr pop_job(std::size_t worker);
+  void push_job(job_ptr job);
+  void load(async_job& job, bool additional_log);
+  void finish_job(async_job& job, bool failed);
+  void update_plots() const;
 
-  std::mutex _guard;
-  std::condition_variable _state_changed;
   std::atomic<bool> _stop;
-  std::array<std::list<AsyncObject*>, (size_t)async_priority::count> _to_load;
-  std::list<AsyncObject*> _currently_loading;
+  std::vector<std::unique_ptr<worker_queue>> _queues;
+  std::atomic<std::size_t> _next_queue = 0;
   std::list<std::thread> _threads;
-  bool _important_object_failed_loading = false;
+
+  // number of jobs sitting in the queues, including cancelled ones not yet skipped,
+  // workers sleep on it when it drops to zero
+  std::atomic<std::size_t> _pending = 0;
+  std::atomic<std::size_t> _queued = 0;
+  std::atomic<std::size_t> _currently_loading = 0;
+  std::atomic<std::uint64_t> _loaded = 0;
+  std::atomic<std::uint64_t> _cancelled = 0;
+  std::atomic<std::uint64_t> _stolen = 0;
+  std::atomic<std::uint64_t> _total_latency_us = 0;
+  //! jobs were queued or cancelled since the last reprioritize
+  std::atomic<bool> _queues_changed = false;
+
+  std::mutex _log_guard;
+  std::atomic<bool> _important_object_failed_loading = false;
 };
@@ -5,6 +5,15 @@
 
  AsyncObject::AsyncObject(BlizzardArchive::Listfile::FileKey file_key) : _file_key(std::move(file_key)) {}
 
+ AsyncObject::~AsyncObject()
+{
+  // never let a worker pick up an object that no longer exists
+  if (_job)
+  {
+    _job->cancel();
+  }
+}
+
 [[nodiscard]]
  BlizzardArchive::Listfile::FileKey const& AsyncObject::file_key() const
 {
@@ -41,6 +50,33 @@
   );
 }
 
+ void AsyncObject::wait_for_children()
+{
+  std::shared_ptr<async_job> job;
+
+  {
+    std::lock_guard<std::mutex> const lock(_mutex);
+    job = _job;
+  }
+
+  if (job)
+  {
+    job->children->wait();
+  }
+}
+
+ bool AsyncObject::set_loading_score(float score)
+{
+  std::lock_guard<std::mutex> const lock(_mutex);
+
+  if (!_job || _job->state.load() != async_job_state::queued)
+  {
+    return false;
+  }
+
+  return _job->score.exchange(score, std::memory_order_relaxed) != score;
+}
+
  void AsyncObject::error_on_loading()
 {
   LogError << "File " << (_file_key.hasFilepath() ? _file_key.filepath() : std::to_string(_file_key.fileDataID()))
@@ -2,18 +2,25 @@
 
 #pragma once
 
+#include <noggit/async_job.hpp>
 #include <noggit/async_priority.hpp>
 #include <Listfile.hpp>
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 
 class AsyncObject
 {
+  friend class AsyncLoader;
+
 private: 
   bool _loading_failed = false;
 
+  //! set by AsyncLoader::queue_for_load, guarded by _mutex
+  std::shared_ptr<async_job> _job;
+
 protected:
   std::atomic<bool> finished = {false};
   std::mutex _mutex;
@@ -29,7 +36,7 @@ public:
   BlizzardArchive::Listfile::FileKey const& file_key() const;
 
   AsyncObject() = delete;
-  virtual ~AsyncObject() = default;
+  virtual ~AsyncObject();
 
   [[nodiscard]]
   virtual bool finishedLoading() const;
@@ -39,6 +46,9 @@ public:
 
   void wait_until_loaded();
 
+  //! Blocks until every object queued while this one was loading is loaded.
+  void wait_for_children();
+
   void error_on_loading();
 
   [[nodiscard]]
@@ -47,6 +57,10 @@ public:
   [[nodiscard]]
   virtual async_priority loading_priority() const;
 
+  //! Orders queued objects of the same priority, lower loads first.
+  //! Has no effect once loading started. \returns whether a queued job got a new score.
+  bool set_loading_score(float score);
+
   virtual void finishLoading() = 0;
   virtual void waitForChildrenLoaded() = 0;
 };
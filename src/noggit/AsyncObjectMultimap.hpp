@@ -4,29 +4,30 @@
 #include <noggit/AsyncLoader.h>
 #include <noggit/AsyncObject.h>
 #include <noggit/ContextObject.hpp>
+#include <noggit/file_key_interner.hpp>
 #include <noggit/Model.h>
+#include <util/hash.hpp>
+#include <util/thread_pool.hpp>
 
 #include <Listfile.hpp>
 
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <unordered_map>
-
-struct pair_hash
-{
-  std::size_t operator() (const std::pair<int, BlizzardArchive::Listfile::FileKey> &p) const noexcept
-  {
-    auto h1 = std::hash<int>{}(p.first);
-    auto h2 = std::hash<std::string>{}(p.second.hasFilepath() ? p.second.filepath() : "");
-    auto h3 = std::hash<int>{}(p.second.fileDataID());
-
-    return h1 ^ h2 ^ h3;
-  }
-};
+#include <utility>
+#include <vector>
 
 namespace Noggit
 {
 
+  //! Reference counted assets, one per interned file key and render context.
+  //! Elements are spread over shards with their own lock so that references
+  //! taken from different threads rarely contend.
   template<typename T>
   struct AsyncObjectMultimap
   {
@@ -44,109 +45,201 @@ namespace Noggit
     }
 
     template<typename... Args>
-      T* emplace (BlizzardArchive::Listfile::FileKey const& file_key, Noggit::NoggitRenderContext context, Args&&... args)
+      T* emplace (file_key_id file_key, Noggit::NoggitRenderContext context, Args&&... args)
     {
-      std::scoped_lock const lock(_mutex);
-      auto pair = std::make_pair(context, file_key);
+      std::uint64_t const key = make_key(file_key, context);
+      shard& s = shard_of(key);
+
+      std::scoped_lock const lock(s.mutex);
       //LogDebug << "Emplacing " << normalized << " into context" << context << std::endl;
 
+      if (auto it = s.elements.find(key); it != s.elements.end())
       {
-        if ([&] { return _counts[pair]++; }())
+        it->second.count++;
+        T* const existing = &it->second.object;
+
+        if (!existing->finishedLoading())
         {
-          return &_elements.at (pair);
+          AsyncLoader::instance->add_child_to_current_job(static_cast<AsyncObject*>(existing));
         }
+
+        return existing;
       }
 
-      T* const obj ( [&]
-                     {
-                       return &_elements.emplace ( std::piecewise_construct
-                                                 , std::forward_as_tuple (pair)
-                                                 , std::forward_as_tuple (file_key.filepath(), context, args...)
-                                                 ).first->second;
-                     }()
-                   );
+      T* const obj = &s.elements.emplace ( std::piecewise_construct
+                                         , std::forward_as_tuple (key)
+                                         , std::forward_as_tuple (file_key_interner::instance().key(file_key).filepath(), context, args...)
+                                         ).first->second.object;
 
       AsyncLoader::instance->queue_for_load(static_cast<AsyncObject*>(obj));
 
-      return obj; 
+      return obj;
     }
-    void erase (BlizzardArchive::Listfile::FileKey const& file_key, Noggit::NoggitRenderContext context)
+    void erase (file_key_id file_key, Noggit::NoggitRenderContext context)
     {
-      auto pair = std::make_pair(context, file_key);
+      std::uint64_t const key = make_key(file_key, context);
+      shard& s = shard_of(key);
       //LogDebug << "Erasing " << normalized << " from context" << context << std::endl;
 
-      AsyncObject* obj = nullptr;
+      typename element_map::node_type node;
 
       {
-        std::scoped_lock lock(_mutex);
+        std::scoped_lock lock(s.mutex);
 
-        if (--_counts.at(pair) == 0)
+        auto it = s.elements.find(key);
+        assert(it != s.elements.end());
+
+        if (--it->second.count == 0)
         {
-          obj = static_cast<AsyncObject*>(&(_elements.at(pair)));
+          // taken out of the map right away, a new reference to the same file
+          // gets a fresh object instead of one that is being deleted
+          node = s.elements.extract(it);
         }
       }
 
-      if (obj)
+      if (node)
       {
+        AsyncObject* obj = static_cast<AsyncObject*>(&node.mapped().object);
+
         // always make sure an async object can be deleted before deleting it
         if (!obj->finishedLoading())
         {
           AsyncLoader::instance->ensure_deletable(obj);
         }
+      }
+    }
+    void apply (std::function<void (BlizzardArchive::Listfile::FileKey const&, T&)> fun)
+    {
+      for (shard& s : _shards)
+      {
+        std::scoped_lock lock(s.mutex);
 
+        for (auto& element : s.elements)
         {
-          std::scoped_lock lock(_mutex);
-          _elements.erase(pair);
-          _counts.erase(pair);
+          fun (file_key_interner::instance().key(file_key_of(element.first)), element.second.object);
         }
       }
     }
-    void apply (std::function<void (BlizzardArchive::Listfile::FileKey const&, T&)> fun)
+    void apply (std::function<void (BlizzardArchive::Listfile::FileKey const&, T const&)> fun) const
     {
-      std::scoped_lock lock(_mutex);
-
-      for (auto& element : _elements)
+      for (shard const& s : _shards)
       {
-        fun (element.first.second, element.second);
+        std::scoped_lock lock(s.mutex);
+
+        for (auto const& element : s.elements)
+        {
+          fun (file_key_interner::instance().key(file_key_of(element.first)), element.second.object);
+        }
       }
     }
-    void apply (std::function<void (BlizzardArchive::Listfile::FileKey const&, T const&)> fun) const
+
+    //! Calls fun on the thread pool for every element. Every shard stays locked
+    //! until all of them are done so that no element is freed meanwhile, fun
+    //! must only touch the element it is given and not take references.
+    void parallel_apply (std::function<void (T&)> const& fun)
     {
-      std::scoped_lock lock(_mutex);
-      for (auto const& element : _elements)
+      std::array<std::unique_lock<std::mutex>, shard_count> locks;
+      std::vector<T*> objects;
+
+      // always in the same order, the other functions only lock one shard at a time
+      for (std::size_t i = 0; i < shard_count; ++i)
       {
-        fun (element.first.second, element.second);
+        locks[i] = std::unique_lock<std::mutex>(_shards[i].mutex);
+
+        for (auto& element : _shards[i].elements)
+        {
+          objects.push_back(&element.second.object);
+        }
       }
+
+      util::thread_pool::instance().parallel_for(objects.size(), [&] (std::size_t i)
+      {
+        fun(*objects[i]);
+      });
     }
 
     void context_aware_apply(std::function<void (BlizzardArchive::Listfile::FileKey const&, T&)> fun, Noggit::NoggitRenderContext context)
     {
-      std::scoped_lock lock(_mutex);
-
-      for (auto& element : _elements)
+      for (shard& s : _shards)
       {
-        if (element.first.first != context)
-          continue;
+        std::scoped_lock lock(s.mutex);
+
+        for (auto& element : s.elements)
+        {
+          if (context_of(element.first) != context)
+            continue;
 
-        fun (element.first.second, element.second);
+          fun (file_key_interner::instance().key(file_key_of(element.first)), element.second.object);
+        }
       }
     }
     void context_aware_apply(std::function<void (BlizzardArchive::Listfile::FileKey const&, T const&)> fun, Noggit::NoggitRenderContext context) const
     {
-      std::scoped_lock lock(_mutex);
-      for (auto const& element : _elements)
+      for (shard const& s : _shards)
       {
-        if (element.first.first != context)
-          continue;
+        std::scoped_lock lock(s.mutex);
 
-        fun (element.first.second, element.second);
+        for (auto const& element : s.elements)
+        {
+          if (context_of(element.first) != context)
+            continue;
+
+          fun (file_key_interner::instance().key(file_key_of(element.first)), element.second.object);
+        }
       }
     }
 
   private:
-    std::unordered_map<std::pair<int, BlizzardArchive::Listfile::FileKey>, T, pair_hash> _elements;
-    std::unordered_map<std::pair<int, BlizzardArchive::Listfile::FileKey>, std::size_t, pair_hash> _counts;
-    std::mutex mutable _mutex;
+    static constexpr std::size_t shard_count = 16;
+
+    struct entry
+    {
+      template<typename... Args>
+        entry (Args&&... args)
+          : object (std::forward<Args> (args)...)
+      {}
+
+      T object;
+      std::size_t count = 1;
+    };
+
+    struct key_hash
+    {
+      std::size_t operator() (std::uint64_t key) const noexcept
+      {
+        return util::hash_integer(key);
+      }
+    };
+
+    // node based, the objects must not move while referenced
+    using element_map = std::unordered_map<std::uint64_t, entry, key_hash>;
+
+    struct shard
+    {
+      element_map elements;
+      std::mutex mutable mutex;
+    };
+
+    static std::uint64_t make_key(file_key_id file_key, Noggit::NoggitRenderContext context)
+    {
+      return (static_cast<std::uint64_t>(context) << 32) | file_key;
+    }
+    static file_key_id file_key_of(std::uint64_t key)
+    {
+      return static_cast<file_key_id>(key);
+    }
+    static Noggit::NoggitRenderContext context_of(std::uint64_t key)
+    {
+      return static_cast<Noggit::NoggitRenderContext>(key >> 32);
+    }
+
+    shard& shard_of(std::uint64_t key)
+    {
+      // the low bits pick the bucket inside the shard, use the high ones here
+      return _shards[(util::hash_integer(key) >> 56) % shard_count];
+    }
+
+    std::array<shard, shard_count> _shards;
   };
 
 }
@@ -61,6 +61,9 @@ void DBCFile::open(std::shared_ptr<BlizzardArchive::ClientData> clientData)
   f.read(stringTable.data(), stringTable.size());
 
   f.close();
+
+  _string_offsets.clear();
+  buildIndex();
 }
 
 void DBCFile::save()
@@ -100,6 +103,8 @@ void DBCFile::overwriteWith(DBCFile const& file)
   stringSize = file.stringSize;
   data = file.data;
   stringTable = file.stringTable;
+  _index = file._index;
+  _string_offsets = file._string_offsets;
 }
 
 DBCFile DBCFile::createNew(std::string filename, std::uint32_t fieldCount, std::uint32_t recordSize)
@@ -141,37 +146,100 @@ size_t DBCFile::getRecordSize() const
   return recordSize;
 }
 
+std::optional<std::uint32_t> DBCFile::findRow(unsigned int id, size_t field) const
+{
+  assert(field < fieldCount);
+
+  if (field == 0)
+  {
+    auto const it = _index.rows.find(id);
+    return it != _index.rows.end() ? std::optional<std::uint32_t>(it->second) : std::nullopt;
+  }
+
+  for (std::uint32_t row = 0; row < recordCount; ++row)
+  {
+    if (*reinterpret_cast<std::uint32_t const*>(data.data() + row * recordSize + field * 4) == id)
+    {
+      return row;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void DBCFile::buildIndex()
+{
+  _index.rows.clear();
+  _index.rows.reserve(recordCount);
+  _index.has_duplicates = false;
+
+  for (std::uint32_t row = 0; row < recordCount; ++row)
+  {
+    addToIndex(row);
+  }
+}
+
+void DBCFile::addToIndex(std::uint32_t row)
+{
+  // keeps the first row on duplicates, like the linear search did
+  if (!_index.rows.try_emplace(getRecord(row).getUInt(0), row).second)
+  {
+    _index.has_duplicates = true;
+  }
+}
+
+void DBCFile::updateIndex(std::uint32_t row, std::uint32_t old_id, std::uint32_t new_id)
+{
+  if (old_id == new_id)
+  {
+    return;
+  }
+
+  // another row may hold the old id, only a scan knows which one comes first
+  if (_index.has_duplicates)
+  {
+    buildIndex();
+    return;
+  }
+
+  _index.rows.erase(old_id);
+
+  auto [it, inserted] = _index.rows.try_emplace(new_id, row);
+
+  if (!inserted)
+  {
+    _index.has_duplicates = true;
+
+    if (it->second > row)
+    {
+      it.value() = row;
+    }
+  }
+}
+
 DBCFile::Record DBCFile::getByID(unsigned int id, size_t field)
 {
-  for (Iterator i = begin(); i != end(); ++i)
+  if (auto const row = findRow(id, field))
   {
-    if (i->getUInt(field) == id)
-      return (*i);
+    return getRecord(*row);
   }
+
   LogDebug << "Tried to get a not existing row in " << filename << " (ID = " << id << ")!" << std::endl;
   throw NotFound();
 }
 
 bool DBCFile::CheckIfIdExists(unsigned int id, size_t field)
 {
-  for (Iterator i = begin(); i != end(); ++i)
-  {
-    if (i->getUInt(field) == id)
-      return (true);
-  }
-  return (false);
+  return findRow(id, field).has_value();
 }
 
 int DBCFile::getRecordRowId(unsigned int id, size_t field)
 {
-  int row_id = 0;
-  for (Iterator i = begin(); i != end(); ++i)
+  if (auto const row = findRow(id, field))
   {
-    if (i->getUInt(field) == id)
-      return row_id;
-
-    row_id++;
+    return static_cast<int>(*row);
   }
+
   LogError << "Tried to get a not existing row in " << filename << " (ID = " << id << ")!" << std::endl;
   throw NotFound();
 }
@@ -181,10 +249,9 @@ DBCFile::Record DBCFile::addRecord(size_t id, size_t id_field)
   assert(recordSize > 0);
   assert(id_field < fieldCount);
 
-  for (Iterator i = begin(); i != end(); ++i)
+  if (CheckIfIdExists(static_cast<unsigned int>(id), id_field))
   {
-    if (i->getUInt(id_field) == id)
-      throw AlreadyExists();
+    throw AlreadyExists();
   }
 
   size_t old_size = data.size();
@@ -193,95 +260,78 @@ DBCFile::Record DBCFile::addRecord(size_t id, size_t id_field)
 
   recordCount++;
 
+  addToIndex(recordCount - 1);
+
   return Record(*this, data.data() + old_size);
 }
 
 DBCFile::Record DBCFile::addRecordCopy(size_t id, size_t id_from, size_t id_field)
 {
-  recordCount++;
-
-  bool from_found = false;
-  size_t from_idx = 0;
-
-  for (Iterator i = begin(); i != end(); ++i)
+  if (CheckIfIdExists(static_cast<unsigned int>(id), id_field))
   {
-    if (i->getUInt(id_field) == id)
-      throw AlreadyExists();
-
-    if (i->getUInt(id_field) == id_from)
-    {
-      from_found = true;
-    }
-
-    if (!from_found)
-    {
-      from_idx++;
-    }
+    throw AlreadyExists();
   }
 
-  if (!from_found)
-  {
-    throw NotFound();
-  }
+  size_t const from_idx = getRecordRowId(static_cast<unsigned int>(id_from), id_field);
 
   size_t old_size = data.size();
   data.resize(old_size + recordSize);
 
-  Record record_from = getRecord(from_idx);
   std::copy(data.data() + from_idx * recordSize, data.data() + from_idx * recordSize + recordSize, data.data() + old_size);
   *reinterpret_cast<unsigned int*>(data.data() + old_size + id_field * sizeof(std::uint32_t)) = static_cast<unsigned int>(id);
 
+  recordCount++;
+
+  addToIndex(recordCount - 1);
+
   return Record(*this, data.data() + old_size);
 }
 
 void DBCFile::removeRecord(size_t id, size_t id_field)
 {
-  if (recordCount == 0)
+  if (recordCount == 0 || !CheckIfIdExists(static_cast<unsigned int>(id), id_field))
   {
     throw NotFound();
   }
 
-  size_t row_counter = 0;
+  size_t const row = getRecordRowId(static_cast<unsigned int>(id), id_field);
+  unsigned char* record = data.data() + row * recordSize; // data to remove at position
 
-  for (Iterator i = begin(); i != end(); ++i)
-  {
-    if (i->getUInt(id_field) == id)
-    {
-      size_t initial_size = data.size();
-
-      size_t row_position = row_counter * recordSize; // position of the record to remove
-
-      size_t datasizeafterRow = recordSize * (recordCount - row_counter); // size of the data after the row that needs to be moved at the old row's position
-
-      // assert(initial_size >= (datasizeafterRow + row_position));
-      if ((row_position + datasizeafterRow) > initial_size)
-      {
-        throw std::out_of_range("Attempting to remove more data than available");
-      }
+  // Move all data after the row to the row's position
+  std::memmove(record, record + recordSize, data.size() - (row + 1) * recordSize);
+  data.resize(data.size() - recordSize);
 
-      // size_t numRecordsToMove = recordCount - row_counter; // Number of records to move down
+  recordCount--;
 
-      unsigned char* record = data.data() + row_position; // data to remove at position
+  // every following row moved
+  buildIndex();
+}
 
-      // Move all data after the row to the row's position
-      // only do it if it wasn't the last row
-      if (row_position + recordSize < initial_size)
-      {
-        assert(row_counter < recordCount);
-        std::memmove(record, record + recordSize, datasizeafterRow);
-      }
-      data.resize(initial_size - recordSize);
+std::uint32_t DBCFile::internString(std::string const& val)
+{
+  if (_string_offsets.empty())
+  {
+    for (std::uint32_t offset = 0; offset < stringTable.size(); )
+    {
+      char const* str = stringTable.data() + offset;
+      std::size_t const length = strnlen(str, stringTable.size() - offset);
 
-      recordCount--;
-      return;
+      _string_offsets.try_emplace(std::string(str, length), offset);
+      offset += static_cast<std::uint32_t>(length + 1);
     }
+  }
 
-    row_counter++;
-
+  if (auto it = _string_offsets.find(val); it != _string_offsets.end())
+  {
+    return it->second;
   }
 
-  throw NotFound();
+  auto const offset = static_cast<std::uint32_t>(stringTable.size());
+  stringTable.insert(stringTable.end(), val.c_str(), val.c_str() + val.size() + 1);
+  stringSize += static_cast<std::uint32_t>(val.size() + 1);
+  _string_offsets.emplace(val, offset);
 
+  return offset;
 }
 
 int DBCFile::getEmptyRecordID(size_t id_field)
@@ -347,17 +397,7 @@ void DBCFile::Record::writeString(size_t field, const std::string& val)
 {
   assert(field < file.fieldCount);
 
-  if (!val.size())
-  {
-    *reinterpret_cast<unsigned int*>(offset + field * 4) = 0;
-    return;
-  }
-
-  size_t old_size = file.stringTable.size();
-  *reinterpret_cast<unsigned int*>(offset + field * 4) = static_cast<unsigned int>(file.stringTable.size());
-  file.stringTable.resize(old_size + val.size() + 1);
-  std::copy(val.c_str(), val.c_str() + val.size() + 1, file.stringTable.data() + old_size);
-  file.stringSize += static_cast<std::uint32_t>(val.size() + 1);
+  write<unsigned int>(field, val.size() ? file.internString(val) : 0);
 }
 
 void DBCFile::Record::writeLocalizedString(size_t field, const std::string& val, unsigned int locale)
@@ -365,15 +405,5 @@ void DBCFile::Record::writeLocalizedString(size_t field, const std::string& val,
   assert(field < file.fieldCount);
   assert(locale < 16);
 
-  if (!val.size())
-  {
-    *reinterpret_cast<unsigned int*>(offset + ((field + locale) * 4)) = 0;
-    return;
-  }
-
-  size_t old_size = file.stringTable.size();
-  *reinterpret_cast<unsigned int*>(offset + ((field + locale) * 4)) = static_cast<unsigned int>(file.stringTable.size());
-  file.stringTable.resize(old_size + val.size() + 1);
-  std::copy(val.c_str(), val.c_str() + val.size() + 1, file.stringTable.data() + old_size);
-  file.stringSize += static_cast<std::uint32_t>(val.size() + 1);
+  write<unsigned int>(field + locale, val.size() ? file.internString(val) : 0);
 }
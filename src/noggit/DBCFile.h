@@ -2,7 +2,12 @@
 
 #pragma once
 
+#include <external/tsl/robin_map.h>
+
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -55,7 +60,14 @@ public:
     {
       static_assert(sizeof(T) == 4, "This function only writes int/uint/float values.");
       assert(field < file.fieldCount);
+
+      std::uint32_t const old_value = getUInt(field);
       *reinterpret_cast<T*>(offset + field * 4) = val;
+
+      if (field == 0)
+      {
+        file.updateIndex(row(), old_value, std::bit_cast<std::uint32_t>(val));
+      }
     }
 
     void writeString(size_t field, const std::string& val);
@@ -64,6 +76,12 @@ public:
 
   private:
     Record(DBCFile &pfile, unsigned char *poffset) : file(pfile), offset(poffset) {}
+
+    std::uint32_t row() const
+    {
+      return static_cast<std::uint32_t>((offset - file.data.data()) / file.recordSize);
+    }
+
     DBCFile &file;
     unsigned char *offset;
 
@@ -117,6 +135,25 @@ public:
 private:
   DBCFile() = default;
 
+  //! row of the first record holding each id of field 0. It's built when the file
+  //! is opened and kept up to date by every change, lookups never modify it so they
+  //! can run concurrently. Lookups on other fields scan the records.
+  struct id_index
+  {
+    tsl::robin_map<std::uint32_t, std::uint32_t> rows;
+    //! some id is used by more than one record, only the first row is in rows
+    bool has_duplicates = false;
+  };
+
+  std::optional<std::uint32_t> findRow(unsigned int id, size_t field) const;
+  void buildIndex();
+  void addToIndex(std::uint32_t row);
+  void updateIndex(std::uint32_t row, std::uint32_t old_id, std::uint32_t new_id);
+
+  //! \returns the offset of the string in the string block, only appending it
+  //! when the block doesn't hold it yet
+  std::uint32_t internString(std::string const& val);
+
   std::string filename;
   std::uint32_t recordSize = 0;
   std::uint32_t recordCount = 0;
@@ -124,4 +161,8 @@ private:
   std::uint32_t stringSize = 0;
   std::vector<unsigned char> data;
   std::vector<char> stringTable;
+
+  id_index _index;
+  //! offset of every string of the string block, filled on the first string write
+  tsl::robin_map<std::string, std::uint32_t> _string_offsets;
 };
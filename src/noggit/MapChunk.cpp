@@ -13,6 +13,7 @@
 #include <noggit/MapTile.h> // MapTile
 #include <noggit/Misc.h>
 #include <noggit/ModelInstance.h>
+#include <noggit/terrain_edit_batch.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/TileWater.hpp>
 #include <noggit/tool_enums.hpp>
@@ -20,10 +21,38 @@
 #include <noggit/World.h>
 #include <util/sExtendableArray.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <QImage>
 
+namespace
+{
+  std::uint32_t pack_normal(int x, int y, int z)
+  {
+    return static_cast<std::uint32_t>(static_cast<std::uint8_t>(x))
+         | static_cast<std::uint32_t>(static_cast<std::uint8_t>(y)) << 8
+         | static_cast<std::uint32_t>(static_cast<std::uint8_t>(z)) << 16;
+  }
+
+  std::int8_t normal_component(std::uint32_t normal, int component)
+  {
+    return static_cast<std::int8_t>(static_cast<std::uint8_t>(normal >> (component * 8)));
+  }
+}
+
+terrain_memory_usage& terrain_memory_usage::operator+= (terrain_memory_usage const& other)
+{
+  vertices += other.vertices;
+  vertex_colors += other.vertex_colors;
+  shadows += other.shadows;
+  alphamaps += other.alphamaps;
+  gpu += other.gpu;
+  return *this;
+}
+
 MapChunk::MapChunk(MapTile* maintile, BlizzardArchive::ClientFile* f, bool bigAlpha,tile_mode mode
                     , Noggit::NoggitRenderContext context, bool init_empty, int chunk_idx, bool load_textures)
   : _mode(mode)
@@ -59,20 +88,11 @@ MapChunk::MapChunk(MapTile* maintile, BlizzardArchive::ClientFile* f, bool bigAl
 
     texture_set.reset();
 
-    auto& tile_buffer = mt->getChunkHeightmapBuffer();
-    int chunk_start = (px * 16 + py) * mapbufsize * 4;
-
     // Generate normals
-    for (int i = 0; i < mapbufsize; ++i)
-    {
-      int pixel_start = chunk_start + i * 4;
-      tile_buffer[pixel_start] = 0.0f;
-      tile_buffer[pixel_start + 1] = 1.0f;
-      tile_buffer[pixel_start + 2] = 0.0f;
-    }
+    std::fill(std::begin(_normals), std::end(_normals), pack_normal(0, 127, 0));
 
     // Clear shadows
-    memset(_shadow_map, 0, 64 * 64);
+    _packed_shadow_map.clear();
 
     // Do not write MCCV
     hasMCCV = false;
@@ -208,17 +228,11 @@ MapChunk::MapChunk(MapTile* maintile, BlizzardArchive::ClientFile* f, bool bigAl
 
     assert(fourcc == 'MCNR');
 
-    auto& tile_buffer = mt->getChunkHeightmapBuffer();
-    int chunk_start = (px * 16 + py) * mapbufsize * 4;
-
-    char nor[3];
+    std::int8_t nor[3];
     for (int i = 0; i < mapbufsize; ++i)
     {
       f->read(nor, 3);
-      int pixel_start = chunk_start + i * 4;
-      tile_buffer[pixel_start] = nor[0] / 127.0f;
-      tile_buffer[pixel_start + 1] = nor[2] / 127.0f;
-      tile_buffer[pixel_start + 2] = nor[1] / 127.0f;
+      _normals[i] = pack_normal(nor[0], nor[2], nor[1]);
     }
   }
   // - MCSH ----------------------------------------------
@@ -230,40 +244,12 @@ MapChunk::MapChunk(MapTile* maintile, BlizzardArchive::ClientFile* f, bool bigAl
 
     assert(fourcc == 'MCSH');
 
-    char compressed_shadow_map[64 * 64 / 8];
-
-    // shadow map 64 x 64
-    f->read(&compressed_shadow_map, 0x200);
+    // shadow map 64 x 64, unpacked on first use
+    _packed_shadow_map.resize(0x200);
+    f->read(_packed_shadow_map.data(), 0x200);
     f->seekRelative(-0x200);
 
-    uint8_t *p;
-    char *c;
-    p = _shadow_map;
-    c = compressed_shadow_map;
-    for (int i = 0; i<64 * 8; ++i)
-    {
-      for (int b = 0x01; b != 0x100; b <<= 1)
-      {
-        *p++ = ((*c) & b) ? 85 : 0;
-      }
-      c++;
-    }
-
-    if (!header_flags.flags.do_not_fix_alpha_map)
-    {
-      for (std::size_t i(0); i < 64; ++i)
-      {
-        _shadow_map[i * 64 + 63] = _shadow_map[i * 64 + 62];
-        _shadow_map[63 * 64 + i] = _shadow_map[62 * 64 + i];
-      }
-      _shadow_map[63 * 64 + 63] = _shadow_map[62 * 64 + 62];
-    }
-  }
-  else
-  {
-    /** We have no shadow map (MCSH), so we got no shadows at all!  **
-    ** This results in everything being black.. Yay. Lets fake it! **/
-    memset(_shadow_map, 0, 64 * 64);
+    _fix_shadow_map_edges = !header_flags.flags.do_not_fix_alpha_map;
   }
   // - MCCV ----------------------------------------------
   if(tmp_chunk_header.ofsMCCV)
@@ -281,20 +267,9 @@ MapChunk::MapChunk(MapTile* maintile, BlizzardArchive::ClientFile* f, bool bigAl
 
     hasMCCV = true;
 
-    unsigned char t[4];
-    for (int i = 0; i < mapbufsize; ++i)
-    {
-      f->read(t, 4);
-      mccv[i] = glm::vec3((float)t[2] / 127.0f, (float)t[1] / 127.0f, (float)t[0] / 127.0f);
-    }
-  }
-  else
-  {
-    glm::vec3 mccv_default(1.f, 1.f, 1.f);
-    for (int i = 0; i < mapbufsize; ++i)
-    {
-      mccv[i] = mccv_default;
-    }
+    // BGRA per vertex, converted on first use
+    _packed_vertex_colors.resize(mapbufsize * 4);
+    f->read(_packed_vertex_colors.data(), mapbufsize * 4);
   }
 
   if (tmp_chunk_header.sizeLiquid > 8)
@@ -365,32 +340,133 @@ void MapChunk::update_intersect_points()
 }
 
 
-std::vector<uint8_t> MapChunk::compressed_shadow_map() const
+uint8_t* MapChunk::shadow_map()
 {
-  std::vector<uint8_t> shadow_map(64 * 64 / 8);
+  std::lock_guard<std::mutex> const lock(_shadow_map_mutex);
+  return decoded_shadow_map().data();
+}
 
-  for (int i = 0; i < 64 * 64; ++i)
+uint8_t const* MapChunk::shadow_map() const
+{
+  std::lock_guard<std::mutex> const lock(_shadow_map_mutex);
+  return decoded_shadow_map().data();
+}
+
+std::array<uint8_t, 64 * 64>& MapChunk::decoded_shadow_map() const
+{
+  if (_shadow_map)
+  {
+    return *_shadow_map;
+  }
+
+  _shadow_map = std::make_unique<std::array<uint8_t, 64 * 64>>();
+
+  if (_packed_shadow_map.empty())
+  {
+    /** We have no shadow map (MCSH), so we got no shadows at all!  **
+    ** This results in everything being black.. Yay. Lets fake it! **/
+    _shadow_map->fill(0);
+    return *_shadow_map;
+  }
+
+  uint8_t* p = _shadow_map->data();
+  uint8_t const* c = _packed_shadow_map.data();
+
+  for (int i = 0; i < 64 * 8; ++i)
   {
-    if (_shadow_map[i])
+    for (int b = 0x01; b != 0x100; b <<= 1)
     {
-      shadow_map[i / 8] |= 1 << i % 8;
+      *p++ = ((*c) & b) ? 85 : 0;
     }
+    c++;
   }
 
-  return shadow_map;
+  if (_fix_shadow_map_edges)
+  {
+    auto& shadows = *_shadow_map;
+
+    for (std::size_t i(0); i < 64; ++i)
+    {
+      shadows[i * 64 + 63] = shadows[i * 64 + 62];
+      shadows[63 * 64 + i] = shadows[62 * 64 + i];
+    }
+    shadows[63 * 64 + 63] = shadows[62 * 64 + 62];
+  }
+
+  // the decoded map is the only source of truth from now on
+  _packed_shadow_map.clear();
+  _packed_shadow_map.shrink_to_fit();
+
+  return *_shadow_map;
 }
 
-bool MapChunk::has_shadows() const
+std::vector<uint8_t> MapChunk::compressed_shadow_map() const
 {
+  std::vector<uint8_t> packed(64 * 64 / 8);
+  uint8_t const* shadows = shadow_map();
+
   for (int i = 0; i < 64 * 64; ++i)
   {
-    if (_shadow_map[i])
+    if (shadows[i])
     {
-      return true;
+      packed[i / 8] |= 1 << i % 8;
     }
   }
 
-  return false;
+  return packed;
+}
+
+glm::vec3* MapChunk::getVertexColors()
+{
+  std::lock_guard<std::mutex> const lock(_vertex_colors_mutex);
+  return decoded_vertex_colors().data();
+}
+
+glm::vec3 const* MapChunk::getVertexColors() const
+{
+  std::lock_guard<std::mutex> const lock(_vertex_colors_mutex);
+  return decoded_vertex_colors().data();
+}
+
+std::array<glm::vec3, mapbufsize>& MapChunk::decoded_vertex_colors() const
+{
+  if (_vertex_colors)
+  {
+    return *_vertex_colors;
+  }
+
+  _vertex_colors = std::make_unique<std::array<glm::vec3, mapbufsize>>();
+
+  if (_packed_vertex_colors.empty())
+  {
+    _vertex_colors->fill(glm::vec3(1.f, 1.f, 1.f));
+    return *_vertex_colors;
+  }
+
+  uint8_t const* t = _packed_vertex_colors.data();
+
+  for (int i = 0; i < mapbufsize; ++i, t += 4)
+  {
+    (*_vertex_colors)[i] = glm::vec3((float)t[2] / 127.0f, (float)t[1] / 127.0f, (float)t[0] / 127.0f);
+  }
+
+  _packed_vertex_colors.clear();
+  _packed_vertex_colors.shrink_to_fit();
+
+  return *_vertex_colors;
+}
+
+bool MapChunk::has_shadows() const
+{
+  std::lock_guard<std::mutex> const lock(_shadow_map_mutex);
+
+  if (!_shadow_map && _packed_shadow_map.empty())
+  {
+    return false;
+  }
+
+  auto const& shadows = decoded_shadow_map();
+  return std::any_of(shadows.begin(), shadows.end(), [](uint8_t value) { return value != 0; });
 }
 
 bool MapChunk::GetVertex(float x, float z, glm::vec3 *V)
@@ -555,77 +631,131 @@ void MapChunk::draw ( math::frustum const& frustum
 
 }
 
-bool MapChunk::intersect (math::ray const& ray, selection_result* results, bool first_result)
+namespace
 {
-  if (!ray.intersect_bounds (vmin, vmax))
+  constexpr std::array<int, 4> height_tree_level_offset = {0, 1, 1 + 4, 1 + 4 + 16};
+
+  // outer vertices are stored in rows of 9 followed by the 8 inner vertices of the row of quads
+  constexpr int outer_vertex(int row, int col)
+  {
+    return row * 17 + col;
+  }
+
+  constexpr int inner_vertex(int row, int col)
+  {
+    return row * 17 + 9 + col;
+  }
+}
+
+void MapChunk::build_height_tree()
+{
+  if (!_height_tree)
+  {
+    _height_tree = std::make_unique<std::array<std::array<float, 2>, 1 + 4 + 16 + 64>>();
+  }
+
+  auto& tree = *_height_tree;
+
+  for (int row = 0; row < 8; ++row)
+  {
+    for (int col = 0; col < 8; ++col)
+    {
+      float min = mVertices[inner_vertex(row, col)].y;
+      float max = min;
+
+      for (int vertex : { outer_vertex(row, col), outer_vertex(row, col + 1)
+                        , outer_vertex(row + 1, col), outer_vertex(row + 1, col + 1)
+                        }
+          )
+      {
+        min = std::min(min, mVertices[vertex].y);
+        max = std::max(max, mVertices[vertex].y);
+      }
+
+      tree[height_tree_level_offset[3] + row * 8 + col] = {min, max};
+    }
+  }
+
+  for (int level = 2; level >= 0; --level)
+  {
+    int const size = 1 << level;
+
+    for (int row = 0; row < size; ++row)
+    {
+      for (int col = 0; col < size; ++col)
+      {
+        auto& node = tree[height_tree_level_offset[level] + row * size + col];
+        node = {std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+
+        for (int child = 0; child < 4; ++child)
+        {
+          auto const& child_node = tree[height_tree_level_offset[level + 1]
+                                        + (row * 2 + child / 2) * size * 2 + col * 2 + child % 2];
+          node[0] = std::min(node[0], child_node[0]);
+          node[1] = std::max(node[1], child_node[1]);
+        }
+      }
+    }
+  }
+
+  _height_tree_dirty = false;
+}
+
+bool MapChunk::intersect_height_tree(math::ray const& ray, int level, int row, int col, selection_result* results, bool first_result)
+{
+  int const size = 1 << level;
+  int const quads = 8 / size;
+  auto const& node = (*_height_tree)[height_tree_level_offset[level] + row * size + col];
+
+  glm::vec3 const& min_corner = mVertices[outer_vertex(row * quads, col * quads)];
+  glm::vec3 const& max_corner = mVertices[outer_vertex((row + 1) * quads, (col + 1) * quads)];
+
+  if (!ray.intersect_bounds ( {min_corner.x, node[0], min_corner.z}
+                            , {max_corner.x, node[1], max_corner.z}
+                            )
+     )
   {
     return false;
   }
 
-  static constexpr std::array<std::uint16_t, 768> indices =
-  {
-    9, 0, 17, 9, 17, 18, 9, 18, 1, 9, 1, 0, 26, 17, 34, 26,
-    34, 35, 26, 35, 18, 26, 18, 17, 43, 34, 51, 43, 51, 52, 43, 52,
-    35, 43, 35, 34, 60, 51, 68, 60, 68, 69, 60, 69, 52, 60, 52, 51,
-    77, 68, 85, 77, 85, 86, 77, 86, 69, 77, 69, 68, 94, 85, 102, 94,
-    102, 103, 94, 103, 86, 94, 86, 85, 111, 102, 119, 111, 119, 120, 111, 120,
-    103, 111, 103, 102, 128, 119, 136, 128, 136, 137, 128, 137, 120, 128, 120, 119,
-    10, 1, 18, 10, 18, 19, 10, 19, 2, 10, 2, 1, 27, 18, 35, 27,
-    35, 36, 27, 36, 19, 27, 19, 18, 44, 35, 52, 44, 52, 53, 44, 53,
-    36, 44, 36, 35, 61, 52, 69, 61, 69, 70, 61, 70, 53, 61, 53, 52,
-    78, 69, 86, 78, 86, 87, 78, 87, 70, 78, 70, 69, 95, 86, 103, 95,
-    103, 104, 95, 104, 87, 95, 87, 86, 112, 103, 120, 112, 120, 121, 112, 121,
-    104, 112, 104, 103, 129, 120, 137, 129, 137, 138, 129, 138, 121, 129, 121, 120,
-    11, 2, 19, 11, 19, 20, 11, 20, 3, 11, 3, 2, 28, 19, 36, 28,
-    36, 37, 28, 37, 20, 28, 20, 19, 45, 36, 53, 45, 53, 54, 45, 54,
-    37, 45, 37, 36, 62, 53, 70, 62, 70, 71, 62, 71, 54, 62, 54, 53,
-    79, 70, 87, 79, 87, 88, 79, 88, 71, 79, 71, 70, 96, 87, 104, 96,
-    104, 105, 96, 105, 88, 96, 88, 87, 113, 104, 121, 113, 121, 122, 113, 122,
-    105, 113, 105, 104, 130, 121, 138, 130, 138, 139, 130, 139, 122, 130, 122, 121,
-    12, 3, 20, 12, 20, 21, 12, 21, 4, 12, 4, 3, 29, 20, 37, 29,
-    37, 38, 29, 38, 21, 29, 21, 20, 46, 37, 54, 46, 54, 55, 46, 55,
-    38, 46, 38, 37, 63, 54, 71, 63, 71, 72, 63, 72, 55, 63, 55, 54,
-    80, 71, 88, 80, 88, 89, 80, 89, 72, 80, 72, 71, 97, 88, 105, 97,
-    105, 106, 97, 106, 89, 97, 89, 88, 114, 105, 122, 114, 122, 123, 114, 123,
-    106, 114, 106, 105, 131, 122, 139, 131, 139, 140, 131, 140, 123, 131, 123, 122,
-    13, 4, 21, 13, 21, 22, 13, 22, 5, 13, 5, 4, 30, 21, 38, 30,
-    38, 39, 30, 39, 22, 30, 22, 21, 47, 38, 55, 47, 55, 56, 47, 56,
-    39, 47, 39, 38, 64, 55, 72, 64, 72, 73, 64, 73, 56, 64, 56, 55,
-    81, 72, 89, 81, 89, 90, 81, 90, 73, 81, 73, 72, 98, 89, 106, 98,
-    106, 107, 98, 107, 90, 98, 90, 89, 115, 106, 123, 115, 123, 124, 115, 124,
-    107, 115, 107, 106, 132, 123, 140, 132, 140, 141, 132, 141, 124, 132, 124, 123,
-    14, 5, 22, 14, 22, 23, 14, 23, 6, 14, 6, 5, 31, 22, 39, 31,
-    39, 40, 31, 40, 23, 31, 23, 22, 48, 39, 56, 48, 56, 57, 48, 57,
-    40, 48, 40, 39, 65, 56, 73, 65, 73, 74, 65, 74, 57, 65, 57, 56,
-    82, 73, 90, 82, 90, 91, 82, 91, 74, 82, 74, 73, 99, 90, 107, 99,
-    107, 108, 99, 108, 91, 99, 91, 90, 116, 107, 124, 116, 124, 125, 116, 125,
-    108, 116, 108, 107, 133, 124, 141, 133, 141, 142, 133, 142, 125, 133, 125, 124,
-    15, 6, 23, 15, 23, 24, 15, 24, 7, 15, 7, 6, 32, 23, 40, 32,
-    40, 41, 32, 41, 24, 32, 24, 23, 49, 40, 57, 49, 57, 58, 49, 58,
-    41, 49, 41, 40, 66, 57, 74, 66, 74, 75, 66, 75, 58, 66, 58, 57,
-    83, 74, 91, 83, 91, 92, 83, 92, 75, 83, 75, 74, 100, 91, 108, 100,
-    108, 109, 100, 109, 92, 100, 92, 91, 117, 108, 125, 117, 125, 126, 117, 126,
-    109, 117, 109, 108, 134, 125, 142, 134, 142, 143, 134, 143, 126, 134, 126, 125,
-    16, 7, 24, 16, 24, 25, 16, 25, 8, 16, 8, 7, 33, 24, 41, 33,
-    41, 42, 33, 42, 25, 33, 25, 24, 50, 41, 58, 50, 58, 59, 50, 59,
-    42, 50, 42, 41, 67, 58, 75, 67, 75, 76, 67, 76, 59, 67, 59, 58,
-    84, 75, 92, 84, 92, 93, 84, 93, 76, 84, 76, 75, 101, 92, 109, 101,
-    109, 110, 101, 110, 93, 101, 93, 92, 118, 109, 126, 118, 126, 127, 118, 127,
-    110, 118, 110, 109, 135, 126, 143, 135, 143, 144, 135, 144, 127, 135, 127, 126
-  };
+  if (level < 3)
+  {
+    bool intersection_found = false;
+
+    for (int child = 0; child < 4; ++child)
+    {
+      intersection_found |= intersect_height_tree(ray, level + 1, row * 2 + child / 2, col * 2 + child % 2, results, first_result);
+
+      if (intersection_found && first_result)
+      {
+        return true;
+      }
+    }
+
+    return intersection_found;
+  }
+
+  // same triangles and winding as the terrain index buffer
+  std::uint16_t const center = inner_vertex(row, col);
+  std::array<std::uint16_t, 5> const corners = { static_cast<std::uint16_t>(outer_vertex(row, col))
+                                               , static_cast<std::uint16_t>(outer_vertex(row + 1, col))
+                                               , static_cast<std::uint16_t>(outer_vertex(row + 1, col + 1))
+                                               , static_cast<std::uint16_t>(outer_vertex(row, col + 1))
+                                               , static_cast<std::uint16_t>(outer_vertex(row, col))
+                                               };
 
   bool intersection_found = false;
-  for (int i (0); i < indices.size(); i += 3)
+
+  for (int i = 0; i < 4; ++i)
   {
-    if ( auto distance = ray.intersect_triangle ( mVertices[indices[i + 0]]
-                                                , mVertices[indices[i + 1]]
-                                                , mVertices[indices[i + 2]]
+    if ( auto distance = ray.intersect_triangle ( mVertices[center]
+                                                , mVertices[corners[i]]
+                                                , mVertices[corners[i + 1]]
                                                 )
        )
     {
       results->emplace_back
-          (*distance, selected_chunk_type (this, std::make_tuple(indices[i], indices[i + 1],
-                                                                 indices[i + 2]), ray.position (*distance)));
+          (*distance, selected_chunk_type (this, std::make_tuple(center, corners[i], corners[i + 1]), ray.position (*distance)));
       intersection_found = true;
 
       if (first_result)
@@ -636,6 +766,21 @@ bool MapChunk::intersect (math::ray const& ray, selection_result* results, bool
   return intersection_found;
 }
 
+bool MapChunk::intersect (math::ray const& ray, selection_result* results, bool first_result)
+{
+  if (!ray.intersect_bounds (vmin, vmax))
+  {
+    return false;
+  }
+
+  if (_height_tree_dirty)
+  {
+    build_height_tree();
+  }
+
+  return intersect_height_tree(ray, 0, 0, 0, results, first_result);
+}
+
 void MapChunk::updateVerticesData()
 {
   // This method assumes tile's heightmap texture is currently bound to the active tex unit
@@ -646,15 +791,10 @@ void MapChunk::updateVerticesData()
   vmin.y = std::numeric_limits<float>::max();
   vmax.y = std::numeric_limits<float>::lowest();
 
-  auto& tile_buffer = mt->getChunkHeightmapBuffer();
-
-  int chunk_start = (px * 16 + py) * mapbufsize * 4;
-
   for (int i(0); i < mapbufsize; ++i)
   {
     vmin.y = std::min(vmin.y, mVertices[i].y);
     vmax.y = std::max(vmax.y, mVertices[i].y);
-    tile_buffer[chunk_start + i * 4 + 3] = mVertices[i].y;
   }
 
   mt->markExtentsDirty();
@@ -813,48 +953,80 @@ glm::uvec2 MapChunk::getUnitIndextAt(glm::vec3 pos)
     return unit_index;
 }
 
-void MapChunk::recalcNorms()
+void MapChunk::recalcNorm(int i)
 {
   // 0 - up_left
   // 1 - up_right
   // 2 - down_left
   // 3 - down_right
 
-  auto& tile_buffer = mt->getChunkHeightmapBuffer();
-  int chunk_start = (px * 16 + py) * mapbufsize * 4;
+  glm::vec3 const P1 (getNeighborVertex(i, 0)); // up_left
+  glm::vec3 const P2 (getNeighborVertex(i, 1)); // up_right
+  glm::vec3 const P3 (getNeighborVertex(i, 2)); // down_left
+  glm::vec3 const P4 (getNeighborVertex(i, 3)); // down_right
 
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    glm::vec3 const P1 (getNeighborVertex(i, 0)); // up_left
-    glm::vec3 const P2 (getNeighborVertex(i, 1)); // up_right
-    glm::vec3 const P3 (getNeighborVertex(i, 2)); // down_left
-    glm::vec3 const P4 (getNeighborVertex(i, 3)); // down_right
+  glm::vec3 const N1 = glm::cross((P2 - mVertices[i]) , (P1 - mVertices[i]));
+  glm::vec3 const N2 = glm::cross((P3 - mVertices[i]) , (P2 - mVertices[i]));
+  glm::vec3 const N3 = glm::cross((P4 - mVertices[i]) , (P3 - mVertices[i]));
+  glm::vec3 const N4 = glm::cross((P1 - mVertices[i]) , (P4 - mVertices[i]));
 
-    glm::vec3 const N1 = glm::cross((P2 - mVertices[i]) , (P1 - mVertices[i]));
-    glm::vec3 const N2 = glm::cross((P3 - mVertices[i]) , (P2 - mVertices[i]));
-    glm::vec3 const N3 = glm::cross((P4 - mVertices[i]) , (P3 - mVertices[i]));
-    glm::vec3 const N4 = glm::cross((P1 - mVertices[i]) , (P4 - mVertices[i]));
+  glm::vec3 Norm (N1 + N2 + N3 + N4);
+  Norm = glm::normalize(Norm);
 
-    glm::vec3 Norm (N1 + N2 + N3 + N4);
-    Norm = glm::normalize(Norm);
+  int const x = static_cast<int>(std::floor(Norm.x * 127));
+  int const y = static_cast<int>(std::floor(Norm.y * 127));
+  int const z = static_cast<int>(std::floor(Norm.z * 127));
 
-    Norm.x = std::floor(Norm.x * 127) / 127;
-    Norm.y = std::floor(Norm.y * 127) / 127;
-    Norm.z = std::floor(Norm.z * 127) / 127;
+  //! \todo: find out why recalculating normals without changing the terrain result in slightly different normals
 
-    //! \todo: find out why recalculating normals without changing the terrain result in slightly different normals
+  _normals[i] = pack_normal(-z, y, -x);
+}
 
-    int pixel_start = chunk_start + i * 4;
-    tile_buffer[pixel_start] = -Norm.z;
-    tile_buffer[pixel_start + 1] = Norm.y;
-    tile_buffer[pixel_start + 2] = -Norm.x;
+glm::vec3 MapChunk::getNormal(int i) const
+{
+  return glm::vec3 ( normal_component(_normals[i], 0)
+                   , normal_component(_normals[i], 1)
+                   , normal_component(_normals[i], 2)
+                   ) / 127.f;
+}
 
+void MapChunk::recalcNorms()
+{
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    recalcNorm(i);
   }
 
   registerChunkUpdate(ChunkUpdateFlags::NORMALS);
 
 }
 
+void MapChunk::recalcEditedNorms(Noggit::terrain_edit_batch const& batch)
+{
+  // the neighbours of vertex i are i-9, i-8, i+8 and i+9, the ones of border vertices
+  // may end up being another vertex of the chunk, recomputing it is harmless
+  std::array<bool, mapbufsize> touched{};
+
+  for (std::uint8_t i : batch.vertices)
+  {
+    for (int diff : {-9, -8, 0, 8, 9})
+    {
+      if (i + diff >= 0 && i + diff < mapbufsize)
+      {
+        touched[i + diff] = true;
+      }
+    }
+  }
+
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    if (touched[i])
+    {
+      recalcNorm(i);
+    }
+  }
+}
+
 void MapChunk::updateNormalsData()
 {
   //gl.texSubImage2D(GL_TEXTURE_2D, 0, 0, px * 16 + py, mapbufsize, 1, GL_RGB, GL_FLOAT, mNormals);
@@ -862,23 +1034,35 @@ void MapChunk::updateNormalsData()
 
 bool MapChunk::changeTerrain(glm::vec3 const& pos, float change, float radius, int BrushType, float inner_radius)
 {
-  //float dist, xdiff, zdiff;
-  bool changed = false;
+  Noggit::terrain_edit_batch batch;
+  collectTerrainChange(pos, change, radius, BrushType, inner_radius, batch);
+  applyTerrainEdit(batch);
+
+  if (!batch.empty())
+  {
+    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
+  }
+  return !batch.empty();
+}
 
+void MapChunk::collectTerrainChange(glm::vec3 const& pos, float change, float radius, int BrushType, float inner_radius, Noggit::terrain_edit_batch& batch)
+{
   for (int i = 0; i < mapbufsize; ++i)
   {
     float dt = change;
     if (changeTerrainProcessVertex(pos, mVertices[i], dt, radius, inner_radius, BrushType))
     {
-      changed = true;
-      mVertices[i].y += dt;
+      batch.add(i, mVertices[i].y + dt);
     }
   }
-  if (changed)
+}
+
+void MapChunk::applyTerrainEdit(Noggit::terrain_edit_batch const& batch)
+{
+  for (std::size_t n = 0; n < batch.vertices.size(); ++n)
   {
-    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
+    mVertices[batch.vertices[n]].y = batch.heights[n];
   }
-  return changed;
 }
 
 bool MapChunk::ChangeMCCV(glm::vec3 const& pos, glm::vec4 const& color, float change, float radius, bool editMode)
@@ -892,6 +1076,8 @@ bool MapChunk::ChangeMCCV(glm::vec3 const& pos, glm::vec4 const& color, float ch
     changed = true;
   }
 
+  glm::vec3* mccv = getVertexColors();
+
   for (int i = 0; i < mapbufsize; ++i)
   {
     dist = misc::dist(mVertices[i], pos);
@@ -937,6 +1123,8 @@ bool MapChunk::stampMCCV(glm::vec3 const& pos, glm::vec4 const& color, float cha
     changed = true;
   }
 
+  glm::vec3* mccv = getVertexColors();
+
   for (int i = 0; i < mapbufsize; ++i)
   {
     dist = misc::dist(mVertices[i], pos);
@@ -1012,11 +1200,58 @@ bool MapChunk::stampMCCV(glm::vec3 const& pos, glm::vec4 const& color, float cha
   return changed;
 }
 
+void MapChunk::update_heightmap()
+{
+  // the bits of the height and the packed normal, x and z come from the chunk position
+  std::array<std::uint32_t, mapbufsize * 2> texels;
+
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    std::memcpy(&texels[i * 2], &mVertices[i].y, sizeof(float));
+    texels[i * 2 + 1] = _normals[i];
+  }
+
+  gl.texSubImage2D(GL_TEXTURE_2D, 0, 0, px * 16 + py, mapbufsize, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, texels.data());
+}
+
 void MapChunk::update_vertex_colors()
 {
-  if (_chunk_update_flags & ChunkUpdateFlags::MCCV)
+  if (!(_chunk_update_flags & ChunkUpdateFlags::MCCV))
+    return;
 
-    gl.texSubImage2D(GL_TEXTURE_2D, 0, 0, px * 16 + py, mapbufsize, 1, GL_RGB, GL_FLOAT, mccv);
+  // same scale as MCCV, 127 is the neutral color, the shader scales it back
+  std::array<std::uint8_t, mapbufsize * 4> colors;
+  glm::vec3 const* mccv = getVertexColors();
+
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      colors[i * 4 + c] = static_cast<std::uint8_t>(std::clamp(std::lround(mccv[i][c] * 127.f), 0l, 255l));
+    }
+
+    colors[i * 4 + 3] = 0xFF;
+  }
+
+  gl.texSubImage2D(GL_TEXTURE_2D, 0, 0, px * 16 + py, mapbufsize, 1, GL_RGBA, GL_UNSIGNED_BYTE, colors.data());
+}
+
+terrain_memory_usage MapChunk::memoryUsage() const
+{
+  terrain_memory_usage usage;
+
+  usage.vertices = sizeof(mVertices) + sizeof(_normals);
+  {
+    std::lock_guard<std::mutex> const lock(_vertex_colors_mutex);
+    usage.vertex_colors = _packed_vertex_colors.capacity() + (_vertex_colors ? sizeof(*_vertex_colors) : 0);
+  }
+  {
+    std::lock_guard<std::mutex> const lock(_shadow_map_mutex);
+    usage.shadows = _packed_shadow_map.capacity() + (_shadow_map ? sizeof(*_shadow_map) : 0);
+  }
+  usage.alphamaps = texture_set ? texture_set->memoryUsage() : 0;
+
+  return usage;
 }
 
 glm::vec3 MapChunk::pickMCCV(glm::vec3 const& pos)
@@ -1040,7 +1275,7 @@ glm::vec3 MapChunk::pickMCCV(glm::vec3 const& pos)
     }
   }
 
-  return mccv[v_index];
+  return getVertexColors()[v_index];
 
 }
 
@@ -1054,57 +1289,68 @@ bool MapChunk::flattenTerrain ( glm::vec3 const& pos
                               , math::degrees orientation
                               )
 {
-  bool changed (false);
+  Noggit::terrain_edit_batch batch;
+  collectTerrainFlatten(pos, remain, radius, BrushType, mode, origin, angle, orientation, batch);
+  applyTerrainEdit(batch);
 
-  for (int i(0); i < mapbufsize; ++i)
+  if (!batch.empty())
   {
-	  float const dist(misc::dist(mVertices[i], pos));
-
-	  if (dist >= radius)
-	  {
-		  continue;
-	  }
-
-	  float const ah(origin.y
-		  + ((mVertices[i].x - origin.x) * glm::cos(math::radians(orientation)._)
-			  + (mVertices[i].z - origin.z) * glm::sin(math::radians(orientation)._)
-			  ) * glm::tan(math::radians(angle)._)
-	  );
-
-	  if ((!mode.lower && ah < mVertices[i].y)
-		  || (!mode.raise && ah > mVertices[i].y)
-		  )
-	  {
-		  continue;
-	  }
-
-	  if (BrushType == eFlattenType_Origin)
-	  {
-		  mVertices[i].y = origin.y;
-		  changed = true;
-		  continue;
-	  }
-
-    mVertices[i].y = glm::mix
-      ( 
-        mVertices[i].y
-      , ah
-      , BrushType == eFlattenType_Flat ? remain
-      : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
-      : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
-      : throw std::logic_error ("bad brush type")
-
-      );
-
-    changed = true;
+    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
   }
 
-  if (changed)
+  return !batch.empty();
+}
+
+void MapChunk::collectTerrainFlatten ( glm::vec3 const& pos
+                                     , float remain
+                                     , float radius
+                                     , int BrushType
+                                     , flatten_mode const& mode
+                                     , glm::vec3 const& origin
+                                     , math::degrees angle
+                                     , math::degrees orientation
+                                     , Noggit::terrain_edit_batch& batch
+                                     ) const
+{
+  for (int i(0); i < mapbufsize; ++i)
   {
-    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
-  }
+    float const dist(misc::dist(mVertices[i], pos));
 
-  return changed;
+    if (dist >= radius)
+    {
+      continue;
+    }
+
+    float const ah(origin.y
+      + ((mVertices[i].x - origin.x) * glm::cos(math::radians(orientation)._)
+        + (mVertices[i].z - origin.z) * glm::sin(math::radians(orientation)._)
+        ) * glm::tan(math::radians(angle)._)
+    );
+
+    if ((!mode.lower && ah < mVertices[i].y)
+      || (!mode.raise && ah > mVertices[i].y)
+      )
+    {
+      continue;
+    }
+
+    if (BrushType == eFlattenType_Origin)
+    {
+      batch.add(i, origin.y);
+      continue;
+    }
+
+    batch.add ( i
+              , glm::mix
+                  ( mVertices[i].y
+                  , ah
+                  , BrushType == eFlattenType_Flat ? remain
+                  : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
+                  : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
+                  : throw std::logic_error ("bad brush type")
+                  )
+              );
+  }
 }
 
 bool MapChunk::blurTerrain ( glm::vec3 const& pos
@@ -1115,13 +1361,33 @@ bool MapChunk::blurTerrain ( glm::vec3 const& pos
                            /*, std::function<std::optional<float>(float, float)> height*/
                            )
 {
-  bool changed = false;
+  Noggit::terrain_edit_batch batch;
+  collectTerrainBlur(pos, remain, radius, BrushType, mode, batch);
+  applyTerrainEdit(batch);
+
+  if (!batch.empty())
+  {
+    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
+  }
+
+  return !batch.empty();
+}
 
+void MapChunk::collectTerrainBlur ( glm::vec3 const& pos
+                                  , float remain
+                                  , float radius
+                                  , int BrushType
+                                  , flatten_mode const& mode
+                                  , Noggit::terrain_edit_batch& batch
+                                  ) const
+{
   if (BrushType == eFlattenType_Origin)
   {
-    return false;
+    return;
   }
 
+  // every target is computed from the heights before the edit, whatever the
+  // order the vertices and chunks are processed in
   for (int i (0); i < mapbufsize; ++i)
   {
     float const dist = misc::dist(mVertices[i], pos);
@@ -1148,49 +1414,31 @@ bool MapChunk::blurTerrain ( glm::vec3 const& pos
         bool res = mt->getWorld()->GetVertex(tx, tz, &vec);
         if (res)
         {
-            // float h = vec.y;
             TotalHeight += (1.0f - dist2 / radius) * vec.y;
             TotalWeight += (1.0f - dist2 / radius);
         }
-
-        /*
-        // auto h (height (tx, tz));
-        auto h = height(tx, tz);
-        if (h)
-        {
-          TotalHeight += (1.0f - dist2 / radius) * h.value();
-          TotalWeight += (1.0f - dist2 / radius);
-        }*/
       }
     }
 
     float target = TotalHeight / TotalWeight;
-    float& y = mVertices[i].y;
+    float const y = mVertices[i].y;
 
     if ((target > y && !mode.raise) || (target < y && !mode.lower))
     {
       continue;
     }
 
-    y = glm::mix
-      ( 
-        y,
-        target,
-        BrushType == eFlattenType_Flat ? remain
-      : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
-      : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
-      : throw std::logic_error ("bad brush type")
-      );
-
-    changed = true;
+    batch.add ( i
+              , glm::mix
+                  ( y
+                  , target
+                  , BrushType == eFlattenType_Flat ? remain
+                  : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
+                  : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
+                  : throw std::logic_error ("bad brush type")
+                  )
+              );
   }
-
-  if (changed)
-  {
-    registerChunkUpdate(ChunkUpdateFlags::VERTEX);
-  }
-
-  return changed;
 }
 
 bool MapChunk::changeTerrainProcessVertex(glm::vec3 const& pos, glm::vec3 const& vertex, float& dt,
@@ -1382,12 +1630,12 @@ bool MapChunk::canPaintTexture(scoped_blp_texture_reference texture)
 void MapChunk::update_shadows()
 {
   if (_chunk_update_flags & ChunkUpdateFlags::SHADOW)
-    gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, px * 16 + py, 64, 64, 1, GL_RED, GL_UNSIGNED_BYTE, _shadow_map);
+    gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, px * 16 + py, 64, 64, 1, GL_RED, GL_UNSIGNED_BYTE, shadow_map());
 }
 
 void MapChunk::clear_shadows()
 {
-  memset(_shadow_map, 0, 64 * 64);
+  std::memset(shadow_map(), 0, 64 * 64);
 
   registerChunkUpdate(ChunkUpdateFlags::SHADOW);
 }
@@ -1457,7 +1705,6 @@ void MapChunk::setFlag(bool changeto, uint32_t flag)
 
 void MapChunk::save(util::sExtendableArray& lADTFile
                     , int& lCurrentPosition
-                    , int& lMCIN_Position
                     , std::map<std::string, int> &lTextures
                     , std::vector<WMOInstance*> &lObjectInstances
                     , std::vector<ModelInstance*>& lModelInstances
@@ -1468,7 +1715,6 @@ void MapChunk::save(util::sExtendableArray& lADTFile
   int lMCNK_Position = lCurrentPosition;
   lADTFile.Extend(8 + 0x80);  // This is only the size of the header. More chunks will increase the size.
   SetChunkHeader(lADTFile, lCurrentPosition, 'MCNK', lMCNK_Size);
-  lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].offset = lCurrentPosition; // check this
 
                                                                                                    // MCNK data
   // lADTFile.Insert(lCurrentPosition + 8, 0x80, reinterpret_cast<char*>(&(header)));
@@ -1558,6 +1804,7 @@ void MapChunk::save(util::sExtendableArray& lADTFile
     header_ptr->ofsMCCV = lCurrentPosition - lMCNK_Position;
 
     auto const lmccv = lADTFile.GetPointer<unsigned int>(lCurrentPosition + 8);
+    glm::vec3 const* mccv = getVertexColors();
 
     for (int i = 0; i < mapbufsize; ++i)
     {
@@ -1584,16 +1831,11 @@ void MapChunk::save(util::sExtendableArray& lADTFile
 
   auto const lNormals = lADTFile.GetPointer<char>(lCurrentPosition + 8);
 
-  auto& tile_buffer = mt->getChunkHeightmapBuffer();
-  int chunk_start = (px * 16 + py) * mapbufsize * 4;
-
   for (int i = 0; i < mapbufsize; ++i)
   {
-    int pixel_start = chunk_start + i * 4;
-
-    lNormals[i * 3 + 0] = static_cast<char>(tile_buffer[pixel_start] * 127);
-    lNormals[i * 3 + 1] = static_cast<char>(tile_buffer[pixel_start + 2] * 127);
-    lNormals[i * 3 + 2] = static_cast<char>(tile_buffer[pixel_start + 1] * 127);
+    lNormals[i * 3 + 0] = normal_component(_normals[i], 0);
+    lNormals[i * 3 + 1] = normal_component(_normals[i], 2);
+    lNormals[i * 3 + 2] = normal_component(_normals[i], 1);
   }
 
   lCurrentPosition += 8 + lMCNR_Size;
@@ -1731,8 +1973,8 @@ void MapChunk::save(util::sExtendableArray& lADTFile
 
     auto const lLayer = lADTFile.GetPointer<char>(lCurrentPosition + 8);
 
-    auto shadow_map = compressed_shadow_map();
-    memcpy(lLayer.get(), shadow_map.data(), 0x200);
+    auto packed_shadows = compressed_shadow_map();
+    memcpy(lLayer.get(), packed_shadows.data(), 0x200);
 
     lCurrentPosition += 8 + lMCSH_Size;
     lMCNK_Size += 8 + lMCSH_Size;
@@ -1830,7 +2072,6 @@ void MapChunk::save(util::sExtendableArray& lADTFile
   lMCNK_Size += 8 + lMCSE_Size;
 
   lADTFile.GetPointer<sChunkHeader>(lMCNK_Position)->mSize = lMCNK_Size;
-  lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].size = lMCNK_Size + sizeof (sChunkHeader);
 }
 
 
@@ -1889,16 +2130,6 @@ glm::vec3* MapChunk::getHeightmap()
   return &mVertices[0];
 }
 
-glm::vec3 const* MapChunk::getNormals() const
-{
-  return &mNormals[0];
-}
-
-glm::vec3* MapChunk::getVertexColors()
-{
-  return &mccv[0];
-}
-
 
 void MapChunk::selectVertex(glm::vec3 const& pos, float radius, std::unordered_set<glm::vec3*>& vertices)
 {
@@ -2147,6 +2378,8 @@ void MapChunk::initMCCV()
 {
   if (!hasMCCV)
   {
+    glm::vec3* mccv = getVertexColors();
+
     for (int i = 0; i < mapbufsize; ++i)
     {
       mccv[i].x = 1.0f; // set default shaders
@@ -2160,6 +2393,18 @@ void MapChunk::initMCCV()
 }
 
 void MapChunk::registerChunkUpdate(unsigned flags)
+{
+  if (flags & ChunkUpdateFlags::VERTEX)
+  {
+    _height_tree_dirty = true;
+  }
+
+  _chunk_update_flags |= flags;
+  _dirty_flags.fetch_or(flags);
+  mt->registerChunkUpdate(flags);
+}
+
+void MapChunk::deferChunkUpdate(unsigned flags)
 {
   _chunk_update_flags |= flags;
   mt->registerChunkUpdate(flags);
@@ -12,8 +12,12 @@
 #include <QImage>
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_set>
 
 namespace BlizzardArchive
@@ -33,6 +37,11 @@ namespace util
   class sExtendableArray;
 }
 
+namespace Noggit
+{
+  struct terrain_edit_batch;
+}
+
 class Brush;
 class ChunkWater;
 class MapTile;
@@ -59,6 +68,20 @@ enum ChunkUpdateFlags
   DETAILDOODADS_EXCLUSION = 0x200
 };
 
+//! Bytes of terrain data held in memory, see MapChunk::memoryUsage and MapTile::memoryUsage
+struct terrain_memory_usage
+{
+  std::size_t vertices = 0; //!< positions and normals
+  std::size_t vertex_colors = 0;
+  std::size_t shadows = 0;
+  std::size_t alphamaps = 0; //!< including the float copies made for editing
+  std::size_t gpu = 0; //!< textures of the tile renderer, once uploaded
+
+  std::size_t cpu() const { return vertices + vertex_colors + shadows + alphamaps; }
+
+  terrain_memory_usage& operator+= (terrain_memory_usage const& other);
+};
+
 class MapChunk
 {
 private:
@@ -69,8 +92,38 @@ private:
   std::vector<uint8_t> compressed_shadow_map() const;
   bool has_shadows() const;
 
+  //! unpacks MCSH the first time, callers hold _shadow_map_mutex
+  std::array<uint8_t, 64 * 64>& decoded_shadow_map() const;
+
+  // chunks are saved on worker threads, the first access can come from any of them
+  std::mutex mutable _shadow_map_mutex;
+  // packed MCSH as read from the file, empty when the chunk has no shadows
+  std::vector<uint8_t> mutable _packed_shadow_map;
+  bool _fix_shadow_map_edges = false;
+  std::unique_ptr<std::array<uint8_t, 64 * 64>> mutable _shadow_map;
+
+  //! unpacks MCCV the first time, callers hold _vertex_colors_mutex
+  std::array<glm::vec3, mapbufsize>& decoded_vertex_colors() const;
+
+  std::mutex mutable _vertex_colors_mutex;
+  // MCCV as read from the file, empty when the chunk has no vertex colors
+  std::vector<uint8_t> mutable _packed_vertex_colors;
+  // blizzard stores alpha, but deosn't seem to be used
+  std::unique_ptr<std::array<glm::vec3, mapbufsize>> mutable _vertex_colors;
+
+  //! x, y and z of the vertex normals as signed bytes scaled by 127, the
+  //! precision of MCNR, packed the way update_heightmap uploads them
+  std::uint32_t _normals[mapbufsize];
+
   void update_intersect_points();
 
+  //! min/max height of a quadtree over the 8x8 quads: the root, then the 2x2, 4x4 and 8x8 levels.
+  //! Built by the first ray test after ChunkUpdateFlags::VERTEX was registered.
+  std::unique_ptr<std::array<std::array<float, 2>, 1 + 4 + 16 + 64>> _height_tree;
+  bool _height_tree_dirty = true;
+
+  void build_height_tree();
+  bool intersect_height_tree(math::ray const& ray, int level, int row, int col, selection_result* results, bool first_result);
 
 public:
   MapChunk(MapTile* mt, BlizzardArchive::ClientFile* f, bool bigAlpha, tile_mode mode, Noggit::NoggitRenderContext context
@@ -99,10 +152,11 @@ public:
   std::vector<ENTRY_MCSE> sound_emitters;
 
   glm::vec3 mVertices[mapbufsize];
-  glm::vec3 mNormals[mapbufsize];
-  glm::vec3 mccv[mapbufsize]; // blizzard stores alpha, but deosn't seem to be used
 
-  uint8_t _shadow_map[64 * 64];
+  //! Decoded 64x64 shadow map. MCSH is only unpacked the first time this is called
+  //! (rendering, editing or saving), chunks that are only preloaded keep the packed bits.
+  uint8_t* shadow_map();
+  uint8_t const* shadow_map() const;
 
   void update_shadows();
 
@@ -111,6 +165,9 @@ public:
   static int indexNoLoD(int x, int y);
   static int indexLoD(int x, int y);
 
+  void recalcNorm(int i);
+  glm::vec3 getNormal(int i) const;
+
 private:
 
   unsigned _chunk_update_flags;
@@ -162,6 +219,16 @@ public:
                    /*, std::function<std::optional<float>(float, float)> height*/
                    );
 
+  //! brush kernels: store the new height of the vertices in range in batch without
+  //! modifying the chunk, blur reads the neighbouring chunks through the world
+  void collectTerrainChange(glm::vec3 const& pos, float change, float radius, int BrushType, float inner_radius, Noggit::terrain_edit_batch& batch);
+  void collectTerrainFlatten(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const glm::vec3& origin, math::degrees angle, math::degrees orientation, Noggit::terrain_edit_batch& batch) const;
+  void collectTerrainBlur(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, Noggit::terrain_edit_batch& batch) const;
+  //! the two don't register the chunk update, which isn't thread safe, it's up to the caller
+  void applyTerrainEdit(Noggit::terrain_edit_batch const& batch);
+  //! recomputes the normals of the edited vertices and of their neighbours only
+  void recalcEditedNorms(Noggit::terrain_edit_batch const& batch);
+
   bool changeTerrainProcessVertex(glm::vec3 const& pos, glm::vec3 const& vertex, float& dt, float radiusOuter, float radiusInner, int brushType);
   auto stamp(glm::vec3 const& pos, float dt, QImage const* img, float radiusOuter
   , float radiusInner, int brushType, bool sculpt) -> void;
@@ -203,9 +270,10 @@ public:
   void clearHeight();
 
   //! \todo this is ugly create a build struct or sth
+  //! Only reads the chunk's own data and the shared tables so chunks of a tile can be
+  //! saved concurrently, each into its own array. MCIN is filled by the caller.
   void save(util::sExtendableArray &lADTFile
             , int &lCurrentPosition
-            , int &lMCIN_Position
             , std::map<std::string, int> &lTextures
             , std::vector<WMOInstance*> &lObjectInstances
             , std::vector<ModelInstance*>& lModelInstances
@@ -218,11 +286,17 @@ public:
   bool fixGapAbove(const MapChunk* chunk);
 
   glm::vec3* getHeightmap();;
-  glm::vec3 const* getNormals() const;
-  glm::vec3* getVertexColors();;
+  //! MCCV is only decoded the first time this is called (rendering, editing or
+  //! saving), chunks without vertex colors get the neutral color
+  glm::vec3* getVertexColors();
+  glm::vec3 const* getVertexColors() const;
 
+  //! heights and normals, to the tile heightmap texture bound to the active unit
+  void update_heightmap();
   void update_vertex_colors();
 
+  terrain_memory_usage memoryUsage() const;
+
   QImage getHeightmapImage(float min_height, float max_height);
   QImage getAlphamapImage(unsigned layer);
   QImage getVertexColorImage();
@@ -231,7 +305,24 @@ public:
   void setVertexColorImage(QImage const& image);
   void initMCCV();
 
+  //! flags the data as modified, for both the renderer and the next save
   void registerChunkUpdate(unsigned flags);
+  //! queues the update again for the renderer only, the data itself didn't change
+  void deferChunkUpdate(unsigned flags);
   void endChunkUpdates();
   unsigned getUpdateFlags() const;
+
+  //! ChunkUpdateFlags registered since MapTile::save last wrote this chunk, saving
+  //! reuses the bytes it wrote for chunks which have none. Everything is dirty
+  //! until the chunk is saved once.
+  unsigned dirtyFlags() const { return _dirty_flags.load(); }
+  //! for changes not going through registerChunkUpdate, by default the chunk is
+  //! serialized again whatever changed
+  void markDirty(unsigned flags = ~0u) { _dirty_flags.fetch_or(flags); }
+  void clearDirty() { _dirty_flags = 0; }
+  //! clears the flags and returns them, for a save which may have to restore them
+  unsigned takeDirty() { return _dirty_flags.exchange(0); }
+
+private:
+  std::atomic<unsigned> _dirty_flags = ~0u;
 };
@@ -10,6 +10,7 @@
 #include <noggit/ModelInstance.h> // ModelInstance
 #include <noggit/ModelManager.h> // ModelManager
 #include <noggit/project/CurrentProject.hpp>
+#include <noggit/save_queue.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/TileWater.hpp>
 #include <noggit/WMOInstance.h> // WMOInstance
@@ -20,17 +21,91 @@
 
 #include <ClientFile.hpp>
 
+#include <util/hash.hpp>
 #include <util/sExtendableArray.hpp>
+#include <util/thread_pool.hpp>
+
+#include <external/tracy/Tracy.hpp>
 
 #include <QtCore/QSettings>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+namespace
+{
+  //! what MapChunk::save reads outside of the chunk: the MTEX ids of the textures,
+  //! the MCRF indices of the instances overlapping the chunk and the liquid format.
+  //! The model indices depend on the order of MDDF, which the size class sort changes
+  std::size_t save_context_hash ( std::map<std::string, int> const& textures
+                                , std::vector<WMOInstance*> const& wmos
+                                , std::vector<ModelInstance*> const& models
+                                , bool use_mclq_liquids
+                                , bool sort_models_by_size_class
+                                )
+  {
+    std::size_t seed = use_mclq_liquids;
+    util::hash_combine(seed, sort_models_by_size_class);
+
+    for (auto const& texture : textures)
+    {
+      util::hash_combine(seed, texture.first);
+    }
+
+    auto const add_instances = [&] (auto const& instances)
+    {
+      util::hash_combine(seed, instances.size());
+
+      for (SceneObject* instance : instances)
+      {
+        auto const& extents = instance->getExtents();
+
+        // only the position on the ground plane matters, see misc::rectOverlap
+        util::hash_combine(seed, extents[0].x);
+        util::hash_combine(seed, extents[0].z);
+        util::hash_combine(seed, extents[1].x);
+        util::hash_combine(seed, extents[1].z);
+      }
+    };
+
+    add_instances(wmos);
+    add_instances(models);
+
+    if (sort_models_by_size_class)
+    {
+      for (ModelInstance* model : models)
+      {
+        util::hash_combine(seed, model->size_cat);
+      }
+    }
+
+    return seed;
+  }
+
+  bool is_saved_chunk(std::vector<char> const& file, std::uint32_t offset, std::uint32_t size)
+  {
+    std::uint32_t magic;
+
+    if (size < sizeof(magic) || std::size_t(offset) + size > file.size())
+    {
+      return false;
+    }
+
+    std::memcpy(&magic, file.data() + offset, sizeof(magic));
+
+    return magic == 'MCNK';
+  }
+}
 
 MapTile::MapTile( int pX
                 , int pZ
@@ -74,6 +149,14 @@ MapTile::MapTile( int pX
 }
 
 MapTile::~MapTile()
+{
+  if (!_instances_released)
+  {
+    releaseInstances();
+  }
+}
+
+void MapTile::releaseInstances()
 {
   {
     std::lock_guard<std::mutex> const lock(_mutex);
@@ -88,10 +171,22 @@ MapTile::~MapTile()
   }
 
   _world->remove_models_if_needed(uids);
+  _instances_released = true;
+}
+
+void MapTile::unloadRenderers()
+{
+  _renderer.unload();
+  _fl_bounds_render.unload();
+  Water.renderer()->unload();
 }
 
 void MapTile::waitForChildrenLoaded()
 {
+  // everything referenced by the file was queued as a child of this tile
+  wait_for_children();
+
+  // objects added after loading are not part of the group, those checks are cheap once loaded
   for (auto& instance : object_instances)
   {
     instance.first->wait_until_loaded();
@@ -116,6 +211,9 @@ void MapTile::finishLoading()
   if (finished)
     return;
 
+  // reloaded while its last save is still being written
+  Noggit::save_queue::instance().wait_for(_file_key.filepath());
+
   BlizzardArchive::ClientFile theFile(_file_key, Noggit::Application::NoggitApplication::instance()->clientData());
 
   Log << "Opening tile " << index.x << ", " << index.z << " (\"" << _file_key.stringRepr() << "\") from " << (theFile.isExternal() ? "disk" : "MPQ") << "." << std::endl;
@@ -124,8 +222,12 @@ void MapTile::finishLoading()
 
   // We store this data to load it at the end.
   uint32_t lMCNKOffsets[256];
-  std::vector<ENTRY_MDDF> lModelInstances;
-  std::vector<ENTRY_MODF> lWMOInstances;
+
+  // MDDF / MODF entries are used in place, the file stays open until the instances are created
+  ENTRY_MDDF const* mddf_ptr = nullptr;
+  std::size_t mddf_count = 0;
+  ENTRY_MODF const* modf_ptr = nullptr;
+  std::size_t modf_count = 0;
 
   std::vector<std::string> mModelFilenames;
   std::vector<std::string> mWMOFilenames;
@@ -241,11 +343,8 @@ void MapTile::finishLoading()
 
     assert(fourcc == 'MDDF');
 
-    ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(theFile.getPointer());
-    for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
-    {
-      lModelInstances.push_back(mddf_ptr[i]);
-    }
+    mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(theFile.getPointer());
+    mddf_count = size / sizeof(ENTRY_MDDF);
 
     // - MODF ----------------------------------------------
 
@@ -255,13 +354,8 @@ void MapTile::finishLoading()
 
     assert(fourcc == 'MODF');
 
-    ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(theFile.getPointer());
-    for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
-    {
-      lWMOInstances.push_back(modf_ptr[i]);
-      if(lWMOInstances[i].scale == 0.0f)
-        lWMOInstances[i].scale = 1024.0f;
-    }
+    modf_ptr = reinterpret_cast<ENTRY_MODF const*>(theFile.getPointer());
+    modf_count = size / sizeof(ENTRY_MODF);
   }
 
   // - MISC ----------------------------------------------
@@ -348,16 +442,28 @@ void MapTile::finishLoading()
   {
     // - Load WMOs -----------------------------------------
 
-    for (auto const& object : lWMOInstances)
+    for (std::size_t i = 0; i < modf_count; ++i)
     {
-      add_model(_world->add_wmo_instance(WMOInstance(mWMOFilenames[object.nameID],
-                                                     &object, _context), _tile_is_being_reloaded, false));
+      ENTRY_MODF const* object = &modf_ptr[i];
+
+      // only copy the entries that need to be patched
+      ENTRY_MODF fixed_scale;
+      if (object->scale == 0)
+      {
+        fixed_scale = *object;
+        fixed_scale.scale = 1024;
+        object = &fixed_scale;
+      }
+
+      add_model(_world->add_wmo_instance(WMOInstance(mWMOFilenames[object->nameID],
+                                                     object, _context), _tile_is_being_reloaded, false));
     }
 
     // - Load M2s ------------------------------------------
 
-    for (auto const& model : lModelInstances)
+    for (std::size_t i = 0; i < mddf_count; ++i)
     {
+      ENTRY_MDDF const& model = mddf_ptr[i];
       add_model(_world->add_model_instance(ModelInstance(mModelFilenames[model.nameID],
                                                          &model, _context), _tile_is_being_reloaded, false));
     }
@@ -447,6 +553,9 @@ void MapTile::convert_alphamap(bool to_big_alpha)
       mChunks[i][j]->use_big_alphamap = to_big_alpha;
     }
   }
+
+  // the alphamaps of every chunk are written in the new format
+  markAllChunksDirty();
 }
 
 
@@ -565,10 +674,193 @@ void MapTile::saveTile(World* world)
   save(world, use_mclq);
 }
 
+bool MapTile::settleSave(bool wait)
+{
+  if (!_pending_save)
+  {
+    return true;
+  }
+
+  if (wait)
+  {
+    Noggit::save_queue::instance().wait_for(_file_key.filepath());
+  }
+
+  std::optional<bool> const written = Noggit::save_queue::instance().result(_pending_save->ticket);
+
+  if (!written)
+  {
+    return false;
+  }
+
+  if (!*written)
+  {
+    LogError << "ADT \"" << _file_key.stringRepr() << "\" wasn't written, its changes are kept for the next save." << std::endl;
+
+    for (int i = 0; i < 16; ++i)
+    {
+      for (int j = 0; j < 16; ++j)
+      {
+        mChunks[i][j]->markDirty(_pending_save->dirty_flags[i * 16 + j]);
+      }
+    }
+
+    // the file on disk isn't the one the layout describes
+    _saved_layout.reset();
+    changed = true;
+  }
+
+  _pending_save.reset();
+
+  return true;
+}
+
 void MapTile::save(World* world, bool save_using_mclq_liquids)
 {
   Log << "Saving ADT \"" << _file_key.stringRepr() << "\"." << std::endl;
 
+  // a previous write which failed in the meantime is saved again by this one
+  settleSave();
+
+  serialized_tile tile = serialize(world, save_using_mclq_liquids, chunk_writer::incremental);
+
+  // nothing changed in the chunks nor around them (a tile flagged by a read only helper),
+  // the file on disk is already up to date
+  if (tile.unchanged)
+  {
+    Log << "ADT \"" << _file_key.stringRepr() << "\" didn't change, not writing it." << std::endl;
+    return;
+  }
+
+  std::size_t const file_size = tile.data.size();
+
+  // only the writing happens in the background, the buffer is a snapshot of the tile
+  Noggit::save_queue::ticket const ticket = Noggit::save_queue::instance().write(_file_key.filepath(), std::move(tile.data));
+
+  // adspartan's way, save MCLQ files separately
+  /*
+      if (save_using_mclq_liquids)
+  {
+    f.save_file_to_folder(NoggitSettings.value("project/mclq_liquids_path").toString().toStdString());
+  }
+  else
+  {
+    f.save();
+  }*/
+
+  // the chunks are clean relative to the file queued, their flags are kept until
+  // it's written, along with those of a previous save still pending
+  _saved_layout = saved_chunks_layout{file_size, tile.context_hash, tile.offsets, tile.sizes};
+
+  pending_save pending {ticket, {}};
+
+  for (int i = 0; i < 16; ++i)
+  {
+    for (int j = 0; j < 16; ++j)
+    {
+      unsigned const previous = _pending_save ? _pending_save->dirty_flags[i * 16 + j] : 0u;
+      pending.dirty_flags[i * 16 + j] = previous | mChunks[i][j]->takeDirty();
+    }
+  }
+
+  _pending_save = pending;
+}
+
+MapTile::serialization_check MapTile::checkSerialization(World* world)
+{
+  ZoneScoped;
+
+  using clock = std::chrono::steady_clock;
+
+  auto const to_ms = [] (clock::duration duration)
+  {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  clock::time_point const serial_start = clock::now();
+  serialized_tile const serial = serialize(world, false, chunk_writer::serial);
+  clock::time_point const parallel_start = clock::now();
+  serialized_tile const parallel = serialize(world, false, chunk_writer::parallel);
+  clock::time_point const end = clock::now();
+
+  serialization_check check {serial.data.size(), parallel.data.size(), std::nullopt, to_ms(parallel_start - serial_start), to_ms(end - parallel_start)};
+
+  auto const mismatch = std::mismatch(serial.data.begin(), serial.data.end(), parallel.data.begin(), parallel.data.end());
+
+  if (mismatch.first != serial.data.end() || mismatch.second != parallel.data.end())
+  {
+    check.first_difference = static_cast<std::size_t>(mismatch.first - serial.data.begin());
+  }
+
+  return check;
+}
+
+MapTile::incremental_check MapTile::checkIncrementalSerialization(World* world, std::size_t edited_chunks)
+{
+  ZoneScoped;
+
+  using clock = std::chrono::steady_clock;
+
+  auto const to_ms = [] (clock::duration duration)
+  {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  clock::time_point const full_start = clock::now();
+  serialized_tile const full = serialize(world, false, chunk_writer::parallel);
+  clock::time_point const full_end = clock::now();
+
+  // pretend the full file was just saved and only the edited chunks changed since
+  std::optional<saved_chunks_layout> const saved_layout = _saved_layout;
+  std::array<unsigned, 256> dirty_flags;
+
+  for (std::size_t i = 0; i < 256; ++i)
+  {
+    MapChunk* chunk = mChunks[i / 16][i % 16].get();
+    dirty_flags[i] = chunk->dirtyFlags();
+    chunk->clearDirty();
+
+    if (i < edited_chunks)
+    {
+      chunk->markDirty();
+    }
+  }
+
+  _saved_layout = saved_chunks_layout{full.data.size(), full.context_hash, full.offsets, full.sizes};
+
+  clock::time_point const incremental_start = clock::now();
+  serialized_tile const incremental = serialize(world, false, chunk_writer::incremental, &full.data);
+  clock::time_point const incremental_end = clock::now();
+
+  _saved_layout = saved_layout;
+
+  for (std::size_t i = 0; i < 256; ++i)
+  {
+    MapChunk* chunk = mChunks[i / 16][i % 16].get();
+    chunk->clearDirty();
+    chunk->markDirty(dirty_flags[i]);
+  }
+
+  incremental_check check { incremental.data.size(), incremental.reused_chunks, std::nullopt
+                          , to_ms(full_end - full_start), to_ms(incremental_end - incremental_start)
+                          };
+
+  auto const mismatch = std::mismatch(full.data.begin(), full.data.end(), incremental.data.begin(), incremental.data.end());
+
+  if (mismatch.first != full.data.end() || mismatch.second != incremental.data.end())
+  {
+    check.first_difference = static_cast<std::size_t>(mismatch.first - full.data.begin());
+  }
+
+  return check;
+}
+
+MapTile::serialized_tile MapTile::serialize( World* world
+                                           , bool save_using_mclq_liquids
+                                           , chunk_writer writer
+                                           , std::vector<char> const* previous_file
+                                           )
+{
   int lID;  // This is a global counting variable. Do not store something in here you need later.
   std::vector<WMOInstance*> lObjectInstances;
   std::vector<ModelInstance*> lModelInstances;
@@ -892,14 +1184,125 @@ void MapTile::save(World* world, bool save_using_mclq_liquids)
   }
 
   // MCNK
-  for (int y = 0; y < 16; ++y)
+  // every chunk is serialized on its own in parallel, then copied into its slice of the file.
+  // chunks which didn't change since the last save are copied from the file it wrote instead
+  std::vector<char> lPreviousFile;
+  std::size_t const lContextHash = save_context_hash(lTextures, lObjectInstances, lModelInstances, save_using_mclq_liquids, world->mapIndex.sort_models_by_size_class());
+  std::array<std::uint32_t, 256> lMCNK_Offsets;
+  std::array<std::uint32_t, 256> lMCNK_Sizes;
+  std::size_t lReusedChunks = 0;
+
+  // the water can be saved in the chunks, their bytes then depend on it too
+  if (writer == chunk_writer::incremental && _saved_layout && _saved_layout->context_hash == lContextHash && !save_using_mclq_liquids)
   {
-    for (int x = 0; x < 16; ++x)
+    if (previous_file)
+    {
+      if (previous_file->size() == _saved_layout->file_size)
+      {
+        lPreviousFile = *previous_file;
+      }
+    }
+    // the last save may not have reached the disk yet
+    else if (auto pending = Noggit::save_queue::instance().pending(_file_key.filepath()))
+    {
+      if (pending->size() == _saved_layout->file_size)
+      {
+        lPreviousFile = *pending;
+      }
+    }
+    else
     {
-      mChunks[y][x]->save(lADTFile, lCurrentPosition, lMCIN_Position, lTextures, lObjectInstances, lModelInstances, save_using_mclq_liquids);
+      // read without a lock like every other ClientFile, see BLPRenderer::load_thumbnail
+      BlizzardArchive::ClientFile f(_file_key.filepath(), Noggit::Application::NoggitApplication::instance()->clientData());
+
+      if (f.isExternal() && f.getSize() == _saved_layout->file_size)
+      {
+        lPreviousFile.resize(f.getSize());
+        f.read(lPreviousFile.data(), lPreviousFile.size());
+      }
     }
   }
 
+  if (writer == chunk_writer::serial)
+  {
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      int const lMCNK_Position = lCurrentPosition;
+      mChunks[i / 16][i % 16]->save(lADTFile, lCurrentPosition, lTextures, lObjectInstances, lModelInstances, save_using_mclq_liquids);
+
+      lMCNK_Offsets[i] = lMCNK_Position;
+      lMCNK_Sizes[i] = lCurrentPosition - lMCNK_Position;
+    }
+
+    auto const lMCIN = lADTFile.GetPointer<MCIN>(lMCIN_Position + 8);
+
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      MapChunk const* chunk = mChunks[i / 16][i % 16].get();
+      auto& entry = lMCIN->mEntries[chunk->py * 16 + chunk->px];
+      entry.offset = lMCNK_Offsets[i];
+      entry.size = lMCNK_Sizes[i];
+    }
+  }
+  else
+  {
+    std::array<util::sExtendableArray, 256> lMCNKs;
+    std::array<bool, 256> lReused;
+
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      lReused[i] = !lPreviousFile.empty() && !mChunks[i / 16][i % 16]->dirtyFlags()
+        && is_saved_chunk(lPreviousFile, _saved_layout->offsets[i], _saved_layout->sizes[i]);
+
+      if (lReused[i])
+      {
+        lMCNK_Sizes[i] = _saved_layout->sizes[i];
+        lReusedChunks++;
+      }
+    }
+
+    util::thread_pool::instance().parallel_for(256, [&] (std::size_t i)
+    {
+      if (lReused[i])
+      {
+        return;
+      }
+
+      int lMCNK_Position = 0;
+      mChunks[i / 16][i % 16]->save(lMCNKs[i], lMCNK_Position, lTextures, lObjectInstances, lModelInstances, save_using_mclq_liquids);
+      lMCNK_Sizes[i] = lMCNK_Position;
+    });
+
+    std::uint32_t lMCNKs_Size = 0;
+
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      lMCNK_Offsets[i] = lCurrentPosition + lMCNKs_Size;
+      lMCNKs_Size += lMCNK_Sizes[i];
+    }
+
+    lADTFile.Extend(lMCNKs_Size);
+
+    auto const lMCIN = lADTFile.GetPointer<MCIN>(lMCIN_Position + 8);
+
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      MapChunk const* chunk = mChunks[i / 16][i % 16].get();
+      auto& entry = lMCIN->mEntries[chunk->py * 16 + chunk->px];
+      entry.offset = lMCNK_Offsets[i];
+      entry.size = lMCNK_Sizes[i];
+    }
+
+    util::thread_pool::instance().parallel_for(256, [&] (std::size_t i)
+    {
+      char const* source = lReused[i] ? lPreviousFile.data() + _saved_layout->offsets[i]
+                                      : lMCNKs[i].GetPointer<char>().get();
+      std::memcpy(lADTFile.GetPointer<char>(lMCNK_Offsets[i]).get(), source, lMCNK_Sizes[i]);
+    });
+
+    lCurrentPosition += lMCNKs_Size;
+  }
+
   // MFBO
   if (mFlags & 1)
   {
@@ -942,32 +1345,31 @@ void MapTile::save(World* world, bool save_using_mclq_liquids)
   }
 #endif
 
-  {
-    BlizzardArchive::ClientFile f(_file_key.filepath(), Noggit::Application::NoggitApplication::instance()->clientData()
-      , BlizzardArchive::ClientFile::NEW_FILE);
-    // \todo This sounds wrong. There shouldn't *be* unused nulls to
-    // begin with.
-    f.setBuffer(lADTFile.data_up_to(lCurrentPosition)); // cleaning unused nulls at the end of file
-    f.save();
+  LogDebug << "Reused " << lReusedChunks << " unchanged chunks out of 256" << std::endl;
+
+  bool const unchanged = lReusedChunks == 256 && lPreviousFile.size() == static_cast<std::size_t>(lCurrentPosition)
+    && !std::memcmp(lPreviousFile.data(), lADTFile.GetPointer<char>().get(), lPreviousFile.size());
+
+  // \todo This sounds wrong. There shouldn't *be* unused nulls to
+  // begin with.
+  return {lADTFile.data_up_to(lCurrentPosition), lContextHash, lMCNK_Offsets, lMCNK_Sizes, lReusedChunks, unchanged}; // cleaning unused nulls at the end of file
+}
+
 
-    // adspartan's way, save MCLQ files separately
-    /*
-        if (save_using_mclq_liquids)
+void MapTile::markAllChunksDirty()
+{
+  for (int i = 0; i < 16; ++i)
+  {
+    for (int j = 0; j < 16; ++j)
     {
-      f.save_file_to_folder(NoggitSettings.value("project/mclq_liquids_path").toString().toStdString());
+      if (mChunks[i][j])
+      {
+        mChunks[i][j]->markDirty();
+      }
     }
-    else
-    {
-      f.save();
-    }*/
   }
-
-  lObjectInstances.clear();
-  lModelInstances.clear();
-  lModels.clear();
 }
 
-
 void MapTile::CropWater()
 {
   for (int z = 0; z < 16; ++z)
@@ -1007,6 +1409,7 @@ void MapTile::remove_model(uint32_t uid)
 
     instance->derefTile(this);
     _requires_object_extents_recalc = true;
+    _world->markModelInstancesDirty();
   }
 }
 
@@ -1035,6 +1438,7 @@ void MapTile::remove_model(SceneObject* instance)
     }
 
     _requires_object_extents_recalc = true;
+    _world->markModelInstancesDirty();
   }
 }
 
@@ -1070,6 +1474,7 @@ void MapTile::add_model(uint32_t uid)
     }
 
     instance->refTile(this);
+    _world->markModelInstancesDirty();
   }
 }
 
@@ -1103,6 +1508,7 @@ void MapTile::add_model(SceneObject* instance)
     }
 
     instance->refTile(this);
+    _world->markModelInstancesDirty();
   }
 }
 
@@ -1124,11 +1530,9 @@ void MapTile::initEmptyChunks()
   }
 }
 
-QImage MapTile::getHeightmapImage(float min_height, float max_height)
+std::vector<float> MapTile::getHeightmapSamples()
 {
-    // grayscale 16 doesn't work, it rounds values or is actually 8bit
-    QImage image(257, 257, QImage::Format_RGBA64);
-    int depth = image.depth();
+  std::vector<float> samples(257 * 257);
 
   unsigned const LONG{9}, SHORT{8}, SUM{LONG + SHORT}, DSUM{SUM * 2};
 
@@ -1149,14 +1553,33 @@ QImage MapTile::getHeightmapImage(float min_height, float max_height)
           bool const erp = plain % DSUM / SUM;
           unsigned const idx {(plain - (is_virtual ? (erp ? SUM : 1) : 0)) / 2};
           float value = is_virtual ? (heightmap[idx].y + heightmap[idx + (erp ? SUM : 1)].y) / 2.f : heightmap[idx].y;
-          value = std::min(1.0f, std::max(0.0f, ((value - min_height) / (max_height - min_height))));
-          image.setPixelColor((k * 16) + x,  (l * 16) + y, QColor::fromRgbF(value, value, value, 1.0)); // grayscale uses alpha channel ?
+          samples[((l * 16) + y) * 257 + (k * 16) + x] = value;
         }
       }
     }
   }
 
-  return std::move(image);
+  return samples;
+}
+
+QImage MapTile::getHeightmapImage(float min_height, float max_height)
+{
+  // grayscale 16 doesn't work, it rounds values or is actually 8bit
+  QImage image(257, 257, QImage::Format_RGBA64);
+
+  std::vector<float> const samples = getHeightmapSamples();
+
+  for (int y = 0; y < 257; ++y)
+  {
+    for (int x = 0; x < 257; ++x)
+    {
+      float value = samples[y * 257 + x];
+      value = std::min(1.0f, std::max(0.0f, ((value - min_height) / (max_height - min_height))));
+      image.setPixelColor(x, y, QColor::fromRgbF(value, value, value, 1.0)); // grayscale uses alpha channel ?
+    }
+  }
+
+  return image;
 }
 
 QImage MapTile::getNormalmapImage()
@@ -1171,8 +1594,6 @@ QImage MapTile::getNormalmapImage()
     {
       MapChunk* chunk = getChunk(k, l);
 
-      const glm::vec3* normals = chunk->getNormals();
-
       for (unsigned y = 0; y < SUM; ++y)
       {
         for (unsigned x = 0; x < SUM; ++x)
@@ -1182,8 +1603,8 @@ QImage MapTile::getNormalmapImage()
           bool const erp = plain % DSUM / SUM;
           unsigned const idx {(plain - (is_virtual ? (erp ? SUM : 1) : 0)) / 2};
 
-          auto normal = glm::normalize(normals[idx]);
-          auto normal_inner = glm::normalize(normals[idx + (erp ? SUM : 1)]);
+          auto normal = glm::normalize(chunk->getNormal(idx));
+          auto normal_inner = glm::normalize(chunk->getNormal(idx + (erp ? SUM : 1)));
 
           float value_r = is_virtual ? (normal.x + normal_inner.x) / 2.f : normal.x;
           float value_g = is_virtual ? (normal.y + normal_inner.y) / 2.f : normal.y;
@@ -1212,16 +1633,15 @@ QImage MapTile::getAlphamapImage(unsigned layer)
       if (layer >= chunk->texture_set->num())
         continue;
 
-      chunk->texture_set->apply_alpha_changes();
-      auto alphamaps = chunk->texture_set->getAlphamaps();
-
-      auto alpha_layer = *alphamaps->at(layer - 1);
+      // read only, the tile may be converted off the ui thread
+      auto const alphamaps = chunk->texture_set->alphamap_values();
+      auto const& alpha_layer = alphamaps[layer - 1];
 
       for (int k = 0; k < 64; ++k)
       {
         for (int l = 0; l < 64; ++l)
         {
-          int value = alpha_layer.getAlpha(64 * l + k);
+          int value = alpha_layer[64 * l + k];
           image.setPixelColor((i * 64) + k, (j * 64) + l, QColor(value, value, value, 255));
         }
       }
@@ -1267,8 +1687,8 @@ QImage MapTile::getAlphamapImage(std::string const& filename)
       }
       else
       {
-        chunk->texture_set->apply_alpha_changes();
-        auto alphamaps = chunk->texture_set->getAlphamaps();
+        // read only, the tile may be converted off the ui thread
+        auto const alphamaps = chunk->texture_set->alphamap_values();
 
         for (int k = 0; k < 64; ++k)
         {
@@ -1277,22 +1697,16 @@ QImage MapTile::getAlphamapImage(std::string const& filename)
             if (layer == 0)
             {
               // WoW calculates layer 0 as 255 - sum(Layer[1]...Layer[3])
-              int layers_sum = 0;
-              if (alphamaps->at(0))
-                  layers_sum += alphamaps->at(0)->getAlpha(64 * l + k);
-              if (alphamaps->at(1))
-                  layers_sum += alphamaps->at(1)->getAlpha(64 * l + k);
-              if (alphamaps->at(2))
-                  layers_sum += alphamaps->at(2)->getAlpha(64 * l + k);
+              int layers_sum = alphamaps[0][64 * l + k] + alphamaps[1][64 * l + k] + alphamaps[2][64 * l + k];
               
               int value = std::clamp((255 - layers_sum), 0, 255);
               image.setPixelColor((i * 64) + k, (j * 64) + l, QColor(value, value, value, 255));
             }
             else // layer 1-3
             {
-                auto& alpha_layer = *alphamaps->at(layer - 1);
+              auto const& alpha_layer = alphamaps[layer - 1];
 
-              int value = alpha_layer.getAlpha(64 * l + k);
+              int value = alpha_layer[64 * l + k];
               image.setPixelColor((i * 64) + k, (j * 64) + l, QColor(value, value, value, 255));
             }
           }
@@ -1310,6 +1724,23 @@ void MapTile::setHeightmapImage(QImage const& baseimage, float min_height, float
 
   float const height_range = (max_height - min_height);
 
+  // a tiled edges image is 256x256, the last row and column are never read
+  std::vector<float> heights(257 * 257, 0.f);
+
+  for (int y = 0; y < std::min(257, image.height()); ++y)
+  {
+    for (int x = 0; x < std::min(257, image.width()); ++x)
+    {
+      double const ratio = image.pixelColor(x, y).redF(); // 0.0 - 1.0
+      heights[y * 257 + x] = height_range * ratio + min_height;
+    }
+  }
+
+  setHeightmapSamples(heights, mode, tiledEdges);
+}
+
+void MapTile::setHeightmapSamples(std::vector<float> const& heights, int mode, bool tiledEdges)
+{
   unsigned const LONG{9}, SHORT{8}, SUM{LONG + SHORT}, DSUM{SUM * 2};
   for (int k = 0; k < 16; ++k)
   {
@@ -1338,67 +1769,26 @@ void MapTile::setHeightmapImage(QImage const& baseimage, float min_height, float
               continue;
           }
 
-          switch (image.depth())
-          {
-            case 8:
-            case 16:
-            case 32:
-            {
-              float const ratio = qGray(image.pixel((k * 16) + x, (l * 16) + y)) / 255.0f; // 0.0 - 1.0
-              float const new_height = (height_range * ratio) + min_height;
-
-              float test_newheight = (ratio + min_height) * (height_range);
-
-              switch (mode)
-              {
-                case 0: // Set
-                  heightmap[idx].y = new_height;
-                  break;
-
-                case 1: // Add
-                  heightmap[idx].y += new_height;
-                  break;
-
-                case 2: // Subtract
-                  heightmap[idx].y -= new_height;
-                  break;
-
-                case 3: // Multiply
-                  heightmap[idx].y *= new_height;
-                  break;
-              }
+          float const new_height = heights[((l * 16) + y) * 257 + (k * 16) + x];
 
+          switch (mode)
+          {
+            case 0: // Set
+              heightmap[idx].y = new_height;
               break;
-            }
-
-            case 64:
-            {
-              double const ratio = image.pixelColor((k * 16) + x, (l * 16) + y).redF(); // 0.0 - 1.0
-              float new_height = height_range * ratio + min_height;
-
-              switch (mode)
-              {
-                case 0: // Set
-                  heightmap[idx].y = new_height;
-                  break;
-
-                case 1: // Add
-                  heightmap[idx].y += new_height;
-                  break;
 
-                case 2: // Subtract
-                  heightmap[idx].y -= new_height;
-                  break;
+            case 1: // Add
+              heightmap[idx].y += new_height;
+              break;
 
-                case 3: // Multiply
-                  heightmap[idx].y *= new_height;
-                  break;
-              }
+            case 2: // Subtract
+              heightmap[idx].y -= new_height;
+              break;
 
+            case 3: // Multiply
+              heightmap[idx].y *= new_height;
               break;
-            }
           }
-
         }
 
       registerChunkUpdate(ChunkUpdateFlags::VERTEX);
@@ -1728,9 +2118,24 @@ void MapTile::endChunkUpdates()
   _chunk_update_flags = 0;
 }
 
-std::array<float, 145 * 256 * 4>& MapTile::getChunkHeightmapBuffer()
+terrain_memory_usage MapTile::memoryUsage() const
 {
-  return _chunk_heightmap_buffer;
+  terrain_memory_usage usage;
+
+  for (auto const& row : mChunks)
+  {
+    for (auto const& chunk : row)
+    {
+      if (chunk)
+      {
+        usage += chunk->memoryUsage();
+      }
+    }
+  }
+
+  usage.gpu = _renderer.memoryUsage();
+
+  return usage;
 }
 
 unsigned MapTile::getChunkUpdateFlags() const
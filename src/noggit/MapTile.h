@@ -15,7 +15,9 @@
 #include <external/tsl/robin_map.h>
 
 #include <array>
+#include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -27,6 +29,7 @@ namespace math
 }
 
 class MapChunk;
+struct terrain_memory_usage;
 struct texture_heightmapping_data;
 class World;
 
@@ -53,6 +56,13 @@ public:
          );
   ~MapTile();
 
+  //! Drops the references of the object instances to this tile, done by the
+  //! destructor unless called before. Must run on the thread owning the world.
+  void releaseInstances();
+  //! Frees the OpenGL objects of the terrain, water and flight bounds, the
+  //! tile can then be destroyed without a context.
+  void unloadRenderers();
+
   void finishLoading() override;
   void waitForChildrenLoaded() override;
 
@@ -105,9 +115,98 @@ public:
 	void CropWater();
   void saveTile(World* world);
 
+  //! the last save is queued and not yet known to be written
+  bool savePending() const { return _pending_save.has_value(); }
+  //! Checks on the write of the last save once it's done, a failed one flags
+  //! the tile and its chunks as changed again. Returns false while it's pending,
+  //! unless \a wait blocks until the file is written.
+  bool settleSave(bool wait = false);
+
+  //! for changes which weren't tracked per chunk, the next save serializes everything
+  void markAllChunksDirty();
+
+  struct serialization_check
+  {
+    std::size_t serial_size;
+    std::size_t parallel_size;
+    //! offset of the first differing byte, the size of the shortest file when one is a prefix of the other
+    std::optional<std::size_t> first_difference;
+    double serial_ms;
+    double parallel_ms;
+  };
+
+  //! Serializes the tile with the MCNKs written one after another into the file,
+  //! as the writer did before chunks were saved in parallel, then with the
+  //! parallel writer, and compares both. Nothing is written nor marked clean.
+  serialization_check checkSerialization(World* world);
+
+  struct incremental_check
+  {
+    std::size_t size;
+    std::size_t reused_chunks;
+    //! offset of the first byte differing from the full serialization
+    std::optional<std::size_t> first_difference;
+    double full_ms;
+    double incremental_ms;
+  };
+
+  //! Serializes the tile in full, then again with every chunk but the first
+  //! \a edited_chunks copied from that file, as the save following an edit of
+  //! those chunks does, and compares both. Nothing is written, the dirty flags
+  //! and the layout of the last save are left as they were.
+  incremental_check checkIncrementalSerialization(World* world, std::size_t edited_chunks);
+
 private:
+  //! how MapTile::serialize writes the MCNKs
+  enum class chunk_writer
+  {
+    incremental, //!< in parallel, unchanged chunks are copied from the last saved file
+    parallel,
+    serial,
+  };
+
+  struct serialized_tile
+  {
+    std::vector<char> data;
+    std::size_t context_hash;
+    std::array<std::uint32_t, 256> offsets;
+    std::array<std::uint32_t, 256> sizes;
+    std::size_t reused_chunks;
+    //! every chunk was reused and the file is the same as the last saved one
+    bool unchanged;
+  };
+
+  //! \a previous_file replaces the file of the last save, read from the save queue or the disk otherwise
+  serialized_tile serialize( World* world
+                           , bool save_using_mclq_liquids
+                           , chunk_writer writer
+                           , std::vector<char> const* previous_file = nullptr
+                           );
   void save(World* world, bool save_using_mclq_liquids);
 
+  //! Where the MCNKs are in the file written by the last save. A chunk without
+  //! dirty flags is copied from there by the next save, as long as what its
+  //! MCNK depends on outside of the chunk (texture ids, object references) is
+  //! the same, which context_hash stands for.
+  struct saved_chunks_layout
+  {
+    std::size_t file_size;
+    std::size_t context_hash;
+    std::array<std::uint32_t, 256> offsets;
+    std::array<std::uint32_t, 256> sizes;
+  };
+
+  std::optional<saved_chunks_layout> _saved_layout;
+
+  //! dirty flags the chunks had before the save which queued \a ticket
+  struct pending_save
+  {
+    std::uint64_t ticket;
+    std::array<unsigned, 256> dirty_flags;
+  };
+
+  std::optional<pending_save> _pending_save;
+
 public:
 
   bool isTile(int pX, int pZ);
@@ -133,19 +232,24 @@ public:
 
   void setFilename(const std::string& new_filename) {_file_key.setFilepath(new_filename);};
 
+  //! 257x257 heights, row by row, the vertices between the outer ones are interpolated
+  std::vector<float> getHeightmapSamples();
   QImage getHeightmapImage(float min_height, float max_height);
   QImage getAlphamapImage(unsigned layer);
   QImage getAlphamapImage(std::string const& filename);
   QImage getVertexColorsImage();
   QImage getNormalmapImage();
   void setHeightmapImage(QImage const& baseimage, float min_height, float max_height, int mode, bool tiledEdges);
+  //! heights laid out like getHeightmapSamples, combined with the current ones according to mode
+  void setHeightmapSamples(std::vector<float> const& heights, int mode, bool tiledEdges);
   // void setWatermapImage(QImage const& baseimage, float multiplier, int mode, bool tiledEdges);
   void setAlphaImage(QImage const& image, unsigned layer, bool cleanup);
   void setVertexColorImage(QImage const& image, int mode, bool tiledEdges);
   void registerChunkUpdate(unsigned flags);;
   void endChunkUpdates();;
-  std::array<float, 145 * 256 * 4>& getChunkHeightmapBuffer();;
   unsigned getChunkUpdateFlags() const;
+  //! terrain data of the chunks, the objects and water aren't counted
+  terrain_memory_usage memoryUsage() const;
   void recalcExtents();
   void recalcObjectInstanceExtents();
   void recalcCombinedExtents();
@@ -212,10 +316,10 @@ private:
   tsl::robin_map<AsyncObject*, std::vector<SceneObject*>> object_instances; // only includes M2 and WMO. perhaps a medium common ancestor then?
 
   std::unique_ptr<MapChunk> mChunks[16][16];
-  std::array<float, 145 * 256 * 4> _chunk_heightmap_buffer;
 
   bool _load_models;
   bool _load_textures;
+  bool _instances_released = false;
   World* _world;
 
   Noggit::Rendering::TileRender _renderer;
@@ -9,6 +9,7 @@
 #include <noggit/World.h>
 #include <noggit/MapTile.h>
 #include <noggit/map_index.hpp>
+#include <noggit/save_queue.hpp>
 #include <noggit/TabletManager.hpp>
 #include <opengl/texture.hpp>
 #include <noggit/Tool.hpp>
@@ -1112,7 +1113,8 @@ void MapView::setupAssistMenu()
                       (
                         makeCurrent();
                     OpenGL::context::scoped_setter const _(::gl, context());
-                    _world->delete_duplicate_model_and_wmo_instances();
+                    std::size_t const deleted = _world->delete_duplicate_model_and_wmo_instances();
+                    _main_window->statusBar()->showMessage(QString("Deleted %1 duplicate models").arg(deleted), 5000);
                     )
                   }
   );
@@ -1391,6 +1393,14 @@ void MapView::setupAssistMenu()
   adt_import_height_params_layout->addWidget(adt_import_height_params_mode);
   adt_import_height_params_mode->addItems({"Set", "Add", "Subtract", "Multiply" });
 
+  adt_import_height_params_layout->addWidget(new QLabel("Format (all ADTs):", adt_import_height_params));
+  QComboBox* adt_import_height_params_format = new QComboBox(adt_import_height_params);
+  adt_import_height_params_layout->addWidget(adt_import_height_params_format);
+  // same order as Noggit::map_image_format
+  adt_import_height_params_format->addItems({"PNG", "Raw 16 bit (.r16)", "Raw float (.r32, absolute heights)"});
+  adt_import_height_params_format->setToolTip("Raw files are 257x257 little endian samples named MAPNAME_XX_YY_height.r16 or .r32."
+      "\nOnly used when importing the heightmaps of all the ADTs.");
+
   QCheckBox* adt_import_height_tiled_edges = new QCheckBox("Tiled Edges", adt_import_height_params);
   adt_import_height_tiled_edges->setToolTip(tiled_edges_tooltip_str);
   adt_import_height_params_layout->addWidget(adt_import_height_tiled_edges);
@@ -1713,6 +1723,19 @@ void MapView::setupAssistMenu()
     }
   );
 
+  ADD_ACTION_NS ( all_adts_export_menu
+  , "Export alphamaps (raw 16 bit)"
+  , [this]
+    {
+      DESTRUCTIVE_ACTION
+      (
+        makeCurrent();
+        OpenGL::context::scoped_setter const _(::gl, context());
+        _world->exportAllADTsAlphamap(Noggit::map_image_format::r16);
+      )
+    }
+  );
+
   ADD_ACTION_NS ( all_adts_export_menu
   , "Export alphamaps (current texture)"
   , [this]
@@ -1744,6 +1767,34 @@ void MapView::setupAssistMenu()
     }
   );
 
+  ADD_ACTION_NS ( all_adts_export_menu
+  , "Export heightmap (raw 16 bit)"
+  , [this]
+    {
+      DESTRUCTIVE_ACTION
+      (
+        makeCurrent();
+        OpenGL::context::scoped_setter const _(::gl, context());
+
+        _world->exportAllADTsHeightmap(Noggit::map_image_format::r16);
+      )
+    }
+  );
+
+  ADD_ACTION_NS ( all_adts_export_menu
+  , "Export heightmap (raw float)"
+  , [this]
+    {
+      DESTRUCTIVE_ACTION
+      (
+        makeCurrent();
+        OpenGL::context::scoped_setter const _(::gl, context());
+
+        _world->exportAllADTsHeightmap(Noggit::map_image_format::r32);
+      )
+    }
+  );
+
   ADD_ACTION_NS ( all_adts_export_menu
   , "Export vertex color map"
   , [this]
@@ -1777,6 +1828,22 @@ void MapView::setupAssistMenu()
   }
   );
   ADD_ACTION_NS ( all_adts_import_menu
+  , "Import alphamaps (raw 16 bit)"
+  , [this]
+  {
+    DESTRUCTIVE_ACTION
+    (
+        makeCurrent();
+        OpenGL::context::scoped_setter const _(::gl, context());
+        QProgressDialog progress_dialog("Importing Alphamaps...", "Cancel", 0, _world->mapIndex.getNumExistingTiles(), this);
+        progress_dialog.setWindowModality(Qt::WindowModal);
+        NOGGIT_ACTION_MGR->beginAction(this, Noggit::ActionFlags::eCHUNKS_TEXTURE);
+        _world->importAllADTsAlphamaps(&progress_dialog, Noggit::map_image_format::r16);
+        NOGGIT_ACTION_MGR->endAction();
+    )
+  }
+  );
+  ADD_ACTION_NS ( all_adts_import_menu
   , "Import heightmaps"
   , [=]
     {
@@ -1790,7 +1857,8 @@ void MapView::setupAssistMenu()
             progress_dialog.setWindowModality(Qt::WindowModal);
             NOGGIT_ACTION_MGR->beginAction(this, Noggit::ActionFlags::eCHUNKS_TERRAIN);
             _world->importAllADTsHeightmaps(&progress_dialog, heightmap_import_min->value(), heightmap_import_max->value(), 
-                adt_import_height_params_mode->currentIndex(), adt_import_height_tiled_edges->isChecked());
+                adt_import_height_params_mode->currentIndex(), adt_import_height_tiled_edges->isChecked(),
+                static_cast<Noggit::map_image_format>(adt_import_height_params_format->currentIndex()));
             NOGGIT_ACTION_MGR->endAction();
         )
 
@@ -1830,6 +1898,22 @@ void MapView::setupAssistMenu()
   }
   );
 
+  ADD_ACTION_NS ( debug_menu
+  , "Log terrain memory usage"
+  , [=]
+  {
+    _world->logTerrainMemoryUsage();
+  }
+  );
+
+  ADD_ACTION_NS ( debug_menu
+  , "Compare serial and parallel tile saves"
+  , [=]
+  {
+    _world->checkTileSerialization();
+  }
+  );
+
 }
 
 void MapView::setupViewMenu()
@@ -2585,6 +2669,34 @@ MapView::MapView( math::degrees camera_yaw0
       , [=] { _main_window->statusBar()->removeWidget(_status_database); }
   );
 
+  // files are written in the background by the save queue, report when they are on disk
+  connect ( &Noggit::save_queue::instance()
+          , &Noggit::save_queue::progress
+          , this
+          , [=] (int done, int total)
+            {
+              _main_window->statusBar()->showMessage(QString("Saving map... %1/%2 files").arg(done).arg(total));
+            }
+          );
+  connect ( &Noggit::save_queue::instance()
+          , &Noggit::save_queue::finished
+          , this
+          , [=] (int files, int failed, qint64 bytes, qint64 duration_ms, qint64 latency_ms)
+            {
+              if (failed)
+              {
+                _main_window->statusBar()->showMessage(QString("Map NOT saved: %1 out of %2 files failed, see the log").arg(failed).arg(files));
+                return;
+              }
+
+              _main_window->statusBar()->showMessage
+                ( QString("Map saved: %1 files, %2 KiB in %3 ms (slowest file %4 ms)")
+                    .arg(files).arg(bytes / 1024).arg(duration_ms).arg(latency_ms)
+                , 5000
+                );
+            }
+          );
+
   setContextMenuPolicy(Qt::CustomContextMenu);
 
   connect(this, SIGNAL(customContextMenuRequested(const QPoint&)),
@@ -2710,6 +2822,28 @@ void MapView::on_uid_fix_fail()
   deleteLater();
 }
 
+uid_fix_status MapView::fixUIDs(bool cancel_on_model_loading_error)
+{
+  // the fix runs on the thread pool, the dialog keeps the event loop running
+  // while blocking the input, the map isn't drawn until it is done
+  QProgressDialog progress_dialog ("UID fix...", QString(), 0, 0, this);
+  progress_dialog.setWindowTitle("Noggit");
+  progress_dialog.setWindowModality(Qt::ApplicationModal);
+  progress_dialog.setCancelButton(nullptr);
+  progress_dialog.setMinimumDuration(0);
+  progress_dialog.show();
+
+  _main_window->statusBar()->showMessage("Fixing the UIDs of the map...");
+  _uid_fix_running = true;
+
+  auto const result = _world->mapIndex.fixUIDs (_world.get(), cancel_on_model_loading_error, &progress_dialog);
+
+  _uid_fix_running = false;
+  _main_window->statusBar()->clearMessage();
+
+  return result;
+}
+
 void MapView::initializeGL()
 {
   bool uid_warning = false;
@@ -2726,7 +2860,7 @@ void MapView::initializeGL()
   }
   else if (_uid_fix == uid_fix_mode::fix_all_fail_on_model_loading_error)
   {
-    auto result = _world->mapIndex.fixUIDs (_world.get(), true);
+    auto result = fixUIDs (true);
 
     if (result == uid_fix_status::failed)
     {
@@ -2736,7 +2870,7 @@ void MapView::initializeGL()
   }
   else if (_uid_fix == uid_fix_mode::fix_all_fuckporting_edition)
   {
-    auto result = _world->mapIndex.fixUIDs (_world.get(), false);
+    auto result = fixUIDs (false);
 
     uid_warning = result == uid_fix_status::done_with_errors;
   }
@@ -2788,6 +2922,10 @@ void MapView::paintGL()
   if (lock)
     return;
 
+  // the events are processed while the uid fix runs, the map can't be drawn yet
+  if (_uid_fix_running)
+    return;
+
   if (!_needs_redraw)
     return;
   else
@@ -2971,6 +3109,9 @@ MapView::~MapView()
 
   _world.reset();
 
+  // the next map opened may read the files still being written
+  Noggit::save_queue::instance().flush();
+
   AsyncLoader::instance->reset_object_fail();
 
   Noggit::Ui::selected_texture::texture.reset();
@@ -3018,6 +3159,8 @@ void MapView::tick (float dt)
   _world->mapIndex.enterTile (TileIndex (_camera.position));
   if (_unload_tiles)
     _world->mapIndex.unloadTiles (TileIndex (_camera.position));
+  _world->mapIndex.releaseRetiredTiles();
+  _world->mapIndex.settleSaves();
 
   dt = std::min(dt, 1.0f);
 
@@ -4221,7 +4364,8 @@ void MapView::save(save_mode mode)
     NOGGIT_ACTION_MGR->purge();
     AsyncLoader::instance->reset_object_fail();
 
-    _main_window->statusBar()->showMessage("Map saved", 2000);
+    // the save queue reports when the files are written
+    _main_window->statusBar()->showMessage("Saving map...");
 
   }
   else
@@ -4257,6 +4401,8 @@ void MapView::unloadOpenglData()
   WMOManager::unload_all(_context);
   TextureManager::unload_all(_context);
 
+  _world->mapIndex.releaseAllRetiredTiles();
+
   for (MapTile* tile : _world->mapIndex.loaded_tiles())
   {
     tile->renderer()->unload();
@@ -4372,6 +4518,8 @@ void MapView::onSettingsSave()
   _world.get()->mapIndex.setLoadingRadius(_settings->value("loading_radius", 2).toInt());
   _world.get()->mapIndex.setUnloadDistance(_settings->value("unload_dist", 5).toInt());
   _world.get()->mapIndex.setUnloadInterval(_settings->value("unload_interval", 30).toInt());
+  _world.get()->mapIndex.setTileMemoryBudget(_settings->value("tile_memory_budget", 2048).toInt());
+  NOGGIT_ACTION_MGR->setMemoryBudget(static_cast<std::size_t>(std::max(_settings->value("undo_memory_budget", 512).toInt(), 0)) * 1024 * 1024);
 
   _camera.fov(math::degrees(_settings->value("fov", 54.f).toFloat()));
   _debug_cam.fov(math::degrees(_settings->value("fov", 54.f).toFloat()));
@@ -22,6 +22,7 @@
 
 class DBCFile;
 class World;
+enum class uid_fix_status;
 struct ImGuiContext;
 
 class QSettings;
@@ -201,7 +202,9 @@ private:
   bool _uid_duplicate_warning_shown = false;
   bool _force_uid_check = false;
   bool _uid_fix_failed = false;
+  bool _uid_fix_running = false;
   void on_uid_fix_fail();
+  uid_fix_status fixUIDs(bool cancel_on_model_loading_error);
 
   uid_fix_mode _uid_fix;
   bool _from_bookmark;
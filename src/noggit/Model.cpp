@@ -2,6 +2,7 @@
 
 #include <math/bounding_box.hpp>
 #include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
 #include <noggit/application/NoggitApplication.hpp>
 #include <noggit/Log.h>
 #include <noggit/Model.h>
@@ -607,6 +608,7 @@ void Model::animate(glm::mat4x4 const& model_view, int anim_id, int anim_time)
   if (animBones) 
   {
     calcBones(model_view, _current_anim_seq, t, _global_animtime);
+    _bones_pose = bones_pose{_current_anim_seq, t, _global_animtime, model_view};
   }
 
   if (animGeometry || animBones)
@@ -623,7 +625,7 @@ void Model::animate(glm::mat4x4 const& model_view, int anim_id, int anim_time)
 
     // transform vertices
     // Animations are done in GPU now
-    // getTransformVertices();
+    // getTransformPositions();
   }
 
   for (size_t i=0; i< _lights.size(); ++i)
@@ -656,18 +658,18 @@ void Model::animate(glm::mat4x4 const& model_view, int anim_id, int anim_time)
   }
 }
 
-std::vector<ModelVertex> Model::getTransformVertices() const
+std::vector<glm::vec3> Model::getTransformPositions() const
 {
   if (!animGeometry)
     return {};
 
-  // Don't need to store them anymore, we only need them for operations like intersections
-  // _current_vertices = _vertices;
-  std::vector<ModelVertex> _current_vertices = _vertices;
+  // only the positions are needed for operations like intersections or bounds
+  std::vector<glm::vec3> positions;
+  positions.reserve(_vertices.size());
 
-  for (auto& vertex : _current_vertices)
+  for (auto const& vertex : _vertices)
   {
-    ::glm::vec3 v(0, 0, 0), n(0, 0, 0);
+    ::glm::vec3 v(0, 0, 0);
 
     for (size_t b(0); b < 4; ++b)
     {
@@ -675,21 +677,14 @@ std::vector<ModelVertex> Model::getTransformVertices() const
         continue;
 
       ::glm::vec3 tv = bones[vertex.bones[b]].mat * glm::vec4(vertex.position, 1.0f);
-      ::glm::vec3 tn = bones[vertex.bones[b]].mrot * glm::vec4(vertex.normal, 1.0f);
 
       v += tv * (static_cast<float> (vertex.weights[b]) / 255.0f);
-      n += tn * (static_cast<float> (vertex.weights[b]) / 255.0f);
     }
 
-    vertex.position = v;
-    vertex.normal = glm::normalize(n);
+    positions.push_back(v);
   }
-  /*
-  OpenGL::Scoped::buffer_binder<GL_ARRAY_BUFFER> const binder (_vertices_buffer);
-  gl.bufferData (GL_ARRAY_BUFFER, _current_vertices.size() * sizeof (ModelVertex), _current_vertices.data(), GL_STREAM_DRAW);
 
-   */
-  return _current_vertices;
+  return positions;
 }
 
 std::optional<std::array<glm::vec3, 2>> Model::getCurrentSequenceBounds()
@@ -720,22 +715,22 @@ std::array<glm::vec3, 2> Model::getAnimatedBoundingBox() const
   if (mesh_bounds_ratio >= 1.0f)
     return { bounding_box_min, bounding_box_max };;
 
-  auto const transform_verts = getTransformVertices();
+  auto const transform_positions = getTransformPositions();
 
-  if (!animGeometry || transform_verts.empty())
+  if (!animGeometry || transform_positions.empty())
     return { bounding_box_min, bounding_box_max };
 
   glm::vec3 min_bound(std::numeric_limits<float>::max());
   glm::vec3 max_bound(std::numeric_limits<float>::lowest());
 
-  for (const auto& vertex : transform_verts) {
-    min_bound.x = std::min(min_bound.x, vertex.position.x);
-    min_bound.y = std::min(min_bound.y, vertex.position.y);
-    min_bound.z = std::min(min_bound.z, vertex.position.z);
+  for (const auto& position : transform_positions) {
+    min_bound.x = std::min(min_bound.x, position.x);
+    min_bound.y = std::min(min_bound.y, position.y);
+    min_bound.z = std::min(min_bound.z, position.z);
 
-    max_bound.x = std::max(max_bound.x, vertex.position.x);
-    max_bound.y = std::max(max_bound.y, vertex.position.y);
-    max_bound.z = std::max(max_bound.z, vertex.position.z);
+    max_bound.x = std::max(max_bound.x, position.x);
+    max_bound.y = std::max(max_bound.y, position.y);
+    max_bound.z = std::max(max_bound.z, position.z);
   }
   return { min_bound, max_bound };
 }
@@ -979,40 +974,69 @@ std::vector<std::pair<float, std::tuple<int, int, int>>> Model::intersect (glm::
     return results;
   }
 
-  auto const transformed_verts = getTransformVertices();
-  bool const has_transformed_verts = !transformed_verts.empty();
-  for (auto const& pass : _renderer.renderPasses())
+  math::triangle_bvh const* bvh;
+
+  if (animGeometry)
   {
-    for (int i (pass.index_start); i < pass.index_start + pass.index_count; i += 3)
+    // the same pose is usually picked many times (several rays, instances sharing the animation...)
+    if (!_skinned_bvh || _skinned_bvh_pose != _bones_pose)
     {
-      std::optional<float> distance;
-      if (!has_transformed_verts)
-      {
-        distance = ray.intersect_triangle(_vertices[_indices[static_cast<std::size_t>(i + 0)]].position,
-                                          _vertices[_indices[static_cast<std::size_t>(i + 1)]].position,
-                                          _vertices[_indices[static_cast<std::size_t>(i + 2)]].position);
-      }
-      else
+      if (!_skinned_bvh)
       {
-        distance = ray.intersect_triangle(transformed_verts[_indices[static_cast<std::size_t>(i + 0)]].position,
-                                          transformed_verts[_indices[static_cast<std::size_t>(i + 1)]].position,
-                                          transformed_verts[_indices[static_cast<std::size_t>(i + 2)]].position);
+        _skinned_bvh = std::make_unique<math::triangle_bvh>();
       }
 
-      glm::vec3 debug_vert1 = _vertices[_indices[static_cast<std::size_t>(i + 0)]].position; ////
-      glm::vec3 debug_vert2 = _vertices[_indices[static_cast<std::size_t>(i + 1)]].position; ////
-      glm::vec3 debug_vert3 = _vertices[_indices[static_cast<std::size_t>(i + 2)]].position; ////
+      _skinned_bvh->clear();
+      fillBVH(*_skinned_bvh, getTransformPositions());
+      _skinned_bvh_pose = _bones_pose;
+    }
 
-      if (distance)
+    bvh = _skinned_bvh.get();
+  }
+  else
+  {
+    if (!_bvh)
+    {
+      std::vector<glm::vec3> positions;
+      positions.reserve(_vertices.size());
+
+      for (auto const& vertex : _vertices)
       {
-        results.emplace_back (*distance, std::make_tuple(i, i + 1, 1 + 2));
+        positions.push_back(vertex.position);
       }
+
+      _bvh = std::make_unique<math::triangle_bvh>();
+      fillBVH(*_bvh, positions);
     }
+
+    bvh = _bvh.get();
   }
 
+  bvh->intersect(ray, [&] (std::uint32_t i, float distance)
+  {
+    int const index = static_cast<int>(i);
+    results.emplace_back (distance, std::make_tuple(index, index + 1, 1 + 2));
+  });
+
   return results;
 }
 
+void Model::fillBVH(math::triangle_bvh& bvh, std::vector<glm::vec3> const& positions) const
+{
+  for (auto const& pass : _renderer.renderPasses())
+  {
+    for (int i (pass.index_start); i < pass.index_start + pass.index_count; i += 3)
+    {
+      bvh.add_triangle(positions[_indices[static_cast<std::size_t>(i + 0)]],
+                       positions[_indices[static_cast<std::size_t>(i + 1)]],
+                       positions[_indices[static_cast<std::size_t>(i + 2)]],
+                       static_cast<std::uint32_t>(i));
+    }
+  }
+
+  bvh.build();
+}
+
 void Model::lightsOn(OpenGL::light lbase)
 {
   // setup lights
@@ -1027,8 +1051,6 @@ void Model::lightsOff(OpenGL::light lbase)
 
 void Model::updateEmitters(float dt)
 {
-  return;
-
   if (finished)
   {
     for (auto& particle : _particles)
@@ -9,6 +9,7 @@
 #include <noggit/rendering/ModelRender.hpp>
 #include <noggit/scoped_blp_texture_reference.hpp>
 
+#include <math/triangle_bvh.hpp>
 #include <opengl/types.hpp>
 
 #include <ClientFile.hpp>
@@ -16,6 +17,7 @@
 #include <glm/mat4x4.hpp>
 
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -166,6 +168,7 @@ public:
   std::vector<std::pair<float, std::tuple<int, int, int>>> intersect (glm::mat4x4 const& model_view, math::ray const&, int animtime, bool calc_anims);
 
   void updateEmitters(float dt);
+  std::vector<ParticleSystem> const& particle_systems() const { return _particles; }
 
   void finishLoading() override;
   void waitForChildrenLoaded() override;
@@ -278,7 +281,10 @@ private:
   void animate(glm::mat4x4 const& model_view, int anim_id, int anim_time);
   void calcBones(glm::mat4x4 const& model_view, int anim, int time, int animation_time);
 
-  std::vector<ModelVertex> getTransformVertices() const;
+  //! vertex positions skinned with the current bone matrices, empty if the geometry isn't animated
+  std::vector<glm::vec3> getTransformPositions() const;
+  //! adds the triangles of every render pass, identified by their first index
+  void fillBVH(math::triangle_bvh& bvh, std::vector<glm::vec3> const& positions) const;
 
   // size of vertex box compared to global bounds
   float calcMeshBoundsRatio() const;
@@ -294,6 +300,28 @@ private:
   bool animated;
   bool animGeometry, animTextures, animBones;
 
+  //! what the bone matrices were last computed for
+  struct bones_pose
+  {
+    int anim_seq;
+    int anim_time;
+    int global_anim_time;
+    glm::mat4x4 model_view;
+
+    bool operator== (bones_pose const& other) const = default;
+  };
+
+  std::optional<bones_pose> _bones_pose;
+
+  // ===============================
+  // Picking
+  // ===============================
+  //! bind pose triangles, built by the first intersect()
+  std::unique_ptr<math::triangle_bvh> _bvh;
+  //! skinned triangles of animated geometry, rebuilt when the bones pose changes
+  std::unique_ptr<math::triangle_bvh> _skinned_bvh;
+  std::optional<bones_pose> _skinned_bvh_pose;
+
   //      <anim_id, <sub_anim_id, animation>
   std::map<uint16_t, std::map<uint16_t, ModelAnimation>> _animations_seq_per_id;
   std::map<int16_t, uint32_t> _animation_length;
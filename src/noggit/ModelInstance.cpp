@@ -222,24 +222,35 @@ bool ModelInstance::isInFrustum(const math::frustum& frustum)
 
 bool ModelInstance::isInRenderDist(const float cull_distance, const glm::vec3& camera, display_mode display)
 {
-  float dist;
+  float const dist = renderDistance(pos, model->bounding_box_radius * scale, camera, display);
 
-  if (display == display_mode::in_3D)
+  if (dist >= cull_distance)
   {
-    dist = glm::distance(camera, pos) - (model->bounding_box_radius * scale);
+    return false;
   }
-  else
+
+  ensureExtents();
+
+  return isInRenderDist(dist, size_cat, cull_distance);
+}
+
+float ModelInstance::renderDistance(glm::vec3 const& pos, float radius, glm::vec3 const& camera, display_mode display)
+{
+  if (display == display_mode::in_3D)
   {
-    dist = std::abs(pos.y - camera.y) - model->bounding_box_radius * scale;
+    return glm::distance(camera, pos) - radius;
   }
 
+  return std::abs(pos.y - camera.y) - radius;
+}
+
+bool ModelInstance::isInRenderDist(float dist, float size_cat, float cull_distance)
+{
   if (dist >= cull_distance)
   {
     return false;
   }
 
-  ensureExtents();
-
   if (size_cat < 1.f && dist > 300.f)
   {
     return false;
@@ -540,16 +551,7 @@ void wmo_doodad_instance::update_transform_matrix_wmo(WMOInstance* wmo)
 
 bool wmo_doodad_instance::isInRenderDist(const float cull_distance, const glm::vec3& camera, display_mode display)
 {
-  float dist;
-
-  if (display == display_mode::in_3D)
-  {
-    dist = glm::distance(camera, world_pos) - model->bounding_box_radius * scale;
-  }
-  else
-  {
-    dist = std::abs(world_pos.y - camera.y) - model->bounding_box_radius * scale;
-  }
+  float const dist = renderDistance(world_pos, model->bounding_box_radius * scale, camera, display);
 
   if (dist >= cull_distance)
   {
@@ -558,20 +560,7 @@ bool wmo_doodad_instance::isInRenderDist(const float cull_distance, const glm::v
 
   ensureExtents();
 
-  if (size_cat < 1.f && dist > 300.f)
-  {
-    return false;
-  }
-  else if (size_cat < 4.f && dist > 500.f)
-  {
-    return false;
-  }
-  else if (size_cat < 25.f && dist > 1000.f)
-  {
-    return false;
-  }
-
-  return true;
+  return ModelInstance::isInRenderDist(dist, size_cat, cull_distance);
 }
 
 [[nodiscard]]
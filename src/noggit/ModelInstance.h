@@ -78,6 +78,12 @@ public:
   bool isInFrustum(math::frustum const& frustum);
   bool isInRenderDist(const float cull_distance, const glm::vec3& camera, display_mode display);
 
+  //! distance between the camera and the bounding sphere of an instance at pos
+  static float renderDistance(glm::vec3 const& pos, float radius, glm::vec3 const& camera, display_mode display);
+  //! distance and size culling from plain values, it doesn't touch any instance
+  //! so it can run on any thread once the size categories are up to date
+  static bool isInRenderDist(float dist, float size_cat, float cull_distance);
+
   bool extentsDirty() const;;
 
   [[nodiscard]]
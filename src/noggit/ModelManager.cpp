@@ -49,11 +49,12 @@ void ModelManager::resetAnim()
 
 void ModelManager::updateEmitters(float dt)
 {
-  _.apply ( [&] (BlizzardArchive::Listfile::FileKey const&, Model& model)
-            {
-              model.updateEmitters (dt);
-            }
-          );
+  // every model only touches its own emitters
+  _.parallel_apply ( [&] (Model& model)
+                     {
+                       model.updateEmitters (dt);
+                     }
+                   );
 }
 
 void ModelManager::clear_hidden_models()
@@ -79,7 +80,7 @@ void ModelManager::unload_all(Noggit::NoggitRenderContext context)
 scoped_model_reference::scoped_model_reference(BlizzardArchive::Listfile::FileKey const& file_key, Noggit::NoggitRenderContext context)
 
     : _valid(true)
-    , _file_key(file_key)
+    , _file_key(Noggit::file_key_interner::instance().intern(file_key))
     , _model(ModelManager::_.emplace(_file_key, context))
     , _context(context)
 
@@ -96,9 +97,17 @@ scoped_model_reference::scoped_model_reference(scoped_model_reference const& oth
 
 scoped_model_reference& scoped_model_reference::operator=(scoped_model_reference const& other)
 {
+    // taken before releasing ours in case both point to the same model
+    Model* model = ModelManager::_.emplace(other._file_key, other._context);
+
+    if (_valid)
+    {
+      ModelManager::_.erase(_file_key, _context);
+    }
+
     _valid = other._valid;
     _file_key = other._file_key;
-    _model = ModelManager::_.emplace(_file_key, other._context);
+    _model = model;
     _context = other._context;
     return *this;
 }
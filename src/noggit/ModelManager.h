@@ -10,7 +10,12 @@ class Model;
 class ModelManager
 {
 public:
+  //! particles aren't drawn yet (see ModelRender::draw), the editor doesn't update
+  //! them either until they are, it would only cost frame time
+  static constexpr bool particles_drawn = false;
+
   static void resetAnim();
+  //! every model is updated on the thread pool, with the map locked
   static void updateEmitters(float dt);
   static void clear_hidden_models();
   static void unload_all(Noggit::NoggitRenderContext context);
@@ -41,7 +46,7 @@ struct scoped_model_reference
 
 private:
   bool _valid;
-  BlizzardArchive::Listfile::FileKey _file_key;
+  Noggit::file_key_id _file_key;
   Model* _model;
   Noggit::NoggitRenderContext _context;
 };
@@ -9,11 +9,47 @@
 #include <ClientFile.hpp>
 #include <glm/vec3.hpp>
 
-
-#include <list>
+#include <random>
 
 static const unsigned int MAX_PARTICLES = 10000;
 
+namespace
+{
+  // rand() is shared with every other thread of the process and locked on some platforms
+  float random_float(float lower, float upper)
+  {
+    thread_local std::minstd_rand engine (std::random_device{}());
+    return lower + (upper - lower) * std::uniform_real_distribution<float> (0.f, 1.f) (engine);
+  }
+
+  int random_int(int lower, int upper)
+  {
+    return lower + static_cast<int>((upper + 1 - lower) * random_float(0.f, 1.f));
+  }
+
+  //! Fills the count T of the buffer in place through a mapping, instead of
+  //! building them in a vector first and copying it.
+  template<typename T, typename Fill>
+    void stream_vertices(GLuint buffer, std::size_t count, Fill&& fill)
+  {
+    OpenGL::Scoped::buffer_binder<GL_ARRAY_BUFFER> const binder (buffer);
+
+    // orphans the storage of the previous frame, the driver doesn't have to wait for it
+    gl.bufferData(GL_ARRAY_BUFFER, count * sizeof(T), nullptr, GL_STREAM_DRAW);
+
+    if (!count)
+    {
+      return;
+    }
+
+    if (T* data = static_cast<T*>(gl.mapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY)))
+    {
+      fill(data);
+      gl.unmapBuffer(GL_ARRAY_BUFFER);
+    }
+  }
+}
+
 template<class T>
 T lifeRamp(float life, float mid, const T &a, const T &b, const T &c)
 {
@@ -52,6 +88,7 @@ ParticleSystem::ParticleSystem(Model* model_
   , type (mta.ParticleType)
   , manim (0)
   , mtime (0)
+  , manimtime (0)
   , rows (mta.rows)
   , cols (mta.cols)
   , billboard (!(mta.flags & 4096))
@@ -188,6 +225,64 @@ void ParticleSystem::initTile(glm::vec2 *tc, int num)
 }
 
 
+void ParticlePool::push_back(Particle const& p)
+{
+  pos.push_back(p.pos);
+  speed.push_back(p.speed);
+  down.push_back(p.down);
+  origin.push_back(p.origin);
+  dir.push_back(p.dir);
+  corners.push_back({p.corners[0], p.corners[1], p.corners[2], p.corners[3]});
+  size.push_back(p.size);
+  life.push_back(p.life);
+  maxlife.push_back(p.maxlife);
+  tile.push_back(p.tile);
+  color.push_back(p.color);
+}
+
+void ParticlePool::remove_dead()
+{
+  std::size_t kept = 0;
+
+  for (std::size_t i = 0; i < count(); ++i)
+  {
+    if (life[i] / maxlife[i] >= 1.0f)
+    {
+      continue;
+    }
+
+    if (kept != i)
+    {
+      pos[kept] = pos[i];
+      speed[kept] = speed[i];
+      down[kept] = down[i];
+      origin[kept] = origin[i];
+      dir[kept] = dir[i];
+      corners[kept] = corners[i];
+      size[kept] = size[i];
+      life[kept] = life[i];
+      maxlife[kept] = maxlife[i];
+      tile[kept] = tile[i];
+      color[kept] = color[i];
+    }
+
+    ++kept;
+  }
+
+  // shrinking never frees, the capacity is kept for the next spawns
+  pos.resize(kept);
+  speed.resize(kept);
+  down.resize(kept);
+  origin.resize(kept);
+  dir.resize(kept);
+  corners.resize(kept);
+  size.resize(kept);
+  life.resize(kept);
+  maxlife.resize(kept);
+  tile.resize(kept);
+  color.resize(kept);
+}
+
 void ParticleSystem::update(float dt)
 {
   float grav = gravity.getValue(manim, mtime, manimtime);
@@ -208,8 +303,8 @@ void ParticleSystem::update(float dt)
     else {
       int tospawn = (int)ftospawn;
 
-      if ((tospawn + particles.size()) > MAX_PARTICLES) // Error check to prevent the program from trying to load insane amounts of particles.
-        tospawn = static_cast<int>(particles.size()) - MAX_PARTICLES;
+      if ((tospawn + particles.count()) > MAX_PARTICLES) // Error check to prevent the program from trying to load insane amounts of particles.
+        tospawn = static_cast<int>(MAX_PARTICLES - particles.count());
 
       rem = ftospawn - static_cast<float>(tospawn);
 
@@ -227,42 +322,60 @@ void ParticleSystem::update(float dt)
       //rem = 0;
       if (en) {
         for (int i = 0; i<tospawn; ++i) {
-          Particle p = emitter->newParticle(this, manim, mtime, manimtime, w, l, spd, var, spr, spr2);
-          // sanity check:
-          //if (particles.size() < MAX_PARTICLES) // No need to check this every loop iteration. Already checked above.
-          particles.push_back(p);
+          particles.push_back(emitter->newParticle(this, manim, mtime, manimtime, w, l, spd, var, spr, spr2));
         }
       }
     }
   }
 
-  float mspeed = 1.0f;
+  // one pass per attribute over contiguous arrays, simple enough for the compiler to vectorize
+  std::size_t const n = particles.count();
 
-  for (ParticleList::iterator it = particles.begin(); it != particles.end();) {
-    Particle &p = *it;
-    p.speed += p.down * grav * dt - p.dir * deaccel * dt;
+  glm::vec3* const p_pos = particles.pos.data();
+  glm::vec3* const p_speed = particles.speed.data();
+  glm::vec3 const* const p_down = particles.down.data();
+  glm::vec3 const* const p_dir = particles.dir.data();
+  float* const p_life = particles.life.data();
+  float const* const p_maxlife = particles.maxlife.data();
 
-    if (slowdown>0) {
-      mspeed = expf(-1.0f * slowdown * p.life);
-    }
-    p.pos += p.speed * mspeed * dt;
+  float const grav_dt = grav * dt;
+  float const deaccel_dt = deaccel * dt;
 
-    p.life += dt;
-    float rlife = p.life / p.maxlife;
-    // calculate size and color based on lifetime
-    p.size = lifeRamp<float>(rlife, mid, sizes[0], sizes[1], sizes[2]);
-    p.color = lifeRamp<glm::vec4>(rlife, mid, colors[0], colors[1], colors[2]);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    p_speed[i] += p_down[i] * grav_dt - p_dir[i] * deaccel_dt;
+  }
 
-    // kill off old particles
-    if (rlife >= 1.0f)
+  if (slowdown > 0)
+  {
+    for (std::size_t i = 0; i < n; ++i)
     {
-      it = particles.erase (it);
+      p_pos[i] += p_speed[i] * (expf(-1.0f * slowdown * p_life[i]) * dt);
     }
-    else
+  }
+  else
+  {
+    for (std::size_t i = 0; i < n; ++i)
     {
-      ++it;
+      p_pos[i] += p_speed[i] * dt;
     }
   }
+
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    p_life[i] += dt;
+  }
+
+  // calculate size and color based on lifetime
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    float const rlife = p_life[i] / p_maxlife[i];
+    particles.size[i] = lifeRamp<float>(rlife, mid, sizes[0], sizes[1], sizes[2]);
+    particles.color[i] = lifeRamp<glm::vec4>(rlife, mid, colors[0], colors[1], colors[2]);
+  }
+
+  // kill off old particles
+  particles.remove_dead();
 }
 
 void ParticleSystem::setup(int anim, int time, int animtime)
@@ -319,14 +432,6 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
   glm::vec3 bv0 = glm::vec3(-f, +f, 0);
   glm::vec3 bv1 = glm::vec3(+f, +f, 0);
 
-  std::vector<std::uint16_t> indices;
-  std::vector<glm::vec3> vertices;
-  std::vector<glm::vec3> offsets;
-  std::vector<glm::vec4> colors_data;
-  std::vector<glm::vec2> texcoords;
-
-  std::uint16_t indice = 0;
-
   if (billboard) 
   {
       vRight = model_view[0]; 
@@ -337,138 +442,112 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
     //vUp = glm::vec3(0,1,0); // Cylindrical billboarding
   }
 
-  auto add_quad_indices([] (std::vector<std::uint16_t>& indices, std::uint16_t& start)
-  {
-    indices.push_back(start + 0);
-    indices.push_back(start + 1);
-    indices.push_back(start + 2);
-
-    indices.push_back(start + 2);
-    indices.push_back(start + 3);
-    indices.push_back(start + 0);
-
-    start += 4;
-  });
-
   /*
   * type:
   * 0   "normal" particle
   * 1  large quad from the particle's origin to its position (used in Moonwell water effects)
   * 2  seems to be the same as 0 (found some in the Deeprun Tram blinky-lights-sign thing)
   */
-  if (type == 0 || type == 2) 
-  {
-    //! \todo figure out type 2 (deeprun tram subway sign)
-    // - doesn't seem to be any different from 0 -_-
-    // regular particles
+  //! \todo figure out type 2 (deeprun tram subway sign)
+  // - doesn't seem to be any different from 0 -_-
+  bool const regular = type == 0 || type == 2;
 
-    if (billboard) 
-    {
-      //! \todo per-particle rotation in a non-expensive way?? :|
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
-      {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
-        {
-          break;
-        }
-
-        const float size = it->size;// / 2;
+  // one quad per particle, up to the first one with an invalid tile
+  std::size_t quads = 0;
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos);
-        offsets.push_back(-(vRight + vUp) * size);
-        colors_data.push_back(it->color);
-
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos);
-        offsets.push_back((vRight - vUp) * size);
-        colors_data.push_back(it->color);
-
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos);
-        offsets.push_back((vRight + vUp) * size);
-        colors_data.push_back(it->color);
+  if (regular || type == 1)
+  {
+    while (quads < particles.count() && particles.tile[quads] < tiles.size()) // Alfred, 2009.08.07, error prevent
+    {
+      ++quads;
+    }
+  }
 
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos);
-        offsets.push_back(-(vRight - vUp) * size);
-        colors_data.push_back(it->color);
+  // the four vertices of the quad of particle i, in the order of its tile's texture coordinates
+  stream_vertices<glm::vec3>(_vertices_vbo, quads * 4, [&] (glm::vec3* out)
+  {
+    for (std::size_t i = 0; i < quads; ++i, out += 4)
+    {
+      glm::vec3 const& p = particles.pos[i];
+      float const size = particles.size[i];
 
-        add_quad_indices(indices, indice);
+      if (regular && billboard)
+      {
+        //! \todo per-particle rotation in a non-expensive way?? :|
+        out[0] = out[1] = out[2] = out[3] = p;
       }
-    }
-    else 
-    {
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+      else if (regular)
       {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
-        {
-          break;
-        }
+        auto const& corners = particles.corners[i];
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos + it->corners[0] * it->size);
-        colors_data.push_back(it->color);
-
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos + it->corners[1] * it->size);
-        colors_data.push_back(it->color);
-
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos + it->corners[2] * it->size);
-        colors_data.push_back(it->color);
-
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos + it->corners[3] * it->size);
-        colors_data.push_back(it->color);
-
-        add_quad_indices(indices, indice);
+        out[0] = p + corners[0] * size;
+        out[1] = p + corners[1] * size;
+        out[2] = p + corners[2] * size;
+        out[3] = p + corners[3] * size;
+      }
+      else
+      { // Sphere particles
+        // particles from origin to position
+        /*
+        bv0 = mbb * glm::vec3(0,-1.0f,0);
+        bv1 = mbb * glm::vec3(0,+1.0f,0);
+
+
+        bv0 = mbb * glm::vec3(-1.0f,0,0);
+        bv1 = mbb * glm::vec3(1.0f,0,0);
+        */
+        glm::vec3 const& origin = particles.origin[i];
+
+        out[0] = p + bv0 * size;
+        out[1] = p + bv1 * size;
+        out[2] = origin + bv1 * size;
+        out[3] = origin + bv0 * size;
       }
     }
-  }  
-  else if (type == 1) 
-  { // Sphere particles
-    // particles from origin to position
-    /*
-    bv0 = mbb * glm::vec3(0,-1.0f,0);
-    bv1 = mbb * glm::vec3(0,+1.0f,0);
-
+  });
 
-    bv0 = mbb * glm::vec3(-1.0f,0,0);
-    bv1 = mbb * glm::vec3(1.0f,0,0);
-    */
+  stream_vertices<glm::vec4>(_colors_vbo, quads * 4, [&] (glm::vec4* out)
+  {
+    for (std::size_t i = 0; i < quads; ++i, out += 4)
+    {
+      out[0] = out[1] = out[2] = out[3] = particles.color[i];
+    }
+  });
 
-    for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+  stream_vertices<glm::vec2>(_texcoord_vbo, quads * 4, [&] (glm::vec2* out)
+  {
+    for (std::size_t i = 0; i < quads; ++i, out += 4)
     {
-      if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
-      {
-        break;
-      }
+      auto const& tc = tiles[particles.tile[i]].tc;
 
-      texcoords.push_back(tiles[it->tile].tc[0]);
-      vertices.push_back(it->pos + bv0 * it->size);
-      colors_data.push_back(it->color);
+      out[0] = tc[0];
+      out[1] = tc[1];
+      out[2] = tc[2];
+      out[3] = tc[3];
+    }
+  });
 
-      texcoords.push_back(tiles[it->tile].tc[1]);
-      vertices.push_back(it->pos + bv1 * it->size);
-      colors_data.push_back(it->color);
+  if (quads > _indexed_quads)
+  {
+    std::vector<std::uint16_t> indices;
+    indices.reserve(quads * 6);
 
-      texcoords.push_back(tiles[it->tile].tc[2]);
-      vertices.push_back(it->origin + bv1 * it->size);
-      colors_data.push_back(it->color);
+    for (std::size_t i = 0; i < quads; ++i)
+    {
+      auto const start = static_cast<std::uint16_t>(i * 4);
 
-      texcoords.push_back(tiles[it->tile].tc[3]);
-      vertices.push_back(it->origin + bv0 * it->size);
-      colors_data.push_back(it->color);
+      indices.push_back(start + 0);
+      indices.push_back(start + 1);
+      indices.push_back(start + 2);
 
-      add_quad_indices(indices, indice);
+      indices.push_back(start + 2);
+      indices.push_back(start + 3);
+      indices.push_back(start + 0);
     }
-  }
 
-  gl.bufferData<GL_ARRAY_BUFFER, glm::vec3>(_vertices_vbo, vertices, GL_STREAM_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER, glm::vec4>(_colors_vbo, colors_data, GL_STREAM_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER, glm::vec2>(_texcoord_vbo, texcoords, GL_STREAM_DRAW);
-  gl.bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint16_t>(_indices_vbo, indices, GL_STREAM_DRAW);
+    gl.bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint16_t>(_indices_vbo, indices, GL_STATIC_DRAW);
+    _indexed_quads = quads;
+  }
 
   shader.uniform("alpha_test", alpha_test);
   shader.uniform("billboard", (int)billboard);
@@ -481,7 +560,20 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
   }
   if(billboard)
   {
-    gl.bufferData<GL_ARRAY_BUFFER, glm::vec3>(_offsets_vbo, offsets, GL_STREAM_DRAW);
+    std::size_t const offset_count = regular ? quads * 4 : 0;
+
+    stream_vertices<glm::vec3>(_offsets_vbo, offset_count, [&] (glm::vec3* out)
+    {
+      for (std::size_t i = 0; i < quads; ++i, out += 4)
+      {
+        float const size = particles.size[i];// / 2;
+
+        out[0] = -(vRight + vUp) * size;
+        out[1] = (vRight - vUp) * size;
+        out[2] = (vRight + vUp) * size;
+        out[3] = -(vRight - vUp) * size;
+      }
+    });
 
     OpenGL::Scoped::buffer_binder<GL_ARRAY_BUFFER> const offset_binder (_offsets_vbo);
     shader.attrib("offset", 3, GL_FLOAT, GL_FALSE, 0, 0);
@@ -500,7 +592,7 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
   }
 
   OpenGL::Scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const indices_binder (_indices_vbo);
-  gl.drawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, nullptr, instances_count);
+  gl.drawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(quads * 6), GL_UNSIGNED_SHORT, nullptr, instances_count);
 
 }
 
@@ -515,6 +607,7 @@ void ParticleSystem::unload()
 {
   _vertex_array.unload();
   _buffers.unload();
+  _indexed_quads = 0;
   _uploaded = false;
 }
 
@@ -528,8 +621,8 @@ namespace
 
     glm::mat4x4 SpreadMat = glm::mat4x4(1);
 
-    a[0] = misc::randfloat(-Spread1, Spread1) / 2.0f;
-    a[1] = misc::randfloat(-Spread2, Spread2) / 2.0f;
+    a[0] = random_float(-Spread1, Spread1) / 2.0f;
+    a[1] = random_float(-Spread2, Spread2) / 2.0f;
 
     /*SpreadMat.m[0][0]*=l;
     SpreadMat.m[1][1]*=l;
@@ -617,9 +710,9 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
   auto mrot = sys->parent->mrot*CalcSpreadMatrix(spr, spr, 1.0f, 1.0f);
 
   if (sys->flags == 1041) { // Trans Halo
-    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(misc::randfloat(-l, l), 0, misc::randfloat(-w, w),0));
+    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(random_float(-l, l), 0, random_float(-w, w),0));
 
-    const float t = misc::randfloat(0.0f, 2.0f * glm::pi<float>());
+    const float t = random_float(0.0f, 2.0f * glm::pi<float>());
 
     p.pos = glm::vec3(0.0f, sys->pos.y + 0.15f, sys->pos.z) + glm::vec3(cos(t) / 8, 0.0f, sin(t) / 8); // Need to manually correct for the halo - why?
 
@@ -629,10 +722,10 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
     glm::vec3 dir(0.0f, 1.0f, 0.0f);
     p.dir = dir;
 
-    p.speed = glm::normalize(dir) * spd * misc::randfloat(0, var);
+    p.speed = glm::normalize(dir) * spd * random_float(0, var);
   }
   else if (sys->flags == 25 && sys->parent->parent<1) { // Weapon Flame
-    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w)));
+    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(random_float(-l, l), random_float(-l, l), random_float(-w, w)));
     glm::vec3 dir = mrot * glm::vec4(0.0f, 1.0f, 0.0f,0.0f);
     p.dir = glm::normalize(dir);
     //glm::vec3 dir = sys->model->bones[sys->parent->parent].mrot * sys->parent->mrot * glm::vec3(0.0f, 1.0f, 0.0f);
@@ -640,19 +733,19 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
   }
   else if (sys->flags == 25 && sys->parent->parent > 0) { // Weapon with built-in Flame (Avenger lightsaber!)
-    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w),0));
+    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(random_float(-l, l), random_float(-l, l), random_float(-w, w),0));
     glm::vec3 dir = glm::vec4(sys->parent->mat[1][0], sys->parent->mat[1][1], sys->parent->mat [1][2],0.0f) + glm::vec4(0.0f, 1.0f, 0.0f,0.0f);
-    p.speed = glm::normalize(dir) * spd * misc::randfloat(0, var * 2);
+    p.speed = glm::normalize(dir) * spd * random_float(0, var * 2);
 
   }
   else if (sys->flags == 17 && sys->parent->parent<1) { // Weapon Glow
-    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w)));
+    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(random_float(-l, l), random_float(-l, l), random_float(-w, w)));
     glm::vec3 dir = mrot * glm::vec4(0, 1, 0,0);
     p.dir = glm::normalize(dir);
 
   }
   else {
-    p.pos = sys->pos + glm::vec3(misc::randfloat(-l, l), 0, misc::randfloat(-w, w));
+    p.pos = sys->pos + glm::vec3(random_float(-l, l), 0, random_float(-w, w));
     p.pos = sys->parent->mat * glm::vec4(p.pos,0);
 
     //glm::vec3 dir = mrot * glm::vec3(0,1,0);
@@ -660,7 +753,7 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
     p.dir = dir;//.normalize();
     p.down = glm::vec3(0, -1.0f, 0); // dir * -1.0f;
-    p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));
+    p.speed = glm::normalize(dir) * spd * (1.0f + random_float(-var, var));
   }
 
   if (!sys->billboard)  {
@@ -675,7 +768,7 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
   p.origin = p.pos;
 
-  p.tile = misc::randint(0, sys->rows*sys->cols - 1);
+  p.tile = random_int(0, sys->rows*sys->cols - 1);
   return p;
 }
 
@@ -685,18 +778,18 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
   glm::vec3 dir;
   float radius;
 
-  radius = misc::randfloat(0, 1);
+  radius = random_float(0, 1);
 
   // Old method
-  //float t = misc::randfloat(0,2*math::constants::pi);
+  //float t = random_float(0,2*math::constants::pi);
 
   // New
   // Spread should never be zero for sphere particles ?
   math::radians t (0);
   if (spr == 0)
-    t._ = misc::randfloat(-glm::pi<float>(), glm::pi<float>());
+    t._ = random_float(-glm::pi<float>(), glm::pi<float>());
   else
-    t._ = misc::randfloat(-spr, spr);
+    t._ = random_float(-spr, spr);
 
   //Spread Calculation
   auto mrot =  sys->parent->mrot*CalcSpreadMatrix(spr * 2, spr2 * 2, w, l);
@@ -717,11 +810,11 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
 
 
   float theta_range = sys->spread.getValue(anim, time, animtime);
-  float theta = -0.5f* theta_range + misc::randfloat(0, theta_range);
+  float theta = -0.5f* theta_range + random_float(0, theta_range);
   glm::vec3 bdir(0, l*math::cos(theta), w*math::sin(theta));
 
   float phi_range = sys->lat.getValue(anim, time, animtime);
-  float phi = misc::randfloat(0, phi_range);
+  float phi = random_float(0, phi_range);
   rotate(0,0, &bdir.z, &bdir.x, phi);
   */
 
@@ -735,7 +828,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
       p.speed = glm::vec3(0, 0, 0);
     else {
       dir = sys->parent->mrot * glm::vec4((glm::normalize(bdir)),0);//mrot * glm::vec3(0, 1.0f,0);
-      p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));   // ?
+      p.speed = glm::normalize(dir) * spd * (1.0f + random_float(-var, var));   // ?
     }
 
   }
@@ -767,7 +860,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
       else
         dir = glm::normalize(bdir);
 
-      p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));   // ?
+      p.speed = glm::normalize(dir) * spd * (1.0f + random_float(-var, var));   // ?
     }
   }
 
@@ -779,7 +872,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
 
   p.origin = p.pos;
 
-  p.tile = misc::randint(0, sys->rows*sys->cols - 1);
+  p.tile = random_int(0, sys->rows*sys->cols - 1);
   return p;
 }
 
@@ -890,24 +983,17 @@ void RibbonEmitter::setup(int anim, int time, int animtime)
   // kill stuff from the end TODO: occasional crashes here
   float l = 0;
   bool erasemode = false;
-  for (std::list<RibbonSegment>::iterator it = segs.begin(); it != segs.end();)
+  std::size_t kept = 0;
+  for (; kept < segs.size() && !erasemode; ++kept)
   {
-    if (!erasemode)
+    l += segs[kept].len;
+    if (l > length)
     {
-      l += it->len;
-      if (l > length)
-      {
-          it->len = l - length;
-          erasemode = true;
-      }
-
-      ++it;
-    }
-    else
-    {
-      it = segs.erase(it);
+        segs[kept].len = l - length;
+        erasemode = true;
     }
   }
+  segs.erase(segs.begin() + kept, segs.end());
 
   tpos = ntpos;
   auto col = color.getValue(anim, time, animtime);
@@ -951,7 +1037,11 @@ void RibbonEmitter::draw( OpenGL::Scoped::use_program& shader
     start += 2;
   });
 
-  std::list<RibbonSegment>::iterator it = segs.begin();
+  indices.reserve(segs.size() * 6);
+  vertices.reserve(segs.size() * 2 + 2);
+  texcoords.reserve(segs.size() * 2 + 2);
+
+  auto it = segs.begin();
   float l = 0;
   for (; it != segs.end(); ++it) 
   {
@@ -5,7 +5,8 @@
 #include <noggit/Animated.h> // Animation::M2Value
 #include <opengl/scoped.hpp>
 
-#include <list>
+#include <array>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -24,16 +25,34 @@ namespace BlizzardArchive
   class ClientFile;
 }
 
+//! A particle as created by an emitter, it is stored in a ParticlePool.
+//! Zero initialized, the emitters only set what their kind of particle uses.
 struct Particle {
-  glm::vec3 pos, speed, down, origin, dir;
-  glm::vec3  corners[4];
+  glm::vec3 pos {}, speed {}, down {}, origin {}, dir {};
+  glm::vec3  corners[4] {};
   //glm::vec3 tpos;
-  float size, life, maxlife;
-  unsigned int tile;
-  glm::vec4 color;
+  float size = 0.f, life = 0.f, maxlife = 0.f;
+  unsigned int tile = 0;
+  glm::vec4 color {};
 };
 
-typedef std::list<Particle> ParticleList;
+//! Live particles of a system, one contiguous array per attribute so that the
+//! update loops stream through what they touch. The arrays only grow, up to the
+//! particle limit of the system, and dead particles are compacted away in place,
+//! spawning doesn't allocate once the pool reached its working size.
+struct ParticlePool
+{
+  std::vector<glm::vec3> pos, speed, down, origin, dir;
+  std::vector<std::array<glm::vec3, 4>> corners;
+  std::vector<float> size, life, maxlife;
+  std::vector<unsigned int> tile;
+  std::vector<glm::vec4> color;
+
+  std::size_t count() const { return life.size(); }
+  void push_back(Particle const& p);
+  //! removes the particles which lived their maxlife, keeping the spawn order
+  void remove_dead();
+};
 
 class ParticleEmitter {
 public:
@@ -70,7 +89,7 @@ class ParticleSystem
   float mid, slowdown;
   glm::vec3 pos;
   uint16_t _texture_id;
-  ParticleList particles;
+  ParticlePool particles;
   int blend, order, type;
   int manim, mtime;
   int manimtime;
@@ -106,6 +125,8 @@ public:
            , int instances_count
            );
 
+  ParticlePool const& live_particles() const { return particles; }
+
   friend class PlaneParticleEmitter;
   friend class SphereParticleEmitter;
 
@@ -123,6 +144,8 @@ private:
   GLuint const& _colors_vbo = _buffers[2];
   GLuint const& _texcoord_vbo = _buffers[3];
   GLuint const& _indices_vbo = _buffers[4];
+  // the quad indices only depend on the particle count, they are uploaded again when it grows
+  std::size_t _indexed_quads = 0;
   Noggit::NoggitRenderContext _context;
 };
 
@@ -160,7 +183,8 @@ class RibbonEmitter
   std::vector<uint16_t> _texture_ids;
   std::vector<uint16_t> _material_ids;
 
-  std::list<RibbonSegment> segs;
+  // new segments are added at the front, old ones dropped from the back
+  std::deque<RibbonSegment> segs;
 
 public:
   RibbonEmitter(Model*, const BlizzardArchive::ClientFile &f, ModelRibbonEmitterDef const& mta, int *globals
@@ -1,15 +1,19 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #include <noggit/TextureManager.h>
+#include <noggit/blp_decoder.hpp>
 #include <noggit/Log.h> // LogDebug
 #include <noggit/application/NoggitApplication.hpp>
 #include <noggit/application/Configuration/NoggitApplicationConfiguration.hpp>
+#include <noggit/project/CurrentProject.hpp>
+#include <util/thread_pool.hpp>
 #include <ClientFile.hpp>
 
-#include <QtGui/QOffscreenSurface>
-#include <QtGui/QOpenGLFramebufferObjectFormat>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QSaveFile>
 
 #include <algorithm>
-#include <glm/vec2.hpp>
 
 decltype (TextureManager::_) TextureManager::_;
 decltype (TextureManager::_tex_arrays) TextureManager::_tex_arrays;
@@ -132,24 +136,6 @@ TexArrayParams& TextureManager::get_tex_array(GLint compression, int width, int
   return array_params;
 }
 
-#include <cstdint>
-//! \todo Cross-platform syntax for packed structs.
-#pragma pack(push,1)
-struct BLPHeader
-{
-  int32_t magix;
-  int32_t version;
-  uint8_t attr_0_compression;
-  uint8_t attr_1_alphadepth;
-  uint8_t attr_2_alphatype;
-  uint8_t attr_3_mipmaplevels;
-  int32_t resx;
-  int32_t resy;
-  int32_t offsets[16];
-  int32_t sizes[16];
-};
-#pragma pack(pop)
-
 void blp_texture::bind()
 {
   if (!finished)
@@ -579,65 +565,99 @@ namespace Noggit
         return instance;
     }
 
-    QPixmap* BLPRenderer::render_blp_to_pixmap ( std::string const& blp_filename
-                                               , int width
-                                               , int height
-                                               )
+  QImage BLPRenderer::load_thumbnail(std::string const& blp_filename, int width, int height)
   {
-    if (!_uploaded)
-    [[unlikely]]
+    // runs on the thread pool. Like the AsyncLoader threads, each read opens its own
+    // ClientFile and the shared client data is used without any lock on noggit's side
+    auto client_data = Noggit::Application::NoggitApplication::instance()->clientData();
+
+    // same file choice as blp_texture::finishLoading()
+    std::string filename = blp_filename;
+    if (!client_data->exists(filename))
     {
-      upload();
+      LogError << "file not found: '" << blp_filename << "'" << std::endl;
+      filename = "textures/shanecube.blp";
+    }
+    else if (filename.starts_with("tileset/"))
+    {
+      std::string const spec_filename = filename.substr(0, filename.find_last_of(".")) + "_s.blp";
+      if (client_data->exists(spec_filename))
+      {
+        filename = spec_filename;
+      }
     }
 
-    std::tuple<std::string, int, int> const curEntry{blp_filename, width, height};
-    auto it{_cache.find(curEntry)};
-
-    if(it != _cache.end())
-      return &it->second;
-
-    OpenGL::context::save_current_context const context_save (::gl);
+    BlizzardArchive::ClientFile f(filename, client_data.get());
+    if (f.isEof())
+    {
+      throw std::runtime_error("File " + filename + " does not exist");
+    }
 
-    _context->makeCurrent(_surface.get());
+    char const* data = f.getPointer();
+    std::size_t const size = f.getSize();
 
-    OpenGL::context::scoped_setter const context_set (::gl, _context.get());
+    QString cache_path;
+    if (auto project = Noggit::Project::CurrentProject::get())
+    {
+      QDir const dir(QString::fromStdString(project->ProjectPath) + "/.noggit/thumbnails");
+      if (dir.exists() || dir.mkpath("."))
+      {
+        QByteArray const hash = QCryptographicHash::hash(QByteArray::fromRawData(data, static_cast<int>(size)), QCryptographicHash::Md5);
+        cache_path = dir.filePath(QString("%1_%2x%3.png").arg(QString(hash.toHex())).arg(width).arg(height));
+      }
+    }
 
-    gl.activeTexture(GL_TEXTURE0);
-    blp_texture texture(blp_filename, Noggit::NoggitRenderContext::BLP_RENDERER);
-    texture.finishLoading();
-    texture.upload();
+    if (!cache_path.isEmpty())
+    {
+      QImage cached;
+      if (cached.load(cache_path, "PNG"))
+      {
+        return cached;
+      }
+    }
 
-    width = width == -1 ? texture.width() : width;
-    height = height == -1 ? texture.height() : height;
+    QImage image = decode_blp(data, size, width, height);
+    f.close();
 
-    float h = static_cast<float>(height);
-    float w = static_cast<float>(width);
+    if (image.isNull())
+    {
+      LogError << "Unsupported BLP, no thumbnail for: " << filename << std::endl;
+      return image;
+    }
 
-    QOpenGLFramebufferObject pixel_buffer(width, height, *_fmt.get());
-    pixel_buffer.bind();
+    if (width != -1 && height != -1 && (image.width() != width || image.height() != height))
+    {
+      image = image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
 
-    gl.viewport(0, 0, w, h);
-    gl.clearColor(.0f, .0f, .0f, 1.f);
-    gl.clear(GL_COLOR_BUFFER_BIT);
-    
-    OpenGL::Scoped::use_program shader (*_program.get());
+    // the alpha channel holds specular or height data, not transparency
+    image = image.convertToFormat(QImage::Format_RGB32);
 
-    shader.uniform("tex", 0);
-    shader.uniform("width", w);
-    shader.uniform("height", h);
+    if (!cache_path.isEmpty())
+    {
+      // written aside and renamed so a concurrent reader never sees half a file
+      QSaveFile file(cache_path);
+      if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG"))
+      {
+        file.commit();
+      }
+    }
 
-    gl.bindTexture(GL_TEXTURE_2D_ARRAY, texture.texture_array());
-    shader.uniform("tex_index", texture.array_index());
+    return image;
+  }
 
-    OpenGL::Scoped::vao_binder const _ (_vao[0]);
-    
-    OpenGL::Scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> indices_binder(_buffers[0]);
+    QPixmap* BLPRenderer::render_blp_to_pixmap ( std::string const& blp_filename
+                                               , int width
+                                               , int height
+                                               )
+  {
+    cache_key const curEntry{blp_filename, width, height};
+    auto it{_cache.find(curEntry)};
 
-    gl.drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+    if(it != _cache.end())
+      return &it->second;
 
-    QPixmap result{};
-    result = std::move(QPixmap::fromImage(pixel_buffer.toImage()));
-    pixel_buffer.release();
+    QPixmap result = QPixmap::fromImage(load_thumbnail(blp_filename, width, height));
 
     if (result.isNull())
     {
@@ -648,129 +668,69 @@ namespace Noggit
     return &(_cache[curEntry] = std::move(result));
   }
 
-  void BLPRenderer::upload()
+  QPixmap const* BLPRenderer::request_blp_pixmap ( std::string const& blp_filename
+                                                 , int width
+                                                 , int height
+                                                 , QObject* receiver
+                                                 , pixmap_callback on_ready
+                                                 )
   {
-    _cache = {};
-
-    OpenGL::context::save_current_context const context_save (::gl);
-
-    _context = std::make_unique<QOpenGLContext>();
-    _fmt = std::make_unique<QOpenGLFramebufferObjectFormat>();
-    _surface = std::make_unique<QOffscreenSurface>();
+    cache_key const key{blp_filename, width, height};
 
-    _context->create();
+    if (auto it = _cache.find(key); it != _cache.end())
+    {
+      return &it->second;
+    }
 
-    _fmt->setSamples(1);
-    _fmt->setInternalTextureFormat(GL_RGBA8);
+    auto& waiting = _pending[key];
+    bool const in_flight = !waiting.empty();
+    waiting.emplace_back(receiver, std::move(on_ready));
 
-    _surface->create();
-    _context->makeCurrent(_surface.get());
+    if (!in_flight)
+    {
+      util::thread_pool::instance().submit([this, key]
+      {
+        QImage image;
 
-    OpenGL::context::scoped_setter const context_set (::gl, _context.get());
+        try
+        {
+          image = load_thumbnail(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+        }
+        catch (std::exception const& e)
+        {
+          LogError << "failed rendering " << std::get<0>(key) << " to pixmap: " << e.what() << std::endl;
+        }
 
-    OpenGL::Scoped::bool_setter<GL_CULL_FACE, GL_FALSE> cull;
-    OpenGL::Scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth;
+        // QPixmaps can only be created on the GUI thread
+        QMetaObject::invokeMethod ( QCoreApplication::instance()
+                                  , [this, key, image = std::move(image)] { thumbnail_ready(key, image); }
+                                  , Qt::QueuedConnection
+                                  );
+      });
+    }
 
-    _vao.upload();
-    _buffers.upload();
+    return nullptr;
+  }
 
-    GLuint const& indices_vbo = _buffers[0];
-    GLuint const& vertices_vbo = _buffers[1];
-    GLuint const& texcoords_vbo = _buffers[2];
+  void BLPRenderer::thumbnail_ready(cache_key const& key, QImage const& image)
+  {
+    QPixmap const& pixmap = _cache[key] = QPixmap::fromImage(image);
 
-    std::vector<glm::vec2> vertices =
-        {
-             {-1.0f, -1.0f}
-            ,{-1.0f, 1.0f}
-            ,{ 1.0f, 1.0f}
-            ,{ 1.0f, -1.0f}
-        };
-    std::vector<glm::vec2> texcoords =
-        {
-             {0.f, 0.f}
-            ,{0.f, 1.0f}
-            ,{1.0f, 1.0f}
-            ,{1.0f, 0.f}
-        };
-    std::vector<std::uint16_t> indices = {0,1,2, 2,3,0};
-
-    gl.bufferData<GL_ARRAY_BUFFER,glm::vec2>(vertices_vbo, vertices, GL_STATIC_DRAW);
-    gl.bufferData<GL_ARRAY_BUFFER,glm::vec2>(texcoords_vbo, texcoords, GL_STATIC_DRAW);
-    gl.bufferData<GL_ELEMENT_ARRAY_BUFFER, std::uint16_t>(indices_vbo, indices, GL_STATIC_DRAW);
-
-
-    _program.reset(new OpenGL::program
-                       (
-                           {
-                               {
-                                   GL_VERTEX_SHADER, R"code(
-                                  #version 330 core
-
-                                  in vec4 position;
-                                  in vec2 tex_coord;
-                                  out vec2 f_tex_coord;
-
-                                  uniform float width;
-                                  uniform float height;
-
-                                  void main()
-                                  {
-                                    f_tex_coord = vec2(tex_coord.x * width, -tex_coord.y * height);
-                                    gl_Position = vec4(position.x * width / 2, position.y * height / 2, position.z, 1.0);
-                                  }
-                                  )code"
-                               },
-                               {
-                                   GL_FRAGMENT_SHADER, R"code(
-                                  #version 330 core
-
-                                  uniform sampler2DArray tex;
-                                  uniform int tex_index;
-
-                                  in vec2 f_tex_coord;
-
-                                  layout(location = 0) out vec4 out_color;
-
-                                  void main()
-                                  {
-                                    out_color = vec4(texture(tex, vec3(f_tex_coord/2.f + vec2(0.5), tex_index)).rgb, 1.);
-                                  }
-                                  )code"
-                               }
-                           }
-                       ));
-
-    OpenGL::Scoped::use_program shader (*_program.get());
-
-    OpenGL::Scoped::vao_binder const _ (_vao[0]);
+    auto waiting = std::move(_pending[key]);
+    _pending.erase(key);
 
+    for (auto& [receiver, on_ready] : waiting)
     {
-      OpenGL::Scoped::buffer_binder<GL_ARRAY_BUFFER> vertices_binder (vertices_vbo);
-      shader.attrib("position", 2, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-    {
-      OpenGL::Scoped::buffer_binder<GL_ARRAY_BUFFER> texcoords_binder (texcoords_vbo);
-      shader.attrib("tex_coord", 2, GL_FLOAT, GL_FALSE, 0, 0);
+      if (receiver)
+      {
+        on_ready(pixmap);
+      }
     }
-
-    _uploaded = true;
   }
 
   void BLPRenderer::unload()
   {
-    OpenGL::context::save_current_context const context_save (::gl);
-    _context->makeCurrent(_surface.get());
-    OpenGL::context::scoped_setter const context_set (::gl, _context.get());
-
     _cache.clear();
-    _vao.unload();
-    _buffers.unload();
-    _program.reset();
-    _surface.reset();
-    _fmt.reset();
-    _context.reset();
-
-    _uploaded = false;
   }
 
 }
@@ -7,8 +7,11 @@
 #include <noggit/AsyncObjectMultimap.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.hpp>
+#include <util/hash.hpp>
 
+#include <QtCore/QPointer>
 #include <QtGui/QPixmap>
+#include <functional>
 #include <optional>
 #include <map>
 #include <unordered_map>
@@ -17,9 +20,6 @@
 #include <array>
 #include <tuple>
 
-class QOffscreenSurface;
-class QOpenGLFramebufferObjectFormat;
-
 struct texture_heightmapping_data
 {
     texture_heightmapping_data(uint32_t scale = 0, float heightscale = 0, float heightoffset = 1.0f)
@@ -38,12 +38,13 @@ struct tuple_hash
   template <class T1, class T2, class T3, class T4>
   std::size_t operator() (const std::tuple<T1,T2,T3,T4> &p) const
   {
-    auto h1 = std::hash<T1>{}(std::get<0>(p));
-    auto h2 = std::hash<T2>{}(std::get<1>(p));
-    auto h3 = std::hash<T3>{}(std::get<2>(p));
-    auto h4 = std::hash<T4>{}(std::get<3>(p));
+    std::size_t seed = 0;
+    util::hash_combine(seed, std::get<0>(p));
+    util::hash_combine(seed, std::get<1>(p));
+    util::hash_combine(seed, std::get<2>(p));
+    util::hash_combine(seed, std::get<3>(p));
 
-    return h1 ^ h2 ^ h3 ^ h4; // use hash combine here
+    return seed;
   }
 };
 
@@ -129,32 +130,44 @@ private:
 namespace Noggit
 {
 
+  //! Thumbnails of BLP files for the texture pickers. They are decoded on the CPU,
+  //! on the thread pool for asynchronous requests, and kept on disk in the project
+  //! directory keyed by the hash of the file content, so only new or changed
+  //! textures are ever decoded again.
   class BLPRenderer
   {
+  public:
+    using pixmap_callback = std::function<void (QPixmap const&)>;
+
   private:
     BLPRenderer() = default;
 
     BLPRenderer( const BLPRenderer&) = delete;
     BLPRenderer& operator=( BLPRenderer& ) = delete;
 
-    std::map<std::tuple<std::string, int, int>, QPixmap> _cache;
+    using cache_key = std::tuple<std::string, int, int>;
 
-    std::unique_ptr<QOpenGLContext> _context;
-    std::unique_ptr<QOpenGLFramebufferObjectFormat> _fmt;
-    std::unique_ptr<QOffscreenSurface> _surface;
-    std::unique_ptr<OpenGL::program> _program;
+    static QImage load_thumbnail(std::string const& blp_filename, int width, int height);
+    void thumbnail_ready(cache_key const& key, QImage const& image);
 
-    OpenGL::Scoped::deferred_upload_vertex_arrays<1> _vao;
-    OpenGL::Scoped::deferred_upload_buffers<3> _buffers;
-
-    bool _uploaded = false;
+    std::map<cache_key, QPixmap> _cache;
+    std::map<cache_key, std::vector<std::pair<QPointer<QObject>, pixmap_callback>>> _pending;
 
   public:
     static BLPRenderer& getInstance();
 
     QPixmap* render_blp_to_pixmap ( std::string const& blp_filename, int width = -1, int height = -1);
+
+    //! \returns the thumbnail if it is already in memory, otherwise nullptr and
+    //! on_ready gets called from the GUI thread once it is decoded, as long as
+    //! receiver still exists
+    QPixmap const* request_blp_pixmap ( std::string const& blp_filename
+                                      , int width
+                                      , int height
+                                      , QObject* receiver
+                                      , pixmap_callback on_ready
+                                      );
     void unload();
-    void upload();
 
   };
 
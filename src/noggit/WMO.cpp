@@ -3,6 +3,7 @@
 #include <ClientFile.hpp>
 #include <math/frustum.hpp>
 #include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
 #include <noggit/application/NoggitApplication.hpp>
 #include <noggit/Log.h> // LogDebug
 #include <noggit/Model.h>
@@ -1182,23 +1183,31 @@ void WMOGroup::intersect (math::ray const& ray, std::vector<float>* results) con
   }
 
   //! \todo Also allow clicking on doodads and liquids.
-  for (auto&& batch : _batches)
+  if (!_bvh)
   {
-    for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; i += 3)
+    _bvh = std::make_unique<math::triangle_bvh>();
+
+    for (auto&& batch : _batches)
     {
-      // TODO : only intersect visible triangles
-      // TODO : option to only check collision
-      if ( auto&& distance
-         = ray.intersect_triangle ( _vertices[_indices[i + 0]]
-                                  , _vertices[_indices[i + 1]]
-                                  , _vertices[_indices[i + 2]]
-                                  )
-         )
+      for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; i += 3)
       {
-        results->emplace_back (*distance);
+        // TODO : only intersect visible triangles
+        // TODO : option to only check collision
+        _bvh->add_triangle ( _vertices[_indices[i + 0]]
+                           , _vertices[_indices[i + 1]]
+                           , _vertices[_indices[i + 2]]
+                           , static_cast<std::uint32_t>(i)
+                           );
       }
     }
+
+    _bvh->build();
   }
+
+  _bvh->intersect (ray, [&] (std::uint32_t, float distance)
+  {
+    results->emplace_back (distance);
+  });
 }
 
 /*
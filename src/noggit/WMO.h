@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #pragma once
 
+#include <math/triangle_bvh.hpp>
 #include <noggit/AsyncObjectMultimap.hpp>
 #include <noggit/ContextObject.hpp>
 #include <noggit/ModelManager.h>
@@ -11,6 +12,7 @@
 
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -237,6 +239,9 @@ private:
   std::optional<std::vector<wmo_bsp_node>> _bsp_tree_nodes;
   std::optional<std::vector<uint16_t>> _bsp_indices;
 
+  //! triangles of every batch, built by the first intersect()
+  mutable std::unique_ptr<math::triangle_bvh> _bvh;
+
   Noggit::Rendering::WMOGroupRender _renderer;
 };
 
@@ -376,9 +381,9 @@ struct scoped_wmo_reference
 {
   scoped_wmo_reference (BlizzardArchive::Listfile::FileKey const& file_key, Noggit::NoggitRenderContext context)
     : _valid(true)
-    , _file_key(file_key)
+    , _file_key(Noggit::file_key_interner::instance().intern(file_key))
+    , _wmo (WMOManager::_.emplace(_file_key, context))
     , _context(context)
-    , _wmo (WMOManager::_.emplace(file_key, context))
   {}
 
   scoped_wmo_reference (scoped_wmo_reference const& other)
@@ -389,9 +394,17 @@ struct scoped_wmo_reference
   {}
   scoped_wmo_reference& operator= (scoped_wmo_reference const& other)
   {
+    // taken before releasing ours in case both point to the same wmo
+    WMO* wmo = WMOManager::_.emplace(other._file_key, other._context);
+
+    if (_valid)
+    {
+      WMOManager::_.erase(_file_key, _context);
+    }
+
     _valid = other._valid;
     _file_key = other._file_key;
-    _wmo = WMOManager::_.emplace(_file_key, other._context);
+    _wmo = wmo;
     _context = other._context;
     return *this;
   }
@@ -436,7 +449,7 @@ struct scoped_wmo_reference
 private:  
   bool _valid;
 
-  BlizzardArchive::Listfile::FileKey _file_key;
+  Noggit::file_key_id _file_key;
   WMO* _wmo;
   Noggit::NoggitRenderContext _context;
 };
@@ -14,6 +14,7 @@
 #include <noggit/ModelManager.h> // ModelManager
 #include <noggit/object_paste_params.hpp>
 #include <noggit/project/CurrentProject.hpp>
+#include <noggit/terrain_edit_batch.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/TextureManager.h>
 #include <noggit/TileIndex.hpp>
@@ -24,6 +25,8 @@
 #include <noggit/World.inl>
 
 #include <math/bounding_box.hpp>
+#include <math/frustum.hpp>
+#include <util/thread_pool.hpp>
 
 #include <blizzard-database-library/include/structures/FileStructures.h>
 
@@ -41,8 +44,10 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -494,12 +499,9 @@ void World::rotate_model_to_ground_normal(SceneObject* obj, bool smoothNormals)
     {
         auto normalWeights = getBarycentricCoordinatesAt(p0, p1, p2, hitChunkInfo.position, varnormal);
 
-        auto& tile_buffer = hitChunkInfo.chunk->mt->getChunkHeightmapBuffer();
-        int chunk_start = (hitChunkInfo.chunk->px * 16 + hitChunkInfo.chunk->py) * mapbufsize * 4;
-
-        const auto& vNormal0 = *reinterpret_cast<glm::vec3*>(&tile_buffer[chunk_start + std::get<0>(hitChunkInfo.triangle) * 4]);
-        const auto& vNormal1 = *reinterpret_cast<glm::vec3*>(&tile_buffer[chunk_start + std::get<1>(hitChunkInfo.triangle) * 4]);
-        const auto& vNormal2 = *reinterpret_cast<glm::vec3*>(&tile_buffer[chunk_start + std::get<2>(hitChunkInfo.triangle) * 4]);
+        const auto vNormal0 = hitChunkInfo.chunk->getNormal(std::get<0>(hitChunkInfo.triangle));
+        const auto vNormal1 = hitChunkInfo.chunk->getNormal(std::get<1>(hitChunkInfo.triangle));
+        const auto vNormal2 = hitChunkInfo.chunk->getNormal(std::get<2>(hitChunkInfo.triangle));
 
         varnormal.x =
             vNormal0.x * normalWeights.x +
@@ -1125,8 +1127,12 @@ bool World::isInIndoorWmoGroup(std::array<glm::vec3, 2> obj_bounds, glm::mat4x4
 {
     bool is_indoor = false;
     // check if model bounds is within wmo bounds then check each indor wmo group bounds
-    _model_instance_storage.for_each_wmo_instance([&](WMOInstance& wmo_instance)
+    _model_instance_storage.for_each_instance_in_box(obj_bounds[0], obj_bounds[1], [&](SceneObject* obj)
         {
+            if (obj->which() != eWMO)
+                return;
+
+            auto& wmo_instance = *static_cast<WMOInstance*>(obj);
             auto wmo_extents = wmo_instance.getExtents();
             // check if global wmo bounds intersect
             if (obj_bounds[1].x >= wmo_extents[0].x
@@ -1217,29 +1223,28 @@ selection_result World::intersect (glm::mat4x4 const& model_view
 
   if (!pOnlyMap && do_objects)
   {
-    if (draw_models)
+    ZoneScopedN("World::intersect() : intersect objects");
+    _model_instance_storage.for_each_instance_on_ray(ray, [&] (SceneObject* obj)
     {
-      ZoneScopedN("World::intersect() : intersect M2s");
-      _model_instance_storage.for_each_m2_instance([&] (ModelInstance& model_instance)
+      if (obj->which() == eMODEL && draw_models)
       {
+        auto& model_instance = *static_cast<ModelInstance*>(obj);
+
         if (draw_hidden_models || !model_instance.model->is_hidden())
         {
           model_instance.intersect(model_view, ray, &results, animtime, animate);
         }
-      });
-    }
-
-    if (draw_wmo)
-    {
-      ZoneScopedN("World::intersect() : intersect WMOs");
-      _model_instance_storage.for_each_wmo_instance([&] (WMOInstance& wmo_instance)
+      }
+      else if (obj->which() == eWMO && draw_wmo)
       {
+        auto& wmo_instance = *static_cast<WMOInstance*>(obj);
+
         if (draw_hidden_models || !wmo_instance.wmo->is_hidden())
         {
           wmo_instance.intersect(ray, &results, draw_wmo_exterior);
         }
-      });
-    }
+      }
+    });
   }
 
   return std::move(results);
@@ -1247,6 +1252,11 @@ selection_result World::intersect (glm::mat4x4 const& model_view
 
 void World::update_models_emitters(float dt)
 {
+  if (!ModelManager::particles_drawn)
+  {
+    return;
+  }
+
   ZoneScoped;
   while (dt > 0.1f)
   {
@@ -1547,20 +1557,80 @@ void World::changeTerrain(glm::vec3 const& pos, float change, float radius, int
 {
   ZoneScoped;
 
-  for_all_chunks_in_range
+  edit_terrain_in_range
     ( pos, radius
-    , [&] (MapChunk* chunk)
-      {
-        NOGGIT_CUR_ACTION->registerChunkTerrainChange(chunk);
-        return chunk->changeTerrain(pos, change, radius, BrushType, inner_radius);
-      }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk, Noggit::terrain_edit_batch& batch)
       {
-        recalc_norms (chunk);
+        chunk->collectTerrainChange(pos, change, radius, BrushType, inner_radius, batch);
       }
     );
 }
 
+void World::edit_terrain_in_range ( glm::vec3 const& pos
+                                  , float radius
+                                  , std::function<void (MapChunk*, Noggit::terrain_edit_batch&)> const& collect
+                                  )
+{
+  ZoneScoped;
+
+  std::vector<Noggit::terrain_edit_batch> batches;
+
+  for (MapTile* tile : mapIndex.tiles_in_range (pos, radius))
+  {
+    if (!tile->finishedLoading())
+    {
+      continue;
+    }
+
+    for (MapChunk* chunk : tile->chunks_in_range (pos, radius))
+    {
+      // the undo state has to be taken here, before anything is written
+      NOGGIT_CUR_ACTION->registerChunkTerrainChange(chunk);
+      batches.emplace_back().chunk = chunk;
+    }
+  }
+
+  auto& pool = util::thread_pool::instance();
+
+  // kernels only read the terrain (blur reads the neighbouring chunks), so all of
+  // them have to be done before the first height is written
+  pool.parallel_for ( batches.size()
+                    , [&] (std::size_t i)
+                      {
+                        collect(batches[i].chunk, batches[i]);
+                      }
+                    );
+
+  std::erase_if(batches, [] (Noggit::terrain_edit_batch const& batch) { return batch.empty(); });
+
+  pool.parallel_for ( batches.size()
+                    , [&] (std::size_t i)
+                      {
+                        batches[i].chunk->applyTerrainEdit(batches[i]);
+                      }
+                    );
+
+  // update flags and changed state are shared by all the chunks of a tile
+  for (auto const& batch : batches)
+  {
+    batch.chunk->registerChunkUpdate(ChunkUpdateFlags::VERTEX);
+    mapIndex.setChanged (batch.chunk, ChunkUpdateFlags::VERTEX);
+  }
+
+  // normals read the neighbouring vertices, which are all final now
+  pool.parallel_for ( batches.size()
+                    , [&] (std::size_t i)
+                      {
+                        batches[i].chunk->recalcEditedNorms(batches[i]);
+                      }
+                    );
+
+  for (auto const& batch : batches)
+  {
+    batch.chunk->registerChunkUpdate(ChunkUpdateFlags::NORMALS);
+  }
+}
+
 std::vector<selected_object_type> World::getObjectsInRange(glm::vec3 const& pos, float radius, bool ignore_height, bool iter_wmos_, bool iter_m2s)
 {
     // ignores height by default
@@ -1582,39 +1652,13 @@ std::vector<selected_object_type> World::getObjectsInRange(glm::vec3 const& pos,
             auto instance = _model_instance_storage.get_instance(uid);
 
             */
-    if (iter_m2s)
-    {
-        _model_instance_storage.for_each_m2_instance([&](ModelInstance& model_instance)
-            {
-                selected_object_type obj = &model_instance;
-                auto obj_pos = obj->pos;
-                if (ignore_height)
-                {
-                    obj_pos = glm::vec3(obj->pos.x, pos.y, obj->pos.z);
-                }
-                if (glm::distance(obj_pos, pos) <= radius) // this is just origin point
-                {
-                    objects_hit_list.push_back(obj);
-                }
-            });
-    }
-
-    if (iter_wmos_)
-    {
-        _model_instance_storage.for_each_wmo_instance([&](WMOInstance& wmo_instance)
+    _model_instance_storage.for_each_instance_in_range(pos, radius, ignore_height, [&](SceneObject* obj)
+        {
+            if ((obj->which() == eMODEL && iter_m2s) || (obj->which() == eWMO && iter_wmos_))
             {
-                selected_object_type obj = &wmo_instance;
-                auto obj_pos = obj->pos;
-                if (ignore_height)
-                {
-                    obj_pos = glm::vec3(obj->pos.x, pos.y, obj->pos.z);
-                }
-                if (glm::distance(obj_pos, pos) <= radius)
-                {
-                    objects_hit_list.push_back(obj);
-                }
-            });
-    }
+                objects_hit_list.push_back(obj);
+            }
+        });
 
     return objects_hit_list;
 }
@@ -1622,16 +1666,11 @@ std::vector<selected_object_type> World::getObjectsInRange(glm::vec3 const& pos,
 void World::flattenTerrain(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const glm::vec3& origin, math::degrees angle, math::degrees orientation)
 {
   ZoneScoped;
-  for_all_chunks_in_range
+  edit_terrain_in_range
     ( pos, radius
-    , [&] (MapChunk* chunk)
-      {
-        NOGGIT_CUR_ACTION->registerChunkTerrainChange(chunk);
-        return chunk->flattenTerrain(pos, remain, radius, BrushType, mode, origin, angle, orientation);
-      }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk, Noggit::terrain_edit_batch& batch)
       {
-        recalc_norms (chunk);
+        chunk->collectTerrainFlatten(pos, remain, radius, BrushType, mode, origin, angle, orientation, batch);
       }
     );
 }
@@ -1660,27 +1699,11 @@ std::vector<std::pair<SceneObject*, float>> World::getObjectsGroundDistance(glm:
 void World::blurTerrain(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode)
 {
   ZoneScoped;
-  for_all_chunks_in_range
+  edit_terrain_in_range
     ( pos, radius
-    , [&] (MapChunk* chunk)
-      {
-        NOGGIT_CUR_ACTION->registerChunkTerrainChange(chunk);
-        return chunk->blurTerrain ( pos
-                                  , remain
-                                  , radius
-                                  , BrushType
-                                  , mode
-                                  /*, [this](float x, float z) -> std::optional<float>
-                                    {
-                                      glm::vec3 vec;
-                                      auto res (GetVertex (x, z, &vec));
-                                      return res ? std::optional<float>(vec.y) : std::nullopt;
-                                    }*/
-                                  );
-      }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk, Noggit::terrain_edit_batch& batch)
       {
-        recalc_norms (chunk);
+        chunk->collectTerrainBlur(pos, remain, radius, BrushType, mode, batch);
       }
     );
 }
@@ -1761,7 +1784,7 @@ bool World::replaceTexture(glm::vec3 const& pos, float radius, scoped_blp_textur
                   if (chunk->replaceTexture(pos, radius, old_texture, new_texture, true))
                   {
                       changed = true;
-                      mapIndex.setChanged(tile);
+                      mapIndex.setChanged(chunk, ChunkUpdateFlags::ALPHAMAP);
                   }
               }
           }
@@ -1897,8 +1920,64 @@ void World::loadAllTiles(glm::vec3& camera_pos)
     if (mTile)
     {
       // mTile->wait_until_loaded();
+      // kept loaded for the rest of the session, whatever the camera does
+      mapIndex.pinTile(pair.second);
+    }
+  }
+}
+
+void World::logTerrainMemoryUsage()
+{
+  auto const kib = [] (std::size_t bytes) { return bytes / 1024; };
+
+  terrain_memory_usage total;
+  int tiles = 0;
+
+  for (MapTile* tile : mapIndex.loaded_tiles())
+  {
+    terrain_memory_usage const usage = tile->memoryUsage();
+
+    Log << "Tile " << tile->index.x << "_" << tile->index.z << ": "
+        << kib(usage.cpu()) << " KiB in memory (vertices " << kib(usage.vertices)
+        << ", colors " << kib(usage.vertex_colors) << ", shadows " << kib(usage.shadows)
+        << ", alphamaps " << kib(usage.alphamaps) << "), " << kib(usage.gpu) << " KiB of textures" << std::endl;
+
+    total += usage;
+    tiles++;
+  }
+
+  Log << "Terrain of " << tiles << " tiles: " << kib(total.cpu()) << " KiB in memory (vertices " << kib(total.vertices)
+      << ", colors " << kib(total.vertex_colors) << ", shadows " << kib(total.shadows)
+      << ", alphamaps " << kib(total.alphamaps) << "), " << kib(total.gpu) << " KiB of textures" << std::endl;
+}
+
+void World::checkTileSerialization()
+{
+  wait_for_all_tile_updates();
+
+  int tiles = 0;
+  int different = 0;
+
+  for (MapTile* tile : mapIndex.loaded_tiles())
+  {
+    MapTile::serialization_check const check = tile->checkSerialization(this);
+
+    if (check.first_difference)
+    {
+      LogError << "Tile " << tile->index.x << "_" << tile->index.z << ": serial and parallel saves differ at byte "
+               << *check.first_difference << " (" << check.serial_size << " and " << check.parallel_size << " bytes)" << std::endl;
+      different++;
+    }
+    else
+    {
+      Log << "Tile " << tile->index.x << "_" << tile->index.z << ": " << check.serial_size << " bytes, serial "
+          << check.serial_ms << " ms, parallel " << check.parallel_ms << " ms" << std::endl;
     }
+
+    tiles++;
   }
+
+  Log << "Compared the serial and parallel saves of " << tiles << " tiles, " << different << " differ" << std::endl;
 }
 
 unsigned World::getNumLoadedTiles() const
@@ -2005,13 +2084,15 @@ bool World::uid_duplicates_found() const
   return _model_instance_storage.uid_duplicates_found();
 }
 
-void World::delete_duplicate_model_and_wmo_instances()
+std::size_t World::delete_duplicate_model_and_wmo_instances()
 {
   ZoneScoped;
   reset_selection();
 
-  _model_instance_storage.clear_duplicates(false);
+  std::size_t const deleted = _model_instance_storage.clear_duplicates(false);
   need_model_updates = true;
+
+  return deleted;
 }
 
 void World::unload_every_model_and_wmo_instance()
@@ -2297,12 +2378,20 @@ void World::updateTilesEntry(SceneObject* entry, model_update type)
 void World::updateTilesWMO(WMOInstance* wmo, model_update type)
 {
   ZoneScoped;
+  if (type == model_update::add)
+  {
+    _model_instance_storage.update_instance_extents(wmo);
+  }
   _tile_update_queue.queue_update(wmo, type);
 }
 
 void World::updateTilesModel(ModelInstance* m2, model_update type)
 {
   ZoneScoped;
+  if (type == model_update::add)
+  {
+    _model_instance_storage.update_instance_extents(m2);
+  }
   _tile_update_queue.queue_update(m2, type);
 }
 
@@ -2312,6 +2401,16 @@ void World::wait_for_all_tile_updates()
   _tile_update_queue.wait_for_all_update();
 }
 
+void World::markModelInstancesDirty()
+{
+  _model_instances_dirty = true;
+}
+
+bool World::modelInstancesChanged()
+{
+  return _model_instances_dirty.exchange(false);
+}
+
 unsigned int World::getMapID() const
 {
   ZoneScoped;
@@ -3321,407 +3420,306 @@ void World::setVertexSelectionCache(Noggit::VertexSelectionCache& cache)
   _vertex_border_updated = false;
 }
 
-void World::exportAllADTsAlphamap()
+void World::exportAllADTsAlphamap(Noggit::map_image_format format)
 {
   ZoneScoped;
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
+  Noggit::export_all_tiles ( this
+                           , [&] (MapTile* tile)
+                             {
+                               Noggit::tile_image_writes writes;
 
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
+                               for (unsigned i = 1; i < 4; ++i)
+                               {
+                                 QString const path = Noggit::map_image_path(basename, tile->index, "layer" + QString::number(i), format);
+                                 writes.push_back(Noggit::gray_image_write(path, tile->getAlphamapImage(i), format));
+                               }
 
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
+                               return writes;
+                             }
+                           );
+}
 
-        QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-        if (!(path.endsWith('\\') || path.endsWith('/')))
-        {
-          path += "/";
-        }
+void World::exportAllADTsAlphamap(const std::string& filename, Noggit::map_image_format format)
+{
+  ZoneScoped;
+  QString tex(filename.c_str());
+  QString const suffix = tex.replace("/", "-");
+
+  Noggit::export_all_tiles ( this
+                           , [&] (MapTile* tile)
+                             {
+                               bool found = false;
+
+                               for (int i = 0; i < 16 && !found; ++i)
+                               {
+                                 for (int j = 0; j < 16 && !found; ++j)
+                                 {
+                                   auto chunk = tile->getChunk(i, j);
+
+                                   for (int k = 1; k < chunk->texture_set->num(); ++k)
+                                   {
+                                     if (chunk->texture_set->filename(k) == filename)
+                                     {
+                                       found = true;
+                                       break;
+                                     }
+                                   }
+                                 }
+                               }
+
+                               Noggit::tile_image_writes writes;
+
+                               if (found)
+                               {
+                                 QString const path = Noggit::map_image_path(basename, tile->index, suffix, format);
+                                 writes.push_back(Noggit::gray_image_write(path, tile->getAlphamapImage(filename), format));
+                               }
+
+                               return writes;
+                             }
+                           );
+}
+
+void World::exportAllADTsHeightmap(Noggit::map_image_format format)
+{
+  ZoneScoped;
+  float min_height = std::numeric_limits<float>::max();
+  float max_height = std::numeric_limits<float>::lowest();
 
-        QDir dir(path + "/world/maps/" + basename.c_str());
-        if (!dir.exists())
-          dir.mkpath(".");
+  // r32 files hold absolute heights, no need for the range
+  if (format != Noggit::map_image_format::r32)
+  {
+    std::mutex range_mutex;
 
-        for (int i = 1; i < 4; ++i)
-        {
-          QImage img = mTile->getAlphamapImage(i);
-          img.save(path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                   + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                   + "_layer" + std::to_string(i).c_str() + ".png", "PNG");
-        }
+    Noggit::export_all_tiles ( this
+                             , [&] (MapTile* tile)
+                               {
+                                 float const max = tile->getMaxHeight();
+                                 float const min = tile->getMinHeight();
 
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
-      }
-    }
+                                 std::scoped_lock const lock(range_mutex);
+                                 max_height = std::max(max_height, max);
+                                 min_height = std::min(min_height, min);
+
+                                 return Noggit::tile_image_writes{};
+                               }
+                             );
   }
+
+  Noggit::export_all_tiles ( this
+                           , [&] (MapTile* tile) -> Noggit::tile_image_writes
+                             {
+                               QString const path = Noggit::map_image_path(basename, tile->index, "height", format);
+
+                               if (format == Noggit::map_image_format::png)
+                               {
+                                 return {[path, img = tile->getHeightmapImage(min_height, max_height)] { img.save(path, "PNG"); }};
+                               }
+
+                               std::vector<float> samples = tile->getHeightmapSamples();
+
+                               if (format == Noggit::map_image_format::r16)
+                               {
+                                 float const range = max_height > min_height ? max_height - min_height : 1.f;
+
+                                 for (float& sample : samples)
+                                 {
+                                   sample = (sample - min_height) / range;
+                                 }
+                               }
+
+                               return { [path, samples = std::move(samples), format]
+                                        {
+                                          Noggit::save_raw_image(path, samples, format);
+                                        }
+                                      };
+                             }
+                           );
 }
 
-void World::exportAllADTsAlphamap(const std::string& filename)
+void World::exportAllADTsVertexColorMap()
 {
   ZoneScoped;
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
+  Noggit::export_all_tiles ( this
+                           , [&] (MapTile* tile) -> Noggit::tile_image_writes
+                             {
+                               QString const path = Noggit::map_image_path(basename, tile->index, "vcol", Noggit::map_image_format::png);
 
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
+                               return {[path, img = tile->getVertexColorsImage()] { img.save(path, "PNG"); }};
+                             }
+                           );
+}
 
-      if (mTile)
+void World::importAllADTsAlphamaps(QProgressDialog* progress_dialog, Noggit::map_image_format format)
+{
+  bool clean_up = false;
+  ZoneScoped;
+
+  auto layer_path = [&] (TileIndex const& tile, unsigned layer)
+  {
+    return Noggit::map_image_path(basename, tile, "layer" + QString::number(layer), format);
+  };
+
+  Noggit::import_all_tiles
+    ( this
+    , progress_dialog
+    , [&] (TileIndex const& tile)
       {
-        mTile->wait_until_loaded();
+        for (unsigned i = 1; i < 4; ++i)
+        {
+          if (QFileInfo::exists(layer_path(tile, i)))
+          {
+            return true;
+          }
+        }
 
-        bool found = false;
+        return false;
+      }
+    , [&] (TileIndex const& tile) -> Noggit::tile_image_apply
+      {
+        std::array<QImage, 4> layers;
 
-        for (int i = 0; i < 16; ++i)
+        for (unsigned i = 1; i < 4; ++i)
         {
-          for (int j = 0; j < 16; ++j)
+          QString const filename = layer_path(tile, i);
+
+          if (!QFileInfo::exists(filename))
+            continue;
+
+          QImage img;
+
+          if (format == Noggit::map_image_format::png)
           {
-            auto chunk = mTile->getChunk(i, j);
+            img.load(filename, "PNG");
+          }
+          else if (auto samples = Noggit::load_raw_image(filename, 1024 * 1024, format))
+          {
+            img = QImage(1024, 1024, QImage::Format_Grayscale8);
 
-            for (int k = 1; k < chunk->texture_set->num(); ++k)
+            for (int y = 0; y < 1024; ++y)
             {
-              if (chunk->texture_set->filename(k) == filename)
+              uchar* line = img.scanLine(y);
+
+              for (int x = 0; x < 1024; ++x)
               {
-                found = true;
-                break;
+                line[x] = static_cast<uchar>(std::lround(std::clamp((*samples)[y * 1024 + x], 0.f, 1.f) * 255.f));
               }
             }
           }
-        }
-
-        if (!found)
-          continue;
 
-        QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-        if (!(path.endsWith('\\') || path.endsWith('/')))
-        {
-          path += "/";
-        }
+          if (img.isNull())
+            continue;
 
-        QDir dir(path + "/world/maps/" + basename.c_str());
-        if (!dir.exists())
-          dir.mkpath(".");
+          if (img.width() != 1024 || img.height() != 1024)
+          {
+            img = img.scaled(1024, 1024, Qt::IgnoreAspectRatio);
+          }
 
-        QString tex(filename.c_str());
-        QImage img = mTile->getAlphamapImage(filename);
-        img.save(path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                 + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                 + "_" + tex.replace("/", "-") + ".png", "PNG");
+          layers[i] = std::move(img);
+        }
 
-        if (unload)
+        return [layers = std::move(layers), clean_up] (MapTile* tile)
         {
-          mapIndex.unloadTile(tile);
-        }
+          for (unsigned i = 1; i < 4; ++i)
+          {
+            if (!layers[i].isNull())
+            {
+              tile->setAlphaImage(layers[i], i, clean_up);
+            }
+          }
+        };
       }
-    }
-  }
+    );
 }
 
-void World::exportAllADTsHeightmap()
+void World::importAllADTsHeightmaps ( QProgressDialog* progress_dialog, float min_height, float max_height, unsigned mode, bool tiledEdges
+                                    , Noggit::map_image_format format
+                                    )
 {
   ZoneScoped;
-  float min_height = std::numeric_limits<float>::max();
-  float max_height = std::numeric_limits<float>::lowest();
-
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
+  Noggit::import_all_tiles
+    ( this
+    , progress_dialog
+    , [&] (TileIndex const& tile)
+      {
+        return QFileInfo::exists(Noggit::map_image_path(basename, tile, "height", format));
+      }
+    , [&] (TileIndex const& tile) -> Noggit::tile_image_apply
+      {
+        QString const filename = Noggit::map_image_path(basename, tile, "height", format);
 
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
+        if (format != Noggit::map_image_format::png)
+        {
+          auto samples = Noggit::load_raw_image(filename, 257 * 257, format);
 
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
+          if (!samples)
+          {
+            return {};
+          }
 
-        float max = mTile->getMaxHeight();
-        float min = mTile->getMinHeight();
+          if (format == Noggit::map_image_format::r16)
+          {
+            for (float& sample : *samples)
+            {
+              sample = (max_height - min_height) * sample + min_height;
+            }
+          }
 
-        if (max_height < max)
-          max_height = max;
+          return [heights = std::move(*samples), mode, tiledEdges] (MapTile* tile)
+          {
+            tile->setHeightmapSamples(heights, mode, tiledEdges);
+          };
+        }
 
-        if (min_height > min)
-          min_height = min;
+        QImage img;
+        img.load(filename, "PNG");
 
-        if (unload)
+        int const desiredSize = tiledEdges ? 256 : 257;
+        if (img.width() != desiredSize || img.height() != desiredSize)
         {
-          mapIndex.unloadTile(tile);
+          img = img.scaled(257, 257, Qt::IgnoreAspectRatio);
         }
+
+        return [img = std::move(img), min_height, max_height, mode, tiledEdges] (MapTile* tile)
+        {
+          tile->setHeightmapImage(img, min_height, max_height, mode, tiledEdges);
+        };
       }
-    }
-  }
+    );
+}
 
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
-
-        QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-        if (!(path.endsWith('\\') || path.endsWith('/')))
-        {
-          path += "/";
-        }
-
-        QDir dir(path + "/world/maps/" + basename.c_str());
-        if (!dir.exists())
-          dir.mkpath(".");
-
-        QImage img = mTile->getHeightmapImage(min_height, max_height);
-        img.save(path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                 + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                 + "_height.png", "PNG");
-
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
-      }
-    }
-  }
-}
-
-void World::exportAllADTsVertexColorMap()
+void World::importAllADTVertexColorMaps(unsigned mode, bool tiledEdges)
 {
   ZoneScoped;
-  for (size_t z = 0; z < 64; z++)
+  auto vcol_path = [&] (TileIndex const& tile)
   {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
+    return Noggit::map_image_path(basename, tile, "vcol", Noggit::map_image_format::png);
+  };
 
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-
-      if (mTile)
+  Noggit::import_all_tiles
+    ( this
+    , nullptr
+    , [&] (TileIndex const& tile)
       {
-        mTile->wait_until_loaded();
-
-        QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-        if (!(path.endsWith('\\') || path.endsWith('/')))
-        {
-          path += "/";
-        }
-
-        QDir dir(path + "/world/maps/" + basename.c_str());
-        if (!dir.exists())
-          dir.mkpath(".");
-
-        QImage img = mTile->getVertexColorsImage();
-        img.save(path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                 + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                 + "_vcol.png", "PNG");
-
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
+        return QFileInfo::exists(vcol_path(tile));
       }
-    }
-  }
-}
-
-void World::importAllADTsAlphamaps(QProgressDialog* progress_dialog)
-{
-  bool clean_up = false;
-  ZoneScoped;
-  QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-  if (!(path.endsWith('\\') || path.endsWith('/')))
-  {
-    path += "/";
-  }
-  int count = 0;
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      if (progress_dialog->wasCanceled())
-        return;
-
-      TileIndex tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-      
-      if (mTile)
+    , [&] (TileIndex const& tile) -> Noggit::tile_image_apply
       {
-        mTile->wait_until_loaded();
-      
-        for (int i = 1; i < 4; ++i)
-        {
-          QString filename = path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                  + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                  + "_layer" + std::to_string(i).c_str() + ".png";
-      
-          if(!QFileInfo::exists(filename))
-            continue;
-      
-          QImage img;
-          img.load(filename, "PNG");
-      
-          if (img.width() != 1024 || img.height() != 1024)
-          {
-            QImage scaled = img.scaled(1024, 1024, Qt::IgnoreAspectRatio);
-            mTile->setAlphaImage(scaled, i, clean_up);
-          }
-          else
-          {
-            mTile->setAlphaImage(img, i, clean_up);
-          }
-      
-        }
-      
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
-      
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
-
-        count++;
-        progress_dialog->setValue(count);
-      }
-
-    }
-  }
-}
-
-void World::importAllADTsHeightmaps(QProgressDialog* progress_dialog, float min_height, float max_height, unsigned mode, bool tiledEdges)
-{
-  ZoneScoped;
-  QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-  if (!(path.endsWith('\\') || path.endsWith('/')))
-  {
-    path += "/";
-  }
-
-  int count = 0;
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      if (progress_dialog->wasCanceled())
-        return;
-      TileIndex tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-      
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
-      
-        QString filename = path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                           + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                           + "_height.png";
-      
-        if (!QFileInfo::exists(filename))
-            continue;
-      
         QImage img;
-        img.load(filename, "PNG");
-      
-        size_t desiredSize = tiledEdges ? 256 : 257;
-        if (img.width() != desiredSize || img.height() != desiredSize)
-        {
-          QImage scaled = img.scaled(257, 257, Qt::IgnoreAspectRatio);
-          mTile->setHeightmapImage(scaled, min_height, max_height, mode, tiledEdges);
-        }
-        else
-        {
-          mTile->setHeightmapImage(img, min_height, max_height, mode, tiledEdges);
-        }
-      
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
-      
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
-        count++;
-        progress_dialog->setValue(count);
-      }
-    }
-  }
-}
+        img.load(vcol_path(tile), "PNG");
 
-void World::importAllADTVertexColorMaps(unsigned mode, bool tiledEdges)
-{
-  ZoneScoped;
-  QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-  if (!(path.endsWith('\\') || path.endsWith('/')))
-  {
-    path += "/";
-  }
-
-  for (size_t z = 0; z < 64; z++)
-  {
-    for (size_t x = 0; x < 64; x++)
-    {
-      TileIndex tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile) && !mapIndex.tileAwaitingLoading(tile);
-      MapTile* mTile = mapIndex.loadTile(tile);
-
-      if (mTile)
-      {
-        mTile->wait_until_loaded();
-
-        QString filename = path + "/world/maps/" + basename.c_str() + "/" + basename.c_str()
-                           + "_" + std::to_string(mTile->index.x).c_str() + "_" + std::to_string(mTile->index.z).c_str()
-                           + "_vcol.png";
-
-        if(!QFileInfo::exists(filename))
-          continue;
-
-        QImage img;
-        img.load(filename, "PNG");
-
-        size_t desiredSize = tiledEdges ? 256 : 257;
+        int const desiredSize = tiledEdges ? 256 : 257;
         if (img.width() != desiredSize || img.height() != desiredSize)
         {
-          QImage scaled = img.scaled(257, 257, Qt::IgnoreAspectRatio);
-          mTile->setVertexColorImage(scaled, mode, tiledEdges);
-        }
-        else
-        {
-          mTile->setVertexColorImage(img, mode, tiledEdges);
+          img = img.scaled(257, 257, Qt::IgnoreAspectRatio);
         }
 
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
-
-        if (unload)
+        return [img = std::move(img), mode, tiledEdges] (MapTile* tile)
         {
-          mapIndex.unloadTile(tile);
-        }
+          tile->setVertexColorImage(img, mode, tiledEdges);
+        };
       }
-    }
-  }
+    );
 }
 
 void World::ensureAllTilesetsAllADTs()
@@ -3815,349 +3813,310 @@ void World::select_objects_in_area(
   // int debug_count_obj_min_size = 0;
   // int debug_count_obj_min_size_not = 0;
 
-  for (auto& map_object : _loaded_tiles_buffer)
+  // the instances in view, the index skips the tiles and models out of the frustum.
+  // collected first, the selection and the terrain raycasts must not run under the storage lock
+  std::vector<SceneObject*> instances_in_view;
+  _model_instance_storage.for_each_instance_in_frustum(math::frustum(VPmatrix), [&] (SceneObject* instance)
   {
-    MapTile* tile = map_object.second;
+    instances_in_view.push_back(instance);
+  });
 
-    if (!tile)
-    {
-      break;
-    }
+  for (SceneObject* instance : instances_in_view)
+  {
+    [[unlikely]]
+    if (!instance->finishedLoading() || instance->instance_model()->loading_failed())
+      continue;
 
-    // some optimizations to see if the tile is in selection before iterating objects in it
-    {
-      // tile not in screen, skip
-      // frustum.intersects(tile_extents[1], tile_extents[0])
-      if (!tile->_was_rendered_last_frame)
-        continue;
+    SceneObjectTypes objectType = instance->which();
 
-      // check if tile combined extents are within selection rectangle
-      // note very useful because cases where a tile is fully rendered and not selected are very rare
- 
-      // skip if no objects
-      if (tile->getObjectInstances().empty())
+    // check if object is hidden
+    if (objectType == eWMO)
+    {
+      if (static_cast<WMOInstance*>(instance)->wmo->is_hidden())
         continue;
-
-      // bool valid = false;
-      // auto screenBounds = misc::getBoundingBoxScreenBounds(tile->getCombinedExtents(), VPmatrix
-      //   , viewport_width, viewport_height, valid,  1.0f);
-      // 
-      // // this only works if all tile points are in screen space
-      // if (valid && !math::boxIntersects(screenBounds[0], screenBounds[1]
-      //   , selection_box[0], selection_box[1]))
-      // {
-      //   continue;
-      // }
     }
-
-    for (auto const& pair : tile->getObjectInstances())
+    else if (objectType == eMODEL)
     {
-      [[unlikely]]
-      if (!(pair.first->finishedLoading()) || pair.first->loading_failed())
+      if (static_cast<ModelInstance*>(instance)->model->is_hidden())
         continue;
+    }
+    else
+    [[unlikely]]
+    {
+      continue;
+    }
 
-      [[unlikely]]
-      if (pair.second.empty())
-        continue;
+    // problem : M2s have additional sized based culling with >isInRenderDist()
+    // if (!instance->_rendered_last_frame)
+    //   continue;
+
+    // rectangle selection Pipeline
+    // 1 : regular distance checks with object's position
+    // 2 : check if oriented bounding box center is in selection rectangle (2D screen projection)
+    // 3 : If so, do a raycast that position and check if it's occluded (if any terrain is hit before object center point)
+    // if raycast succeeded it's valid !
+    // If not, continue : 
+    // 4 : check if bounding box is within selection in 2D screen space to test other points (extents screen projection + rectangles intersection)
+    //    ! if not, it definitely doesn't intersect, quit.
+    // 5 : First, check if object takes enough screenspace, if not and center point failed, it's useless to test more
+    // 6 : Now iterate a list of key points from bounding box points to check if they're occluded :
+    //    - Optional : get the center of the intersection rectangle (overlap area between obj screen bounds and selection rectangle)
+    //                 Project it to 3D and add it to the list of points to check
+    //    - First, check if each point is in the selection rectangle (screen projection)
+    //    - Now raycast each point and check if each point is occluded by terrain
+    //    - if ANY point succeeds and isn't occluded, it means the object isn't entirely occluded and we can select it
+
+    if (processed_obj_count > max_position_raycast_processing)
+      break;
 
-      SceneObjectTypes objectType = pair.second[0]->which();
+    // 1 : regular distance checks with object's position
+    const float distance = glm::distance(camera_position, instance->pos);
+    if (distance > user_depth || distance > renderer()->cullDistance())
+      continue;
 
-      // check if object is hidden
-      if (objectType == eWMO)
-      {
-        WMOInstance* model_instance = static_cast<WMOInstance*>(pair.second[0]);
+    math::aabb obj_world_aabb(instance->getExtents()[0], instance->getExtents()[1]);
+    auto aabb_center = obj_world_aabb.center();
 
-        if (model_instance->wmo->is_hidden())
-          continue;
-      }
-      else if (objectType == eMODEL)
-      {
-        ModelInstance* model_instance = static_cast<ModelInstance*>(pair.second[0]);
+    bool point_valid = false;
+    auto center_screen_pos = misc::projectPointToScreen(aabb_center, VPmatrix, viewport_width, viewport_height, point_valid);
+    // if screenPos.w < 0.0f, object is behind camera
+    // check object bounding radius instead to compare the object's size, if it clips with the camera.
+    if (center_screen_pos.w < -instance->getBoundingRadius())
+    {
+      continue;
+    }
 
-        if (model_instance->model->is_hidden())
-          continue;
-      }
-      else
-      [[unlikely]]
+    bool do_selection = false;
+    // 2: check if position point is within rectangle first because it is much cheaper
+    {
+      const glm::vec2 screenPos2D = glm::vec2(center_screen_pos);
+      if (misc::pointInside(screenPos2D, selection_box))
       {
-        continue;
+        // processed_obj_count++;
+        // 3: check if center point is occluded by terrain
+        if (processed_obj_count < max_position_raycast_processing && 
+          !is_point_occluded_by_terrain(aabb_center, view, VPmatrix, viewport_width, viewport_height, camera_position))
+        {
+          // if not occluded success! select it and skip other checks
+          add_to_selection(instance, false, false);
+          continue;
+        }
+        // else
+        //   bool debug_breakpoint = true;
       }
+    }
+    
+    // 4 : if center point raycast didn't succeed, check again if bounding box is within selection in 2D screen space to test other points
 
-      for (auto const& instance : pair.second)
-      {
-        // problem : M2s have additional sized based culling with >isInRenderDist()
-        // if (!instance->_rendered_last_frame)
-        //   continue;
-
-        // rectangle selection Pipeline
-        // 1 : regular distance checks with object's position
-        // 2 : check if oriented bounding box center is in selection rectangle (2D screen projection)
-        // 3 : If so, do a raycast that position and check if it's occluded (if any terrain is hit before object center point)
-        // if raycast succeeded it's valid !
-        // If not, continue : 
-        // 4 : check if bounding box is within selection in 2D screen space to test other points (extents screen projection + rectangles intersection)
-        //    ! if not, it definitely doesn't intersect, quit.
-        // 5 : First, check if object takes enough screenspace, if not and center point failed, it's useless to test more
-        // 6 : Now iterate a list of key points from bounding box points to check if they're occluded :
-        //    - Optional : get the center of the intersection rectangle (overlap area between obj screen bounds and selection rectangle)
-        //                 Project it to 3D and add it to the list of points to check
-        //    - First, check if each point is in the selection rectangle (screen projection)
-        //    - Now raycast each point and check if each point is occluded by terrain
-        //    - if ANY point succeeds and isn't occluded, it means the object isn't entirely occluded and we can select it
-
-        if (processed_obj_count > max_position_raycast_processing)
-          break;
+    std::array<glm::vec3, 2> local_extents;
+    if (objectType == eWMO)
+    {
+      WMOInstance* wmo_instance = static_cast<WMOInstance*>(instance);
+      local_extents = wmo_instance->getLocalExtents();
+    }
+    else if (objectType == eMODEL)
+    {
+      ModelInstance* model_instance = static_cast<ModelInstance*>(instance);
+      local_extents = model_instance->getLocalExtents();
+    }
 
-        // 1 : regular distance checks with object's position
-        const float distance = glm::distance(camera_position, instance->pos);
-        if (distance > user_depth || distance > renderer()->cullDistance())
-          continue;
+    int num_valid_points = 0;
+    std::array<glm::vec2, 2> obj_screnbounds = misc::getBoundingBoxScreenBounds(local_extents, VPmatrix
+      , viewport_width, viewport_height, num_valid_points, instance->transformMatrix(), bounds_check_scale);
+      
+    LogError << "point A reached (" << std::endl;
 
-        math::aabb obj_world_aabb(instance->getExtents()[0], instance->getExtents()[1]);
-        auto aabb_center = obj_world_aabb.center();
+    if (num_valid_points < 3)
+      continue;
 
-        bool point_valid = false;
-        auto center_screen_pos = misc::projectPointToScreen(aabb_center, VPmatrix, viewport_width, viewport_height, point_valid);
-        // if screenPos.w < 0.0f, object is behind camera
-        // check object bounding radius instead to compare the object's size, if it clips with the camera.
-        if (center_screen_pos.w < -instance->getBoundingRadius())
-        {
-          continue;
-        }
+    // Screen bounds intersection check 
+    // 
+    // if (!math::boxIntersects(obj_screnbounds[0], obj_screnbounds[1]
+    //   , selection_box[0], selection_box[1]))
+    // {
+    //   // if rectangles don't intersect, just skip
+    //   continue;
+    // }
+
+    LogError << "point B reached (" << std::endl;
+
+    // 1 : get the intersection rectangle of screen space and bounding box
+    glm::vec2 intersectionMin = glm::max(obj_screnbounds[0], selection_box[0]);
+    glm::vec2 intersectionMax = glm::min(obj_screnbounds[1], selection_box[1]);
+    // Check for Valid Intersection:
+    // if (intersectionMin.x < intersectionMax.x && intersectionMin.y < intersectionMax.y)
+    if (!(intersectionMin.x < intersectionMax.x) || !(intersectionMin.y < intersectionMax.y))
+      continue;
 
-        bool do_selection = false;
-        // 2: check if position point is within rectangle first because it is much cheaper
-        {
-          const glm::vec2 screenPos2D = glm::vec2(center_screen_pos);
-          if (misc::pointInside(screenPos2D, selection_box))
-          {
-            // processed_obj_count++;
-            // 3: check if center point is occluded by terrain
-            if (processed_obj_count < max_position_raycast_processing && 
-              !is_point_occluded_by_terrain(aabb_center, view, VPmatrix, viewport_width, viewport_height, camera_position))
-            {
-              // if not occluded success! select it and skip other checks
-              add_to_selection(instance, false, false);
-              continue;
-            }
-            // else
-            //   bool debug_breakpoint = true;
-          }
-        }
-        
-        // 4 : if center point raycast didn't succeed, check again if bounding box is within selection in 2D screen space to test other points
+    LogError << "point C reached (" << std::endl;
+    
+    // 2 : get center
+    glm::vec2 intersectionCenter = (intersectionMin + intersectionMax) * 0.5f;
+    // 3 : convert 2D screenspace point back to 3d
+    glm::vec4 normalisedView = invertedProjViewMatrix * misc::normalized_device_coords(intersectionCenter.x, intersectionCenter.y,
+      viewport_width, viewport_height);
+    glm::vec3 intersectionCenter_pos = glm::vec3(normalisedView.x / normalisedView.w, normalisedView.y / normalisedView.w, normalisedView.z / normalisedView.w);
+
+    std::array<glm::vec3, 8> obj_world_bounds_corners;
+    // For animated models, recalc vertex bounding box
+    if (objectType == eMODEL)
+    {
+      ModelInstance* model_instance = static_cast<ModelInstance*>(instance);
+      if (model_instance->model->animated_mesh() && model_instance->model->mesh_bounds_ratio < 0.8f)
+      {
+        auto animated_local_extents = model_instance->model->getAnimatedBoundingBox();
 
-        std::array<glm::vec3, 2> local_extents;
-        if (objectType == eWMO)
-        {
-          WMOInstance* wmo_instance = static_cast<WMOInstance*>(pair.second[0]);
-          local_extents = wmo_instance->getLocalExtents();
-        }
-        else if (objectType == eMODEL)
-        {
-          ModelInstance* model_instance = static_cast<ModelInstance*>(pair.second[0]);
-          local_extents = model_instance->getLocalExtents();
-        }
+        // hack, animated coords are already adjusted
+        animated_local_extents[0] = glm::vec3(animated_local_extents[0].x, -animated_local_extents[0].z, animated_local_extents[0].y);
+        animated_local_extents[1] = glm::vec3(animated_local_extents[1].x, -animated_local_extents[1].z, animated_local_extents[1].y);
 
-        int num_valid_points = 0;
-        std::array<glm::vec2, 2> obj_screnbounds = misc::getBoundingBoxScreenBounds(local_extents, VPmatrix
+        // update screen bounds
+        num_valid_points = 0;
+        obj_screnbounds = misc::getBoundingBoxScreenBounds(animated_local_extents, VPmatrix
           , viewport_width, viewport_height, num_valid_points, instance->transformMatrix(), bounds_check_scale);
-          
-        LogError << "point A reached (" << std::endl;
 
+
+        // check if animated BB intersected
         if (num_valid_points < 3)
           continue;
+        if (!math::boxIntersects(obj_screnbounds[0], obj_screnbounds[1]
+          , selection_box[0], selection_box[1]))
+        {
+          continue;
+        }
 
-        // Screen bounds intersection check 
-        // 
-        // if (!math::boxIntersects(obj_screnbounds[0], obj_screnbounds[1]
-        //   , selection_box[0], selection_box[1]))
-        // {
-        //   // if rectangles don't intersect, just skip
-        //   continue;
-        // }
+        math::aabb animated_local_aabb(animated_local_extents[0], animated_local_extents[1]);
+        // converts to world
+        obj_world_bounds_corners = animated_local_aabb.rotated_corners(instance->transformMatrix(), true);
 
-        LogError << "point B reached (" << std::endl;
+        // get extents and update bb to use
+        obj_world_aabb = math::aabb(std::vector<glm::vec3>(obj_world_bounds_corners.begin(), obj_world_bounds_corners.end()));
 
+        // raycast the center of the intersecting animated bounds
+        // 
+        // get the center of the intersection rectangle
         // 1 : get the intersection rectangle of screen space and bounding box
-        glm::vec2 intersectionMin = glm::max(obj_screnbounds[0], selection_box[0]);
-        glm::vec2 intersectionMax = glm::min(obj_screnbounds[1], selection_box[1]);
+        intersectionMin = glm::max(obj_screnbounds[0], selection_box[0]);
+        intersectionMax = glm::min(obj_screnbounds[1], selection_box[1]);
         // Check for Valid Intersection:
-        // if (intersectionMin.x < intersectionMax.x && intersectionMin.y < intersectionMax.y)
-        if (!(intersectionMin.x < intersectionMax.x) || !(intersectionMin.y < intersectionMax.y))
+        if (intersectionMin.x < intersectionMax.x && intersectionMin.y < intersectionMax.y) {
+          // Valid intersection
+        }
+        else 
+        {
           continue;
-
-        LogError << "point C reached (" << std::endl;
-        
+        }
         // 2 : get center
-        glm::vec2 intersectionCenter = (intersectionMin + intersectionMax) * 0.5f;
+        intersectionCenter = (intersectionMin + intersectionMax) * 0.5f;
         // 3 : convert 2D screenspace point back to 3d
-        glm::vec4 normalisedView = invertedProjViewMatrix * misc::normalized_device_coords(intersectionCenter.x, intersectionCenter.y,
+        normalisedView = invertedProjViewMatrix * misc::normalized_device_coords(intersectionCenter.x, intersectionCenter.y,
           viewport_width, viewport_height);
-        glm::vec3 intersectionCenter_pos = glm::vec3(normalisedView.x / normalisedView.w, normalisedView.y / normalisedView.w, normalisedView.z / normalisedView.w);
-
-        std::array<glm::vec3, 8> obj_world_bounds_corners;
-        // For animated models, recalc vertex bounding box
-        if (objectType == eMODEL)
-        {
-          ModelInstance* model_instance = static_cast<ModelInstance*>(pair.second[0]);
-          if (model_instance->model->animated_mesh() && model_instance->model->mesh_bounds_ratio < 0.8f)
-          {
-            auto animated_local_extents = model_instance->model->getAnimatedBoundingBox();
-
-            // hack, animated coords are already adjusted
-            animated_local_extents[0] = glm::vec3(animated_local_extents[0].x, -animated_local_extents[0].z, animated_local_extents[0].y);
-            animated_local_extents[1] = glm::vec3(animated_local_extents[1].x, -animated_local_extents[1].z, animated_local_extents[1].y);
-
-            // update screen bounds
-            num_valid_points = 0;
-            obj_screnbounds = misc::getBoundingBoxScreenBounds(animated_local_extents, VPmatrix
-              , viewport_width, viewport_height, num_valid_points, instance->transformMatrix(), bounds_check_scale);
+        intersectionCenter_pos = glm::vec3(normalisedView.x / normalisedView.w, normalisedView.y / normalisedView.w, normalisedView.z / normalisedView.w);
+        //////
 
+      }
+      else
+      {
+        obj_world_bounds_corners = obj_world_aabb.rotated_corners(instance->transformMatrix(), false);
+      }
+    }
+    else if (objectType == eWMO)
+    {
+      obj_world_bounds_corners = obj_world_aabb.rotated_corners(instance->transformMatrix(), false);
+    }
 
-            // check if animated BB intersected
-            if (num_valid_points < 3)
-              continue;
-            if (!math::boxIntersects(obj_screnbounds[0], obj_screnbounds[1]
-              , selection_box[0], selection_box[1]))
-            {
-              continue;
-            }
-
-            math::aabb animated_local_aabb(animated_local_extents[0], animated_local_extents[1]);
-            // converts to world
-            obj_world_bounds_corners = animated_local_aabb.rotated_corners(instance->transformMatrix(), true);
-
-            // get extents and update bb to use
-            obj_world_aabb = math::aabb(std::vector<glm::vec3>(obj_world_bounds_corners.begin(), obj_world_bounds_corners.end()));
-
-            // raycast the center of the intersecting animated bounds
-            // 
-            // get the center of the intersection rectangle
-            // 1 : get the intersection rectangle of screen space and bounding box
-            intersectionMin = glm::max(obj_screnbounds[0], selection_box[0]);
-            intersectionMax = glm::min(obj_screnbounds[1], selection_box[1]);
-            // Check for Valid Intersection:
-            if (intersectionMin.x < intersectionMax.x && intersectionMin.y < intersectionMax.y) {
-              // Valid intersection
-            }
-            else 
-            {
-              continue;
-            }
-            // 2 : get center
-            intersectionCenter = (intersectionMin + intersectionMax) * 0.5f;
-            // 3 : convert 2D screenspace point back to 3d
-            normalisedView = invertedProjViewMatrix * misc::normalized_device_coords(intersectionCenter.x, intersectionCenter.y,
-              viewport_width, viewport_height);
-            intersectionCenter_pos = glm::vec3(normalisedView.x / normalisedView.w, normalisedView.y / normalisedView.w, normalisedView.z / normalisedView.w);
-            //////
 
-          }
-          else
-          {
-            obj_world_bounds_corners = obj_world_aabb.rotated_corners(instance->transformMatrix(), false);
-          }
-        }
-        else if (objectType == eWMO)
-        {
-          obj_world_bounds_corners = obj_world_aabb.rotated_corners(instance->transformMatrix(), false);
-        }
+    // 4.5 2nd raycast. Check if center of the intersection box is visible
+    // TODO : for WMOs this is way to generous due to their more complex shape, it would be better to iterate the bounding box of each group
+    if (!is_point_occluded_by_terrain(intersectionCenter_pos, view, VPmatrix, viewport_width, viewport_height
+      , camera_position, (distance - instance->getBoundingRadius())))
+    {
+      // if not occluded success! select it and skip other checks
+      add_to_selection(instance, false, false);
+      continue;
+    }
 
+    // 5 : Optimization : Only do raycast bounds checks for object that take enough screen space
+    // if object is too small checking other points is useless
+    // we check _rendered_last_frame because m2s that are too small or frustum culled already don't render
+    {
+      float bounds_size = glm::distance(obj_screnbounds[0], obj_screnbounds[1]);
+      if (bounds_size < obj_raycast_min_size || !instance->_rendered_last_frame)
+      {
+        // debug_count_obj_min_size_not++;
+        continue;
+      }
+      else if (processed_obj_count > max_bounds_raycast_processing)
+      {
+        // select it anyways
+        do_selection = true;
+        // debug_count_obj_min_size++;
+      }
+    }
 
-        // 4.5 2nd raycast. Check if center of the intersection box is visible
-        // TODO : for WMOs this is way to generous due to their more complex shape, it would be better to iterate the bounding box of each group
-        if (!is_point_occluded_by_terrain(intersectionCenter_pos, view, VPmatrix, viewport_width, viewport_height
-          , camera_position, (distance - instance->getBoundingRadius())))
-        {
-          // if not occluded success! select it and skip other checks
-          add_to_selection(instance, false, false);
-          continue;
-        }
+    constexpr bool enable_bounds_raycasts = true;
+    //6 : Occlusion test on object's corners (that are in selection box)
+    // uses ray casting, very expensive
+    if (enable_bounds_raycasts && !do_selection /* && instance->_rendered_last_frame && (processed_obj_count < max_bounds_raycast_processing)*/)
+    {
+      processed_obj_count++;
 
-        // 5 : Optimization : Only do raycast bounds checks for object that take enough screen space
-        // if object is too small checking other points is useless
-        // we check _rendered_last_frame because m2s that are too small or frustum culled already don't render
-        {
-          float bounds_size = glm::distance(obj_screnbounds[0], obj_screnbounds[1]);
-          if (bounds_size < obj_raycast_min_size || !instance->_rendered_last_frame)
-          {
-            // debug_count_obj_min_size_not++;
-            continue;
-          }
-          else if (processed_obj_count > max_bounds_raycast_processing)
-          {
-            // select it anyways
-            do_selection = true;
-            // debug_count_obj_min_size++;
-          }
-        }
+      // TODO : instead iterate bounds of the intersection rectangle instead of object's bounds
 
-        constexpr bool enable_bounds_raycasts = true;
-        //6 : Occlusion test on object's corners (that are in selection box)
-        // uses ray casting, very expensive
-        if (enable_bounds_raycasts && !do_selection /* && instance->_rendered_last_frame && (processed_obj_count < max_bounds_raycast_processing)*/)
-        {
-          processed_obj_count++;
-
-          // TODO : instead iterate bounds of the intersection rectangle instead of object's bounds
-
-          // Iterate key points instead of all 8 corners
-          std::vector<glm::vec3> key_points = {
-            // intersectionCenter_pos, // checked in 4.5 now
-            // (obj_world_bounds_corners[0] + obj_world_bounds_corners[6]) * 0.5f,  // Center between top corners
-            // obj_world_bounds_corners[0], // Top-right-front
-            // obj_world_bounds_corners[5], // Top-left-back
-            // obj_world_bounds_corners[4], // Top-left-front
-            // obj_world_bounds_corners[1] // Top-right-back
-          };
+      // Iterate key points instead of all 8 corners
+      std::vector<glm::vec3> key_points = {
+        // intersectionCenter_pos, // checked in 4.5 now
+        // (obj_world_bounds_corners[0] + obj_world_bounds_corners[6]) * 0.5f,  // Center between top corners
+        // obj_world_bounds_corners[0], // Top-right-front
+        // obj_world_bounds_corners[5], // Top-left-back
+        // obj_world_bounds_corners[4], // Top-left-front
+        // obj_world_bounds_corners[1] // Top-right-back
+      };
 
-          // int required_num_unoccluded_corners = 2;
-          bool object_occluded = true;
+      // int required_num_unoccluded_corners = 2;
+      bool object_occluded = true;
 
-          // check if points are occluded by terrain
-          // bool first_point = true;// special for intersectionCenter_pos because it doesn't have a distance, just a direction
+      // check if points are occluded by terrain
+      // bool first_point = true;// special for intersectionCenter_pos because it doesn't have a distance, just a direction
 
-          for (const auto& corner : key_points /*obj_aabb_corners*/)
-          {
-            // TODO : only need to do max top left and max top right in 2d instead of all corners?
+      for (const auto& corner : key_points /*obj_aabb_corners*/)
+      {
+        // TODO : only need to do max top left and max top right in 2d instead of all corners?
 
-            // only process points that are within selection rectangle
-            bool point_valid = false;
-            auto point_screen_pos = misc::projectPointToScreen(corner, VPmatrix, viewport_width, viewport_height, point_valid);
-            if (!point_valid)
-              continue;
-            if (!misc::pointInside(point_screen_pos, selection_box))
-              continue;
+        // only process points that are within selection rectangle
+        bool point_valid = false;
+        auto point_screen_pos = misc::projectPointToScreen(corner, VPmatrix, viewport_width, viewport_height, point_valid);
+        if (!point_valid)
+          continue;
+        if (!misc::pointInside(point_screen_pos, selection_box))
+          continue;
 
-            bool corner_occluded = is_point_occluded_by_terrain(corner
-              , view
-              , VPmatrix
-              , viewport_width
-              , viewport_height
-              , camera_position
-              /*, first_point ? distance - instance->getBoundingRadius() : 0.0f*/);
+        bool corner_occluded = is_point_occluded_by_terrain(corner
+          , view
+          , VPmatrix
+          , viewport_width
+          , viewport_height
+          , camera_position
+          /*, first_point ? distance - instance->getBoundingRadius() : 0.0f*/);
 
-            // first_point = false;
+        // first_point = false;
 
-            if (!corner_occluded)
-            {
-              // if just one point isn't occluded is enough, select object
-              object_occluded = false;
-              break;
-            }
-            // object_occluded = true;
-          }
-        
-          do_selection = !object_occluded;
+        if (!corner_occluded)
+        {
+          // if just one point isn't occluded is enough, select object
+          object_occluded = false;
+          break;
         }
-
-        if (!do_selection)
-          continue;
-
-        add_to_selection(instance, false, false);
+        // object_occluded = true;
       }
+    
+      do_selection = !object_occluded;
     }
+
+    if (!do_selection)
+      continue;
+
+    add_to_selection(instance, false, false);
   }
 
   this->update_selection_pivot();
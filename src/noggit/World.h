@@ -5,10 +5,13 @@
 #include <math/trig.hpp>
 #include <noggit/Selection.h>
 #include <noggit/map_horizon.h>
+#include <noggit/map_image_pipeline.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/world_tile_update_queue.hpp>
 #include <noggit/world_model_instances_storage.hpp>
 #include <noggit/ContextObject.hpp>
+#include <atomic>
+#include <functional>
 #include <optional>
 #include <string>
 #include <unordered_set>
@@ -19,6 +22,7 @@
 namespace Noggit
 {
   struct object_paste_params;
+  struct terrain_edit_batch;
   struct VertexSelectionCache;
 }
 
@@ -49,6 +53,9 @@ protected:
   std::unordered_set<unsigned int> selected_uids; // fast lookup
   std::vector<selection_type> _current_selection;
   // std::unordered_map<std::string, std::vector<ModelInstance*>> _models_by_filename;
+  //! set when instances are added, moved or removed, the renderer rebuilds its model cull list then.
+  //! declared before the storage and the tiles as they set it until they are destroyed
+  std::atomic<bool> _model_instances_dirty = true;
   Noggit::world_model_instances_storage _model_instance_storage;
   Noggit::world_tile_update_queue _tile_update_queue;
 public:
@@ -241,9 +248,9 @@ public:
   void exportADTAlphamap(glm::vec3 const& pos, std::string const& filename);
   void exportADTHeightmap(glm::vec3 const& pos, float min_height, float max_height);
   void exportADTVertexColorMap(glm::vec3 const& pos);
-  void exportAllADTsAlphamap();
-  void exportAllADTsAlphamap(std::string const& filename);
-  void exportAllADTsHeightmap();
+  void exportAllADTsAlphamap(Noggit::map_image_format format = Noggit::map_image_format::png);
+  void exportAllADTsAlphamap(std::string const& filename, Noggit::map_image_format format = Noggit::map_image_format::png);
+  void exportAllADTsHeightmap(Noggit::map_image_format format = Noggit::map_image_format::png);
   void exportAllADTsVertexColorMap();
 
   void importADTAlphamap(glm::vec3 const& pos, QImage const& image, unsigned layer, bool cleanup);
@@ -254,8 +261,11 @@ public:
   void importADTVertexColorMap(glm::vec3 const& pos, int mode, bool tiledEdges);
   void importADTVertexColorMap(glm::vec3 const& pos, QImage const& image, int mode, bool tiledEdges);
 
-  void importAllADTsAlphamaps(QProgressDialog* progress_dialog);
-  void importAllADTsHeightmaps(QProgressDialog* progress_dialog, float min_height, float max_height, unsigned mode, bool tiledEdges);
+  void importAllADTsAlphamaps(QProgressDialog* progress_dialog, Noggit::map_image_format format = Noggit::map_image_format::png);
+  //! min_height and max_height are only used by png and r16, r32 files hold absolute heights
+  void importAllADTsHeightmaps ( QProgressDialog* progress_dialog, float min_height, float max_height, unsigned mode, bool tiledEdges
+                               , Noggit::map_image_format format = Noggit::map_image_format::png
+                               );
   void importAllADTVertexColorMaps(unsigned mode, bool tiledEdges);
 
   void ensureAllTilesetsADT(glm::vec3 const& pos);
@@ -309,13 +319,18 @@ public:
   void updateTilesWMO(WMOInstance* wmo, model_update type);
   void updateTilesModel(ModelInstance* m2, model_update type);
   void wait_for_all_tile_updates();
+  //! can be called from any thread
+  void markModelInstancesDirty();
+  //! whether instances were added, moved or removed since the last call
+  bool modelInstancesChanged();
 
   void deleteModelInstance(int uid, bool action);
   void deleteWMOInstance(int uid, bool action);
   void deleteInstance(int uid, bool action);
 
   bool uid_duplicates_found() const;
-  void delete_duplicate_model_and_wmo_instances();
+  //! \returns the number of deleted instances
+  std::size_t delete_duplicate_model_and_wmo_instances();
   // used after the uid fix all
   void unload_every_model_and_wmo_instance();
 
@@ -377,6 +392,10 @@ public:
   bool need_model_updates = false;
 
   void loadAllTiles(glm::vec3& camera_pos);
+  //! logs the terrain memory of every loaded tile and the total
+  void logTerrainMemoryUsage();
+  //! logs whether the serial and parallel saves of every loaded tile give the same bytes
+  void checkTileSerialization();
   unsigned getNumLoadedTiles() const;;
   unsigned getNumRenderedTiles() const;;
   unsigned getNumRenderedObjects() const;;
@@ -399,6 +418,13 @@ public:
   void clear_selection_groups();
 
 private:
+  //! registers the chunks in range for undo, runs collect on each of them in
+  //! parallel then writes the heights and recomputes the normals of the edited vertices
+  void edit_terrain_in_range ( glm::vec3 const& pos
+                             , float radius
+                             , std::function<void (MapChunk*, Noggit::terrain_edit_batch&)> const& collect
+                             );
+
   bool is_point_occluded_by_terrain(const glm::vec3& point
     , const glm::mat4x4& view
     , const glm::mat4& VPmatrix
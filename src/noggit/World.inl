@@ -50,8 +50,9 @@ void World::for_chunk_at(glm::vec3 const& pos, Fun&& fun)
 
   if (tile && tile->finishedLoading())
   {
-    mapIndex.setChanged(tile);
-    fun(tile->getChunk((pos.x - tile->xbase) / CHUNKSIZE, (pos.z - tile->zbase) / CHUNKSIZE));
+    MapChunk* chunk = tile->getChunk((pos.x - tile->xbase) / CHUNKSIZE, (pos.z - tile->zbase) / CHUNKSIZE);
+    mapIndex.setChanged(chunk);
+    fun(chunk);
   }
 }
 
@@ -121,7 +122,7 @@ bool World::for_all_chunks_in_range (glm::vec3 const& pos, float radius, Fun&& f
       if (fun (chunk))
       {
         changed = true;
-        mapIndex.setChanged (tile);
+        mapIndex.setChanged (chunk);
       }
     }
   }
@@ -173,7 +174,7 @@ bool World::for_all_chunks_in_rect (glm::vec3 const& pos, float radius, Fun&& fu
       if (fun (chunk))
       {
         changed = true;
-        mapIndex.setChanged (tile);
+        mapIndex.setChanged (chunk);
       }
     }
   }
@@ -1,6 +1,10 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #include <noggit/application/Configuration/NoggitApplicationConfiguration.hpp>
+#include <noggit/application/HeadlessMinimapRenderer.hpp>
 #include <noggit/application/NoggitApplication.hpp>
+#ifdef NOGGIT_BUILD_BENCHMARKS
+#include <noggit/benchmarks/Benchmark.hpp>
+#endif
 #include <noggit/errorHandling.h>
 #include <noggit/ui/windows/projectSelection/NoggitProjectSelectionWindow.hpp>
 
@@ -10,6 +14,10 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QFileDialog>
 
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+
 QCommandLineParser* ProcessCommandLine()
 {
     QCommandLineParser* parser = new QCommandLineParser();
@@ -18,8 +26,22 @@ QCommandLineParser* ProcessCommandLine()
     parser->addVersionOption();
     parser->addOptions({
         {"disable-update", QApplication::translate("main", "Disable the check for update.")},
-        {"force-changelog", QApplication::translate("main", "Force displaying the changelog popup.")}
+        {"force-changelog", QApplication::translate("main", "Force displaying the changelog popup.")},
+        {"render-minimaps", QApplication::translate("main", "Render the minimaps of a map of the project then exit, without opening any window. "
+                                                            "Combine with Qt's -platform offscreen to run without a display."), "project"},
+        {"map", QApplication::translate("main", "Map id of the minimaps to render."), "id"},
+        {"minimap-format", QApplication::translate("main", "Minimap file format: dxt1 (default), dxt5 or png."), "format", "dxt1"},
+        {"minimap-resolution", QApplication::translate("main", "Minimap resolution in pixels (default 512)."), "pixels", "512"},
+        {"combined-minimap", QApplication::translate("main", "Also write an image of the whole map.")}
+        });
+#ifdef NOGGIT_BUILD_BENCHMARKS
+    parser->addOptions({
+        {"benchmark", QApplication::translate("main", "Run a benchmark then exit, an unknown name lists them."), "name"},
+        {"project", QApplication::translate("main", "Project used by the benchmarks working on a map, with --map."), "project"},
+        {"iterations", QApplication::translate("main", "Number of runs of the benchmark (default 10)."), "count", "10"},
+        {"count", QApplication::translate("main", "Size of the benchmark data: instances, tiles... (default depends on the benchmark)."), "count", "0"}
         });
+#endif
 
     return parser;
 }
@@ -39,6 +61,39 @@ int main(int argc, char *argv[])
   auto parser = ProcessCommandLine();
   parser->process(q_application);
 
+  // read before initalize() changes the working directory
+  std::optional<Noggit::Application::HeadlessMinimapOptions> headless_minimaps;
+
+  if (parser->isSet("render-minimaps"))
+  {
+    QString const format = parser->value("minimap-format").toLower();
+
+    headless_minimaps.emplace();
+    headless_minimaps->project_path = std::filesystem::absolute(parser->value("render-minimaps").toStdString());
+    headless_minimaps->map_id = parser->value("map").toInt();
+    headless_minimaps->file_format = format == "png" ? ".png" : format == "dxt5" ? ".blp (DXT5)" : ".blp (DXT1)";
+    headless_minimaps->resolution = parser->value("minimap-resolution").toInt();
+    headless_minimaps->combined_minimap = parser->isSet("combined-minimap");
+  }
+
+#ifdef NOGGIT_BUILD_BENCHMARKS
+  std::optional<Noggit::Benchmarks::BenchmarkOptions> benchmark;
+
+  if (parser->isSet("benchmark"))
+  {
+    benchmark.emplace();
+    benchmark->name = parser->value("benchmark").toStdString();
+    benchmark->map_id = parser->value("map").toInt();
+    benchmark->iterations = std::max(1, parser->value("iterations").toInt());
+    benchmark->count = parser->value("count").toULongLong();
+
+    if (parser->isSet("project"))
+    {
+      benchmark->project_path = std::filesystem::absolute(parser->value("project").toStdString());
+    }
+  }
+#endif
+
   std::vector<bool> Command;
   Command.push_back(parser->isSet("disable-update"));
   Command.push_back(parser->isSet("force-changelog"));
@@ -51,6 +106,18 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+  if (headless_minimaps)
+  {
+    return Noggit::Application::renderMinimapsHeadless(noggit, *headless_minimaps);
+  }
+
+#ifdef NOGGIT_BUILD_BENCHMARKS
+  if (benchmark)
+  {
+    return Noggit::Benchmarks::runBenchmark(noggit, *benchmark);
+  }
+#endif
+
   auto project_selection = new Noggit::Ui::Windows::NoggitProjectSelectionWindow(noggit);
   // project_selection->show();
 
@@ -0,0 +1,126 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/application/HeadlessMinimapRenderer.hpp>
+#include <noggit/application/NoggitApplication.hpp>
+#include <noggit/DBC.h>
+#include <noggit/Log.h>
+#include <noggit/MinimapRenderSettings.hpp>
+#include <noggit/project/ApplicationProject.h>
+#include <noggit/project/CurrentProject.hpp>
+#include <noggit/TileIndex.hpp>
+#include <noggit/World.h>
+#include <opengl/context.hpp>
+
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+namespace Noggit::Application
+{
+  namespace
+  {
+    // tiles loading in the background while one renders
+    constexpr std::size_t prefetch_count = 4;
+  }
+
+  int renderMinimapsHeadless(NoggitApplication* application, HeadlessMinimapOptions const& options)
+  {
+    auto project_service = Noggit::Project::ApplicationProject(application->getConfiguration());
+    auto project = project_service.loadProject(options.project_path);
+
+    if (!project)
+    {
+      LogError << "Minimap batch: couldn't load project " << options.project_path << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    application->setClientData(project->ClientData);
+    Noggit::Project::CurrentProject::initialize(project.get());
+    OpenDBs(project->ClientData);
+
+    std::string map_name;
+
+    try
+    {
+      map_name = gMapDB.getByID(options.map_id).getString(MapDB::InternalName);
+    }
+    catch (MapDB::NotFound)
+    {
+      LogError << "Minimap batch: couldn't find map " << options.map_id << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    QOpenGLContext context;
+    QOffscreenSurface surface;
+    surface.create();
+
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+      LogError << "Minimap batch: failed to create an offscreen OpenGL 4.1 context." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    OpenGL::context::scoped_setter const _(::gl, &context);
+
+    auto world = std::make_unique<World>(map_name, options.map_id, Noggit::NoggitRenderContext::MAP_VIEW);
+    world->renderer()->upload();
+
+    MinimapRenderSettings settings;
+    settings.export_mode = MinimapGenMode::MAP;
+    settings.file_format = options.file_format;
+    settings.resolution = options.resolution;
+    settings.combined_minimap = options.combined_minimap;
+
+    std::optional<QImage> combined_image;
+
+    if (settings.combined_minimap)
+    {
+      combined_image.emplace(8192, 8192, QImage::Format_RGBA8888);
+      combined_image->fill(Qt::black);
+    }
+
+    std::vector<TileIndex> tiles;
+
+    for (std::size_t i = 0; i < 4096; ++i)
+    {
+      TileIndex const tile (i / 64, i % 64);
+
+      if (world->mapIndex.hasTile(tile))
+      {
+        tiles.push_back(tile);
+      }
+    }
+
+    Log << "Minimap batch: rendering " << tiles.size() << " tiles of " << map_name << std::endl;
+
+    for (std::size_t i = 0; i < tiles.size(); ++i)
+    {
+      auto const next = tiles.begin() + i + 1;
+      world->renderer()->prefetchMinimapTiles({next, next + std::min(prefetch_count, tiles.size() - i - 1)});
+
+      if (!world->renderer()->saveMinimap(tiles[i], &settings, combined_image))
+      {
+        LogError << "Minimap rendered incorrectly for tile: " << tiles[i].x << "_" << tiles[i].z << std::endl;
+      }
+    }
+
+    world->renderer()->finishMinimaps(combined_image);
+    world->mapIndex.saveMinimapMD5translate();
+
+    if (combined_image)
+    {
+      world->renderer()->saveCombinedMinimap(*combined_image);
+    }
+
+    world->renderer()->unload();
+
+    Log << "Minimap batch: done" << std::endl;
+
+    return EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,28 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_HEADLESSMINIMAPRENDERER_HPP
+#define NOGGIT_HEADLESSMINIMAPRENDERER_HPP
+
+#include <filesystem>
+#include <string>
+
+namespace Noggit::Application
+{
+  class NoggitApplication;
+
+  struct HeadlessMinimapOptions
+  {
+    std::filesystem::path project_path;
+    int map_id = -1;
+    std::string file_format = ".blp (DXT1)";
+    int resolution = 512;
+    bool combined_minimap = false;
+  };
+
+  //! Renders the minimaps of every tile of a map from the command line, without
+  //! opening any window, using an offscreen OpenGL context (a software
+  //! implementation works). \returns the exit code of the process.
+  int renderMinimapsHeadless(NoggitApplication* application, HeadlessMinimapOptions const& options);
+}
+
+#endif //NOGGIT_HEADLESSMINIMAPRENDERER_HPP
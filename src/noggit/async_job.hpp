@@ -0,0 +1,140 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/async_priority.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class AsyncObject;
+
+enum class async_job_state : int
+{
+  queued,
+  loading,
+  done,
+  cancelled
+};
+
+//! Counter of unfinished jobs, used to await all the children a parent object queued while it was loading.
+class async_job_group
+{
+public:
+  void add()
+  {
+    _pending.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release()
+  {
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      _pending.notify_all();
+    }
+  }
+
+  void wait() const
+  {
+    for (std::size_t pending = _pending.load(); pending != 0; pending = _pending.load())
+    {
+      _pending.wait(pending);
+    }
+  }
+
+  [[nodiscard]]
+  bool finished() const
+  {
+    return _pending.load() == 0;
+  }
+
+private:
+  std::atomic<std::size_t> _pending = 0;
+};
+
+//! Cancellation handle shared between an AsyncObject and the loader queues.
+//! The queues only ever touch `object` after winning the queued -> loading transition,
+//! so a cancelled job can stay in a queue after its object was destroyed.
+struct async_job
+{
+  async_job(AsyncObject* object_, async_priority priority_)
+    : object(object_)
+    , priority(priority_)
+    , queued_at(std::chrono::steady_clock::now())
+  {}
+
+  //! \returns true if the job was still queued and will never be loaded.
+  bool cancel()
+  {
+    auto expected = async_job_state::queued;
+
+    if (state.compare_exchange_strong(expected, async_job_state::cancelled))
+    {
+      complete();
+      return true;
+    }
+
+    return false;
+  }
+
+  //! Blocks until the job is no longer being loaded by a worker.
+  void wait_while_loading() const
+  {
+    for (auto current = state.load(); current == async_job_state::loading; current = state.load())
+    {
+      state.wait(current);
+    }
+  }
+
+  //! Makes `group` wait for this job. Does nothing once the job is done or cancelled.
+  void add_dependent(std::shared_ptr<async_job_group> const& group)
+  {
+    std::lock_guard<std::mutex> const lock(_dependents_guard);
+
+    if (_completed)
+    {
+      return;
+    }
+
+    group->add();
+    _dependents.emplace_back(group);
+  }
+
+  //! Releases every group waiting on this job. Called once the state is final.
+  void complete()
+  {
+    std::vector<std::shared_ptr<async_job_group>> dependents;
+
+    {
+      std::lock_guard<std::mutex> const lock(_dependents_guard);
+      _completed = true;
+      dependents.swap(_dependents);
+    }
+
+    for (auto& group : dependents)
+    {
+      group->release();
+    }
+  }
+
+  AsyncObject* const object;
+  async_priority const priority;
+  std::chrono::steady_clock::time_point const queued_at;
+  std::atomic<async_job_state> state = async_job_state::queued;
+
+  //! order inside a priority level, lower loads first. Updated every frame for tiles,
+  //! children inherit the score of the object that queued them.
+  std::atomic<float> score = 0.f;
+
+  //! children queued while this job was loading
+  std::shared_ptr<async_job_group> const children = std::make_shared<async_job_group>();
+
+private:
+  std::mutex _dependents_guard;
+  std::vector<std::shared_ptr<async_job_group>> _dependents;
+  bool _completed = false;
+};
@@ -0,0 +1,321 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/Animated.h>
+#include <noggit/ModelHeaders.h>
+#include <math/interpolation.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    //! about the bones of a scene with a few hundred animated doodad types
+    constexpr std::size_t default_value_count = 6000;
+    constexpr std::uint32_t animations_per_value = 8;
+    constexpr std::uint32_t keyframes_per_track = 24;
+    constexpr int frames_per_iteration = 200;
+    //! milliseconds between two frames
+    constexpr int frame_time = 16;
+
+    //! stands for the m2 file, M2Value only needs get<T>(offset)
+    struct memory_file
+    {
+      std::vector<char> buffer;
+
+      template<typename T>
+      T const* get(std::size_t offset) const
+      {
+        return reinterpret_cast<T const*>(buffer.data() + offset);
+      }
+
+      template<typename T>
+      std::uint32_t append(T const* values, std::size_t count)
+      {
+        std::size_t const offset = buffer.size();
+        buffer.resize(offset + sizeof(T) * count);
+        std::memcpy(buffer.data() + offset, values, sizeof(T) * count);
+        return static_cast<std::uint32_t>(offset);
+      }
+    };
+
+    //! the keyframes of every animation of a value, as stored in the m2
+    template<typename DataType>
+    struct synthetic_tracks
+    {
+      std::int16_t interpolation;
+      std::vector<std::vector<std::uint32_t>> times;
+      //! three per keyframe (value, in, out) for hermite tracks
+      std::vector<std::vector<DataType>> keys;
+    };
+
+    template<typename DataType, typename MakeKey>
+    synthetic_tracks<DataType> make_tracks(std::int16_t interpolation, std::mt19937& random, MakeKey&& make_key)
+    {
+      std::uniform_int_distribution<std::uint32_t> step(20, 400);
+      synthetic_tracks<DataType> tracks {interpolation, {}, {}};
+
+      for (std::uint32_t anim = 0; anim < animations_per_value; ++anim)
+      {
+        // the first key at 0 and strictly increasing times, where the old lookup was correct
+        std::vector<std::uint32_t> times {0};
+        std::vector<DataType> keys;
+
+        for (std::uint32_t k = 1; k < keyframes_per_track; ++k)
+        {
+          times.push_back(times.back() + step(random));
+        }
+
+        for (std::uint32_t k = 0; k < keyframes_per_track * (interpolation == Animation::Interpolation::Type::HERMITE ? 3 : 1); ++k)
+        {
+          keys.push_back(make_key(random));
+        }
+
+        tracks.times.push_back(std::move(times));
+        tracks.keys.push_back(std::move(keys));
+      }
+
+      return tracks;
+    }
+
+    //! bakes the tracks the way Model reads them from the m2, the file is only read by the constructor
+    template<typename AnimatedType, typename DataType>
+    std::unique_ptr<Animation::M2Value<AnimatedType, DataType>> bake(synthetic_tracks<DataType> const& tracks)
+    {
+      memory_file file;
+      std::vector<AnimationBlockHeader> time_headers, key_headers;
+
+      for (std::size_t anim = 0; anim < tracks.times.size(); ++anim)
+      {
+        std::uint32_t const keyframes = static_cast<std::uint32_t>(tracks.times[anim].size());
+        time_headers.push_back({keyframes, file.append(tracks.times[anim].data(), tracks.times[anim].size())});
+        key_headers.push_back({keyframes, file.append(tracks.keys[anim].data(), tracks.keys[anim].size())});
+      }
+
+      AnimationBlock block {tracks.interpolation, -1, static_cast<std::uint32_t>(time_headers.size()), 0, static_cast<std::uint32_t>(key_headers.size()), 0};
+      block.ofsTimes = file.append(time_headers.data(), time_headers.size());
+      block.ofsKeys = file.append(key_headers.data(), key_headers.size());
+
+      return std::make_unique<Animation::M2Value<AnimatedType, DataType>>(block, file, nullptr);
+    }
+
+    // the lookup M2Value did before the tracks were flattened: a map per
+    // animation looked up with operator[] and a scan of the timestamps
+    template<typename AnimatedType, typename DataType>
+    class reference_value
+    {
+    public:
+      explicit reference_value(synthetic_tracks<DataType> const& tracks)
+        : _interpolation(tracks.interpolation)
+      {
+        Animation::Conversion<DataType, AnimatedType> conversion;
+        int const stride = _interpolation == Animation::Interpolation::Type::HERMITE ? 3 : 1;
+
+        for (std::uint32_t anim = 0; anim < tracks.times.size(); ++anim)
+        {
+          _times[anim] = tracks.times[anim];
+
+          for (std::size_t k = 0; k < tracks.keys[anim].size(); k += stride)
+          {
+            _data[anim].push_back(conversion(tracks.keys[anim][k]));
+
+            if (stride == 3)
+            {
+              _in[anim].push_back(conversion(tracks.keys[anim][k + 1]));
+              _out[anim].push_back(conversion(tracks.keys[anim][k + 2]));
+            }
+          }
+        }
+      }
+
+      AnimatedType getValue(std::uint32_t anim, std::uint32_t time)
+      {
+        std::vector<std::uint32_t>& timestamps = _times[anim];
+        std::vector<AnimatedType>& data = _data[anim];
+        std::vector<AnimatedType>& in = _in[anim];
+        std::vector<AnimatedType>& out = _out[anim];
+
+        if (data.empty())
+        {
+          return AnimatedType();
+        }
+
+        time %= timestamps.back();
+
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < timestamps.size() - 1; ++i)
+        {
+          if (time >= timestamps[i] && time < timestamps[i + 1])
+          {
+            pos = i;
+            break;
+          }
+        }
+
+        float const percentage = (time - timestamps[pos]) / static_cast<float>(timestamps[pos + 1] - timestamps[pos]);
+
+        if (_interpolation == Animation::Interpolation::Type::HERMITE)
+        {
+          return math::interpolation::hermite(percentage, data[pos], data[pos + 1], in[pos], out[pos]);
+        }
+
+        if constexpr (std::is_same_v<AnimatedType, glm::quat>)
+        {
+          return glm::slerp(data[pos], data[pos + 1], percentage);
+        }
+        else
+        {
+          return glm::mix(data[pos], data[pos + 1], percentage);
+        }
+      }
+
+    private:
+      std::int16_t _interpolation;
+      std::map<std::uint32_t, std::vector<std::uint32_t>> _times;
+      std::map<std::uint32_t, std::vector<AnimatedType>> _data;
+      std::map<std::uint32_t, std::vector<AnimatedType>> _in;
+      std::map<std::uint32_t, std::vector<AnimatedType>> _out;
+    };
+
+    //! the values of a bone: translation, rotation and scaling
+    struct bone_values
+    {
+      std::unique_ptr<Animation::M2Value<glm::vec3>> trans;
+      std::unique_ptr<Animation::M2Value<glm::quat, packed_quaternion>> rot;
+      std::unique_ptr<Animation::M2Value<glm::vec3>> scale;
+
+      std::unique_ptr<reference_value<glm::vec3, glm::vec3>> reference_trans;
+      std::unique_ptr<reference_value<glm::quat, packed_quaternion>> reference_rot;
+      std::unique_ptr<reference_value<glm::vec3, glm::vec3>> reference_scale;
+    };
+
+    template<typename T>
+    bool same_bits(T const& a, T const& b)
+    {
+      return std::memcmp(&a, &b, sizeof(T)) == 0;
+    }
+  }
+
+  int animationTrackBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::size_t const count = options.count ? options.count : default_value_count;
+    std::mt19937 random (42);
+    std::uniform_real_distribution<float> coordinate(-10.f, 10.f);
+    std::uniform_int_distribution<int> component(-32767, 32767);
+
+    auto const make_vec3 = [&] (std::mt19937& r) { return glm::vec3(coordinate(r), coordinate(r), coordinate(r)); };
+    auto const make_quaternion = [&] (std::mt19937& r)
+    {
+      return packed_quaternion { static_cast<std::int16_t>(component(r)), static_cast<std::int16_t>(component(r))
+                               , static_cast<std::int16_t>(component(r)), static_cast<std::int16_t>(component(r))
+                               };
+    };
+
+    // bones mostly use linear tracks, some hermite ones for the translations
+    std::vector<bone_values> bones(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      auto const trans = make_tracks<glm::vec3>(i % 4 ? Animation::Interpolation::Type::LINEAR : Animation::Interpolation::Type::HERMITE, random, make_vec3);
+      auto const rot = make_tracks<packed_quaternion>(Animation::Interpolation::Type::LINEAR, random, make_quaternion);
+      auto const scale = make_tracks<glm::vec3>(Animation::Interpolation::Type::LINEAR, random, make_vec3);
+
+      bones[i].trans = bake<glm::vec3>(trans);
+      bones[i].rot = bake<glm::quat>(rot);
+      bones[i].scale = bake<glm::vec3>(scale);
+
+      bones[i].reference_trans = std::make_unique<reference_value<glm::vec3, glm::vec3>>(trans);
+      bones[i].reference_rot = std::make_unique<reference_value<glm::quat, packed_quaternion>>(rot);
+      bones[i].reference_scale = std::make_unique<reference_value<glm::vec3, glm::vec3>>(scale);
+    }
+
+    // every bone of the scene evaluated each frame, what Bone::calcMatrix does,
+    // with the playing animation changing now and then like in the editor
+    auto const animation_of = [] (int frame) { return static_cast<std::uint32_t>(frame / 50) % animations_per_value; };
+
+    glm::vec3 flat_sum(0.f), reference_sum(0.f);
+    stopwatch const flat_time;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      for (int frame = 0; frame < frames_per_iteration; ++frame)
+      {
+        std::uint32_t const anim = animation_of(frame);
+        std::uint32_t const time = static_cast<std::uint32_t>(frame * frame_time);
+
+        for (bone_values& bone : bones)
+        {
+          glm::quat const rotation = bone.rot->getValue(anim, time, time);
+          flat_sum += bone.trans->getValue(anim, time, time) + bone.scale->getValue(anim, time, time) + glm::vec3(rotation.x, rotation.y, rotation.z);
+        }
+      }
+    }
+
+    double const flat_ms = flat_time.elapsed_ms();
+    stopwatch const reference_time;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      for (int frame = 0; frame < frames_per_iteration; ++frame)
+      {
+        std::uint32_t const anim = animation_of(frame);
+        std::uint32_t const time = static_cast<std::uint32_t>(frame * frame_time);
+
+        for (bone_values& bone : bones)
+        {
+          glm::quat const rotation = bone.reference_rot->getValue(anim, time);
+          reference_sum += bone.reference_trans->getValue(anim, time) + bone.reference_scale->getValue(anim, time) + glm::vec3(rotation.x, rotation.y, rotation.z);
+        }
+      }
+    }
+
+    double const reference_ms = reference_time.elapsed_ms();
+
+    // every value once more at random animations and times, compared bit for bit
+    std::uniform_int_distribution<std::uint32_t> any_animation(0, animations_per_value - 1);
+    std::uniform_int_distribution<std::uint32_t> any_time(0, 20000);
+    std::size_t mismatches = 0;
+
+    for (bone_values& bone : bones)
+    {
+      for (int lookup = 0; lookup < 16; ++lookup)
+      {
+        std::uint32_t const anim = any_animation(random);
+        std::uint32_t const time = any_time(random);
+
+        mismatches += !same_bits(bone.trans->getValue(anim, time, time), bone.reference_trans->getValue(anim, time))
+                    + !same_bits(bone.rot->getValue(anim, time, time), bone.reference_rot->getValue(anim, time))
+                    + !same_bits(bone.scale->getValue(anim, time, time), bone.reference_scale->getValue(anim, time));
+      }
+    }
+
+    double const lookups = 3. * count * frames_per_iteration * options.iterations;
+
+    std::cout << "animation-tracks: " << count << " bones of " << animations_per_value << " animations of "
+              << keyframes_per_track << " keyframes, " << frames_per_iteration * options.iterations << " frames" << std::endl;
+    std::cout << "  flat tracks " << flat_ms / (frames_per_iteration * options.iterations) << " ms per frame, "
+              << lookups / (flat_ms * 1000.) << " M lookups/s" << std::endl;
+    std::cout << "  map and scan " << reference_ms / (frames_per_iteration * options.iterations) << " ms per frame, "
+              << lookups / (reference_ms * 1000.) << " M lookups/s" << std::endl;
+
+    if (mismatches || !same_bits(flat_sum, reference_sum))
+    {
+      std::cout << "  " << mismatches << " values differ from the map and scan lookup" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,207 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/AsyncObject.h>
+#include <noggit/AsyncObjectMultimap.hpp>
+#include <noggit/ContextObject.hpp>
+#include <noggit/file_key_interner.hpp>
+
+#include <Listfile.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_instance_count = 10000;
+    //! distinct models used by the instances, about what a busy tile references
+    constexpr std::size_t model_count = 300;
+
+    //! stands for a model, loading it does nothing
+    class benchmark_asset : public AsyncObject
+    {
+    public:
+      benchmark_asset(std::string const& filename, NoggitRenderContext)
+        : AsyncObject(filename)
+      {}
+
+      void finishLoading() override { finished = true; }
+      void waitForChildrenLoaded() override {}
+    };
+
+    // the asset map as it was before the file keys were interned: the path is hashed
+    // on every reference and one mutex guards every model of every context
+    class string_keyed_assets
+    {
+    public:
+      using key_type = std::pair<int, BlizzardArchive::Listfile::FileKey>;
+
+      void emplace(key_type const& key)
+      {
+        std::scoped_lock const lock(_mutex);
+
+        if (!_counts[key]++)
+        {
+          _elements.emplace(key, key.second.filepath());
+        }
+      }
+
+      void erase(key_type const& key)
+      {
+        std::scoped_lock const lock(_mutex);
+
+        if (--_counts.at(key) == 0)
+        {
+          _elements.erase(key);
+          _counts.erase(key);
+        }
+      }
+
+      std::size_t size() const
+      {
+        std::scoped_lock const lock(_mutex);
+        return _elements.size();
+      }
+
+    private:
+      struct pair_hash
+      {
+        std::size_t operator() (key_type const& p) const noexcept
+        {
+          auto h1 = std::hash<int>{}(p.first);
+          auto h2 = std::hash<std::string>{}(p.second.hasFilepath() ? p.second.filepath() : "");
+          auto h3 = std::hash<int>{}(p.second.fileDataID());
+
+          return h1 ^ h2 ^ h3;
+        }
+      };
+
+      std::unordered_map<key_type, std::size_t, pair_hash> _counts;
+      std::unordered_map<key_type, std::string, pair_hash> _elements;
+      std::mutex mutable _mutex;
+    };
+
+    //! runs work(first, last) over [0, count) split between thread_count threads
+    template<typename Work>
+    double run_split(std::size_t count, unsigned thread_count, Work&& work)
+    {
+      std::vector<std::thread> threads;
+      stopwatch const time;
+
+      for (unsigned t = 0; t < thread_count; ++t)
+      {
+        threads.emplace_back([&, t]
+        {
+          work(count * t / thread_count, count * (t + 1) / thread_count);
+        });
+      }
+
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+
+      return time.elapsed_ms();
+    }
+  }
+
+  int assetReferenceBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::size_t const count = options.count ? options.count : default_instance_count;
+    NoggitRenderContext const context = NoggitRenderContext::MAP_VIEW;
+
+    std::vector<std::string> paths;
+
+    for (std::size_t i = 0; i < model_count; ++i)
+    {
+      paths.push_back("world/generic/benchmark/doodad_" + std::to_string(i) + ".m2");
+    }
+
+    std::vector<unsigned> thread_counts {1, 3, std::max(1u, std::thread::hardware_concurrency())};
+    std::sort(thread_counts.begin(), thread_counts.end());
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+    std::cout << "asset-refs: " << count << " instances of " << model_count << " models, each reference taken from"
+              << " the path, copied once like a placed instance, then both released" << std::endl;
+
+    bool leaked = false;
+
+    for (unsigned thread_count : thread_counts)
+    {
+      double interned_ms = 0., string_ms = 0.;
+
+      for (int iteration = 0; iteration < options.iterations; ++iteration)
+      {
+        AsyncObjectMultimap<benchmark_asset> interned;
+        string_keyed_assets string_keyed;
+
+        // a tile load: every instance takes its reference, then the tile unloads
+        std::vector<file_key_id> ids(count);
+
+        interned_ms += run_split(count, thread_count, [&] (std::size_t first, std::size_t last)
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            ids[i] = file_key_interner::instance().intern(BlizzardArchive::Listfile::FileKey(paths[i % model_count]));
+            interned.emplace(ids[i], context);
+            interned.emplace(ids[i], context);
+          }
+        });
+
+        interned_ms += run_split(count, thread_count, [&] (std::size_t first, std::size_t last)
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            interned.erase(ids[i], context);
+            interned.erase(ids[i], context);
+          }
+        });
+
+        std::vector<std::optional<string_keyed_assets::key_type>> keys(count);
+
+        string_ms += run_split(count, thread_count, [&] (std::size_t first, std::size_t last)
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            keys[i].emplace(static_cast<int>(context), BlizzardArchive::Listfile::FileKey(paths[i % model_count]));
+            string_keyed.emplace(*keys[i]);
+            string_keyed.emplace(*keys[i]);
+          }
+        });
+
+        string_ms += run_split(count, thread_count, [&] (std::size_t first, std::size_t last)
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            string_keyed.erase(*keys[i]);
+            string_keyed.erase(*keys[i]);
+          }
+        });
+
+        std::size_t remaining = 0;
+        interned.apply([&] (BlizzardArchive::Listfile::FileKey const&, benchmark_asset&) { remaining++; });
+        leaked |= remaining || string_keyed.size();
+      }
+
+      std::cout << "  " << thread_count << " thread(s): interned ids " << interned_ms / options.iterations
+                << " ms, string keys " << string_ms / options.iterations << " ms per tile" << std::endl;
+    }
+
+    if (leaked)
+    {
+      std::cout << "  some references weren't released" << std::endl;
+    }
+
+    return leaked ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,156 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/application/NoggitApplication.hpp>
+#include <noggit/DBC.h>
+#include <noggit/Log.h>
+#include <noggit/MapTile.h>
+#include <noggit/project/ApplicationProject.h>
+#include <noggit/project/CurrentProject.hpp>
+#include <noggit/World.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    struct benchmark_entry
+    {
+      char const* name;
+      char const* description;
+      int (*run)(Application::NoggitApplication*, BenchmarkOptions const&);
+    };
+
+    benchmark_entry const benchmarks[] =
+    {
+      {"save-compare", "serializes the tiles with the MCNKs written one after another and in parallel, compares the bytes (needs --project and --map)", &saveCompareBenchmark},
+      {"spatial-index", "range, ray, frustum queries and updates of the model instance index against a scan of every instance (--count, default 100000)", &spatialIndexBenchmark},
+      {"terrain-ray", "rays picking the terrain through the chunk height trees against testing every triangle (needs --project and --map, --count tiles, default 4)", &terrainRayBenchmark},
+      {"mesh-pick", "rays through the triangle bvh of synthetic meshes of 500, 5k and 50k triangles against testing every triangle (--count triangles)", &meshPickBenchmark},
+      {"texture-brush", "texels per second of the texture paint kernels against the per texel code they replace, checks the alphamaps are bit identical (--count brush radius)", &textureBrushBenchmark},
+      {"asset-refs", "a tile load taking and releasing the model references of its instances through the interned asset map against the string keyed map it replaced, on 1, 3 and every thread (--count instances, default 10000)", &assetReferenceBenchmark},
+      {"map-image-formats", "heightmaps written and read back as png, r16 and r32 in a temporary folder, time, size and round trip error (--count tiles, default 16)", &mapImageFormatBenchmark},
+      {"incremental-save", "serializes the tiles in full, then again reusing every chunk but 1, 4, 16, 64 or 256 edited ones, compares the bytes (needs --project and --map, --count tiles)", &incrementalSaveBenchmark},
+      {"save-queue", "random tiles written in place on the calling thread against handed to the save queue, time blocked, time until on disk, checks the files (--count files, default 64)", &saveQueueBenchmark},
+      {"animation-tracks", "bone values of synthetic tracks looked up through the flat tracks against the per animation maps and timestamp scan they replaced, checks the values are bit identical (--count bones, default 6000)", &animationTrackBenchmark},
+      {"particles", "emitters of the models of the tiles updated on the thread pool for a few hundred frames, time per frame, checks every particle is finite (needs --project and --map, --count tiles, default 4)", &particleBenchmark},
+      {"model-cull", "M2 instances of the loaded tiles culled from random cameras with the persistent list and by walking the tiles, list build and cull time, checks both draw the same instances (needs --project and --map, --count tiles, default the whole map)", &modelCullBenchmark},
+      {"terrain-memory", "terrain memory and texture size per tile against the float layout it replaced, time to pack the normals again, checks they unpack to unit vectors (needs --project and --map, --count tiles, default 16)", &terrainMemoryBenchmark},
+      {"flight", "camera flown along the row of the map with the most tiles with a 256 MiB terrain budget, time spent unloading per frame, checks the budget holds outside of the loading radius (needs --project and --map, --count tiles crossed, --iterations frames per tile, at least 300 ms)", &flightResidencyBenchmark},
+    };
+  }
+
+  int runBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    for (auto const& benchmark : benchmarks)
+    {
+      if (options.name != benchmark.name)
+      {
+        continue;
+      }
+
+      try
+      {
+        return benchmark.run(application, options);
+      }
+      catch (std::exception const& e)
+      {
+        LogError << "Benchmark " << benchmark.name << " failed: " << e.what() << std::endl;
+        std::cerr << "benchmark " << benchmark.name << " failed: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    std::cerr << "unknown benchmark \"" << options.name << "\", available:" << std::endl;
+
+    for (auto const& benchmark : benchmarks)
+    {
+      std::cerr << "  " << benchmark.name << ": " << benchmark.description << std::endl;
+    }
+
+    return EXIT_FAILURE;
+  }
+
+  headless_map::headless_map(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    auto project_service = Noggit::Project::ApplicationProject(application->getConfiguration());
+    _project = project_service.loadProject(options.project_path);
+
+    if (!_project)
+    {
+      throw std::runtime_error("couldn't load project " + options.project_path.string());
+    }
+
+    application->setClientData(_project->ClientData);
+    Noggit::Project::CurrentProject::initialize(_project.get());
+    OpenDBs(_project->ClientData);
+
+    std::string map_name;
+
+    try
+    {
+      map_name = gMapDB.getByID(options.map_id).getString(MapDB::InternalName);
+    }
+    catch (MapDB::NotFound)
+    {
+      throw std::runtime_error("couldn't find map " + std::to_string(options.map_id));
+    }
+
+    _surface.create();
+
+    if (!_context.create() || !_context.makeCurrent(&_surface))
+    {
+      throw std::runtime_error("failed to create an offscreen OpenGL 4.1 context");
+    }
+
+    _context_setter.emplace(::gl, &_context);
+
+    _world = std::make_unique<World>(map_name, options.map_id, Noggit::NoggitRenderContext::MAP_VIEW);
+    _world->renderer()->upload();
+  }
+
+  headless_map::~headless_map()
+  {
+    if (_world)
+    {
+      _world->wait_for_all_tile_updates();
+      _world->renderer()->unload();
+      _world.reset();
+    }
+  }
+
+  std::vector<TileIndex> headless_map::tiles(std::size_t limit) const
+  {
+    std::vector<TileIndex> tiles;
+
+    for (std::size_t i = 0; i < 4096 && (!limit || tiles.size() < limit); ++i)
+    {
+      TileIndex const tile (i / 64, i % 64);
+
+      if (_world->mapIndex.hasTile(tile))
+      {
+        tiles.push_back(tile);
+      }
+    }
+
+    return tiles;
+  }
+
+  MapTile* headless_map::load(TileIndex const& tile)
+  {
+    MapTile* map_tile = _world->mapIndex.loadTile(tile);
+
+    if (!map_tile)
+    {
+      throw std::runtime_error("couldn't load tile " + std::to_string(tile.x) + "_" + std::to_string(tile.z));
+    }
+
+    map_tile->wait_until_loaded();
+    map_tile->waitForChildrenLoaded();
+
+    return map_tile;
+  }
+}
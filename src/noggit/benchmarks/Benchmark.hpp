@@ -0,0 +1,109 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_BENCHMARK_HPP
+#define NOGGIT_BENCHMARK_HPP
+
+#include <noggit/TileIndex.hpp>
+#include <opengl/context.hpp>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class MapTile;
+class World;
+
+namespace Noggit::Project
+{
+  class NoggitProject;
+}
+
+namespace Noggit::Application
+{
+  class NoggitApplication;
+}
+
+namespace Noggit::Benchmarks
+{
+  struct BenchmarkOptions
+  {
+    std::string name;
+    //! only needed by the benchmarks working on a real map
+    std::filesystem::path project_path;
+    int map_id = -1;
+    int iterations = 10;
+    //! size of the synthetic data, 0 uses the default of the benchmark
+    std::size_t count = 0;
+  };
+
+  //! Runs the benchmark named in the options, or lists them when the name is unknown.
+  //! Results go to the standard output. \returns the exit code of the process.
+  int runBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+
+  class stopwatch
+  {
+  public:
+    stopwatch() : _start(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const
+    {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point _start;
+  };
+
+  //! Loads the project and the map of the options the way the headless minimap
+  //! renderer does, with an offscreen OpenGL context current for its lifetime.
+  //! Throws std::runtime_error when the project, the map or the context can't be created.
+  class headless_map
+  {
+  public:
+    headless_map(Application::NoggitApplication* application, BenchmarkOptions const& options);
+    ~headless_map();
+
+    headless_map(headless_map const&) = delete;
+    headless_map& operator=(headless_map const&) = delete;
+
+    World* world() const { return _world.get(); }
+
+    //! tiles existing in the wdt, at most \a limit of them when not 0
+    std::vector<TileIndex> tiles(std::size_t limit = 0) const;
+
+    //! Loads the tile and everything it references, blocking until done.
+    MapTile* load(TileIndex const& tile);
+
+  private:
+    std::shared_ptr<Project::NoggitProject> _project;
+    QOpenGLContext _context;
+    QOffscreenSurface _surface;
+    std::optional<OpenGL::context::scoped_setter> _context_setter;
+    std::unique_ptr<World> _world;
+  };
+
+  // one per file of this folder, listed in Benchmark.cpp
+  int saveCompareBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int spatialIndexBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int terrainRayBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int meshPickBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int textureBrushBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int assetReferenceBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int mapImageFormatBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int incrementalSaveBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int saveQueueBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int animationTrackBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int particleBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int modelCullBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int terrainMemoryBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+  int flightResidencyBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options);
+}
+
+#endif //NOGGIT_BENCHMARK_HPP
@@ -0,0 +1,179 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapChunk.h>
+#include <noggit/MapTile.h>
+#include <noggit/World.h>
+#include <noggit/rendering/TileRender.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr int loading_radius = 2;
+    constexpr int unload_distance = 5;
+    //! small enough for the budget to decide what is unloaded on a long flight
+    constexpr int memory_budget_mib = 256;
+    //! long enough for the unload interval to never expire during the flight
+    constexpr int unload_interval_seconds = 3600;
+    //! the frame rate of the editor while flying, the frames are paced on it
+    constexpr std::chrono::milliseconds frame_time {33};
+    //! MapIndex::unloadTiles looks at the tiles every 250 ms
+    constexpr std::chrono::milliseconds residency_window {300};
+    //! a frame of the residency work alone longer than this shows as a hitch
+    constexpr double hitch_ms = 16.;
+
+    std::size_t tile_memory(MapTile* tile)
+    {
+      terrain_memory_usage const usage = tile->memoryUsage();
+      return usage.cpu() + usage.gpu;
+    }
+
+    bool in_loading_radius(TileIndex const& tile, TileIndex const& center)
+    {
+      return std::max ( std::abs(static_cast<int>(tile.x) - static_cast<int>(center.x))
+                      , std::abs(static_cast<int>(tile.z) - static_cast<int>(center.z))
+                      ) <= loading_radius;
+    }
+  }
+
+  int flightResidencyBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+    MapIndex& index = map.world()->mapIndex;
+
+    // the row of the map with the most tiles, flown over from its first tile to its last
+    std::vector<TileIndex> const existing = map.tiles();
+    std::vector<int> tiles_per_row(64, 0);
+
+    for (TileIndex const& tile : existing)
+    {
+      tiles_per_row[tile.z]++;
+    }
+
+    std::size_t const row = std::max_element(tiles_per_row.begin(), tiles_per_row.end()) - tiles_per_row.begin();
+    std::size_t first = 64, last = 0;
+
+    for (TileIndex const& tile : existing)
+    {
+      if (tile.z == row)
+      {
+        first = std::min(first, tile.x);
+        last = std::max(last, tile.x);
+      }
+    }
+
+    if (first > last)
+    {
+      std::cout << "flight: the map has no tile" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // the gaps of the row are flown over too
+    std::vector<TileIndex> path;
+
+    for (std::size_t x = first; x <= last && (!options.count || path.size() < options.count); ++x)
+    {
+      path.emplace_back(x, row);
+    }
+
+    index.setUnloadDistance(unload_distance);
+    index.setLoadingRadius(loading_radius);
+    index.setUnloadInterval(unload_interval_seconds);
+    index.setTileMemoryBudget(memory_budget_mib);
+
+    std::size_t const budget = static_cast<std::size_t>(memory_budget_mib) * 1024 * 1024;
+    std::vector<double> frames;
+    std::size_t peak_memory = 0, peak_tiles = 0, over_budget = 0;
+
+    for (TileIndex const& current : path)
+    {
+      // the camera enters the tile, what it loads is drawn, so uploaded, right away
+      index.enterTile(current);
+
+      for (int z = static_cast<int>(current.z) - loading_radius; z <= static_cast<int>(current.z) + loading_radius; ++z)
+      {
+        for (int x = static_cast<int>(current.x) - loading_radius; x <= static_cast<int>(current.x) + loading_radius; ++x)
+        {
+          if (x >= 0 && z >= 0 && x < 64 && z < 64 && index.hasTile(TileIndex(x, z)))
+          {
+            map.load(TileIndex(x, z));
+          }
+        }
+      }
+
+      map.world()->wait_for_all_tile_updates();
+
+      for (MapTile* tile : index.loaded_tiles())
+      {
+        if (!tile->renderer()->isUploaded())
+        {
+          tile->renderer()->upload();
+        }
+      }
+
+      // frames spent over the tile, long enough for a residency update to run
+      auto const entered = std::chrono::steady_clock::now();
+
+      for (int frame = 0; frame < options.iterations || std::chrono::steady_clock::now() - entered < residency_window; ++frame)
+      {
+        auto const frame_start = std::chrono::steady_clock::now();
+        stopwatch const time;
+
+        index.unloadTiles(current);
+        index.releaseRetiredTiles();
+
+        frames.push_back(time.elapsed_ms());
+        std::this_thread::sleep_until(frame_start + frame_time);
+      }
+
+      std::size_t memory = 0, radius_memory = 0;
+      std::vector<MapTile*> const loaded = index.loaded_tiles();
+
+      for (MapTile* tile : loaded)
+      {
+        std::size_t const usage = tile_memory(tile);
+        memory += usage;
+        radius_memory += in_loading_radius(tile->index, current) ? usage : 0;
+      }
+
+      // only the tiles around the camera may keep the terrain over budget
+      over_budget += memory > std::max(budget, radius_memory);
+      peak_memory = std::max(peak_memory, memory);
+      peak_tiles = std::max(peak_tiles, loaded.size());
+    }
+
+    index.releaseAllRetiredTiles();
+
+    double total_ms = 0.;
+    std::size_t hitches = 0;
+
+    for (double ms : frames)
+    {
+      total_ms += ms;
+      hitches += ms > hitch_ms;
+    }
+
+    std::cout << "flight: " << path.size() << " tiles crossed along row " << row << ", loading radius " << loading_radius
+              << ", budget " << memory_budget_mib << " MiB, " << frames.size() / path.size() << " frames per tile" << std::endl;
+    std::cout << "  unloading per frame: average " << total_ms / frames.size() << " ms, slowest "
+              << *std::max_element(frames.begin(), frames.end()) << " ms, " << hitches << " frames over " << hitch_ms
+              << " ms" << std::endl;
+    std::cout << "  terrain memory peaked at " << peak_memory / (1024 * 1024) << " MiB, at most " << peak_tiles
+              << " tiles loaded" << std::endl;
+
+    if (over_budget)
+    {
+      std::cout << "  over budget after " << over_budget << " tiles with tiles outside of the loading radius left" << std::endl;
+    }
+
+    return over_budget ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
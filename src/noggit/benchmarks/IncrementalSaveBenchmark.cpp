@@ -0,0 +1,82 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapTile.h>
+#include <noggit/World.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    //! a brush stroke, the whole tile and everything in between
+    constexpr std::size_t edited_chunks[] = {1, 4, 16, 64, 256};
+  }
+
+  int incrementalSaveBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+
+    std::vector<TileIndex> const tiles = map.tiles(options.count);
+    double full_ms = 0.;
+    double incremental_ms[std::size(edited_chunks)] = {};
+    std::size_t mismatches = 0;
+
+    for (TileIndex const& index : tiles)
+    {
+      MapTile* tile = map.load(index);
+      map.world()->wait_for_all_tile_updates();
+
+      for (std::size_t e = 0; e < std::size(edited_chunks); ++e)
+      {
+        for (int i = 0; i < options.iterations; ++i)
+        {
+          MapTile::incremental_check const check = tile->checkIncrementalSerialization(map.world(), edited_chunks[e]);
+
+          full_ms += check.full_ms;
+          incremental_ms[e] += check.incremental_ms;
+
+          if (check.first_difference || check.reused_chunks != 256 - edited_chunks[e])
+          {
+            std::cout << "tile " << index.x << "_" << index.z << ", " << edited_chunks[e] << " edited chunks: "
+                      << check.reused_chunks << " reused, ";
+
+            if (check.first_difference)
+            {
+              std::cout << "first difference with the full save at " << *check.first_difference << std::endl;
+            }
+            else
+            {
+              std::cout << "identical to the full save" << std::endl;
+            }
+
+            ++mismatches;
+            break;
+          }
+        }
+      }
+
+      map.world()->mapIndex.unloadTile(index);
+      map.world()->mapIndex.releaseRetiredTiles();
+    }
+
+    std::size_t const runs = tiles.size() * options.iterations;
+
+    std::cout << "incremental-save: " << tiles.size() << " tiles, " << mismatches << " different" << std::endl;
+
+    if (runs)
+    {
+      std::cout << "  full " << full_ms / (runs * std::size(edited_chunks)) << " ms per tile" << std::endl;
+
+      for (std::size_t e = 0; e < std::size(edited_chunks); ++e)
+      {
+        std::cout << "  " << edited_chunks[e] << " edited chunk(s) " << incremental_ms[e] / runs << " ms per tile" << std::endl;
+      }
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
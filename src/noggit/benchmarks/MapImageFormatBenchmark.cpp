@@ -0,0 +1,197 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/map_image_pipeline.hpp>
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_tile_count = 16;
+    constexpr int heightmap_size = 257;
+    constexpr float min_height = -200.f;
+    constexpr float max_height = 600.f;
+
+    //! rolling hills with some noise, as getHeightmapSamples lays them out
+    std::vector<float> make_heights(std::mt19937& random)
+    {
+      std::uniform_real_distribution<float> phase(0.f, 6.28f);
+      std::uniform_real_distribution<float> noise(-1.f, 1.f);
+      float const phase_x = phase(random), phase_z = phase(random);
+
+      std::vector<float> heights(heightmap_size * heightmap_size);
+
+      for (int z = 0; z < heightmap_size; ++z)
+      {
+        for (int x = 0; x < heightmap_size; ++x)
+        {
+          heights[z * heightmap_size + x] = 200.f + 250.f * std::sin(x * 0.03f + phase_x) * std::cos(z * 0.02f + phase_z)
+                                          + 100.f * std::sin((x + z) * 0.11f) + noise(random);
+        }
+      }
+
+      return heights;
+    }
+
+    // what MapTile::getHeightmapImage and MapTile::setHeightmapImage do around the samples
+    QImage heights_to_png_image(std::vector<float> const& heights)
+    {
+      QImage image(heightmap_size, heightmap_size, QImage::Format_RGBA64);
+
+      for (int y = 0; y < heightmap_size; ++y)
+      {
+        for (int x = 0; x < heightmap_size; ++x)
+        {
+          float const value = std::clamp((heights[y * heightmap_size + x] - min_height) / (max_height - min_height), 0.f, 1.f);
+          image.setPixelColor(x, y, QColor::fromRgbF(value, value, value, 1.0));
+        }
+      }
+
+      return image;
+    }
+
+    std::vector<float> png_image_to_heights(QImage const& base_image)
+    {
+      QImage const image = base_image.convertToFormat(QImage::Format_RGBA64);
+      std::vector<float> heights(heightmap_size * heightmap_size, 0.f);
+
+      for (int y = 0; y < std::min(heightmap_size, image.height()); ++y)
+      {
+        for (int x = 0; x < std::min(heightmap_size, image.width()); ++x)
+        {
+          heights[y * heightmap_size + x] = (max_height - min_height) * image.pixelColor(x, y).redF() + min_height;
+        }
+      }
+
+      return heights;
+    }
+
+    struct format_result
+    {
+      double write_ms = 0.;
+      double read_ms = 0.;
+      qint64 bytes = 0;
+      float max_error = 0.f;
+      bool failed = false;
+    };
+  }
+
+  int mapImageFormatBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::size_t const tile_count = options.count ? options.count : default_tile_count;
+    QTemporaryDir const directory;
+
+    if (!directory.isValid())
+    {
+      std::cout << "map-image-formats: couldn't create a temporary directory" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::mt19937 random (42);
+    std::vector<std::vector<float>> tiles;
+
+    for (std::size_t i = 0; i < tile_count; ++i)
+    {
+      tiles.push_back(make_heights(random));
+    }
+
+    map_image_format const formats[] = {map_image_format::png, map_image_format::r16, map_image_format::r32};
+    bool failed = false;
+
+    std::cout << "map-image-formats: " << tile_count << " heightmaps of " << heightmap_size << "x" << heightmap_size
+              << " written and read back, heights between " << min_height << " and " << max_height << std::endl;
+
+    for (map_image_format format : formats)
+    {
+      format_result result;
+
+      for (int iteration = 0; iteration < options.iterations; ++iteration)
+      {
+        for (std::size_t i = 0; i < tiles.size(); ++i)
+        {
+          QString const path = directory.filePath(QString("tile_%1_height.%2").arg(i).arg(map_image_extension(format)));
+          std::vector<float> const& heights = tiles[i];
+
+          // r16 is scaled between min and max like the png, r32 keeps the heights
+          stopwatch const write_time;
+
+          if (format == map_image_format::png)
+          {
+            result.failed |= !heights_to_png_image(heights).save(path, "PNG");
+          }
+          else if (format == map_image_format::r16)
+          {
+            std::vector<float> scaled(heights.size());
+            std::transform(heights.begin(), heights.end(), scaled.begin(), [] (float height)
+            {
+              return (height - min_height) / (max_height - min_height);
+            });
+            result.failed |= !save_raw_image(path, scaled, format);
+          }
+          else
+          {
+            result.failed |= !save_raw_image(path, heights, format);
+          }
+
+          result.write_ms += write_time.elapsed_ms();
+          result.bytes = QFileInfo(path).size();
+
+          stopwatch const read_time;
+          std::optional<std::vector<float>> read;
+
+          if (format == map_image_format::png)
+          {
+            QImage const image(path);
+            read = image.isNull() ? std::nullopt : std::optional<std::vector<float>>(png_image_to_heights(image));
+          }
+          else if ((read = load_raw_image(path, heights.size(), format)) && format == map_image_format::r16)
+          {
+            for (float& sample : *read)
+            {
+              sample = sample * (max_height - min_height) + min_height;
+            }
+          }
+
+          result.read_ms += read_time.elapsed_ms();
+
+          if (!read)
+          {
+            result.failed = true;
+            continue;
+          }
+
+          for (std::size_t s = 0; s < heights.size(); ++s)
+          {
+            result.max_error = std::max(result.max_error, std::abs((*read)[s] - heights[s]));
+          }
+        }
+      }
+
+      double const files = static_cast<double>(tiles.size()) * options.iterations;
+
+      // a sixteen bit step of the range, float rounding of the scaling included
+      float const allowed_error = format == map_image_format::r32 ? 0.f : (max_height - min_height) / 65535.f;
+      result.failed |= result.max_error > allowed_error;
+      failed |= result.failed;
+
+      std::cout << "  " << map_image_extension(format).toStdString() << ": write " << result.write_ms / files
+                << " ms, read " << result.read_ms / files << " ms per tile, " << result.bytes / 1024 << " KiB, largest height error "
+                << result.max_error << (result.failed ? " (failed)" : "") << std::endl;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,130 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr int rays_per_iteration = 2000;
+
+    //! a closed bumpy sphere of about \a triangle_count triangles, as coherent as the surface of a model
+    std::vector<std::array<glm::vec3, 3>> make_mesh(std::size_t triangle_count)
+    {
+      int const rings = std::max(4, static_cast<int>(std::sqrt(triangle_count / 4.)));
+      int const segments = rings * 2;
+
+      auto const vertex = [&] (int ring, int segment)
+      {
+        float const theta = glm::pi<float>() * ring / rings;
+        float const phi = 2.f * glm::pi<float>() * segment / segments;
+        float const radius = 10.f + std::sin(theta * 7.f) * std::cos(phi * 5.f);
+        return glm::vec3(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi));
+      };
+
+      std::vector<std::array<glm::vec3, 3>> triangles;
+
+      for (int ring = 0; ring < rings; ++ring)
+      {
+        for (int segment = 0; segment < segments; ++segment)
+        {
+          glm::vec3 const a = vertex(ring, segment), b = vertex(ring + 1, segment);
+          glm::vec3 const c = vertex(ring + 1, segment + 1), d = vertex(ring, segment + 1);
+          triangles.push_back({a, b, c});
+          triangles.push_back({a, c, d});
+        }
+      }
+
+      return triangles;
+    }
+  }
+
+  int meshPickBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::vector<std::size_t> const sizes = options.count ? std::vector<std::size_t>{options.count}
+                                                         : std::vector<std::size_t>{500, 5000, 50000};
+    std::mt19937 random (42);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::size_t mismatches = 0;
+
+    std::cout << "mesh-pick: " << rays_per_iteration * options.iterations << " rays per mesh" << std::endl;
+
+    for (std::size_t size : sizes)
+    {
+      auto const mesh = make_mesh(size);
+
+      stopwatch const build_time;
+      math::triangle_bvh bvh;
+
+      for (std::size_t i = 0; i < mesh.size(); ++i)
+      {
+        bvh.add_triangle(mesh[i][0], mesh[i][1], mesh[i][2], static_cast<std::uint32_t>(i));
+      }
+
+      bvh.build();
+      double const build_ms = build_time.elapsed_ms();
+
+      // from around the mesh towards a point inside its bounds, like clicking on a doodad
+      std::vector<math::ray> rays;
+
+      for (int i = 0; i < rays_per_iteration * options.iterations; ++i)
+      {
+        glm::vec3 const origin = glm::normalize(glm::vec3(unit(random), unit(random), unit(random))) * 50.f;
+        glm::vec3 const target(unit(random) * 10.f, unit(random) * 10.f, unit(random) * 10.f);
+        rays.emplace_back(origin, glm::normalize(target - origin));
+      }
+
+      std::vector<std::size_t> bvh_hits(rays.size(), 0);
+      std::vector<std::size_t> scan_hits(rays.size(), 0);
+
+      stopwatch const bvh_time;
+
+      for (std::size_t i = 0; i < rays.size(); ++i)
+      {
+        bvh.intersect(rays[i], [&] (std::uint32_t, float) { bvh_hits[i]++; });
+      }
+
+      double const bvh_ms = bvh_time.elapsed_ms();
+      stopwatch const scan_time;
+
+      for (std::size_t i = 0; i < rays.size(); ++i)
+      {
+        for (auto const& triangle : mesh)
+        {
+          scan_hits[i] += !!rays[i].intersect_triangle(triangle[0], triangle[1], triangle[2]);
+        }
+      }
+
+      double const scan_ms = scan_time.elapsed_ms();
+
+      for (std::size_t i = 0; i < rays.size(); ++i)
+      {
+        mismatches += bvh_hits[i] != scan_hits[i];
+      }
+
+      std::cout << "  " << mesh.size() << " triangles: build " << build_ms << " ms (" << bvh.memory_usage() / 1024
+                << " KiB), bvh " << bvh_ms * 1000. / rays.size() << " us per ray, every triangle "
+                << scan_ms * 1000. / rays.size() << " us per ray" << std::endl;
+    }
+
+    if (mismatches)
+    {
+      std::cout << "  " << mismatches << " rays hit a different number of triangles" << std::endl;
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,292 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapHeaders.h>
+#include <noggit/MapTile.h>
+#include <noggit/Model.h>
+#include <noggit/ModelInstance.h>
+#include <noggit/World.h>
+#include <noggit/rendering/ModelCullList.hpp>
+#include <math/frustum.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <external/tsl/robin_map.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr int cameras_per_iteration = 50;
+    //! the default view distance of the editor, without fog
+    constexpr float cull_distance = 2000.f + static_cast<float>(TILE_RADIUS);
+
+    using draw_list = tsl::robin_map<Model*, std::vector<glm::mat4x4>>;
+    using visible_tile = Rendering::ModelCullList::visible_tile;
+
+    //! a camera above a loaded tile looking slightly down, in a random direction
+    struct camera
+    {
+      glm::vec3 position;
+      math::frustum frustum;
+    };
+
+    camera look_at(glm::vec3 const& position, glm::vec3 const& target)
+    {
+      glm::mat4x4 const projection = glm::perspective(glm::radians(45.f), 16.f / 9.f, 1.f, cull_distance);
+      return {position, math::frustum(projection * glm::lookAt(position, target, glm::vec3(0.f, 1.f, 0.f)))};
+    }
+
+    camera make_camera(std::vector<MapTile*> const& tiles, std::mt19937& random)
+    {
+      std::uniform_int_distribution<std::size_t> tile(0, tiles.size() - 1);
+      std::uniform_real_distribution<float> offset(0.f, TILESIZE);
+      std::uniform_real_distribution<float> yaw(0.f, glm::two_pi<float>());
+
+      auto const& extents = tiles[tile(random)]->getCombinedExtents();
+      glm::vec3 const position ( extents[0].x + offset(random)
+                               , (extents[0].y + extents[1].y) * 0.5f + 50.f
+                               , extents[0].z + offset(random)
+                               );
+      float const angle = yaw(random);
+
+      return look_at(position, position + glm::vec3(std::cos(angle), -0.25f, std::sin(angle)));
+    }
+
+    // what WorldRender::draw keeps of the loaded tiles, front to back
+    std::vector<visible_tile> visible_tiles(std::vector<MapTile*> const& tiles, camera const& view)
+    {
+      std::vector<visible_tile> visible;
+
+      for (MapTile* tile : tiles)
+      {
+        auto const& extents = tile->getCombinedExtents();
+        tile->calcCamDist(view.position);
+
+        if (view.frustum.intersects(extents[1], extents[0]) && tile->camDist() <= cull_distance)
+        {
+          visible.push_back({tile, view.frustum.contains(extents[0]) && view.frustum.contains(extents[1])});
+        }
+      }
+
+      std::sort(visible.begin(), visible.end(), [] (visible_tile const& a, visible_tile const& b)
+      {
+        return a.tile->camDist() < b.tile->camDist();
+      });
+
+      return visible;
+    }
+
+    //! the draw lists are emptied, not freed, between frames as WorldRender does
+    void reset(draw_list& models)
+    {
+      for (auto it = models.begin(); it != models.end(); ++it)
+      {
+        it.value().clear();
+      }
+    }
+
+    //! culling without the list: every instance of the visible tiles is walked every frame,
+    //! the ones referenced by several tiles are drawn for the first tile they are visible from
+    void walk_tiles(std::vector<visible_tile> const& tiles, camera const& view, draw_list& models)
+    {
+      std::unordered_set<ModelInstance*> drawn;
+
+      for (visible_tile const& tile : tiles)
+      {
+        for (auto const& pair : tile.tile->getObjectInstances())
+        {
+          if (pair.second.empty() || pair.second[0]->which() != eMODEL || !pair.first->finishedLoading())
+          {
+            continue;
+          }
+
+          auto model = reinterpret_cast<Model*>(pair.first);
+
+          if (model->is_hidden())
+          {
+            continue;
+          }
+
+          for (SceneObject* object : pair.second)
+          {
+            auto instance = static_cast<ModelInstance*>(object);
+            auto const& extents = instance->getExtents();
+            float const dist = ModelInstance::renderDistance(instance->pos, model->bounding_box_radius * instance->scale, view.position, display_mode::in_3D);
+
+            if ( ModelInstance::isInRenderDist(dist, instance->size_cat, cull_distance)
+              && (tile.in_frustum || view.frustum.intersects(extents[1], extents[0]))
+              && drawn.insert(instance).second
+               )
+            {
+              models[model].emplace_back(instance->transformMatrix());
+            }
+          }
+        }
+      }
+    }
+
+    std::size_t drawn_instances(draw_list const& models)
+    {
+      std::size_t count = 0;
+
+      for (auto const& pair : models)
+      {
+        count += pair.second.size();
+      }
+
+      return count;
+    }
+
+    bool same_draw_lists(draw_list const& a, draw_list const& b)
+    {
+      auto const contained = [] (draw_list const& first, draw_list const& second)
+      {
+        return std::all_of(first.begin(), first.end(), [&] (auto const& pair)
+        {
+          auto it = second.find(pair.first);
+          return pair.second.empty() || (it != second.end() && it->second == pair.second);
+        });
+      };
+
+      return contained(a, b) && contained(b, a);
+    }
+  }
+
+  int modelCullBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+    World* world = map.world();
+
+    // every tile of the map by default, a whole continent loaded at once
+    for (TileIndex const& index : map.tiles(options.count))
+    {
+      map.load(index);
+    }
+
+    world->wait_for_all_tile_updates();
+
+    std::vector<MapTile*> const tiles = world->mapIndex.loaded_tiles();
+
+    if (tiles.empty())
+    {
+      std::cout << "model-cull: the map has no tile" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    Rendering::ModelCullList list;
+    world->modelInstancesChanged();
+
+    double build_ms = 0., unchanged_ms = 0.;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      stopwatch const build_time;
+      list.update(tiles, true);
+      build_ms += build_time.elapsed_ms();
+
+      stopwatch const unchanged_time;
+      list.update(tiles, world->modelInstancesChanged());
+      unchanged_ms += unchanged_time.elapsed_ms();
+    }
+
+    std::mt19937 random (42);
+    draw_list listed, walked;
+    double list_ms = 0., walk_ms = 0., still_ms = 0.;
+    std::size_t drawn = 0, mismatches = 0;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      for (int c = 0; c < cameras_per_iteration; ++c)
+      {
+        camera const view = make_camera(tiles, random);
+        std::vector<visible_tile> const visible = visible_tiles(tiles, view);
+
+        reset(listed);
+        stopwatch const list_time;
+        list.cull(visible, view.frustum, view.position, cull_distance, display_mode::in_3D, true, false, listed);
+        list_ms += list_time.elapsed_ms();
+
+        reset(walked);
+        stopwatch const walk_time;
+        walk_tiles(visible, view, walked);
+        walk_ms += walk_time.elapsed_ms();
+
+        mismatches += !same_draw_lists(listed, walked);
+        drawn += drawn_instances(listed);
+
+        // the same frame again, neither the camera nor the instances moved
+        reset(listed);
+        stopwatch const still_time;
+        list.cull(visible, view.frustum, view.position, cull_distance, display_mode::in_3D, false, false, listed);
+        still_ms += still_time.elapsed_ms();
+
+        mismatches += !same_draw_lists(listed, walked);
+      }
+    }
+
+    // moving an instance has to mark the list dirty through the tile and storage hooks
+    ModelInstance* moved = nullptr;
+
+    world->getModelInstanceStorage().for_each_m2_instance([&] (ModelInstance& instance)
+    {
+      if (!moved && instance.finishedLoading())
+      {
+        moved = &instance;
+      }
+    });
+
+    bool hooked = true;
+
+    if (moved)
+    {
+      world->updateTilesModel(moved, model_update::remove);
+      moved->pos.x += 10.f;
+      moved->recalcExtents();
+      world->updateTilesModel(moved, model_update::add);
+      world->wait_for_all_tile_updates();
+
+      hooked = world->modelInstancesChanged();
+      list.update(tiles, hooked);
+
+      camera const view = look_at(moved->pos + glm::vec3(0.f, 20.f, -60.f), moved->pos);
+      std::vector<visible_tile> const visible = visible_tiles(tiles, view);
+
+      reset(listed);
+      reset(walked);
+      list.cull(visible, view.frustum, view.position, cull_distance, display_mode::in_3D, true, false, listed);
+      walk_tiles(visible, view, walked);
+      mismatches += !same_draw_lists(listed, walked);
+    }
+
+    double const frames = static_cast<double>(cameras_per_iteration) * options.iterations;
+
+    std::cout << "model-cull: " << tiles.size() << " tiles, " << list.size() << " instance entries" << std::endl;
+    std::cout << "  list build " << build_ms / options.iterations << " ms, update with nothing changed "
+              << unchanged_ms / options.iterations << " ms" << std::endl;
+    std::cout << "  cull, camera moving: list " << list_ms / frames << " ms, walking the tiles " << walk_ms / frames
+              << " ms per frame, " << drawn / static_cast<std::size_t>(frames) << " instances drawn" << std::endl;
+    std::cout << "  cull, camera still: list " << still_ms / frames << " ms per frame" << std::endl;
+
+    if (mismatches)
+    {
+      std::cout << "  " << mismatches << " frames where the list and the tile walk don't draw the same instances" << std::endl;
+    }
+
+    if (!hooked)
+    {
+      std::cout << "  moving an instance didn't mark the list dirty" << std::endl;
+    }
+
+    return mismatches || !hooked ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,102 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/Model.h>
+#include <noggit/ModelInstance.h>
+#include <noggit/ModelManager.h>
+#include <noggit/Particle.h>
+#include <noggit/World.h>
+
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <unordered_set>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_tile_count = 4;
+    constexpr int frames_per_iteration = 100;
+    //! seconds per frame, the editor runs at about 60 fps
+    constexpr float frame_time = 1.f / 60.f;
+    //! frames the emitters run before timing, so that the pools reach their working size
+    constexpr int warmup_frames = 300;
+  }
+
+  int particleBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+
+    for (TileIndex const& index : map.tiles(options.count ? options.count : default_tile_count))
+    {
+      map.load(index);
+    }
+
+    map.world()->wait_for_all_tile_updates();
+
+    // the models stay alive as long as their instances, the tiles aren't unloaded before the end
+    std::unordered_set<Model const*> models;
+
+    map.world()->getModelInstanceStorage().for_each_m2_instance([&] (ModelInstance& instance)
+    {
+      if (!instance.model->particle_systems().empty())
+      {
+        models.emplace(instance.model.get());
+      }
+    });
+
+    std::size_t systems = 0;
+
+    for (Model const* model : models)
+    {
+      systems += model->particle_systems().size();
+    }
+
+    // called directly, World::update_models_emitters skips them while particles aren't drawn
+    for (int frame = 0; frame < warmup_frames; ++frame)
+    {
+      ModelManager::updateEmitters(frame_time);
+    }
+
+    stopwatch const time;
+
+    for (int frame = 0; frame < frames_per_iteration * options.iterations; ++frame)
+    {
+      ModelManager::updateEmitters(frame_time);
+    }
+
+    double const ms = time.elapsed_ms();
+
+    // every live particle has to be somewhere, an attribute an emitter left unset shows up here
+    std::size_t live = 0, broken = 0;
+
+    for (Model const* model : models)
+    {
+      for (ParticleSystem const& system : model->particle_systems())
+      {
+        ParticlePool const& pool = system.live_particles();
+        live += pool.count();
+
+        for (std::size_t i = 0; i < pool.count(); ++i)
+        {
+          broken += glm::any(glm::isnan(pool.pos[i])) || glm::any(glm::isinf(pool.pos[i]))
+                 || glm::any(glm::isnan(pool.speed[i])) || glm::any(glm::isinf(pool.speed[i]));
+        }
+      }
+    }
+
+    std::cout << "particles: " << models.size() << " models with " << systems << " emitters, " << live
+              << " live particles" << std::endl;
+    std::cout << "  update " << ms / (frames_per_iteration * options.iterations) << " ms per frame" << std::endl;
+
+    if (broken)
+    {
+      std::cout << "  " << broken << " particles with a position or a speed which isn't finite" << std::endl;
+    }
+
+    return broken ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
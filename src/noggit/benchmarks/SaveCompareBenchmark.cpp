@@ -0,0 +1,59 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapTile.h>
+#include <noggit/World.h>
+
+#include <cstdlib>
+#include <iostream>
+
+namespace Noggit::Benchmarks
+{
+  int saveCompareBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+
+    std::size_t mismatches = 0;
+    double serial_ms = 0.;
+    double parallel_ms = 0.;
+    std::vector<TileIndex> const tiles = map.tiles(options.count);
+
+    for (TileIndex const& index : tiles)
+    {
+      MapTile* tile = map.load(index);
+      map.world()->wait_for_all_tile_updates();
+
+      for (int i = 0; i < options.iterations; ++i)
+      {
+        MapTile::serialization_check const check = tile->checkSerialization(map.world());
+
+        serial_ms += check.serial_ms;
+        parallel_ms += check.parallel_ms;
+
+        if (check.first_difference)
+        {
+          std::cout << "tile " << index.x << "_" << index.z << ": serial " << check.serial_size
+                    << " bytes, parallel " << check.parallel_size << " bytes, first difference at "
+                    << *check.first_difference << std::endl;
+          ++mismatches;
+          break;
+        }
+      }
+
+      map.world()->mapIndex.unloadTile(index);
+      map.world()->mapIndex.releaseRetiredTiles();
+    }
+
+    std::size_t const runs = tiles.size() * options.iterations;
+
+    std::cout << "save-compare: " << tiles.size() << " tiles, " << mismatches << " different" << std::endl;
+
+    if (runs)
+    {
+      std::cout << "  serial   " << serial_ms / runs << " ms per tile" << std::endl;
+      std::cout << "  parallel " << parallel_ms / runs << " ms per tile" << std::endl;
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
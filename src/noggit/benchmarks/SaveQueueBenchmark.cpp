@@ -0,0 +1,168 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/project/ApplicationProject.h>
+#include <noggit/project/CurrentProject.hpp>
+#include <noggit/save_queue.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_file_count = 64;
+    //! about what a detailed tile serializes to
+    constexpr std::size_t file_size = 2 * 1024 * 1024;
+
+    std::string tile_path(std::size_t i)
+    {
+      return "world/maps/benchmark/benchmark_" + std::to_string(i % 64) + "_" + std::to_string(i / 64) + ".adt";
+    }
+
+    std::vector<char> read_file(QString const& path)
+    {
+      QFile file(path);
+
+      if (!file.open(QIODevice::ReadOnly))
+      {
+        return {};
+      }
+
+      QByteArray const content = file.readAll();
+      return std::vector<char>(content.begin(), content.end());
+    }
+
+    //! sums the batches the queue reports, it may run empty more than once while the files are queued
+    struct batch_reports
+    {
+      std::mutex mutex;
+      std::condition_variable reported;
+      int files = 0;
+      int failed = 0;
+      qint64 latency_ms = 0;
+    };
+  }
+
+  int saveQueueBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::size_t const count = options.count ? options.count : default_file_count;
+    QTemporaryDir const directory;
+
+    if (!directory.isValid())
+    {
+      std::cout << "save-queue: couldn't create a temporary directory" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // the queue writes in the current project, which is the temporary directory here
+    Project::NoggitProject project;
+    project.ProjectPath = directory.path().toStdString();
+    Project::CurrentProject::initialize(&project);
+
+    std::mt19937 random (42);
+    std::uniform_int_distribution<int> byte(-128, 127);
+    std::vector<std::vector<char>> files(count, std::vector<char>(file_size));
+
+    for (auto& file : files)
+    {
+      std::generate(file.begin(), file.end(), [&] { return static_cast<char>(byte(random)); });
+    }
+
+    save_queue& queue = save_queue::instance();
+    batch_reports reports;
+
+    auto const connection = QObject::connect(&queue, &save_queue::finished, &queue, [&] (int batch_files, int batch_failed, qint64, qint64, qint64 latency_ms)
+    {
+      std::lock_guard<std::mutex> const lock (reports.mutex);
+      reports.files += batch_files;
+      reports.failed += batch_failed;
+      reports.latency_ms = std::max(reports.latency_ms, latency_ms);
+      reports.reported.notify_all();
+    }, Qt::DirectConnection);
+
+    double in_place_ms = 0., queued_ms = 0., on_disk_ms = 0.;
+    bool failed = false;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      // what the ui thread did before the queue: every file written in place, one after another
+      stopwatch const in_place_time;
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        QString const path = directory.filePath(QString::fromStdString("in_place/" + tile_path(i)));
+        QDir().mkpath(QFileInfo(path).path());
+        QFile file(path);
+        failed |= !file.open(QIODevice::WriteOnly) || file.write(files[i].data(), file_size) != static_cast<qint64>(file_size);
+      }
+
+      in_place_ms += in_place_time.elapsed_ms();
+
+      // the ui thread only hands the buffers over, the rest runs while editing goes on.
+      // they are copied as they are compared afterwards, MapTile::save moves them in
+      stopwatch const queue_time;
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        queue.write(tile_path(i), files[i]);
+      }
+
+      queued_ms += queue_time.elapsed_ms();
+      queue.flush();
+      on_disk_ms += queue_time.elapsed_ms();
+    }
+
+    {
+      std::unique_lock<std::mutex> lock (reports.mutex);
+      reports.reported.wait(lock, [&] { return reports.files == static_cast<int>(count) * options.iterations; });
+      failed |= reports.failed;
+    }
+
+    QObject::disconnect(connection);
+
+    // the files hold the last buffer queued for them, and no temporary file is left
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      failed |= read_file(directory.filePath(QString::fromStdString(tile_path(i)))) != files[i];
+    }
+
+    failed |= QDir(directory.filePath("world/maps/benchmark")).entryList(QDir::Files | QDir::Hidden).size() != static_cast<int>(count);
+
+    // writes of the same file land in the order they were queued
+    std::vector<char> const stale(file_size, 'a'), latest(file_size / 2, 'b');
+    queue.write(tile_path(0), stale);
+    queue.write(tile_path(0), latest);
+    queue.wait_for(tile_path(0));
+    failed |= read_file(directory.filePath(QString::fromStdString(tile_path(0)))) != latest;
+
+    queue.flush();
+    Project::CurrentProject::initialize(nullptr);
+
+    double const runs = options.iterations;
+
+    std::cout << "save-queue: " << count << " files of " << file_size / 1024 << " KiB" << std::endl;
+    std::cout << "  in place on the calling thread " << in_place_ms / runs << " ms" << std::endl;
+    std::cout << "  queued: calling thread blocked " << queued_ms / runs << " ms, all on disk after " << on_disk_ms / runs
+              << " ms, slowest file " << reports.latency_ms << " ms from queuing to disk" << std::endl;
+
+    if (failed)
+    {
+      std::cout << "  a file failed to be written or doesn't hold what was queued last" << std::endl;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,202 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/benchmarks/synthetic_instance.hpp>
+#include <noggit/world_model_instances_index.hpp>
+#include <math/frustum.hpp>
+#include <math/ray.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_instance_count = 100000;
+    constexpr int tiles_per_side = 16;
+    constexpr int queries_per_iteration = 200;
+
+    void report(char const* query, double index_ms, double scan_ms, std::size_t index_results, std::size_t scan_results, int queries)
+    {
+      std::cout << "  " << query << ": index " << index_ms / queries << " ms, scan " << scan_ms / queries
+                << " ms per query (" << index_results / queries << " candidates, " << scan_results / queries
+                << " hits)" << std::endl;
+    }
+  }
+
+  int spatialIndexBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    std::size_t const count = options.count ? options.count : default_instance_count;
+    std::mt19937 random (42);
+    synthetic_model model;
+    auto const instances = make_synthetic_instances(&model, count, tiles_per_side, random);
+
+    float const origin = (32 - tiles_per_side / 2) * TILESIZE;
+    std::uniform_real_distribution<float> horizontal(origin, origin + tiles_per_side * TILESIZE);
+    std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+    world_model_instances_index index;
+
+    stopwatch const insert_time;
+
+    for (auto const& instance : instances)
+    {
+      index.insert(instance.get());
+    }
+
+    double const insert_ms = insert_time.elapsed_ms();
+
+    std::cout << "spatial-index: " << count << " instances over " << tiles_per_side << "x" << tiles_per_side
+              << " adts, inserted in " << insert_ms << " ms" << std::endl;
+
+    std::vector<SceneObject*> result;
+    bool mismatch = false;
+    int const queries = queries_per_iteration * options.iterations;
+
+    // brush and range selection, exact on both sides so the counts must match
+    {
+      double index_ms = 0., scan_ms = 0.;
+      std::size_t index_results = 0, scan_results = 0;
+
+      for (int i = 0; i < queries; ++i)
+      {
+        glm::vec3 const center(horizontal(random), 100.f, horizontal(random));
+        float const radius = 50.f;
+
+        result.clear();
+        stopwatch const index_time;
+        index.query_range(center, radius, true, result);
+        index_ms += index_time.elapsed_ms();
+        index_results += result.size();
+
+        std::size_t hits = 0;
+        stopwatch const scan_time;
+
+        for (auto const& instance : instances)
+        {
+          hits += glm::distance(glm::vec3(instance->pos.x, center.y, instance->pos.z), center) <= radius;
+        }
+
+        scan_ms += scan_time.elapsed_ms();
+        scan_results += hits;
+        mismatch |= hits != result.size();
+      }
+
+      report("range", index_ms, scan_ms, index_results, scan_results, queries);
+    }
+
+    // picking: the index only returns candidates, the caller still tests their extents
+    {
+      double index_ms = 0., scan_ms = 0.;
+      std::size_t index_results = 0, scan_results = 0;
+
+      for (int i = 0; i < queries; ++i)
+      {
+        glm::vec3 const origin_pos(horizontal(random), 500.f, horizontal(random));
+        math::ray const ray(origin_pos, glm::normalize(glm::vec3(direction(random), -0.5f, direction(random))));
+
+        result.clear();
+        stopwatch const index_time;
+        index.query_ray(ray, result);
+        std::size_t index_hits = 0;
+
+        for (SceneObject* instance : result)
+        {
+          index_hits += !!ray.intersect_bounds(instance->getExtents()[0], instance->getExtents()[1]);
+        }
+
+        index_ms += index_time.elapsed_ms();
+        index_results += result.size();
+
+        std::size_t hits = 0;
+        stopwatch const scan_time;
+
+        for (auto const& instance : instances)
+        {
+          hits += !!ray.intersect_bounds(instance->getExtents()[0], instance->getExtents()[1]);
+        }
+
+        scan_ms += scan_time.elapsed_ms();
+        scan_results += hits;
+        mismatch |= hits != index_hits;
+      }
+
+      report("ray", index_ms, scan_ms, index_results, scan_results, queries);
+    }
+
+    // rectangle selection and culling, a camera above the map looking ahead
+    {
+      double index_ms = 0., scan_ms = 0.;
+      std::size_t index_results = 0, scan_results = 0;
+      glm::mat4x4 const projection = glm::perspective(glm::radians(45.f), 16.f / 9.f, 1.f, 1000.f);
+
+      for (int i = 0; i < queries; ++i)
+      {
+        glm::vec3 const eye(horizontal(random), 150.f, horizontal(random));
+        glm::vec3 const target = eye + glm::vec3(direction(random), -0.3f, direction(random));
+        math::frustum const frustum(projection * glm::lookAt(eye, target, glm::vec3(0.f, 1.f, 0.f)));
+
+        result.clear();
+        stopwatch const index_time;
+        index.query_frustum(frustum, result);
+        std::size_t index_hits = 0;
+
+        for (SceneObject* instance : result)
+        {
+          index_hits += frustum.intersects(instance->getExtents()[1], instance->getExtents()[0]);
+        }
+
+        index_ms += index_time.elapsed_ms();
+        index_results += result.size();
+
+        std::size_t hits = 0;
+        stopwatch const scan_time;
+
+        for (auto const& instance : instances)
+        {
+          hits += frustum.intersects(instance->getExtents()[1], instance->getExtents()[0]);
+        }
+
+        scan_ms += scan_time.elapsed_ms();
+        scan_results += hits;
+        mismatch |= hits != index_hits;
+      }
+
+      report("frustum", index_ms, scan_ms, index_results, scan_results, queries);
+    }
+
+    // moving objects around, one percent of them per iteration
+    {
+      std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+      std::size_t const moves = std::max<std::size_t>(1, count / 100) * options.iterations;
+
+      stopwatch const update_time;
+
+      for (std::size_t i = 0; i < moves; ++i)
+      {
+        auto& instance = *instances[pick(random)];
+        instance.pos += glm::vec3(direction(random) * 100.f, 0.f, direction(random) * 100.f);
+        instance.recalcExtents();
+        index.update(&instance);
+      }
+
+      std::cout << "  update: " << update_time.elapsed_ms() * 1000. / moves << " us per moved instance" << std::endl;
+    }
+
+    if (mismatch)
+    {
+      std::cout << "  the index and the scan found different instances" << std::endl;
+    }
+
+    index.clear();
+
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
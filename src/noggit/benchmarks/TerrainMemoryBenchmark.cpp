@@ -0,0 +1,145 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapChunk.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/MapTile.h>
+#include <noggit/World.h>
+#include <noggit/rendering/TileRender.hpp>
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_tile_count = 16;
+
+    // what the terrain took before normals, colors and alphamaps were stored compactly
+    //! the RGBA float heightmap staging buffer every tile kept
+    constexpr std::size_t float_heightmap_buffer = mapbufsize * 256 * 4 * sizeof(float);
+    //! the unused float normals of every chunk, next to the packed ones now
+    constexpr std::size_t float_chunk_normals = mapbufsize * 3 * sizeof(float);
+    constexpr std::size_t packed_chunk_normals = mapbufsize * sizeof(std::uint32_t);
+    //! RGBA32F heightmap and RGB32F vertex colors, rgb padded to 4 components as TileRender::memoryUsage assumes
+    constexpr std::size_t float_textures = 2 * mapbufsize * 256 * 4 * sizeof(float);
+    //! RG32UI heightmap and RGBA8 vertex colors
+    constexpr std::size_t packed_textures = mapbufsize * 256 * (2 * sizeof(std::uint32_t) + 4);
+
+    //! signed bytes scaled by 127 keep each component within 1/127 once rounded down
+    float const allowed_length_error = std::sqrt(3.f) / 127.f;
+
+    std::size_t kib(std::size_t bytes)
+    {
+      return bytes / 1024;
+    }
+
+    //! how far from unit length the unpacked normals of the tile are
+    float normal_length_error(MapTile* tile)
+    {
+      float error = 0.f;
+
+      for (unsigned z = 0; z < 16; ++z)
+      {
+        for (unsigned x = 0; x < 16; ++x)
+        {
+          MapChunk* chunk = tile->getChunk(x, z);
+
+          for (int i = 0; i < mapbufsize; ++i)
+          {
+            error = std::max(error, std::abs(glm::length(chunk->getNormal(i)) - 1.f));
+          }
+        }
+      }
+
+      return error;
+    }
+  }
+
+  int terrainMemoryBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+    std::vector<MapTile*> tiles;
+
+    for (TileIndex const& index : map.tiles(options.count ? options.count : default_tile_count))
+    {
+      tiles.push_back(map.load(index));
+    }
+
+    map.world()->wait_for_all_tile_updates();
+
+    if (tiles.empty())
+    {
+      std::cout << "terrain-memory: the map has no tile" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    terrain_memory_usage total;
+    float loaded_error = 0.f;
+
+    for (MapTile* tile : tiles)
+    {
+      // the textures are only counted once uploaded, which drawing the tile does
+      tile->renderer()->upload();
+      total += tile->memoryUsage();
+      loaded_error = std::max(loaded_error, normal_length_error(tile));
+    }
+
+    // normals packed again from the heights, as every terrain edit does
+    double pack_ms = 0.;
+    float recalculated_error = 0.f;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      for (MapTile* tile : tiles)
+      {
+        stopwatch const time;
+
+        for (unsigned z = 0; z < 16; ++z)
+        {
+          for (unsigned x = 0; x < 16; ++x)
+          {
+            tile->getChunk(x, z)->recalcNorms();
+          }
+        }
+
+        pack_ms += time.elapsed_ms();
+      }
+    }
+
+    for (MapTile* tile : tiles)
+    {
+      recalculated_error = std::max(recalculated_error, normal_length_error(tile));
+      tile->renderer()->unload();
+    }
+
+    std::size_t const count = tiles.size();
+    std::size_t const float_cpu = total.cpu() + count * (float_heightmap_buffer + 256 * (float_chunk_normals - packed_chunk_normals));
+    std::size_t const float_gpu = total.gpu + count * (float_textures - packed_textures);
+    bool const failed = recalculated_error > allowed_length_error;
+
+    std::cout << "terrain-memory: " << count << " tiles" << std::endl;
+    std::cout << "  in memory " << kib(total.cpu() / count) << " KiB per tile (vertices " << kib(total.vertices / count)
+              << ", colors " << kib(total.vertex_colors / count) << ", shadows " << kib(total.shadows / count)
+              << ", alphamaps " << kib(total.alphamaps / count) << "), " << kib(float_cpu / count) << " KiB with float normals"
+              << " and the heightmap staging buffer" << std::endl;
+    std::cout << "  textures " << kib(total.gpu / count) << " KiB per tile, " << kib(float_gpu / count)
+              << " KiB with float heightmap and vertex colors" << std::endl;
+    std::cout << "  normals packed again in " << pack_ms / (count * options.iterations) << " ms per tile, largest length error "
+              << recalculated_error << " (allowed " << allowed_length_error << "), " << loaded_error << " as loaded from MCNR" << std::endl;
+
+    if (failed)
+    {
+      std::cout << "  a packed normal doesn't unpack to a unit vector" << std::endl;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
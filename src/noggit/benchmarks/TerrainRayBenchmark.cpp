@@ -0,0 +1,185 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/MapChunk.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/MapTile.h>
+#include <noggit/World.h>
+#include <math/ray.hpp>
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr std::size_t default_tile_count = 4;
+    constexpr int rays_per_iteration = 20000;
+
+    // what MapChunk::intersect did before the height tree: the bounds of the chunk, then all 256 triangles
+    std::optional<float> intersect_every_triangle(MapChunk* chunk, math::ray const& ray)
+    {
+      if (!ray.intersect_bounds(chunk->vmin, chunk->vmax))
+      {
+        return std::nullopt;
+      }
+
+      std::optional<float> nearest;
+
+      for (int row = 0; row < 8; ++row)
+      {
+        for (int col = 0; col < 8; ++col)
+        {
+          int const center = row * 17 + 9 + col;
+          int const corners[5] = {row * 17 + col, (row + 1) * 17 + col, (row + 1) * 17 + col + 1, row * 17 + col + 1, row * 17 + col};
+
+          for (int i = 0; i < 4; ++i)
+          {
+            auto const distance = ray.intersect_triangle(chunk->mVertices[center], chunk->mVertices[corners[i]], chunk->mVertices[corners[i + 1]]);
+
+            if (distance && (!nearest || *distance < *nearest))
+            {
+              nearest = distance;
+            }
+          }
+        }
+      }
+
+      return nearest;
+    }
+  }
+
+  int terrainRayBenchmark(Application::NoggitApplication* application, BenchmarkOptions const& options)
+  {
+    headless_map map (application, options);
+
+    std::vector<MapTile*> tiles;
+
+    for (TileIndex const& index : map.tiles(options.count ? options.count : default_tile_count))
+    {
+      tiles.push_back(map.load(index));
+    }
+
+    if (tiles.empty())
+    {
+      std::cout << "terrain-ray: the map has no tile" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::mt19937 random (42);
+    std::uniform_int_distribution<std::size_t> pick_tile(0, tiles.size() - 1);
+    std::uniform_real_distribution<float> in_tile(0.f, TILESIZE);
+    std::uniform_real_distribution<float> slope(-0.5f, 0.5f);
+
+    // rays from above, like picking with the camera looking down at the terrain
+    std::vector<std::pair<MapTile*, math::ray>> rays;
+    int const ray_count = rays_per_iteration * options.iterations;
+    rays.reserve(ray_count);
+
+    for (int i = 0; i < ray_count; ++i)
+    {
+      MapTile* tile = tiles[pick_tile(random)];
+      glm::vec3 const origin(tile->index.x * TILESIZE + in_tile(random), 2000.f, tile->index.z * TILESIZE + in_tile(random));
+      rays.emplace_back(tile, math::ray(origin, glm::normalize(glm::vec3(slope(random), -1.f, slope(random)))));
+    }
+
+    // the first ray hitting a chunk builds its tree, that's not timed
+    for (MapTile* tile : tiles)
+    {
+      for (unsigned z = 0; z < 16; ++z)
+      {
+        for (unsigned x = 0; x < 16; ++x)
+        {
+          MapChunk* chunk = tile->getChunk(x, z);
+          glm::vec3 const center = (chunk->vmin + chunk->vmax) * 0.5f;
+          selection_result results;
+          chunk->intersect(math::ray(center + glm::vec3(0.f, 2000.f, 0.f), glm::vec3(0.f, -1.f, 0.f)), &results);
+        }
+      }
+    }
+
+    // nearest hit of each ray on the chunks of its tile, -1 when it misses
+    std::vector<float> tree_nearest(rays.size(), -1.f);
+    std::vector<float> scan_nearest(rays.size(), -1.f);
+    selection_result results;
+
+    stopwatch const tree_time;
+
+    for (std::size_t i = 0; i < rays.size(); ++i)
+    {
+      auto const& [tile, ray] = rays[i];
+      results.clear();
+
+      for (unsigned z = 0; z < 16; ++z)
+      {
+        for (unsigned x = 0; x < 16; ++x)
+        {
+          tile->getChunk(x, z)->intersect(ray, &results);
+        }
+      }
+
+      for (auto const& result : results)
+      {
+        if (tree_nearest[i] < 0.f || result.first < tree_nearest[i])
+        {
+          tree_nearest[i] = result.first;
+        }
+      }
+    }
+
+    double const tree_ms = tree_time.elapsed_ms();
+    stopwatch const scan_time;
+
+    for (std::size_t i = 0; i < rays.size(); ++i)
+    {
+      auto const& [tile, ray] = rays[i];
+
+      for (unsigned z = 0; z < 16; ++z)
+      {
+        for (unsigned x = 0; x < 16; ++x)
+        {
+          if (auto const distance = intersect_every_triangle(tile->getChunk(x, z), ray))
+          {
+            if (scan_nearest[i] < 0.f || *distance < scan_nearest[i])
+            {
+              scan_nearest[i] = *distance;
+            }
+          }
+        }
+      }
+    }
+
+    double const scan_ms = scan_time.elapsed_ms();
+
+    std::size_t hits = 0;
+    std::size_t mismatches = 0;
+
+    for (std::size_t i = 0; i < rays.size(); ++i)
+    {
+      hits += scan_nearest[i] >= 0.f;
+      mismatches += (tree_nearest[i] >= 0.f) != (scan_nearest[i] >= 0.f)
+                 || std::abs(tree_nearest[i] - scan_nearest[i]) > 0.001f;
+    }
+
+    std::cout << "terrain-ray: " << rays.size() << " rays against the 256 chunks of their tile, "
+              << tiles.size() << " tiles loaded, " << hits << " rays hit the terrain" << std::endl;
+    std::cout << "  height tree    " << tree_ms * 1000. / rays.size() << " us per ray, "
+              << rays.size() / (tree_ms / 1000.) << " rays/s" << std::endl;
+    std::cout << "  every triangle " << scan_ms * 1000. / rays.size() << " us per ray, "
+              << rays.size() / (scan_ms / 1000.) << " rays/s" << std::endl;
+
+    if (mismatches)
+    {
+      std::cout << "  " << mismatches << " rays got a different nearest hit" << std::endl;
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+}
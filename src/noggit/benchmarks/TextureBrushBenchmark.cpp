@@ -0,0 +1,330 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/benchmarks/Benchmark.hpp>
+#include <noggit/Brush.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/Misc.h>
+#include <noggit/texture_brush_kernels.hpp>
+#include <noggit/texture_set.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  namespace
+  {
+    constexpr int strokes_per_iteration = 2000;
+
+    struct stroke
+    {
+      float x, z;
+      float strength, pressure;
+      int tex_layer;
+    };
+
+    // what TextureSet::paintTexture did per texel before the row kernels
+    void reference_apply_alpha_change( tmp_edit_alpha_values& amaps
+                                     , std::size_t offset
+                                     , std::array<double, 4>& alpha_values
+                                     , double sum_other_alphas
+                                     , double alpha_change
+                                     , int tex_layer
+                                     , std::size_t n_textures
+                                     )
+    {
+      if (sum_other_alphas < 1.)
+      {
+        if (alpha_change > 0.f)
+        {
+          for (int layer = 0; layer < n_textures; ++layer)
+          {
+            alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
+          }
+        }
+        else
+        {
+          bool change_applied = false;
+
+          for (int layer = 0; layer < n_textures; ++layer)
+          {
+            if (layer == tex_layer)
+            {
+              alpha_values[layer] += alpha_change;
+            }
+            else
+            {
+              if (!change_applied)
+              {
+                alpha_values[layer] -= alpha_change;
+              }
+              else
+              {
+                alpha_values[tex_layer] += alpha_values[layer];
+                alpha_values[layer] = 0.;
+              }
+
+              change_applied = true;
+            }
+          }
+        }
+      }
+      else
+      {
+        for (int layer = 0; layer < n_textures; ++layer)
+        {
+          if (layer == tex_layer)
+          {
+            alpha_values[layer] += alpha_change;
+          }
+          else
+          {
+            alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
+
+            if (alpha_values[layer] < 1.)
+            {
+              alpha_values[tex_layer] += alpha_values[layer];
+              alpha_values[layer] = 0.f;
+            }
+          }
+        }
+      }
+
+      double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
+
+      if (std::abs(total_final - 255.) > 0.001)
+      {
+        for (double& d : alpha_values)
+        {
+          d = d * 255. / total_final;
+        }
+      }
+
+      for (int n = 0; n < 4; ++n)
+      {
+        amaps[n][offset] = static_cast<float>(alpha_values[n]);
+      }
+    }
+
+    // the body of the texel loop of TextureSet::paintTexture
+    template<typename ApplyChange>
+    void paint_texel(tmp_edit_alpha_values& amaps, std::size_t offset, float brush_value, stroke const& s, ApplyChange&& apply)
+    {
+      std::array<double, 4> alpha_values;
+      double total = 0.;
+
+      for (int n = 0; n < 4; ++n)
+      {
+        total += alpha_values[n] = amaps[n][offset];
+      }
+
+      double current_alpha = alpha_values[s.tex_layer];
+      double sum_other_alphas = (total - current_alpha);
+      double alpha_change = (s.strength - current_alpha) * s.pressure * brush_value;
+
+      if (alpha_change < 0. && current_alpha + alpha_change < 1.)
+      {
+        alpha_change = -current_alpha;
+      }
+
+      if (!misc::float_equals(current_alpha, s.strength))
+      {
+        apply(amaps, offset, alpha_values, sum_other_alphas, alpha_change, s.tex_layer, 4);
+      }
+    }
+  }
+
+  int textureBrushBenchmark(Application::NoggitApplication*, BenchmarkOptions const& options)
+  {
+    float const radius = options.count ? static_cast<float>(options.count) : CHUNKSIZE * 0.75f;
+    std::mt19937 random (42);
+    std::uniform_real_distribution<float> position(-radius, CHUNKSIZE + radius);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::uniform_int_distribution<int> layer(0, 3);
+
+    Brush brush;
+    brush.init();
+    brush.setRadius(radius);
+    brush.setHardness(0.5f);
+
+    // 4 layers of random alpha summing to 255, the way the temporary alphamaps hold them
+    tmp_edit_alpha_values initial;
+
+    for (std::size_t offset = 0; offset < 64 * 64; ++offset)
+    {
+      std::array<float, 4> weights {unit(random), unit(random), unit(random), unit(random)};
+      float const sum = weights[0] + weights[1] + weights[2] + weights[3];
+
+      for (int n = 0; n < 4; ++n)
+      {
+        initial[n][offset] = weights[n] * 255.f / sum;
+      }
+    }
+
+    std::vector<stroke> strokes;
+
+    for (int i = 0; i < strokes_per_iteration * options.iterations; ++i)
+    {
+      strokes.push_back({position(random), position(random), unit(random) < 0.8f ? 255.f : 0.f, unit(random), layer(random)});
+    }
+
+    auto const x_positions = texture_brush::texel_positions(0.f);
+
+    // distances and brush values alone, a row at a time against one call per texel
+    {
+      texture_brush::texel_row distances, values;
+      float kernel_sum = 0.f, scalar_sum = 0.f;
+      bool identical = true;
+
+      stopwatch const kernel_time;
+
+      for (stroke const& s : strokes)
+      {
+        float z_pos = 0.f;
+
+        for (int j = 0; j < 64; ++j)
+        {
+          texture_brush::row_shortest_distances(s.x, s.z, x_positions, z_pos, distances);
+          texture_brush::row_brush_values(brush, distances, values);
+          kernel_sum += values[j];
+          z_pos += TEXDETAILSIZE;
+        }
+      }
+
+      double const kernel_ms = kernel_time.elapsed_ms();
+      stopwatch const scalar_time;
+
+      for (stroke const& s : strokes)
+      {
+        float z_pos = 0.f;
+
+        for (int j = 0; j < 64; ++j)
+        {
+          float x_pos = 0.f;
+
+          for (int i = 0; i < 64; ++i)
+          {
+            float const value = brush.getValue(misc::getShortestDist(s.x, s.z, x_pos, z_pos, TEXDETAILSIZE));
+            scalar_sum += i == j ? value : 0.f;
+            x_pos += TEXDETAILSIZE;
+          }
+
+          z_pos += TEXDETAILSIZE;
+        }
+      }
+
+      double const scalar_ms = scalar_time.elapsed_ms();
+
+      // every texel once more, compared bit for bit
+      for (stroke const& s : strokes)
+      {
+        float z_pos = 0.f;
+
+        for (int j = 0; j < 64; ++j)
+        {
+          texture_brush::row_shortest_distances(s.x, s.z, x_positions, z_pos, distances);
+          texture_brush::row_brush_values(brush, distances, values);
+          float x_pos = 0.f;
+
+          for (int i = 0; i < 64; ++i)
+          {
+            float const dist = misc::getShortestDist(s.x, s.z, x_pos, z_pos, TEXDETAILSIZE);
+            float const value = brush.getValue(dist);
+            identical &= std::memcmp(&dist, &distances[i], sizeof(float)) == 0
+                      && std::memcmp(&value, &values[i], sizeof(float)) == 0;
+            x_pos += TEXDETAILSIZE;
+          }
+
+          z_pos += TEXDETAILSIZE;
+        }
+      }
+
+      double const texels = strokes.size() * 64. * 64.;
+
+      std::cout << "texture-brush: " << strokes.size() << " strokes of radius " << radius << " over a 4 layer chunk" << std::endl;
+      std::cout << "  distances and brush values: kernels " << texels / (kernel_ms * 1000.) << " Mtexel/s, per texel calls "
+                << texels / (scalar_ms * 1000.) << " Mtexel/s" << std::endl;
+
+      if (!identical || kernel_sum != scalar_sum)
+      {
+        std::cout << "  the kernels and misc::getShortestDist or Brush::getValue disagree" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    // the whole paint loop, the alphamaps have to end up bit identical
+    tmp_edit_alpha_values kernel_maps = initial;
+    tmp_edit_alpha_values scalar_maps = initial;
+    std::size_t painted = 0;
+
+    stopwatch const kernel_time;
+
+    for (stroke const& s : strokes)
+    {
+      texture_brush::texel_row distances, values;
+      float z_pos = 0.f;
+
+      for (int j = 0; j < 64; ++j)
+      {
+        texture_brush::row_shortest_distances(s.x, s.z, x_positions, z_pos, distances);
+        texture_brush::row_brush_values(brush, distances, values);
+
+        for (int i = 0; i < 64; ++i)
+        {
+          if (distances[i] <= radius)
+          {
+            paint_texel(kernel_maps, i + 64 * j, values[i], s, &texture_brush::apply_alpha_change);
+            painted++;
+          }
+        }
+
+        z_pos += TEXDETAILSIZE;
+      }
+    }
+
+    double const kernel_ms = kernel_time.elapsed_ms();
+    stopwatch const scalar_time;
+
+    for (stroke const& s : strokes)
+    {
+      float z_pos = 0.f;
+
+      for (int j = 0; j < 64; ++j)
+      {
+        float x_pos = 0.f;
+
+        for (int i = 0; i < 64; ++i)
+        {
+          float const dist = misc::getShortestDist(s.x, s.z, x_pos, z_pos, TEXDETAILSIZE);
+
+          if (dist <= radius)
+          {
+            paint_texel(scalar_maps, i + 64 * j, brush.getValue(dist), s, &reference_apply_alpha_change);
+          }
+
+          x_pos += TEXDETAILSIZE;
+        }
+
+        z_pos += TEXDETAILSIZE;
+      }
+    }
+
+    double const scalar_ms = scalar_time.elapsed_ms();
+    bool const identical = std::memcmp(kernel_maps.map.data(), scalar_maps.map.data(), sizeof(kernel_maps.map)) == 0;
+
+    std::cout << "  paint: " << painted << " texels in the brush, kernels " << painted / (kernel_ms * 1000.)
+              << " Mtexel/s, per texel calls " << painted / (scalar_ms * 1000.) << " Mtexel/s" << std::endl;
+
+    if (!identical)
+    {
+      std::cout << "  the alphamaps painted with the kernels differ from the per texel code" << std::endl;
+    }
+
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,100 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_SYNTHETIC_INSTANCE_HPP
+#define NOGGIT_SYNTHETIC_INSTANCE_HPP
+
+#include <noggit/AsyncObject.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/SceneObject.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Noggit::Benchmarks
+{
+  //! stands for the model of the synthetic instances, never loaded from the client data
+  class synthetic_model : public AsyncObject
+  {
+  public:
+    synthetic_model() : AsyncObject(std::string("world/benchmark/synthetic.m2")) {}
+
+    void finishLoading() override {}
+    void waitForChildrenLoaded() override {}
+  };
+
+  //! an axis aligned box standing for a model instance in the benchmarks of the
+  //! world structures, its extents are known as soon as it is created
+  class synthetic_instance : public SceneObject
+  {
+  public:
+    synthetic_instance(synthetic_model* model, glm::vec3 const& position, float half_size)
+      : SceneObject(eMODEL, Noggit::NoggitRenderContext::MAP_VIEW)
+      , _model(model)
+      , _half_size(half_size)
+    {
+      pos = position;
+      recalcExtents();
+    }
+
+    void recalcExtents() override
+    {
+      extents[0] = pos - glm::vec3(_half_size * scale);
+      extents[1] = pos + glm::vec3(_half_size * scale);
+      bounding_radius = _half_size * scale * 1.7320508f;
+    }
+
+    void ensureExtents() override {}
+    bool finishedLoading() override { return true; }
+    AsyncObject* instance_model() const override { return _model; }
+
+    std::array<glm::vec3, 8> getBoundingBox() override
+    {
+      std::array<glm::vec3, 8> corners;
+
+      for (std::size_t i = 0; i < 8; ++i)
+      {
+        corners[i] = glm::vec3(extents[i & 1].x, extents[(i >> 1) & 1].y, extents[(i >> 2) & 1].z);
+      }
+
+      return corners;
+    }
+
+    void updateDetails(Noggit::Ui::detail_infos*) override {}
+
+  private:
+    synthetic_model* _model;
+    float _half_size;
+  };
+
+  //! \a count instances spread over \a tiles_per_side * \a tiles_per_side adts
+  //! around the middle of the map, sized from small doodads to buildings
+  inline std::vector<std::unique_ptr<synthetic_instance>> make_synthetic_instances
+    (synthetic_model* model, std::size_t count, int tiles_per_side, std::mt19937& random)
+  {
+    float const origin = (32 - tiles_per_side / 2) * TILESIZE;
+    std::uniform_real_distribution<float> horizontal(origin, origin + tiles_per_side * TILESIZE);
+    std::uniform_real_distribution<float> height(0.f, 200.f);
+    std::lognormal_distribution<float> size(1.f, 0.8f);
+
+    std::vector<std::unique_ptr<synthetic_instance>> instances;
+    instances.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      glm::vec3 const position(horizontal(random), height(random), horizontal(random));
+      instances.push_back(std::make_unique<synthetic_instance>(model, position, std::min(size(random), 100.f)));
+      instances.back()->uid = static_cast<unsigned int>(i);
+    }
+
+    return instances;
+  }
+}
+
+#endif //NOGGIT_SYNTHETIC_INSTANCE_HPP
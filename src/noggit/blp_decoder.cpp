@@ -0,0 +1,193 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/blp_decoder.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// defines its own GL types and enums, keep it away from the OpenGL headers
+extern "C" {
+#include <txc_dxtn.h>
+}
+
+namespace Noggit
+{
+  namespace
+  {
+    // palette entries and raw pixels are stored as BGRA
+    void bgra_to_rgba(unsigned char const* bgra, unsigned char* rgba, std::uint8_t alpha)
+    {
+      rgba[0] = bgra[2];
+      rgba[1] = bgra[1];
+      rgba[2] = bgra[0];
+      rgba[3] = alpha;
+    }
+
+    bool decode_paletted ( BLPHeader const* header
+                         , char const* data
+                         , std::size_t size
+                         , unsigned char const* src
+                         , std::size_t src_size
+                         , QImage& image
+                         )
+    {
+      if (size < sizeof(BLPHeader) + 256 * 4)
+      {
+        return false;
+      }
+
+      auto const* palette = reinterpret_cast<unsigned char const*>(data + sizeof(BLPHeader));
+      int const alpha_bits = header->attr_1_alphadepth;
+      std::size_t const pixels = static_cast<std::size_t>(image.width()) * image.height();
+
+      if (src_size < pixels + (pixels * alpha_bits + 7) / 8)
+      {
+        return false;
+      }
+
+      unsigned char const* alpha = src + pixels;
+
+      for (int y = 0; y < image.height(); ++y)
+      {
+        unsigned char* dst = image.scanLine(y);
+
+        for (int x = 0; x < image.width(); ++x, dst += 4)
+        {
+          std::size_t const i = static_cast<std::size_t>(y) * image.width() + x;
+          std::uint8_t a = 0xFF;
+
+          switch (alpha_bits)
+          {
+            case 1: a = (alpha[i / 8] >> (i % 8)) & 1 ? 0xFF : 0; break;
+            case 4: a = ((alpha[i / 2] >> ((i % 2) * 4)) & 0xF) * 17; break;
+            case 8: a = alpha[i]; break;
+          }
+
+          bgra_to_rgba(palette + src[i] * 4, dst, a);
+        }
+      }
+
+      return true;
+    }
+
+    bool decode_dxt ( BLPHeader const* header
+                    , unsigned char const* src
+                    , std::size_t src_size
+                    , QImage& image
+                    )
+    {
+      using fetch_function = void (*)(GLint, GLubyte const*, GLint, GLint, GLvoid*);
+
+      fetch_function fetch;
+      std::size_t block_size = 16;
+
+      switch (header->attr_2_alphatype & 3)
+      {
+        case 0:
+          fetch = header->attr_1_alphadepth == 1 ? &fetch_2d_texel_rgba_dxt1 : &fetch_2d_texel_rgb_dxt1;
+          block_size = 8;
+          break;
+        case 1: fetch = &fetch_2d_texel_rgba_dxt3; break;
+        case 3: fetch = &fetch_2d_texel_rgba_dxt5; break;
+        default: return false;
+      }
+
+      std::size_t const expected = static_cast<std::size_t>((image.width() + 3) / 4)
+                                 * ((image.height() + 3) / 4) * block_size;
+
+      // blizzard stores some small mip levels truncated, the missing blocks are black
+      std::vector<unsigned char> padded;
+      if (src_size < expected)
+      {
+        padded.assign(src, src + src_size);
+        padded.resize(expected, 0);
+        src = padded.data();
+      }
+
+      for (int y = 0; y < image.height(); ++y)
+      {
+        unsigned char* dst = image.scanLine(y);
+
+        for (int x = 0; x < image.width(); ++x)
+        {
+          fetch(image.width(), src, x, y, dst + x * 4);
+        }
+      }
+
+      return true;
+    }
+
+    bool decode_raw(unsigned char const* src, std::size_t src_size, QImage& image)
+    {
+      if (src_size < static_cast<std::size_t>(image.width()) * image.height() * 4)
+      {
+        return false;
+      }
+
+      for (int y = 0; y < image.height(); ++y)
+      {
+        unsigned char* dst = image.scanLine(y);
+
+        for (int x = 0; x < image.width(); ++x, src += 4, dst += 4)
+        {
+          bgra_to_rgba(src, dst, src[3]);
+        }
+      }
+
+      return true;
+    }
+  }
+
+  QImage decode_blp(char const* data, std::size_t size, int min_width, int min_height)
+  {
+    if (size < sizeof(BLPHeader) || std::memcmp(data, "BLP2", 4) != 0)
+    {
+      return {};
+    }
+
+    auto const* header = reinterpret_cast<BLPHeader const*>(data);
+
+    int level = 0;
+    int width = header->resx;
+    int height = header->resy;
+
+    if (width <= 0 || height <= 0)
+    {
+      return {};
+    }
+
+    // the smallest mip level still big enough, the scaling is done by the caller
+    while ( min_width > 0 && min_height > 0 && level < 15
+         && header->offsets[level + 1] > 0 && header->sizes[level + 1] > 0
+         && (width >> 1) >= min_width && (height >> 1) >= min_height
+          )
+    {
+      ++level;
+      width >>= 1;
+      height >>= 1;
+    }
+
+    std::size_t const offset = header->offsets[level];
+    std::size_t const src_size = header->sizes[level];
+
+    if (header->offsets[level] <= 0 || header->sizes[level] <= 0 || offset + src_size > size)
+    {
+      return {};
+    }
+
+    auto const* src = reinterpret_cast<unsigned char const*>(data + offset);
+    QImage image(width, height, QImage::Format_RGBA8888);
+
+    bool decoded = false;
+
+    switch (header->attr_0_compression)
+    {
+      case 1: decoded = decode_paletted(header, data, size, src, src_size, image); break;
+      case 2: decoded = decode_dxt(header, src, src_size, image); break;
+      case 3: decoded = decode_raw(src, src_size, image); break;
+    }
+
+    return decoded ? image : QImage();
+  }
+}
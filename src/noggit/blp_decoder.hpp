@@ -0,0 +1,34 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <cstdint>
+
+//! \todo Cross-platform syntax for packed structs.
+#pragma pack(push,1)
+struct BLPHeader
+{
+  int32_t magix;
+  int32_t version;
+  uint8_t attr_0_compression;
+  uint8_t attr_1_alphadepth;
+  uint8_t attr_2_alphatype;
+  uint8_t attr_3_mipmaplevels;
+  int32_t resx;
+  int32_t resy;
+  int32_t offsets[16];
+  int32_t sizes[16];
+};
+#pragma pack(pop)
+
+namespace Noggit
+{
+  //! Decodes a BLP2 file (paletted, DXT1/3/5 or raw BGRA) on the CPU, without an
+  //! OpenGL context, so it can run on any thread. Only decodes the smallest mip level
+  //! that is still at least min_width x min_height, the full texture when they are -1.
+  //! \returns a null image if the file is truncated or in an unknown format.
+  QImage decode_blp(char const* data, std::size_t size, int min_width = -1, int min_height = -1);
+}
@@ -0,0 +1,92 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <util/hash.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace Noggit
+{
+  //! Buckets instances by model and position to find duplicates in linear time
+  //! instead of comparing every pair. Buckets are a lot bigger than the tolerance of
+  //! misc::float_equals so a duplicate is always in the same or a neighbouring bucket,
+  //! the exact comparison (rotation, scale...) is left to the caller.
+  template<typename Model, typename Instance>
+    class duplicate_instance_finder
+  {
+  public:
+    //! \returns the previously inserted instance `instance` is a duplicate of,
+    //! if there is none `instance` is inserted and std::nullopt is returned
+    template<typename IsDuplicate>
+      std::optional<Instance> find_or_insert(Model const& model, glm::vec3 const& pos, Instance instance, IsDuplicate&& is_duplicate)
+    {
+      int const x = bucket_coord(pos.x);
+      int const z = bucket_coord(pos.z);
+
+      for (int dz = -1; dz <= 1; ++dz)
+      {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+          auto it = _buckets.find({model, x + dx, z + dz});
+
+          if (it == _buckets.end())
+          {
+            continue;
+          }
+
+          for (auto const& other : it->second)
+          {
+            if (is_duplicate(other))
+            {
+              return other;
+            }
+          }
+        }
+      }
+
+      _buckets[{model, x, z}].push_back(instance);
+      return std::nullopt;
+    }
+
+  private:
+    static constexpr float bucket_size = 1.f;
+
+    static int bucket_coord(float pos)
+    {
+      return static_cast<int>(std::floor(pos / bucket_size));
+    }
+
+    struct bucket_key
+    {
+      Model model;
+      int x;
+      int z;
+
+      bool operator== (bucket_key const& other) const
+      {
+        return model == other.model && x == other.x && z == other.z;
+      }
+    };
+
+    struct bucket_hash
+    {
+      std::size_t operator() (bucket_key const& key) const
+      {
+        std::size_t seed = std::hash<Model>{}(key.model);
+        util::hash_combine(seed, key.x);
+        util::hash_combine(seed, key.z);
+        return seed;
+      }
+    };
+
+    std::unordered_map<bucket_key, std::vector<Instance>, bucket_hash> _buckets;
+  };
+}
@@ -0,0 +1,53 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/file_key_interner.hpp>
+#include <util/hash.hpp>
+
+#include <mutex>
+#include <string>
+
+namespace Noggit
+{
+  file_key_interner& file_key_interner::instance()
+  {
+    static file_key_interner interner;
+    return interner;
+  }
+
+  std::size_t file_key_interner::file_key_hash::operator() (BlizzardArchive::Listfile::FileKey const& file_key) const noexcept
+  {
+    std::size_t seed = std::hash<std::string>{}(file_key.hasFilepath() ? file_key.filepath() : "");
+    util::hash_combine(seed, file_key.fileDataID());
+    return seed;
+  }
+
+  file_key_id file_key_interner::intern(BlizzardArchive::Listfile::FileKey const& file_key)
+  {
+    {
+      std::shared_lock const lock(_mutex);
+
+      if (auto it = _ids.find(file_key); it != _ids.end())
+      {
+        return it->second;
+      }
+    }
+
+    std::unique_lock const lock(_mutex);
+
+    // another thread may have interned it between the two locks
+    auto const [it, inserted] = _ids.try_emplace(file_key, static_cast<file_key_id>(_keys.size()));
+
+    if (inserted)
+    {
+      _keys.push_back(file_key);
+    }
+
+    return it->second;
+  }
+
+  BlizzardArchive::Listfile::FileKey const& file_key_interner::key(file_key_id id) const
+  {
+    std::shared_lock const lock(_mutex);
+    return _keys.at(id);
+  }
+}
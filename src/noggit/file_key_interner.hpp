@@ -0,0 +1,40 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <Listfile.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace Noggit
+{
+  using file_key_id = std::uint32_t;
+
+  //! Gives every file key a stable integer id for the lifetime of the process, so
+  //! asset maps hash and compare integers rather than paths. Only interning a key
+  //! for the first time writes, every other lookup shares the lock.
+  class file_key_interner
+  {
+  public:
+    static file_key_interner& instance();
+
+    file_key_id intern(BlizzardArchive::Listfile::FileKey const& file_key);
+
+    //! the reference stays valid forever
+    BlizzardArchive::Listfile::FileKey const& key(file_key_id id) const;
+
+  private:
+    struct file_key_hash
+    {
+      std::size_t operator() (BlizzardArchive::Listfile::FileKey const& file_key) const noexcept;
+    };
+
+    std::unordered_map<BlizzardArchive::Listfile::FileKey, file_key_id, file_key_hash> _ids;
+    std::deque<BlizzardArchive::Listfile::FileKey> _keys;
+    std::shared_mutex mutable _mutex;
+  };
+}
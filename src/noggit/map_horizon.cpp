@@ -7,6 +7,7 @@
 #include <noggit/map_index.hpp>
 #include <noggit/MapChunk.h>
 #include <noggit/MapTile.h>
+#include <noggit/save_queue.hpp>
 #include <noggit/World.h>
 
 #include <opengl/context.hpp>
@@ -475,11 +476,7 @@ void map_horizon::save_wdl(World* world, bool regenerate)
             curPos += 4;
         }
     }
-    BlizzardArchive::ClientFile f(filename.str(), Noggit::Application::NoggitApplication::instance()->clientData(),
-    BlizzardArchive::ClientFile::NEW_FILE);
-    f.setBuffer(wdlFile.all_data());
-    f.save();
-    f.close();
+    Noggit::save_queue::instance().write(filename.str(), wdlFile.all_data());
 
     set_minimap(&world->mapIndex);
 }
@@ -0,0 +1,475 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/map_image_pipeline.hpp>
+#include <noggit/Log.h>
+#include <noggit/MapTile.h>
+#include <noggit/project/CurrentProject.hpp>
+#include <noggit/World.h>
+#include <util/thread_pool.hpp>
+
+#include <external/tracy/Tracy.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QtEndian>
+#include <QtWidgets/QProgressDialog>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+
+namespace Noggit
+{
+  namespace
+  {
+    struct loading_tile
+    {
+      TileIndex index;
+      MapTile* tile;
+      bool unload;
+    };
+
+    std::vector<TileIndex> existing_tiles(World* world)
+    {
+      std::vector<TileIndex> tiles;
+
+      for (std::size_t z = 0; z < 64; ++z)
+      {
+        for (std::size_t x = 0; x < 64; ++x)
+        {
+          if (world->mapIndex.hasTile(TileIndex(x, z)))
+          {
+            tiles.emplace_back(x, z);
+          }
+        }
+      }
+
+      return tiles;
+    }
+
+    // the tiles are pinned until released, the progress dialog processes the events
+    // and a frame could unload them otherwise while the pipeline holds them
+    std::optional<loading_tile> start_loading(World* world, TileIndex const& index)
+    {
+      bool const unload = !world->mapIndex.tileLoaded(index) && !world->mapIndex.tileAwaitingLoading(index);
+      MapTile* tile = world->mapIndex.loadTile(index);
+
+      if (!tile)
+      {
+        return std::nullopt;
+      }
+
+      world->mapIndex.pinTile(index);
+
+      return loading_tile{index, tile, unload};
+    }
+
+    void release(World* world, loading_tile const& tile)
+    {
+      world->mapIndex.unpinTile(tile.index);
+
+      if (tile.unload)
+      {
+        world->mapIndex.unloadTile(tile.index);
+      }
+    }
+
+    QString map_directory(std::string const& map_name)
+    {
+      QString path = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
+      if (!(path.endsWith('\\') || path.endsWith('/')))
+      {
+        path += "/";
+      }
+
+      return path + "world/maps/" + QString::fromStdString(map_name);
+    }
+
+    // the tasks still queued reference the stage functions of the caller,
+    // they have to be done before leaving, even when unwinding
+    template<typename Future>
+      void wait_all(std::deque<Future>& futures)
+    {
+      for (auto& future : futures)
+      {
+        if (future.valid())
+        {
+          future.wait();
+        }
+      }
+    }
+  }
+
+  QString map_image_extension(map_image_format format)
+  {
+    switch (format)
+    {
+      case map_image_format::r16: return "r16";
+      case map_image_format::r32: return "r32";
+      default: return "png";
+    }
+  }
+
+  QString map_image_path ( std::string const& map_name
+                         , TileIndex const& tile
+                         , QString const& suffix
+                         , map_image_format format
+                         )
+  {
+    QString const name = QString::fromStdString(map_name);
+
+    return map_directory(map_name) + "/" + name
+      + "_" + QString::number(tile.x) + "_" + QString::number(tile.z)
+      + "_" + suffix + "." + map_image_extension(format);
+  }
+
+  bool save_raw_image(QString const& path, std::vector<float> const& samples, map_image_format format)
+  {
+    QByteArray data;
+
+    if (format == map_image_format::r16)
+    {
+      data.resize(static_cast<int>(samples.size() * sizeof(std::uint16_t)));
+      auto* dst = reinterpret_cast<uchar*>(data.data());
+
+      for (std::size_t i = 0; i < samples.size(); ++i)
+      {
+        auto const value = static_cast<quint16>(std::lround(std::clamp(samples[i], 0.f, 1.f) * 65535.f));
+        qToLittleEndian(value, dst + i * sizeof(quint16));
+      }
+    }
+    else
+    {
+      data.resize(static_cast<int>(samples.size() * sizeof(float)));
+      auto* dst = reinterpret_cast<uchar*>(data.data());
+
+      for (std::size_t i = 0; i < samples.size(); ++i)
+      {
+        quint32 bits;
+        std::memcpy(&bits, &samples[i], sizeof(bits));
+        qToLittleEndian(bits, dst + i * sizeof(quint32));
+      }
+    }
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+      LogError << "Failed to write " << path.toStdString() << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  std::optional<std::vector<float>> load_raw_image(QString const& path, std::size_t count, map_image_format format)
+  {
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+      return std::nullopt;
+    }
+
+    std::size_t const sample_size = format == map_image_format::r16 ? sizeof(quint16) : sizeof(quint32);
+    QByteArray const data = file.readAll();
+
+    if (static_cast<std::size_t>(data.size()) != count * sample_size)
+    {
+      LogError << path.toStdString() << " should hold " << count << " samples of "
+               << sample_size << " bytes, ignoring it" << std::endl;
+      return std::nullopt;
+    }
+
+    auto const* src = reinterpret_cast<uchar const*>(data.constData());
+    std::vector<float> samples(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (format == map_image_format::r16)
+      {
+        samples[i] = qFromLittleEndian<quint16>(src + i * sample_size) / 65535.f;
+      }
+      else
+      {
+        quint32 const bits = qFromLittleEndian<quint32>(src + i * sample_size);
+        std::memcpy(&samples[i], &bits, sizeof(bits));
+      }
+    }
+
+    return samples;
+  }
+
+  std::function<void()> gray_image_write(QString const& path, QImage image, map_image_format format)
+  {
+    return [path, image = std::move(image), format]
+    {
+      if (format == map_image_format::png)
+      {
+        if (!image.save(path, "PNG"))
+        {
+          LogError << "Failed to write " << path.toStdString() << std::endl;
+        }
+
+        return;
+      }
+
+      QImage const gray = image.convertToFormat(QImage::Format_Grayscale8);
+      std::vector<float> samples(static_cast<std::size_t>(gray.width()) * gray.height());
+
+      for (int y = 0; y < gray.height(); ++y)
+      {
+        uchar const* line = gray.constScanLine(y);
+
+        for (int x = 0; x < gray.width(); ++x)
+        {
+          samples[static_cast<std::size_t>(y) * gray.width() + x] = line[x] / 255.f;
+        }
+      }
+
+      save_raw_image(path, samples, format);
+    };
+  }
+
+  void export_all_tiles(World* world, std::function<tile_image_writes (MapTile*)> const& convert)
+  {
+    ZoneScoped;
+
+    struct converting_tile
+    {
+      loading_tile tile;
+      std::future<tile_image_writes> writes;
+    };
+
+    QDir const directory(map_directory(world->basename));
+    if (!directory.exists())
+    {
+      directory.mkpath(".");
+    }
+
+    auto& pool = util::thread_pool::instance();
+
+    std::size_t const max_loading = pool.size() + 1;
+    std::size_t const max_converting = pool.size();
+    std::size_t const max_writing = pool.size() * 2;
+
+    std::deque<loading_tile> loading;
+    std::deque<converting_tile> converting;
+    std::deque<std::future<void>> writing;
+
+    struct drain
+    {
+      World* world;
+      std::deque<loading_tile>& loading;
+      std::deque<converting_tile>& converting;
+      std::deque<std::future<void>>& writing;
+
+      ~drain()
+      {
+        for (auto& tile : converting)
+        {
+          if (tile.writes.valid())
+          {
+            tile.writes.wait();
+          }
+
+          world->mapIndex.unpinTile(tile.tile.index);
+        }
+
+        for (auto& tile : loading)
+        {
+          world->mapIndex.unpinTile(tile.index);
+        }
+
+        wait_all(writing);
+      }
+    } const _ {world, loading, converting, writing};
+
+    auto write_oldest = [&]
+    {
+      std::future<void> write = std::move(writing.front());
+      writing.pop_front();
+      write.get();
+    };
+
+    // the tiles leave their queue once done with, the drain unpins them otherwise
+    auto finish_oldest_conversion = [&]
+    {
+      tile_image_writes writes = converting.front().writes.get();
+      loading_tile const tile = converting.front().tile;
+      converting.pop_front();
+
+      // the images don't reference the tile, it isn't needed for the writes
+      release(world, tile);
+
+      for (auto& write : writes)
+      {
+        if (writing.size() >= max_writing)
+        {
+          write_oldest();
+        }
+
+        writing.push_back(pool.submit(std::move(write)));
+      }
+    };
+
+    auto convert_oldest_loaded = [&]
+    {
+      loading_tile const tile = loading.front();
+
+      tile.tile->wait_until_loaded();
+      // updated lazily on access, done here so that the conversion only reads the tile
+      tile.tile->getExtents();
+
+      if (converting.size() >= max_converting)
+      {
+        finish_oldest_conversion();
+      }
+
+      converting.push_back({tile, pool.submit([&convert, map_tile = tile.tile] { return convert(map_tile); })});
+      loading.pop_front();
+    };
+
+    for (TileIndex const& index : existing_tiles(world))
+    {
+      if (loading.size() >= max_loading)
+      {
+        convert_oldest_loaded();
+      }
+
+      if (auto tile = start_loading(world, index))
+      {
+        loading.push_back(*tile);
+      }
+    }
+
+    while (!loading.empty())
+    {
+      convert_oldest_loaded();
+    }
+
+    while (!converting.empty())
+    {
+      finish_oldest_conversion();
+    }
+
+    while (!writing.empty())
+    {
+      write_oldest();
+    }
+  }
+
+  void import_all_tiles ( World* world
+                        , QProgressDialog* progress_dialog
+                        , std::function<bool (TileIndex const&)> const& has_image
+                        , std::function<tile_image_apply (TileIndex const&)> const& decode
+                        )
+  {
+    ZoneScoped;
+
+    struct importing_tile
+    {
+      loading_tile tile;
+      std::future<tile_image_apply> apply;
+    };
+
+    auto& pool = util::thread_pool::instance();
+
+    std::size_t const max_in_flight = pool.size() + 1;
+
+    std::deque<importing_tile> in_flight;
+    int count = 0;
+
+    struct drain
+    {
+      World* world;
+      std::deque<importing_tile>& in_flight;
+
+      ~drain()
+      {
+        for (auto& tile : in_flight)
+        {
+          if (tile.apply.valid())
+          {
+            tile.apply.wait();
+          }
+
+          world->mapIndex.unpinTile(tile.tile.index);
+        }
+      }
+    } const _ {world, in_flight};
+
+    auto canceled = [&]
+    {
+      return progress_dialog && progress_dialog->wasCanceled();
+    };
+
+    // terrain updates and the map index aren't thread safe, the tiles are
+    // modified and saved one at a time, in the order of the single tile import
+    auto apply_oldest = [&]
+    {
+      // left in flight until done with, the drain unpins it otherwise
+      importing_tile& oldest = in_flight.front();
+
+      tile_image_apply const apply = oldest.apply.get();
+
+      if (apply && !canceled())
+      {
+        MapTile* tile = oldest.tile.tile;
+
+        tile->wait_until_loaded();
+        apply(tile);
+
+        tile->saveTile(world);
+        world->mapIndex.markOnDisc(oldest.tile.index, true);
+        world->mapIndex.unsetChanged(oldest.tile.index);
+
+        if (progress_dialog)
+        {
+          progress_dialog->setValue(++count);
+        }
+      }
+      else
+      {
+        oldest.tile.tile->wait_until_loaded();
+      }
+
+      loading_tile const tile = oldest.tile;
+      in_flight.pop_front();
+
+      release(world, tile);
+    };
+
+    for (TileIndex const& index : existing_tiles(world))
+    {
+      if (canceled())
+      {
+        break;
+      }
+
+      if (!has_image(index))
+      {
+        continue;
+      }
+
+      if (in_flight.size() >= max_in_flight)
+      {
+        apply_oldest();
+      }
+
+      if (auto tile = start_loading(world, index))
+      {
+        in_flight.push_back({*tile, pool.submit([&decode, index] { return decode(index); })});
+      }
+    }
+
+    while (!in_flight.empty())
+    {
+      apply_oldest();
+    }
+  }
+}
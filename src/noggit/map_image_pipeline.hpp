@@ -0,0 +1,73 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/TileIndex.hpp>
+
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class MapTile;
+class QProgressDialog;
+class World;
+
+namespace Noggit
+{
+  //! File formats of the whole map image exports and imports. The raw ones are
+  //! headerless little endian grids (257x257 heights, 1024x1024 alphamaps)
+  //! meant for round trips with external terrain tools, they skip png entirely.
+  enum class map_image_format
+  {
+    png,
+    r16, //!< unsigned 16 bit, heights are scaled between min and max like the png
+    r32, //!< 32 bit float, absolute heights and 0-1 alpha
+  };
+
+  //! "png", "r16" or "r32"
+  QString map_image_extension(map_image_format format);
+
+  //! <project>/world/maps/<map>/<map>_<x>_<z>_<suffix>.<extension>
+  QString map_image_path ( std::string const& map_name
+                         , TileIndex const& tile
+                         , QString const& suffix
+                         , map_image_format format
+                         );
+
+  //! Writes samples in the 0-1 range (r16) or as they are (r32).
+  bool save_raw_image(QString const& path, std::vector<float> const& samples, map_image_format format);
+  //! \returns the samples as written by save_raw_image, or nothing when the file
+  //! can't be read or doesn't hold exactly count samples.
+  std::optional<std::vector<float>> load_raw_image(QString const& path, std::size_t count, map_image_format format);
+
+  //! Files to write once a tile has been converted, run on the thread pool.
+  using tile_image_writes = std::vector<std::function<void()>>;
+  //! Modifies a tile once its files are decoded, run on the calling thread.
+  using tile_image_apply = std::function<void (MapTile*)>;
+
+  //! Write of a grayscale image, as a png or as 0-1 raw samples of its gray level.
+  std::function<void()> gray_image_write(QString const& path, QImage image, map_image_format format);
+
+  //! Loads every tile of the map a few tiles ahead, converts the loaded ones to
+  //! images on the thread pool and encodes and writes the files there too. Each
+  //! stage has a bounded number of tiles in flight, they are pinned while in the
+  //! pipeline and the ones which weren't loaded before are unloaded as soon as they
+  //! are converted. The conversion must only read the tile it is given.
+  void export_all_tiles(World* world, std::function<tile_image_writes (MapTile*)> const& convert);
+
+  //! Reads and decodes the files of the tiles on the thread pool while the tiles
+  //! load, then applies them, saves and unloads the tiles in order on the calling
+  //! thread. The tiles in flight are pinned, the progress dialog processes the
+  //! events meanwhile. Tiles without has_image are skipped, decode may return an
+  //! empty function when its files turn out to be invalid.
+  void import_all_tiles ( World* world
+                        , QProgressDialog* progress_dialog
+                        , std::function<bool (TileIndex const&)> const& has_image
+                        , std::function<tile_image_apply (TileIndex const&)> const& decode
+                        );
+}
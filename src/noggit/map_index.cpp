@@ -1,7 +1,9 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <math/coordinates.hpp>
+#include <math/frustum.hpp>
 #include <noggit/AsyncLoader.h>
+#include <noggit/duplicate_instance_finder.hpp>
 #include <noggit/MapChunk.h>
 #include <noggit/MapTile.h>
 #include <noggit/Misc.h>
@@ -13,23 +15,45 @@
   #include <mysql/mysql.h>
 #endif
 #include <noggit/map_index.hpp>
+#include <noggit/save_queue.hpp>
 #include <noggit/uid_storage.hpp>
 #include <noggit/application/NoggitApplication.hpp>
 #include <ClientFile.hpp>
+#include <opengl/context.hpp>
+#include <util/thread_pool.hpp>
 
+#include <external/tracy/Tracy.hpp>
+
+#include <QtCore/QCoreApplication>
 #include <QtCore/QSettings>
 #include <QByteArray>
 #include <QTextStream>
 #include <QRegExp>
 #include <QFile>
-
-#include <forward_list>
+#include <QProgressDialog>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <vector>
 
-MapIndex::TileRange<false> MapIndex::loaded_tiles()
+std::vector<MapTile*> MapIndex::loaded_tiles() const
 {
-  return tiles<false>
-    ([](TileIndex const&, MapTile* tile) { return !!tile && tile->finishedLoading(); });
+  std::vector<MapTile*> tiles;
+  tiles.reserve(_active_tiles.size());
+
+  std::copy_if ( _active_tiles.begin(), _active_tiles.end(), std::back_inserter(tiles)
+               , [] (MapTile* tile) { return tile->finishedLoading(); }
+               );
+
+  return tiles;
 }
 
 MapIndex::TileRange<true> MapIndex::tiles_in_range(glm::vec3 const& pos, float radius)
@@ -66,7 +90,7 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world,
                     Noggit::NoggitRenderContext context, bool create_empty)
   : basename(pBasename)
   , _map_id (map_id)
-  , _last_unload_time((clock() / CLOCKS_PER_SEC)) // to not try to unload right away
+  , _last_residency_update(std::chrono::steady_clock::now()) // to not try to unload right away
   , mBigAlpha(false)
   , mHasAGlobalWMO(false)
   , changed(false)
@@ -80,6 +104,7 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world,
   _unload_interval = settings.value("unload_interval", 30).toInt();
   _unload_dist = settings.value("unload_dist", 5).toInt();
   _loading_radius = settings.value("loading_radius", 2).toInt();
+  setTileMemoryBudget(settings.value("tile_memory_budget", 2048).toInt());
 
   if (create_empty)
   {
@@ -314,11 +339,7 @@ void MapIndex::save()
     //  }
   }
 
-  BlizzardArchive::ClientFile f(filename.str(), Noggit::Application::NoggitApplication::instance()->clientData(),
-                                BlizzardArchive::ClientFile::NEW_FILE);
-  f.setBuffer(wdtFile.all_data());
-  f.save();
-  f.close();
+  Noggit::save_queue::instance().write(filename.str(), wdtFile.all_data());
 
   changed = false;
 }
@@ -337,9 +358,87 @@ void MapIndex::enterTile(const TileIndex& tile)
   {
       for (int px = std::max(cx - _loading_radius, 0); px <= std::min(cx + _loading_radius, 63); ++px)
     {
-      loadTile(TileIndex(px, pz));
+      TileIndex const index(px, pz);
+
+      // already asked for, by the camera or by someone holding on to it
+      if (tileLoaded(index) || tileAwaitingLoading(index))
+      {
+        continue;
+      }
+
+      if (loadTile(index))
+      {
+        mTiles[pz][px].camera_request = true;
+      }
+    }
+  }
+}
+
+void MapIndex::dropStaleTileRequests(const TileIndex& tile)
+{
+  int cx = static_cast<int>(tile.x);
+  int cz = static_cast<int>(tile.z);
+
+  // copied, cancelled tiles are taken out of the list
+  std::vector<MapTile*> const active_tiles = _active_tiles;
+
+  for (MapTile* adt : active_tiles)
+  {
+    MapTileEntry const& entry = mTiles[adt->index.z][adt->index.x];
+
+    if (adt->finishedLoading() || !entry.camera_request || entry.pins)
+    {
+      continue;
+    }
+
+    int const px = static_cast<int>(adt->index.x);
+    int const pz = static_cast<int>(adt->index.z);
+
+    if (std::max(std::abs(px - cx), std::abs(pz - cz)) <= _loading_radius)
+    {
+      continue;
+    }
+
+    // the camera moved on before a worker picked this tile up, don't load it at all
+    if (AsyncLoader::instance->cancel(adt))
+    {
+      takeTile(adt->index);
+      _n_loaded_tiles--;
+    }
+  }
+}
+
+void MapIndex::update_loading_priorities(glm::vec3 const& camera, math::frustum const& frustum)
+{
+  bool rescored = false;
+
+  for (MapTile* tile : _active_tiles)
+  {
+    if (tile->finishedLoading())
+    {
+      continue;
+    }
+
+    float const px = static_cast<float>(tile->index.x);
+    float const pz = static_cast<float>(tile->index.z);
+
+    tile->calcCamDist(camera);
+
+    // the height of a tile isn't known before it's loaded, test its whole column
+    glm::vec3 const column_min(px * TILESIZE, std::numeric_limits<float>::lowest(), pz * TILESIZE);
+    glm::vec3 const column_max(px * TILESIZE + TILESIZE, std::numeric_limits<float>::max(), pz * TILESIZE + TILESIZE);
+
+    float score = tile->camDist();
+
+    if (!frustum.intersects(column_max, column_min))
+    {
+      score *= off_screen_loading_penalty;
     }
+
+    rescored |= tile->set_loading_score(score);
   }
+
+  AsyncLoader::instance->reprioritize(rescored);
 }
 
 void MapIndex::update_model_tile(const TileIndex& tile, model_update type, SceneObject* instance)
@@ -369,6 +468,8 @@ void MapIndex::setChanged(const TileIndex& tile)
   if (!!mTile)
   {
     mTile->changed = true;
+    // which chunks changed isn't known here
+    mTile->markAllChunksDirty();
   }
 }
 
@@ -377,6 +478,12 @@ void MapIndex::setChanged(MapTile* tile)
   setChanged(tile->index);
 }
 
+void MapIndex::setChanged(MapChunk* chunk, unsigned flags)
+{
+  chunk->markDirty(flags);
+  chunk->mt->changed = true;
+}
+
 void MapIndex::unsetChanged(const TileIndex& tile)
 {
   // change the changed flag of the map tile
@@ -388,7 +495,8 @@ void MapIndex::unsetChanged(const TileIndex& tile)
 
 bool MapIndex::has_unsaved_changes(const TileIndex& tile) const
 {
-  return (tileLoaded(tile) ? getTile(tile)->changed.load() : false);
+  // a save isn't done before its file is written
+  return (tileLoaded(tile) ? getTile(tile)->changed.load() || getTile(tile)->savePending() : false);
 }
 
 void MapIndex::setFlag(bool to, glm::vec3 const& pos, uint32_t flag)
@@ -417,6 +525,8 @@ MapTile* MapIndex::loadTile(const TileIndex& tile, bool reloading, bool load_mod
 
   if (tileLoaded(tile) || tileAwaitingLoading(tile))
   {
+    // the caller holds the tile now, it isn't dropped with the camera requests anymore
+    mTiles[tile.z][tile.x].camera_request = false;
     return mTiles[tile.z][tile.x].tile.get();
   }
 
@@ -429,10 +539,8 @@ MapTile* MapIndex::loadTile(const TileIndex& tile, bool reloading, bool load_mod
     return nullptr;
   }
 
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
-     mBigAlpha, load_models, use_mclq_green_lava(), reloading, _world, _context, tile_mode::edit, load_textures);
-
-  MapTile* adt = mTiles[tile.z][tile.x].tile.get();
+  MapTile* adt = setTile(tile, std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
+     mBigAlpha, load_models, use_mclq_green_lava(), reloading, _world, _context, tile_mode::edit, load_textures));
 
   AsyncLoader::instance->queue_for_load(adt);
   _n_loaded_tiles++;
@@ -444,55 +552,240 @@ void MapIndex::reloadTile(const TileIndex& tile)
 {
   if (tileLoaded(tile))
   {
-    mTiles[tile.z][tile.x].tile.reset();
+    takeTile(tile);
     loadTile(tile, true);
   }
 }
 
 void MapIndex::unloadTiles(const TileIndex& tile)
 {
-  if (((clock() / CLOCKS_PER_SEC) - _last_unload_time) > _unload_interval)
+  using clock = std::chrono::steady_clock;
+
+  clock::time_point const now = clock::now();
+
+  if (now - _last_residency_update < residency_update_interval)
+  {
+    return;
+  }
+
+  ZoneScoped;
+
+  _last_residency_update = now;
+
+  dropStaleTileRequests(tile);
+
+  // ensure _unload_dist is always bigger than loading dist
+  if (_unload_dist <= _loading_radius)
+  {
+      _unload_dist = _loading_radius + 1;
+      QSettings settings;
+      settings.setValue("unload_dist", _unload_dist);
+      settings.sync();
+  }
+
+  struct eviction_candidate
   {
-    // ensure _unload_dist is always bigger than loading dist
-    if (_unload_dist <= _loading_radius)
+    MapTile* tile;
+    std::size_t memory;
+    float score;
+  };
+
+  std::vector<eviction_candidate> candidates;
+  std::size_t memory = 0;
+
+  for (MapTile* adt : loaded_tiles())
+  {
+    MapTileEntry& entry = mTiles[adt->index.z][adt->index.x];
+    terrain_memory_usage const usage = adt->memoryUsage();
+    float const dist = tile.dist(adt->index);
+
+    memory += usage.cpu() + usage.gpu;
+
+    if (dist <= _unload_dist)
     {
-        _unload_dist = _loading_radius + 1;
-        QSettings settings;
-        settings.setValue("unload_dist", _unload_dist);
-        settings.sync();
+      entry.last_used = now;
     }
 
-    for (MapTile* adt : loaded_tiles())
+    bool const in_loading_radius = std::max ( std::abs(static_cast<int>(adt->index.x) - static_cast<int>(tile.x))
+                                            , std::abs(static_cast<int>(adt->index.z) - static_cast<int>(tile.z))
+                                            ) <= _loading_radius;
+
+    //Only unload adts not marked to save nor being written, enterTile would load the ones in the loading radius again
+    if (in_loading_radius || adt->changed.load() || adt->savePending() || entry.pins)
     {
-      if (tile.dist(adt->index) > _unload_dist)
-      {
-        //Only unload adts not marked to save
-        if (!adt->changed.load())
-        {
-          unloadTile(adt->index);
-        }
-      }
+      continue;
     }
 
-    _last_unload_time = clock() / CLOCKS_PER_SEC;
+    float const unused_seconds = std::chrono::duration<float>(now - entry.last_used).count();
+
+    // the older and the farther, the sooner it goes
+    candidates.push_back({adt, usage.cpu() + usage.gpu, dist * (1.f + unused_seconds / std::max(_unload_interval, 1))});
   }
+
+  std::sort ( candidates.begin(), candidates.end()
+            , [] (eviction_candidate const& lhs, eviction_candidate const& rhs) { return lhs.score > rhs.score; }
+            );
+
+  for (eviction_candidate const& candidate : candidates)
+  {
+    MapTileEntry const& entry = mTiles[candidate.tile->index.z][candidate.tile->index.x];
+
+    bool const expired = now - entry.last_used > std::chrono::seconds(_unload_interval);
+
+    if (expired || memory > _tile_memory_budget)
+    {
+      memory -= candidate.memory;
+      unloadTile(candidate.tile->index);
+    }
+  }
+
+  TracyPlot("Terrain memory (MiB)", static_cast<std::int64_t>(memory / (1024 * 1024)));
+  TracyPlot("Active tiles", static_cast<std::int64_t>(_active_tiles.size()));
 }
 
 void MapIndex::unloadTile(const TileIndex& tile)
 {
-  // unloads a tile with given cords
-  if (tileLoaded(tile))
+  // unloads a tile with given cords, the operations pinning it still use it
+  if (tileLoaded(tile) && !mTiles[tile.z][tile.x].pins)
   {
+    MapTile* adt = mTiles[tile.z][tile.x].tile.get();
+
+    // the changes of a save which failed to be written only live in the tile
+    if (adt->savePending())
+    {
+      adt->settleSave(true);
+
+      if (adt->changed.load())
+      {
+        return;
+      }
+    }
+
     // either log before or don't use a reference for the tile/make a copy
     // otherwise it can be deleted before the log because it comes from the adt itself (see unloadTiles)
     Log << "Unloading Tile " << tile.x << "-" << tile.z << std::endl;
 
     AsyncLoader::instance->ensure_deletable(mTiles[tile.z][tile.x].tile.get());
-    mTiles[tile.z][tile.x].tile.reset();
+    retireTile(takeTile(tile));
     _n_loaded_tiles--;
   }
 }
 
+void MapIndex::pinTile(const TileIndex& tile)
+{
+  if (tile.is_valid())
+  {
+    mTiles[tile.z][tile.x].pins++;
+  }
+}
+
+void MapIndex::unpinTile(const TileIndex& tile)
+{
+  if (tile.is_valid())
+  {
+    assert(mTiles[tile.z][tile.x].pins);
+    mTiles[tile.z][tile.x].pins--;
+  }
+}
+
+bool MapIndex::tilePinned(const TileIndex& tile) const
+{
+  return tile.is_valid() && mTiles[tile.z][tile.x].pins;
+}
+
+void MapIndex::releaseRetiredTiles()
+{
+  for (std::size_t i = 0; i < max_tile_releases_per_frame && !_retired_tiles.empty(); ++i)
+  {
+    releaseOldestRetiredTile();
+  }
+
+  while (!_tile_teardowns.empty() && _tile_teardowns.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+  {
+    _tile_teardowns.front().get();
+    _tile_teardowns.pop_front();
+  }
+}
+
+void MapIndex::settleSaves()
+{
+  for (MapTile* tile : _active_tiles)
+  {
+    if (tile->savePending())
+    {
+      tile->settleSave();
+    }
+  }
+}
+
+void MapIndex::releaseAllRetiredTiles()
+{
+  while (!_retired_tiles.empty())
+  {
+    releaseOldestRetiredTile();
+  }
+}
+
+MapTile* MapIndex::setTile(const TileIndex& index, std::unique_ptr<MapTile> tile)
+{
+  // a tile replaced in place is destroyed right away, like before the active list
+  takeTile(index);
+
+  MapTileEntry& entry = mTiles[index.z][index.x];
+
+  entry.tile = std::move(tile);
+  entry.last_used = std::chrono::steady_clock::now();
+
+  _active_tiles.push_back(entry.tile.get());
+
+  return entry.tile.get();
+}
+
+std::unique_ptr<MapTile> MapIndex::takeTile(const TileIndex& index)
+{
+  std::unique_ptr<MapTile> tile = std::move(mTiles[index.z][index.x].tile);
+  mTiles[index.z][index.x].camera_request = false;
+
+  if (tile)
+  {
+    auto it = std::find(_active_tiles.begin(), _active_tiles.end(), tile.get());
+    *it = _active_tiles.back();
+    _active_tiles.pop_back();
+  }
+
+  return tile;
+}
+
+void MapIndex::retireTile(std::unique_ptr<MapTile> tile)
+{
+  // the world must not see the tile anymore once out of mTiles
+  tile->releaseInstances();
+
+  _retired_tiles.push_back(std::move(tile));
+
+  if (_retired_tiles.size() > max_retired_tiles)
+  {
+    releaseOldestRetiredTile();
+  }
+}
+
+void MapIndex::releaseOldestRetiredTile()
+{
+  ZoneScoped;
+
+  std::unique_ptr<MapTile> tile = std::move(_retired_tiles.front());
+  _retired_tiles.pop_front();
+
+  tile->unloadRenderers();
+
+  // chunks, texture references and water are freed off the ui thread
+  _tile_teardowns.push_back(util::thread_pool::instance().submit([tile = std::move(tile)] () mutable
+  {
+    ZoneScopedN("MapIndex: destroy tile");
+    tile.reset();
+  }));
+}
+
 void MapIndex::markOnDisc(const TileIndex& tile, bool mto)
 {
   if(tile.is_valid())
@@ -514,12 +807,6 @@ void MapIndex::saveTile(const TileIndex& tile, World* world, bool save_unloaded)
 	// save given tile
 	if (save_unloaded)
   {
-    auto filepath = std::filesystem::path (Noggit::Project::CurrentProject::get()->ProjectPath)
-                    / BlizzardArchive::ClientData::normalizeFilenameInternal (mTiles[tile.z][tile.x].tile->file_key().filepath());
-
-    QFile file(filepath.string().c_str());
-    file.open(QIODevice::WriteOnly);
-
     mTiles[tile.z][tile.x].tile->initEmptyChunks();
     mTiles[tile.z][tile.x].tile->saveTile(world);
     return;
@@ -557,37 +844,51 @@ void MapIndex::saveChanged (World* world, bool save_unloaded)
           continue;
         }
 
-        auto filepath = std::filesystem::path (Noggit::Project::CurrentProject::get()->ProjectPath)
-                        / BlizzardArchive::ClientData::normalizeFilenameInternal (mTiles[i][j].tile->file_key().filepath());
-
+        // the save queue creates the file, or removes it after the writes still pending
         if (mTiles[i][j].flags & 0x1)
         {
-          QFile file(filepath.string().c_str());
-          file.open(QIODevice::WriteOnly);
-
           mTiles[i][j].tile->initEmptyChunks();
           mTiles[i][j].tile->saveTile(world);
           mTiles[i][j].tile->changed = false;
         }
         else
         {
-          QFile file(filepath.string().c_str());
-          file.remove();
+          Noggit::save_queue::instance().remove(mTiles[i][j].tile->file_key().filepath());
         }
       }
     }
     return;
   }
 
+  std::vector<MapTile*> changed_tiles;
+
   for (MapTile* tile : loaded_tiles())
   {
     if (tile->changed.load())
     {
-      world->horizon.update_horizon_tile(tile);
-      tile->saveTile(world);
-      tile->changed = false;
+      changed_tiles.push_back(tile);
     }
   }
+
+  // everything shared between tiles is updated here, saving itself only reads it
+  for (MapTile* tile : changed_tiles)
+  {
+    world->horizon.update_horizon_tile(tile);
+
+    for (auto const& pair : tile->getObjectInstances())
+    {
+      for (SceneObject* instance : pair.second)
+      {
+        instance->ensureExtents();
+      }
+    }
+  }
+
+  util::thread_pool::instance().parallel_for(changed_tiles.size(), [&] (std::size_t i)
+  {
+    changed_tiles[i]->saveTile(world);
+    changed_tiles[i]->changed = false;
+  });
 }
 
 bool MapIndex::hasAGlobalWMO() const
@@ -772,6 +1073,11 @@ void MapIndex::setUnloadInterval(int value)
   _unload_interval = value;
 }
 
+void MapIndex::setTileMemoryBudget(int megabytes)
+{
+  _tile_memory_budget = static_cast<std::size_t>(std::max(megabytes, 0)) * 1024 * 1024;
+}
+
 uint32_t MapIndex::newGUID()
 {
   std::unique_lock<std::mutex> lock (_mutex);
@@ -787,7 +1093,77 @@ uint32_t MapIndex::newGUID()
   return ++highestGUID;
 }
 
-uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_error)
+namespace
+{
+  // everything fixUIDs needs from the object chunks of an adt
+  struct uid_fix_tile_objects
+  {
+    TileIndex index;
+    std::vector<ENTRY_MDDF> models;
+    std::vector<ENTRY_MODF> wmos;
+    std::vector<std::string> model_filenames;
+    std::vector<std::string> wmo_filenames;
+  };
+
+  // runs fun(i) for each i in [0, count) on the thread pool, the calling thread
+  // logs the progress, shows it in the dialog and keeps the event loop running
+  void uid_fix_step(char const* step, std::size_t count, QProgressDialog* progress_dialog, std::function<void (std::size_t)> const& fun)
+  {
+    auto& pool = util::thread_pool::instance();
+    std::atomic<std::size_t> done = 0;
+
+    if (progress_dialog)
+    {
+      progress_dialog->setLabelText(QString("UID fix: %1...").arg(step));
+      progress_dialog->setRange(0, static_cast<int>(count));
+      progress_dialog->setValue(0);
+    }
+
+    auto result = pool.submit([&]
+    {
+      pool.parallel_for(count, [&] (std::size_t i)
+      {
+        fun(i);
+        done++;
+      });
+    });
+
+    std::size_t reported = 0;
+    auto last_log = std::chrono::steady_clock::now();
+
+    while (result.wait_for(std::chrono::milliseconds(progress_dialog ? 30 : 500)) != std::future_status::ready)
+    {
+      std::size_t const current = done.load();
+
+      if (progress_dialog)
+      {
+        // painting other widgets changes the current opengl context
+        OpenGL::context::save_current_context const context_guard (::gl);
+
+        progress_dialog->setValue(static_cast<int>(current));
+        QCoreApplication::processEvents();
+      }
+
+      if (current != reported && std::chrono::steady_clock::now() - last_log >= std::chrono::milliseconds(500))
+      {
+        Log << "UID fix: " << step << " " << current << "/" << count << std::endl;
+        reported = current;
+        last_log = std::chrono::steady_clock::now();
+      }
+    }
+
+    result.get();
+
+    if (progress_dialog)
+    {
+      progress_dialog->setValue(static_cast<int>(count));
+    }
+
+    Log << "UID fix: " << step << " " << count << "/" << count << std::endl;
+  }
+}
+
+uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_error, QProgressDialog* progress_dialog)
 {
   // clear all selection groups since UIDs will change.
   // TODO : update them instead.
@@ -815,248 +1191,296 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
 
   _uid_fix_all_in_progress = true;
 
-  auto models = std::make_unique<std::forward_list<ModelInstance>>();
-  auto wmos = std::make_unique<std::forward_list<WMOInstance>>();
+  std::vector<uid_fix_tile_objects> tiles;
 
   for (int z = 0; z < 64; ++z)
   {
     for (int x = 0; x < 64; ++x)
     {
-      if (!(mTiles[z][x].flags & 1))
+      if (mTiles[z][x].flags & 1)
       {
-        continue;
+        tiles.push_back({TileIndex(x, z)});
       }
+    }
+  }
 
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
-      BlizzardArchive::ClientFile file(filename.str(), Noggit::Application::NoggitApplication::instance()->clientData());
+  // - read the object chunks of every adt ---------------
+  std::atomic<std::size_t> duplicates_found = 0;
 
-      if (file.isEof())
-      {
-        continue;
-      }
+  uid_fix_step("reading adts", tiles.size(), progress_dialog, [&] (std::size_t i)
+  {
+    auto& objects = tiles[i];
+    std::size_t const x = objects.index.x;
+    std::size_t const z = objects.index.z;
 
-      std::array<glm::vec3, 2> tileExtents;
-      tileExtents[0] = { x*TILESIZE, 0, z*TILESIZE };
-      tileExtents[1] = { (x+1)*TILESIZE, 0, (z+1)*TILESIZE };
-      misc::minmax(&tileExtents[0], &tileExtents[1]);
+    std::stringstream filename;
+    filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
+    BlizzardArchive::ClientFile file(filename.str(), Noggit::Application::NoggitApplication::instance()->clientData());
 
-      std::forward_list<ENTRY_MDDF> modelEntries;
-      std::forward_list<ENTRY_MODF> wmoEntries;
-      std::vector<std::string> modelFilenames;
-      std::vector<std::string> wmoFilenames;
+    if (file.isEof())
+    {
+      return;
+    }
 
-      uint32_t fourcc;
-      uint32_t size;
+    std::array<glm::vec3, 2> tileExtents;
+    tileExtents[0] = { x*TILESIZE, 0, z*TILESIZE };
+    tileExtents[1] = { (x+1)*TILESIZE, 0, (z+1)*TILESIZE };
+    misc::minmax(&tileExtents[0], &tileExtents[1]);
 
-      MHDR Header;
+    uint32_t fourcc;
+    uint32_t size;
 
-      // - MVER ----------------------------------------------
-      uint32_t version;
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      file.read(&version, 4);
-      assert(fourcc == 'MVER' && version == 18);
+    MHDR Header;
 
-      // - MHDR ----------------------------------------------
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      assert(fourcc == 'MHDR');
-      file.read(&Header, sizeof(MHDR));
+    // - MVER ----------------------------------------------
+    uint32_t version;
+    file.read(&fourcc, 4);
+    file.seekRelative(4);
+    file.read(&version, 4);
+    assert(fourcc == 'MVER' && version == 18);
 
-      // - MDDF ----------------------------------------------
-      file.seek(Header.mddf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MDDF');
+    // - MHDR ----------------------------------------------
+    file.read(&fourcc, 4);
+    file.seekRelative(4);
+    assert(fourcc == 'MHDR');
+    file.read(&Header, sizeof(MHDR));
 
-      ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(file.getPointer());
+    // - MDDF ----------------------------------------------
+    file.seek(Header.mddf + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MDDF');
 
-      for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
-      {
-        bool add = true;
-        ENTRY_MDDF const& mddf = mddf_ptr[i];
+    ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(file.getPointer());
 
-        if (!misc::pointInside({ mddf.pos[0], 0, mddf.pos[2] }, tileExtents))
-        {
-          continue;
-        }
+    Noggit::duplicate_instance_finder<std::uint32_t, ENTRY_MDDF const*> model_duplicates;
 
-        // check for duplicates
-        for (ENTRY_MDDF& entry : modelEntries)
-        {
-          if ( mddf.nameID == entry.nameID
-            && misc::float_equals(mddf.pos[0], entry.pos[0])
-            && misc::float_equals(mddf.pos[1], entry.pos[1])
-            && misc::float_equals(mddf.pos[2], entry.pos[2])
-            && misc::float_equals(mddf.rot[0], entry.rot[0])
-            && misc::float_equals(mddf.rot[1], entry.rot[1])
-            && misc::float_equals(mddf.rot[2], entry.rot[2])
-            && mddf.scale == entry.scale
-            )
-          {
-            add = false;
-            break;
-          }
-        }
+    for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
+    {
+      ENTRY_MDDF const& mddf = mddf_ptr[i];
 
-        if (add)
-        {
-          modelEntries.emplace_front(mddf);
-        }
+      if (!misc::pointInside({ mddf.pos[0], 0, mddf.pos[2] }, tileExtents))
+      {
+        continue;
       }
 
-      // - MODF ----------------------------------------------
-      file.seek(Header.modf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MODF');
-
-      ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(file.getPointer());
-
-      for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
+      auto const is_duplicate = [&] (ENTRY_MDDF const* entry)
+      {
+        return misc::float_equals(mddf.pos[0], entry->pos[0])
+          && misc::float_equals(mddf.pos[1], entry->pos[1])
+          && misc::float_equals(mddf.pos[2], entry->pos[2])
+          && misc::float_equals(mddf.rot[0], entry->rot[0])
+          && misc::float_equals(mddf.rot[1], entry->rot[1])
+          && misc::float_equals(mddf.rot[2], entry->rot[2])
+          && mddf.scale == entry->scale;
+      };
+
+      glm::vec3 const pos (mddf.pos[0], mddf.pos[1], mddf.pos[2]);
+
+      if (model_duplicates.find_or_insert(mddf.nameID, pos, &mddf, is_duplicate))
       {
-        bool add = true;
-        ENTRY_MODF const& modf = modf_ptr[i];
+        duplicates_found++;
+      }
+      else
+      {
+        objects.models.emplace_back(mddf);
+      }
+    }
 
-        if (!misc::pointInside({ modf.pos[0], 0, modf.pos[2] }, tileExtents))
-        {
-          continue;
-        }
+    // - MODF ----------------------------------------------
+    file.seek(Header.modf + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MODF');
 
-        // check for duplicates
-        for (ENTRY_MODF& entry : wmoEntries)
-        {
-          if (modf.nameID == entry.nameID
-            && misc::float_equals(modf.pos[0], entry.pos[0])
-            && misc::float_equals(modf.pos[1], entry.pos[1])
-            && misc::float_equals(modf.pos[2], entry.pos[2])
-            && misc::float_equals(modf.rot[0], entry.rot[0])
-            && misc::float_equals(modf.rot[1], entry.rot[1])
-            && misc::float_equals(modf.rot[2], entry.rot[2])
-            )
-          {
-            add = false;
-            break;
-          }
-        }
+    ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(file.getPointer());
 
-        if (add)
-        {
-          wmoEntries.emplace_front(modf);
-        }
-      }
+    Noggit::duplicate_instance_finder<std::uint32_t, ENTRY_MODF const*> wmo_duplicates;
 
-      // - MMDX ----------------------------------------------
-      file.seek(Header.mmdx + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MMDX');
+    for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
+    {
+      ENTRY_MODF const& modf = modf_ptr[i];
 
+      if (!misc::pointInside({ modf.pos[0], 0, modf.pos[2] }, tileExtents))
       {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
-
-        while (lCurPos < lEnd)
-        {
-          modelFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
-        }
+        continue;
       }
 
-      // - MWMO ----------------------------------------------
-      file.seek(Header.mwmo + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MWMO');
-
+      auto const is_duplicate = [&] (ENTRY_MODF const* entry)
       {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
+        return misc::float_equals(modf.pos[0], entry->pos[0])
+          && misc::float_equals(modf.pos[1], entry->pos[1])
+          && misc::float_equals(modf.pos[2], entry->pos[2])
+          && misc::float_equals(modf.rot[0], entry->rot[0])
+          && misc::float_equals(modf.rot[1], entry->rot[1])
+          && misc::float_equals(modf.rot[2], entry->rot[2]);
+      };
 
-        while (lCurPos < lEnd)
-        {
-          wmoFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
-        }
+      glm::vec3 const pos (modf.pos[0], modf.pos[1], modf.pos[2]);
+
+      if (wmo_duplicates.find_or_insert(modf.nameID, pos, &modf, is_duplicate))
+      {
+        duplicates_found++;
+      }
+      else
+      {
+        objects.wmos.emplace_back(modf);
       }
+    }
+
+    // - MMDX ----------------------------------------------
+    file.seek(Header.mmdx + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MMDX');
 
-      file.close();
+    {
+      char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
+      char const* lEnd = lCurPos + size;
 
-      for (ENTRY_MDDF& entry : modelEntries)
+      while (lCurPos < lEnd)
       {
-        models->emplace_front(modelFilenames[entry.nameID], &entry, _context);
+        objects.model_filenames.push_back(std::string(lCurPos));
+        lCurPos += strlen(lCurPos) + 1;
       }
-      for (ENTRY_MODF& entry : wmoEntries)
+    }
+
+    // - MWMO ----------------------------------------------
+    file.seek(Header.mwmo + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MWMO');
+
+    {
+      char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
+      char const* lEnd = lCurPos + size;
+
+      while (lCurPos < lEnd)
       {
-        wmos->emplace_front(wmoFilenames[entry.nameID], &entry, _context);
+        objects.wmo_filenames.push_back(std::string(lCurPos));
+        lCurPos += strlen(lCurPos) + 1;
       }
     }
-  }
 
-  // set all uids
-  // for each tile save the m2/wmo present inside
-  highestGUID = 0;
+    file.close();
+  });
 
-  auto uids_per_tile = std::make_unique<std::map<std::size_t, std::map<std::size_t, std::forward_list<std::uint32_t>>>>();
+  Log << "UID fix: skipped " << duplicates_found << " duplicate Model/WMO entries" << std::endl;
 
-  bool loading_error = false;
+  // - create the instances ------------------------------
+  // creating them queues every model for loading so they load concurrently
+  std::size_t model_count = 0;
+  std::size_t wmo_count = 0;
 
-  for (ModelInstance& instance : *models)
+  for (auto const& objects : tiles)
   {
-    instance.uid = highestGUID++;
-    instance.model->wait_until_loaded();
-    instance.recalcExtents();
+    model_count += objects.models.size();
+    wmo_count += objects.wmos.size();
+  }
 
-    loading_error |= instance.model->loading_failed();
+  std::vector<ModelInstance> models;
+  std::vector<WMOInstance> wmos;
+  models.reserve(model_count);
+  wmos.reserve(wmo_count);
 
-    // to avoid going outside of bound
-    std::size_t sx = std::max((std::size_t)(instance.getExtents()[0].x / TILESIZE), (std::size_t)0);
-    std::size_t sz = std::max((std::size_t)(instance.getExtents()[0].z / TILESIZE), (std::size_t)0);
-    std::size_t ex = std::min((std::size_t)(instance.getExtents()[1].x / TILESIZE), (std::size_t)63);
-    std::size_t ez = std::min((std::size_t)(instance.getExtents()[1].z / TILESIZE), (std::size_t)63);
+  for (auto& objects : tiles)
+  {
+    for (ENTRY_MDDF const& entry : objects.models)
+    {
+      models.emplace_back(objects.model_filenames[entry.nameID], &entry, _context);
+    }
+    for (ENTRY_MODF const& entry : objects.wmos)
+    {
+      wmos.emplace_back(objects.wmo_filenames[entry.nameID], &entry, _context);
+    }
+  }
 
-    auto const real_uid (world->add_model_instance (std::move(instance), false, false));
+  tiles.clear();
+  tiles.shrink_to_fit();
 
-    for (std::size_t z = sz; z <= ez; ++z)
+  // - compute the extents -------------------------------
+  std::atomic<bool> loading_error = false;
+
+  uid_fix_step("loading models", models.size() + wmos.size(), progress_dialog, [&] (std::size_t i)
+  {
+    if (i < models.size())
     {
-      auto& row_map = (*uids_per_tile)[z];
-      for (std::size_t x = sx; x <= ex; ++x)
+      ModelInstance& instance = models[i];
+      instance.model->wait_until_loaded();
+      instance.recalcExtents();
+
+      if (instance.model->loading_failed())
       {
-          auto& uid_list = row_map[x];
-          uid_list.emplace_front(real_uid);
+        loading_error = true;
       }
     }
-  }
+    else
+    {
+      // no need to check if the loading is finished since the extents are stored inside the adt
+      WMOInstance& instance = wmos[i - models.size()];
+      instance.wmo->wait_until_loaded();
+      instance.recalcExtents();
+    }
+  });
 
-  models.reset();
+  // set all uids
+  // for each tile save the m2/wmo present inside
+  highestGUID = 0;
 
-  for (WMOInstance& instance : *wmos)
+  std::vector<std::vector<std::uint32_t>> uids_per_tile(64 * 64);
+
+  auto const add_to_tiles = [&] (std::array<glm::vec3, 2> const& extents, std::uint32_t uid)
   {
-    instance.uid = highestGUID++;
-    instance.wmo->wait_until_loaded();
-    instance.recalcExtents();
-    // no need to check if the loading is finished since the extents are stored inside the adt
     // to avoid going outside of bound
-    std::size_t sx = std::max((std::size_t)(instance.getExtents()[0].x / TILESIZE), (std::size_t)0);
-    std::size_t sz = std::max((std::size_t)(instance.getExtents()[0].z / TILESIZE), (std::size_t)0);
-    std::size_t ex = std::min((std::size_t)(instance.getExtents()[1].x / TILESIZE), (std::size_t)63);
-    std::size_t ez = std::min((std::size_t)(instance.getExtents()[1].z / TILESIZE), (std::size_t)63);
-
-    auto const real_uid (world->add_wmo_instance (std::move(instance), false, false));
+    std::size_t sx = std::max((std::size_t)(extents[0].x / TILESIZE), (std::size_t)0);
+    std::size_t sz = std::max((std::size_t)(extents[0].z / TILESIZE), (std::size_t)0);
+    std::size_t ex = std::min((std::size_t)(extents[1].x / TILESIZE), (std::size_t)63);
+    std::size_t ez = std::min((std::size_t)(extents[1].z / TILESIZE), (std::size_t)63);
 
     for (std::size_t z = sz; z <= ez; ++z)
     {
-      auto& row_map = (*uids_per_tile)[z];
       for (std::size_t x = sx; x <= ex; ++x)
       {
-        auto& uid_list = row_map[x];
-        uid_list.emplace_front(real_uid);
+        uids_per_tile[z * 64 + x].push_back(uid);
       }
     }
+  };
+
+  // the world is only modified from this thread, the events are processed now and then meanwhile
+  auto const process_events = [&] (std::size_t added)
+  {
+    if (progress_dialog && added % 4096 == 0)
+    {
+      OpenGL::context::save_current_context const context_guard (::gl);
+      QCoreApplication::processEvents();
+    }
+  };
+
+  if (progress_dialog)
+  {
+    progress_dialog->setLabelText("UID fix: adding the instances to the world...");
+    progress_dialog->setRange(0, 0);
+  }
+
+  for (ModelInstance& instance : models)
+  {
+    instance.uid = highestGUID++;
+    auto const extents = instance.getExtents();
+    add_to_tiles(extents, world->add_model_instance(std::move(instance), false, false));
+    process_events(highestGUID);
   }
 
-  wmos.reset();
+  models.clear();
+
+  for (WMOInstance& instance : wmos)
+  {
+    instance.uid = highestGUID++;
+    auto const extents = instance.getExtents();
+    add_to_tiles(extents, world->add_wmo_instance(std::move(instance), false, false));
+    process_events(highestGUID);
+  }
+
+  wmos.clear();
 
   if (cancel_on_model_loading_error && loading_error)
   {
@@ -1065,35 +1489,52 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
 
   // load each tile without the models and
   // save them with the models with the new uids
+  std::vector<TileIndex> tiles_to_save;
+
   for (int z = 0; z < 64; ++z)
   {
     for (int x = 0; x < 64; ++x)
     {
-      if (!(mTiles[z][x].flags & 1))
+      // load even the tiles without models in case there are old ones
+      // that shouldn't be there to avoid creating new duplicates
+      if (mTiles[z][x].flags & 1)
       {
-        continue;
+        tiles_to_save.emplace_back(x, z);
       }
+    }
+  }
 
-      // load even the tiles without models in case there are old ones
-      // that shouldn't be there to avoid creating new duplicates
+  // instances keep track of the tiles referencing them, that's not thread safe
+  std::mutex instances_tiles_guard;
 
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
+  uid_fix_step("saving adts", tiles_to_save.size(), progress_dialog, [&] (std::size_t i)
+  {
+    std::size_t const x = tiles_to_save[i].x;
+    std::size_t const z = tiles_to_save[i].z;
 
-      // load the tile without the models
-      MapTile tile(x, z, filename.str(), mBigAlpha, false, use_mclq_green_lava(), false, world, _context, tile_mode::uid_fix_all);
-      tile.finishLoading();
+    std::stringstream filename;
+    filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
+
+    // load the tile without the models
+    auto tile = std::make_unique<MapTile>(x, z, filename.str(), mBigAlpha, false, use_mclq_green_lava(), false, world, _context, tile_mode::uid_fix_all);
+    tile->finishLoading();
 
-      // add the uids to the tile to be able to save the models
-      // which have been loaded in world earlier
-      for (std::uint32_t uid : (*uids_per_tile)[z][x])
+    // add the uids to the tile to be able to save the models
+    // which have been loaded in world earlier
+    {
+      std::lock_guard<std::mutex> const lock (instances_tiles_guard);
+
+      for (std::uint32_t uid : uids_per_tile[z * 64 + x])
       {
-        tile.add_model(uid);
+        tile->add_model(uid);
       }
-
-      tile.saveTile(world);
     }
-  }
+
+    tile->saveTile(world);
+
+    std::lock_guard<std::mutex> const lock (instances_tiles_guard);
+    tile.reset();
+  });
 
   // override the db highest uid if used
   saveMaxUID();
@@ -1266,8 +1707,8 @@ void MapIndex::addTile(const TileIndex& tile)
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile.x << "_" << tile.z << ".adt";
 
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
-      mBigAlpha, true, use_mclq_green_lava(), false, _world, _context);
+  setTile(tile, std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
+      mBigAlpha, true, use_mclq_green_lava(), false, _world, _context));
 
   mTiles[tile.z][tile.x].flags |= 0x1;
   mTiles[tile.z][tile.x].tile->changed = true;
@@ -1283,8 +1724,8 @@ void MapIndex::removeTile(const TileIndex &tile)
 
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile.x << "_" << tile.z << ".adt";
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
-     mBigAlpha, true, use_mclq_green_lava(), false, _world, _context);
+  setTile(tile, std::make_unique<MapTile> (static_cast<int>(tile.x), static_cast<int>(tile.z), filename.str(),
+     mBigAlpha, true, use_mclq_green_lava(), false, _world, _context));
 
   mTiles[tile.z][tile.x].tile->changed = true;
   mTiles[tile.z][tile.x].onDisc = false;
@@ -1471,6 +1912,16 @@ void MapIndex::create_empty_wdl() const
     f.close();
 }
 
+MapIndex::~MapIndex()
+{
+  releaseAllRetiredTiles();
+
+  for (auto& teardown : _tile_teardowns)
+  {
+    teardown.wait();
+  }
+}
+
 MapTileEntry::~MapTileEntry()
 {
 }
@@ -1479,5 +1930,7 @@ MapTileEntry::MapTileEntry()
   : flags(0)
   , tile(nullptr)
   , onDisc(false)
+  , camera_request(false)
+  , pins(0)
 {
 }
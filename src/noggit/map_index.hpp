@@ -8,9 +8,15 @@
 #include <noggit/TileIndex.hpp>
 #include <noggit/ContextObject.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 
 enum class uid_fix_status
@@ -20,7 +26,14 @@ enum class uid_fix_status
   failed
 };
 
+class MapChunk;
 class MapTile;
+class QProgressDialog;
+
+namespace math
+{
+  class frustum;
+}
 
 /*!
 \brief This class is only a holder to have easier access to MapTiles and their flags for easier WDT parsing. This is private and for the class World only.
@@ -32,6 +45,12 @@ private:
   uint32_t flags;
   std::unique_ptr<MapTile> tile;
   bool onDisc;
+  //! last time the tile was within the unload distance of the camera
+  std::chrono::steady_clock::time_point last_used;
+  //! only enterTile asked for the tile, it may be dropped once out of the loading radius
+  bool camera_request;
+  //! operations holding the tile across frames, see MapIndex::pinTile
+  unsigned pins;
 
   MapTileEntry();
 
@@ -145,25 +164,36 @@ public:
         return  TileRange<Load>(tile_iterator<Load> {this, { 0, 0 }, pred}, tile_iterator<Load>{});
   }
 
-  TileRange<false> loaded_tiles();
+  //! The tiles done loading, copied out of the active tile list so that tiles
+  //! can be loaded or unloaded while going over them.
+  std::vector<MapTile*> loaded_tiles() const;
 
   TileRange<true> tiles_in_range (glm::vec3 const& pos, float radius);
 
   TileRange<true> tiles_in_rect (glm::vec3 const& pos, float radius);
 
   MapIndex(const std::string& pBasename, int map_id, World*, Noggit::NoggitRenderContext context, bool create_empty = false);
+  //! releases the retired tiles and waits for their destruction
+  ~MapIndex();
 
   void set_basename(const std::string& pBasename);
 
   void create_empty_wdl() const;
 
+  //! Queues the tiles within the loading radius of `tile` which nothing asked for yet.
   void enterTile(const TileIndex& tile);
+
+  //! Re-scores the tiles still waiting in the loader by camera distance,
+  //! tiles outside of the view frustum are pushed back by off_screen_loading_penalty.
+  void update_loading_priorities(glm::vec3 const& camera, math::frustum const& frustum);
   MapTile *loadTile(const TileIndex& tile, bool reloading = false, bool load_models = true, bool load_textures = true);
 
   void update_model_tile(const TileIndex& tile, model_update type, SceneObject* instance);
 
   void setChanged(const TileIndex& tile);
   void setChanged(MapTile* tile);
+  //! only the given chunk is saved again, the rest of the tile reuses what was last written
+  void setChanged(MapChunk* chunk, unsigned flags = ~0u);
 
   void unsetChanged(const TileIndex& tile);
   void setFlag(bool to, glm::vec3 const& pos, uint32_t flag);
@@ -172,8 +202,30 @@ public:
   void saveTile(const TileIndex& tile, World*, bool save_unloaded = false);
   void saveChanged (World*, bool save_unloaded = false);
   void reloadTile(const TileIndex& tile);
-  void unloadTiles(const TileIndex& tile);  // unloads all tiles more then x adts away from given
-  void unloadTile(const TileIndex& tile);  // unload given tile
+  //! Cancels the tiles enterTile queued which left the loading radius before being
+  //! loaded, then unloads the tiles which stayed out of the unload distance around
+  //! `tile` for the unload interval, then the least recently used and farthest ones
+  //! outside of the loading radius while the terrain memory is over budget.
+  //! Pinned tiles and tiles with changes or a save not yet written are left alone.
+  void unloadTiles(const TileIndex& tile);
+  //! The tile is detached from the world right away, its OpenGL data is freed by
+  //! releaseRetiredTiles and the rest on the thread pool. Does nothing for pinned
+  //! tiles. Waits for the tile's save to be written, and keeps it if that failed.
+  void unloadTile(const TileIndex& tile);
+  //! Keeps the tile from being unloaded or cancelled until unpinned, for the
+  //! operations holding tiles while frames go by. Pins are counted, the tile
+  //! doesn't need to be loaded.
+  void pinTile(const TileIndex& tile);
+  void unpinTile(const TileIndex& tile);
+  bool tilePinned(const TileIndex& tile) const;
+  //! Frees the OpenGL data of a few unloaded tiles and hands them over to the
+  //! thread pool for destruction, call once per frame with the context current.
+  void releaseRetiredTiles();
+  //! same, for every unloaded tile, before the context goes away
+  void releaseAllRetiredTiles();
+  //! Checks on the saved tiles whose files are still being written, call once
+  //! per frame. The ones which failed to be written are flagged as changed again.
+  void settleSaves();
   void markOnDisc(const TileIndex& tile, bool mto);
   bool isTileExternal(const TileIndex& tile) const;
 
@@ -200,7 +252,9 @@ public:
 
   uint32_t newGUID();
 
-  uid_fix_status fixUIDs (World*, bool);
+  //! the work runs on the thread pool, the calling thread updates the optional
+  //! dialog and processes the events until it is done
+  uid_fix_status fixUIDs (World*, bool, QProgressDialog* progress_dialog = nullptr);
   void searchMaxUID();
   void saveMaxUID();
   void loadMaxUID();
@@ -222,6 +276,27 @@ public:
   void saveMinimapMD5translate();
 
 private:
+  //! Cancels the tiles only enterTile queued that left the loading radius around
+  //! `tile` before being loaded.
+  void dropStaleTileRequests(const TileIndex& tile);
+
+  //! Every tile slot is assigned through these to keep the active tile list in sync.
+  MapTile* setTile(const TileIndex& index, std::unique_ptr<MapTile> tile);
+  std::unique_ptr<MapTile> takeTile(const TileIndex& index);
+
+  void retireTile(std::unique_ptr<MapTile> tile);
+  void releaseOldestRetiredTile();
+
+  static constexpr float off_screen_loading_penalty = 4.f;
+
+  //! how often unloadTiles looks at the tiles, it is called every frame
+  static constexpr std::chrono::milliseconds residency_update_interval {250};
+  //! tiles whose OpenGL data is freed per frame
+  static constexpr std::size_t max_tile_releases_per_frame = 2;
+  //! past this many retired tiles they are released right away, batch
+  //! operations unload tiles faster than frames go by
+  static constexpr std::size_t max_retired_tiles = 16;
+
 	uint32_t getHighestGUIDFromFile(const std::string& pFilename) const;
 
   bool _uid_fix_all_in_progress = false;
@@ -240,12 +315,15 @@ public:
   void setUnloadDistance(int value);
 
   void setUnloadInterval(int value);;
+
+  void setTileMemoryBudget(int megabytes);
 private:
-  int _last_unload_time;
+  std::chrono::steady_clock::time_point _last_residency_update;
   int _unload_interval;
   int _unload_dist;
   int _loading_radius;
   unsigned _n_loaded_tiles = 0; // to be loaded, not necessarily already loaded
+  std::size_t _tile_memory_budget; // bytes
   int _n_existing_tiles = -1;
 
   // Is the WDT telling us to use a different alphamap structure.
@@ -263,6 +341,12 @@ private:
 
   // Holding all MapTiles there can be in a World.
   MapTileEntry mTiles[64][64];
+  //! every tile of mTiles, loaded or not, in no particular order
+  std::vector<MapTile*> _active_tiles;
+
+  //! unloaded tiles waiting for their OpenGL data to be freed, oldest first
+  std::deque<std::unique_ptr<MapTile>> _retired_tiles;
+  std::deque<std::future<void>> _tile_teardowns;
 
   //! \todo REMOVE!
   World* _world;
@@ -82,6 +82,11 @@ void FlightBoundsRender::upload()
 
 void FlightBoundsRender::unload()
 {
+  if (!_uploaded)
+  {
+    return;
+  }
+
   _mfbo_vbos.unload();
   _mfbo_vaos.unload();
 
@@ -0,0 +1,324 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include "MinimapPipeline.hpp"
+#include <external/PNG2BLP/Png2Blp.h>
+#include <external/tracy/Tracy.hpp>
+#include <noggit/application/NoggitApplication.hpp>
+#include <noggit/DBC.h>
+#include <noggit/Log.h>
+#include <noggit/MinimapRenderSettings.hpp>
+#include <noggit/project/CurrentProject.hpp>
+#include <noggit/World.h>
+#include <opengl/context.hpp>
+#include <util/thread_pool.hpp>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFramebufferObjectFormat>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Noggit::Rendering;
+
+MinimapPipeline::MinimapPipeline(World* world)
+  : _world(world)
+{
+  _pixel_buffers.upload();
+}
+
+MinimapPipeline::~MinimapPipeline()
+{
+  unpinAll();
+}
+
+void MinimapPipeline::prefetch(std::vector<TileIndex> const& tiles)
+{
+  for (TileIndex const& tile : tiles)
+  {
+    // no-op for tiles already loaded or queued
+    if ( _world->mapIndex.loadTile(tile)
+      && std::find(_pinned_tiles.begin(), _pinned_tiles.end(), tile) == _pinned_tiles.end()
+       )
+    {
+      _world->mapIndex.pinTile(tile);
+      _pinned_tiles.push_back(tile);
+    }
+  }
+}
+
+void MinimapPipeline::bindFramebuffer(int resolution)
+{
+  if (!_framebuffer || _resolution != resolution)
+  {
+    // finish() has to be called before changing the resolution
+    assert(!_pending_read_back);
+
+    QOpenGLFramebufferObjectFormat fmt;
+    fmt.setSamples(0);
+    fmt.setInternalTextureFormat(GL_RGBA8);
+    fmt.setAttachment(QOpenGLFramebufferObject::Depth);
+
+    _framebuffer = std::make_unique<QOpenGLFramebufferObject>(resolution, resolution, fmt);
+    _resolution = resolution;
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+      gl.bufferData<GL_PIXEL_PACK_BUFFER>(_pixel_buffers[i], resolution * resolution * 4, nullptr, GL_STREAM_READ);
+    }
+  }
+
+  _framebuffer->bind();
+}
+
+void MinimapPipeline::releaseFramebuffer()
+{
+  _framebuffer->release();
+}
+
+void MinimapPipeline::readBack ( TileIndex const& tile
+                               , bool unload_tile
+                               , MinimapRenderSettings const& settings
+                               , std::optional<QImage>& combined_image
+                               )
+{
+  ZoneScoped;
+
+  assert(_framebuffer && _framebuffer->isValid() && _framebuffer->isBound());
+
+  // returns immediately, the copy happens once the GPU is done with the tile
+  gl.bindBuffer(GL_PIXEL_PACK_BUFFER, _pixel_buffers[_next_buffer]);
+  gl.readPixels(0, 0, _resolution, _resolution, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  QString str = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
+  if (!(str.endsWith('\\') || str.endsWith('/')))
+  {
+    str += "/";
+  }
+
+  QString target_dir = QString("/textures/minimap/");
+  if (settings.export_mode == MinimapGenMode::LOD_MAPTEXTURES || settings.export_mode == MinimapGenMode::LOD_MAPTEXTURES_N)
+  {
+    target_dir = QString("/textures/maptextures/");
+  }
+
+  QDir dir(str + target_dir);
+  if (!dir.exists())
+    dir.mkpath(".");
+
+  std::string const tile_name = _world->basename + "_" + std::to_string(tile.x) + "_" + std::to_string(tile.z);
+
+  output target;
+  target.directory = dir.path();
+  target.texture_name = tile_name + (settings.export_mode == MinimapGenMode::LOD_MAPTEXTURES_N ? "_n.blp" : ".blp");
+  target.png_name = tile_name + ".png";
+  target.file_format = settings.file_format;
+
+  std::optional<pending_read_back> previous = std::move(_pending_read_back);
+  _pending_read_back.emplace(pending_read_back{tile, _next_buffer, unload_tile, settings.combined_minimap, std::move(target)});
+  _next_buffer = (_next_buffer + 1) % 2;
+
+  if (previous)
+  {
+    completeReadBack(*previous, combined_image);
+  }
+}
+
+void MinimapPipeline::finish(std::optional<QImage>& combined_image)
+{
+  ZoneScoped;
+
+  if (_pending_read_back)
+  {
+    completeReadBack(*_pending_read_back, combined_image);
+    _pending_read_back.reset();
+  }
+
+  while (!_pending_writes.empty())
+  {
+    completeWrite(_pending_writes.front());
+    _pending_writes.pop_front();
+  }
+
+  unpinAll();
+}
+
+void MinimapPipeline::unpin(TileIndex const& tile)
+{
+  auto it = std::find(_pinned_tiles.begin(), _pinned_tiles.end(), tile);
+
+  if (it != _pinned_tiles.end())
+  {
+    _world->mapIndex.unpinTile(tile);
+    _pinned_tiles.erase(it);
+  }
+}
+
+void MinimapPipeline::unpinAll()
+{
+  for (TileIndex const& tile : _pinned_tiles)
+  {
+    _world->mapIndex.unpinTile(tile);
+  }
+
+  _pinned_tiles.clear();
+}
+
+void MinimapPipeline::completeReadBack(pending_read_back const& read_back, std::optional<QImage>& combined_image)
+{
+  ZoneScoped;
+
+  auto pixels = std::make_shared<std::vector<std::uint32_t>>(_resolution * _resolution);
+
+  gl.bindBuffer(GL_PIXEL_PACK_BUFFER, _pixel_buffers[read_back.buffer]);
+
+  if (auto const* data = static_cast<std::uint32_t const*>(gl.mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)))
+  {
+    // OpenGL rows go bottom to top
+    for (int row = 0; row < _resolution; ++row)
+    {
+      std::memcpy ( pixels->data() + (_resolution - 1 - row) * _resolution
+                  , data + row * _resolution
+                  , _resolution * sizeof(std::uint32_t)
+                  );
+    }
+
+    gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  else
+  {
+    LogError << "Minimap: couldn't map the pixel buffer of tile " << read_back.tile.x << "_" << read_back.tile.z << std::endl;
+  }
+
+  gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  unpin(read_back.tile);
+
+  if (read_back.unload_tile)
+  {
+    _world->mapIndex.unloadTile(read_back.tile);
+  }
+
+  if (read_back.combined && combined_image.has_value())
+  {
+    QImage const image(reinterpret_cast<uchar const*>(pixels->data()), _resolution, _resolution, QImage::Format_RGBA8888);
+    QImage const scaled_image = image.scaled(128, 128, Qt::KeepAspectRatio).convertToFormat(combined_image->format());
+
+    int const x = static_cast<int>(read_back.tile.x) * 128;
+    int const z = static_cast<int>(read_back.tile.z) * 128;
+    int const width = std::min(scaled_image.width(), 128);
+    int const bytes_per_pixel = scaled_image.depth() / 8;
+
+    for (int i = 0; i < std::min(scaled_image.height(), 128); ++i)
+    {
+      std::memcpy ( combined_image->scanLine(z + i) + x * bytes_per_pixel
+                  , scaled_image.constScanLine(i)
+                  , width * bytes_per_pixel
+                  );
+    }
+  }
+
+  auto& pool = util::thread_pool::instance();
+
+  // every write in flight holds a full resolution image
+  while (_pending_writes.size() > pool.size())
+  {
+    completeWrite(_pending_writes.front());
+    _pending_writes.pop_front();
+  }
+
+  _pending_writes.push_back
+    ( { read_back.tile
+      , pool.submit([pixels, resolution = _resolution, target = read_back.target]
+                    {
+                      return write(*pixels, resolution, target);
+                    })
+      }
+    );
+}
+
+void MinimapPipeline::completeWrite(pending_write& pending)
+{
+  std::string tex_name;
+
+  try
+  {
+    tex_name = pending.texture_name.get();
+  }
+  catch (std::exception const& e)
+  {
+    LogError << "Minimap: couldn't write tile " << pending.tile.x << "_" << pending.tile.z << ": " << e.what() << std::endl;
+    return;
+  }
+
+  // Register in md5translate.trs
+  try
+  {
+    std::string map_name = gMapDB.getByID(_world->mapIndex._map_id).getString(MapDB::InternalName);
+    auto sstream = std::stringstream();
+    sstream << map_name << "\\map" << pending.tile.x << "_" << std::setfill('0') << std::setw(2) << pending.tile.z << ".blp";
+    std::string tilename_left = sstream.str();
+    auto& minimap_md5translate = Noggit::Application::NoggitApplication::instance()->clientData()->_minimap_md5translate;
+    minimap_md5translate[map_name][tilename_left] = tex_name;
+  }
+  catch(MapDB::NotFound)
+  {
+    LogError << "SaveMinimap : Couldn't find entry " << _world->mapIndex._map_id << std::endl;
+    assert(false);
+  }
+}
+
+std::string MinimapPipeline::write(std::vector<std::uint32_t> const& pixels, int resolution, output const& target)
+{
+  ZoneScoped;
+
+  std::string tex_name = target.texture_name;
+  QDir const dir(target.directory);
+
+  if (target.file_format == ".png")
+  {
+    QImage const image(reinterpret_cast<uchar const*>(pixels.data()), resolution, resolution, QImage::Format_RGBA8888);
+    image.save(dir.filePath(target.png_name.c_str()));
+  }
+  else if (target.file_format == ".blp (DXT1)" || target.file_format == ".blp (DXT5)")
+  {
+    bool const dxt5 = target.file_format == ".blp (DXT5)";
+
+    auto blp = Png2Blp();
+    blp.loadRgba(pixels.data(), resolution, resolution);
+
+    uint32_t file_size;
+    // this mirrors blizzards : dxt1, no mipmap
+    std::unique_ptr<void, decltype(&std::free)> const blp_image
+      (blp.createBlpDxtInMemory(dxt5, dxt5 ? FORMAT_DXT5 : FORMAT_DXT1, file_size), &std::free);
+
+    // converts the texture name to an md5 hash like blizzard, this is used to avoid duplicates textures for ocean
+    // downside is that if the file gets updated regularly there will be a lot of duplicates in the project folder
+    // probably should be a patching option when deploying
+    bool use_md5 = false;
+    if (use_md5)
+    {
+      QCryptographicHash md5_hash(QCryptographicHash::Md5);
+      md5_hash.addData(static_cast<char const*>(blp_image.get()), file_size);
+      tex_name = md5_hash.result().toHex().toStdString() + ".blp";
+    }
+
+    QFile file(dir.filePath(tex_name.c_str()));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+      throw std::runtime_error("couldn't open " + file.fileName().toStdString());
+    }
+
+    file.write(static_cast<char const*>(blp_image.get()), file_size);
+  }
+
+  return tex_name;
+}
@@ -0,0 +1,104 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_MINIMAPPIPELINE_HPP
+#define NOGGIT_MINIMAPPIPELINE_HPP
+
+#include <noggit/TileIndex.hpp>
+
+#include <opengl/scoped.hpp>
+
+#include <QImage>
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class QOpenGLFramebufferObject;
+class World;
+struct MinimapRenderSettings;
+
+namespace Noggit::Rendering
+{
+  //! Overlaps the steps of a minimap export. While a tile renders, the previous one
+  //! is read back through a pixel buffer object, its raw pixels are encoded and written
+  //! on the thread pool and the next tiles load in the background.
+  //! Everything but the encoding has to be called with the OpenGL context current.
+  class MinimapPipeline
+  {
+  public:
+    explicit MinimapPipeline(World* world);
+    ~MinimapPipeline();
+
+    MinimapPipeline(MinimapPipeline const&) = delete;
+    MinimapPipeline& operator= (MinimapPipeline const&) = delete;
+
+    //! queues the loading of the tiles about to be rendered, they stay pinned until read back
+    void prefetch(std::vector<TileIndex> const& tiles);
+
+    //! binds the framebuffer tiles are rendered to
+    void bindFramebuffer(int resolution);
+    void releaseFramebuffer();
+
+    //! starts reading back the rendered tile and finishes the one rendered before
+    void readBack ( TileIndex const& tile
+                  , bool unload_tile
+                  , MinimapRenderSettings const& settings
+                  , std::optional<QImage>& combined_image
+                  );
+
+    //! finishes the pending tile, waits for every file to be written and unpins
+    //! the tiles prefetched but not rendered
+    void finish(std::optional<QImage>& combined_image);
+
+  private:
+    struct output
+    {
+      QString directory;
+      std::string texture_name;
+      std::string png_name;
+      std::string file_format;
+    };
+
+    struct pending_read_back
+    {
+      TileIndex tile;
+      unsigned buffer;
+      bool unload_tile;
+      bool combined;
+      output target;
+    };
+
+    struct pending_write
+    {
+      TileIndex tile;
+      std::future<std::string> texture_name;
+    };
+
+    static std::string write(std::vector<std::uint32_t> const& pixels, int resolution, output const& target);
+
+    void completeReadBack(pending_read_back const& read_back, std::optional<QImage>& combined_image);
+    //! waits for the file and registers it in md5translate
+    void completeWrite(pending_write& pending);
+    void unpin(TileIndex const& tile);
+    void unpinAll();
+
+    World* _world;
+    int _resolution = 0;
+
+    std::unique_ptr<QOpenGLFramebufferObject> _framebuffer;
+    OpenGL::Scoped::deferred_upload_buffers<2> _pixel_buffers;
+    unsigned _next_buffer = 0;
+
+    //! prefetched tiles, residency doesn't unload them while the export runs over several frames
+    std::vector<TileIndex> _pinned_tiles;
+
+    std::optional<pending_read_back> _pending_read_back;
+    std::deque<pending_write> _pending_writes;
+  };
+}
+
+#endif //NOGGIT_MINIMAPPIPELINE_HPP
@@ -0,0 +1,207 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/rendering/ModelCullList.hpp>
+#include <external/tracy/Tracy.hpp>
+#include <math/frustum.hpp>
+#include <noggit/MapTile.h>
+#include <noggit/Model.h>
+#include <noggit/ModelInstance.h>
+#include <util/thread_pool.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace Noggit::Rendering
+{
+  namespace
+  {
+    // instances are tested by blocks, a single one is too little work for a task
+    constexpr std::size_t block_size = 512;
+  }
+
+  bool ModelCullList::update(std::vector<MapTile*> const& tiles, bool instances_changed)
+  {
+    ZoneScoped;
+
+    bool const rebuild_needed = instances_changed
+      || tiles != _tiles
+      || std::any_of(_pending_models.begin(), _pending_models.end(), [] (AsyncObject* model)
+         {
+           return model->finishedLoading();
+         });
+
+    if (rebuild_needed)
+    {
+      rebuild(tiles);
+    }
+
+    return rebuild_needed;
+  }
+
+  void ModelCullList::rebuild(std::vector<MapTile*> const& tiles)
+  {
+    ZoneScoped;
+
+    clear();
+    _tiles = tiles;
+
+    for (MapTile* tile : tiles)
+    {
+      std::size_t const begin = _instances.size();
+
+      for (auto const& pair : tile->getObjectInstances())
+      {
+        if (pair.second.empty() || pair.second[0]->which() != eMODEL)
+        {
+          continue;
+        }
+
+        if (!pair.first->finishedLoading())
+        {
+          _pending_models.push_back(pair.first);
+          continue;
+        }
+
+        auto model = reinterpret_cast<Model*>(pair.first);
+
+        for (SceneObject* object : pair.second)
+        {
+          auto instance = static_cast<ModelInstance*>(object);
+          // the extents are computed here, the culling itself doesn't modify the instances
+          auto const& extents = instance->getExtents();
+
+          _models.push_back(model);
+          _instances.push_back(instance);
+          _extents_min.push_back(extents[0]);
+          _extents_max.push_back(extents[1]);
+          _positions.push_back(instance->pos);
+          _radii.push_back(model->bounding_box_radius * instance->scale);
+          _size_cats.push_back(instance->size_cat);
+          _shared.push_back(instance->getTiles().size() > 1);
+          // only kept to know which instances stop being drawn
+          _visible.push_back(instance->_rendered_last_frame);
+        }
+      }
+
+      _tile_ranges.emplace(tile, std::make_pair(begin, _instances.size()));
+    }
+
+    _cull_results.resize(_instances.size());
+    _rebuilt = true;
+  }
+
+  void ModelCullList::cull ( std::vector<visible_tile> const& tiles
+                           , math::frustum const& frustum
+                           , glm::vec3 const& camera_pos
+                           , float cull_distance
+                           , display_mode display
+                           , bool camera_moved
+                           , bool draw_hidden_models
+                           , tsl::robin_map<Model*, std::vector<glm::mat4x4>>& models_to_draw
+                           )
+  {
+    ZoneScoped;
+
+    _frame = _frame == std::numeric_limits<int>::max() ? 0 : _frame + 1;
+    _blocks.clear();
+
+    for (visible_tile const& tile : tiles)
+    {
+      auto it = _tile_ranges.find(tile.tile);
+
+      if (it == _tile_ranges.end())
+      {
+        continue;
+      }
+
+      for (std::size_t begin = it->second.first; begin < it->second.second; begin += block_size)
+      {
+        _blocks.push_back({begin, std::min(it->second.second, begin + block_size), tile.in_frustum});
+      }
+    }
+
+    std::fill(_cull_results.begin(), _cull_results.end(), 0);
+
+    // if neither the camera nor the instances moved since last frame, the ones drawn are drawn again
+    bool const reuse_visible = !_rebuilt && !camera_moved;
+
+    util::thread_pool::instance().parallel_for
+      ( _blocks.size()
+      , [&] (std::size_t b)
+        {
+          block const& block = _blocks[b];
+
+          for (std::size_t i = block.begin; i < block.end; ++i)
+          {
+            if (!draw_hidden_models && _models[i]->is_hidden())
+            {
+              continue;
+            }
+
+            float const dist = ModelInstance::renderDistance(_positions[i], _radii[i], camera_pos, display);
+
+            _cull_results[i] = (reuse_visible && _visible[i])
+              || ( ModelInstance::isInRenderDist(dist, _size_cats[i], cull_distance)
+                && (block.in_frustum || frustum.intersects(_extents_max[i], _extents_min[i]))
+                 );
+          }
+        }
+      );
+
+    for (std::size_t i = 0; i < _instances.size(); ++i)
+    {
+      if (_visible[i] && !_cull_results[i])
+      {
+        _instances[i]->_rendered_last_frame = false;
+      }
+    }
+
+    // appended in the order of the tiles, as when they were culled one at a time
+    for (block const& block : _blocks)
+    {
+      for (std::size_t i = block.begin; i < block.end; ++i)
+      {
+        if (!_cull_results[i])
+        {
+          continue;
+        }
+
+        ModelInstance* instance = _instances[i];
+
+        if (_shared[i])
+        {
+          if (instance->frame == _frame)
+          {
+            continue;
+          }
+
+          instance->frame = _frame;
+        }
+
+        models_to_draw[_models[i]].emplace_back(instance->transformMatrix());
+        instance->_rendered_last_frame = true;
+      }
+    }
+
+    _visible.swap(_cull_results);
+    _rebuilt = false;
+  }
+
+  void ModelCullList::clear()
+  {
+    _tiles.clear();
+    _tile_ranges.clear();
+    _pending_models.clear();
+    _models.clear();
+    _instances.clear();
+    _extents_min.clear();
+    _extents_max.clear();
+    _positions.clear();
+    _radii.clear();
+    _size_cats.clear();
+    _shared.clear();
+    _visible.clear();
+    _cull_results.clear();
+    _blocks.clear();
+  }
+}
@@ -0,0 +1,99 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_MODELCULLLIST_HPP
+#define NOGGIT_MODELCULLLIST_HPP
+
+#include <noggit/tool_enums.hpp>
+
+#include <external/glm/glm.hpp>
+#include <external/tsl/robin_map.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace math
+{
+  class frustum;
+}
+
+class AsyncObject;
+class MapTile;
+class Model;
+class ModelInstance;
+
+namespace Noggit::Rendering
+{
+  //! M2 instances of the loaded tiles, laid out tile after tile in flat arrays so that
+  //! culling walks contiguous memory on the thread pool. The list is kept from one frame
+  //! to the next and only rebuilt once instances were added, moved or removed.
+  class ModelCullList
+  {
+  public:
+    struct visible_tile
+    {
+      MapTile* tile;
+      //! the whole tile is in the frustum, its instances are only tested against the distance
+      bool in_frustum;
+    };
+
+    //! rebuilds the list when the instances changed, the loaded tiles aren't the ones
+    //! it was built from or a model it had to leave out finished loading.
+    //! returns whether the list was rebuilt
+    bool update(std::vector<MapTile*> const& tiles, bool instances_changed);
+
+    //! culls the instances of the given tiles and appends the visible ones to the draw list,
+    //! in the order of the tiles. instances of the other tiles are not drawn
+    void cull ( std::vector<visible_tile> const& tiles
+              , math::frustum const& frustum
+              , glm::vec3 const& camera_pos
+              , float cull_distance
+              , display_mode display
+              , bool camera_moved
+              , bool draw_hidden_models
+              , tsl::robin_map<Model*, std::vector<glm::mat4x4>>& models_to_draw
+              );
+
+    //! entries in the list, an instance referenced by several tiles has one per tile
+    std::size_t size() const { return _instances.size(); }
+
+    void clear();
+
+  private:
+    void rebuild(std::vector<MapTile*> const& tiles);
+
+    struct block
+    {
+      std::size_t begin;
+      std::size_t end;
+      bool in_frustum;
+    };
+
+    std::vector<MapTile*> _tiles;
+    tsl::robin_map<MapTile*, std::pair<std::size_t, std::size_t>> _tile_ranges;
+    //! models still loading when the list was built, their instances were left out
+    std::vector<AsyncObject*> _pending_models;
+
+    // one entry per instance and tile referencing it
+    std::vector<Model*> _models;
+    std::vector<ModelInstance*> _instances;
+    std::vector<glm::vec3> _extents_min;
+    std::vector<glm::vec3> _extents_max;
+    std::vector<glm::vec3> _positions;
+    std::vector<float> _radii;
+    std::vector<float> _size_cats;
+    //! the instance is referenced by several tiles, it is only drawn for the first one
+    std::vector<char> _shared;
+    //! drawn last frame, the results of the current one are swapped in once appended
+    std::vector<char> _visible;
+    std::vector<char> _cull_results;
+
+    std::vector<block> _blocks;
+    //! the entries just changed, the results of last frame can't be reused
+    bool _rebuilt = false;
+    //! tells which shared instances were already appended this frame
+    int _frame = 0;
+  };
+}
+
+#endif //NOGGIT_MODELCULLLIST_HPP
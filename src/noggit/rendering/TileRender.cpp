@@ -205,8 +205,7 @@ void TileRender::draw (OpenGL::Scoped::use_program& mcnk_shader
 
         gl.activeTexture(GL_TEXTURE0 + 0);
         gl.bindTexture(GL_TEXTURE_2D, _height_tex);
-        gl.texSubImage2D(GL_TEXTURE_2D, 0, 0, i, mapbufsize, 1, GL_RGBA,
-                         GL_FLOAT, _map_tile->_chunk_heightmap_buffer.data() + i * mapbufsize * 4);
+        chunk->update_heightmap();
       }
 
       if (flags & ChunkUpdateFlags::MCCV)
@@ -272,7 +271,7 @@ void TileRender::draw (OpenGL::Scoped::use_program& mcnk_shader
       chunk->endChunkUpdates();
 
       if (_texture_not_loaded || skip_upload_alphamap)
-        chunk->registerChunkUpdate(ChunkUpdateFlags::ALPHAMAP);
+        chunk->deferChunkUpdate(ChunkUpdateFlags::ALPHAMAP);
 
     }
 
@@ -412,10 +411,13 @@ void TileRender::uploadTextures()
   _chunk_texture_arrays.upload();
   gl.activeTexture(GL_TEXTURE0 + 0);
   gl.bindTexture(GL_TEXTURE_2D, _height_tex);
-  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, mapbufsize,
-                256, 0, GL_RGBA, GL_FLOAT,nullptr);
+  // height bits and packed normal, see MapChunk::update_heightmap
+  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, mapbufsize,
+                256, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
 
+  // integer textures are incomplete with linear filtering
   gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   //gl.texParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   //gl.texParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   //gl.texParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -428,8 +430,8 @@ void TileRender::uploadTextures()
 
   gl.activeTexture(GL_TEXTURE0 + 2);
   gl.bindTexture(GL_TEXTURE_2D, _mccv_tex);
-  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, mapbufsize,
-                256, 0, GL_RGB, GL_FLOAT, nullptr);
+  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mapbufsize,
+                256, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 
   gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   //gl.texParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -441,8 +443,8 @@ void TileRender::uploadTextures()
 
   gl.activeTexture(GL_TEXTURE0 + 4);
   gl.bindTexture(GL_TEXTURE_2D_ARRAY, _alphamap_tex);
-  gl.texImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, 64, 64,
-                256, 0, GL_RGB, GL_FLOAT,nullptr);
+  gl.texImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, 64, 64,
+                256, 0, GL_RGB, GL_UNSIGNED_BYTE,nullptr);
 
   gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -463,6 +465,22 @@ void TileRender::uploadTextures()
   gl.bindTexture(GL_TEXTURE_2D_ARRAY, 0);
 }
 
+std::size_t TileRender::memoryUsage() const
+{
+  if (!_uploaded)
+  {
+    return 0;
+  }
+
+  std::size_t const heightmap = mapbufsize * 256 * 2 * sizeof(std::uint32_t);
+  std::size_t const mccv = mapbufsize * 256 * 4;
+  // drivers usually pad rgb textures to 4 bytes per texel
+  std::size_t const alphamaps = 64 * 64 * 256 * 4;
+  std::size_t const shadows = 64 * 64 * 256;
+
+  return heightmap + mccv + alphamaps + shadows + sizeof(_chunk_instance_data);
+}
+
 void TileRender::doTileOcclusionQuery(OpenGL::Scoped::use_program& occlusion_shader)
 {
   if (_tile_occlusion_query_in_use || !_uploaded)
@@ -73,6 +73,9 @@ namespace Noggit::Rendering
     [[nodiscard]]
     bool alphamapUploadedLastFrame() const;;
     int numUploadedChunkAlphamaps() const;;
+    //! bytes of the terrain textures of the tile, 0 until uploaded
+    [[nodiscard]]
+    std::size_t memoryUsage() const;
 
   private:
 
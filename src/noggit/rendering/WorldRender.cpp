@@ -1,7 +1,6 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "WorldRender.hpp"
-#include <external/PNG2BLP/Png2Blp.h>
 #include <external/tracy/Tracy.hpp>
 #include <math/frustum.hpp>
 #include <noggit/application/Configuration/NoggitApplicationConfiguration.hpp>
@@ -21,11 +20,8 @@
 
 #include <opengl/shader.hpp>
 
-#include <QBuffer>
-#include <QCryptographicHash>
 #include <QDir>
 #include <QListWidget>
-#include <QOpenGLFramebufferObjectFormat>
 #include <QSettings>
 
 #include <algorithm>
@@ -112,13 +108,21 @@ void WorldRender::draw (glm::mat4x4 const& model_view
   if (_need_terrain_params_ubo_update)
     updateTerrainParamsUniformBlock();
 
+  // load what's under the camera first
+  if (!render_settings.minimap_render)
+  {
+    _world->mapIndex.update_loading_priorities(camera_pos, frustum);
+  }
+
   // Frustum culling
   _world->_n_loaded_tiles = 0;
   unsigned tile_counter = 0;
 
   bool modern_features = Noggit::Application::NoggitApplication::instance()->getConfiguration()->modern_features;
 
-  for (MapTile* tile : _world->mapIndex.loaded_tiles())
+  std::vector<MapTile*> const loaded_tiles = _world->mapIndex.loaded_tiles();
+
+  for (MapTile* tile : loaded_tiles)
   {
     tile->_was_rendered_last_frame = false;
 
@@ -387,12 +391,33 @@ void WorldRender::draw (glm::mat4x4 const& model_view
     _sphere_render.draw(mvp, _world->vertexCenter(), cursor_color, 2.f);
   }
 
-  std::unordered_map<Model*, std::size_t> model_with_particles;
-
-  tsl::robin_map<Model*, std::vector<glm::mat4x4>> models_to_draw;
-  std::vector<WMOInstance*> wmos_to_draw;
+  auto& models_to_draw = _models_to_draw;
+  auto& wmos_to_draw = _wmos_to_draw;
   std::unordered_map<Model*, std::size_t> model_boxes_to_draw;
 
+  // only the models drawn last frame are kept, emptied, the other ones may have been unloaded since.
+  // entries are never dereferenced while empty.
+  for (auto it = models_to_draw.begin(); it != models_to_draw.end();)
+  {
+    if (it->second.empty())
+    {
+      it = models_to_draw.erase(it);
+    }
+    else
+    {
+      it.value().clear();
+      ++it;
+    }
+  }
+
+  wmos_to_draw.clear();
+  _model_cull_tiles.clear();
+
+  // the list only changes with the instances or the loaded tiles, not with the camera
+  _model_cull_list.update(loaded_tiles, _world->modelInstancesChanged());
+
+  bool const draw_models = render_settings.draw_models || (render_settings.minimap_render && minimap_render_settings->use_filters);
+
   // frame counter loop. pretty hacky but works
   // this is used to make sure no object is processed more than once within a frame
   static int frame = 0;
@@ -406,214 +431,136 @@ void WorldRender::draw (glm::mat4x4 const& model_view
     frame++;
   }
 
-  for (auto const& pair : _world->_loaded_tiles_buffer)
   {
-    MapTile* tile = pair.second;
+    ZoneScopedN("World::draw() : Gather object instances");
 
-    if (!tile)
+    for (auto const& pair : _world->_loaded_tiles_buffer)
     {
-      break;
-    }
-
-    if (render_settings.minimap_render)
-      tile->renderer()->setOccluded(false);
-
-    if (tile->renderer()->isOccluded() && !tile->getChunkUpdateFlags() && !tile->renderer()->isOverridingOcclusionCulling())
-      continue;
+      MapTile* tile = pair.second;
 
-    // early dist check
-    // TODO: optional
-    if (tile->camDist() > _cull_distance)
-      continue;
+      if (!tile)
+      {
+        break;
+      }
 
+      if (render_settings.minimap_render)
+        tile->renderer()->setOccluded(false);
 
-    // TODO: subject to potential generalization
-    for (auto& pair : tile->getObjectInstances())
-    {
-      if (!pair.first->finishedLoading())
+      if (tile->renderer()->isOccluded() && !tile->getChunkUpdateFlags() && !tile->renderer()->isOverridingOcclusionCulling())
         continue;
 
-      if (pair.second[0]->which() == eMODEL)
-      {
-        if (!render_settings.draw_models && !(render_settings.minimap_render && minimap_render_settings->use_filters))
-        {
-          // can optimize this with a tile.rendered_m2s_lastframe or just check if models are enabled
-          for (auto& instance : pair.second)
-          {
-            instance->_rendered_last_frame = false;
-          }
-          continue;
-        }
-
-        auto& instances = models_to_draw[reinterpret_cast<Model*>(pair.first)];
+      // early dist check
+      // TODO: optional
+      if (tile->camDist() > _cull_distance)
+        continue;
 
-        // memory allocation heuristic. all objects will pass if tile is entirely in frustum.
-        // otherwise we only allocate for a half
+      bool const tile_in_frustum = tile->renderer()->objectsFrustumCullTest() > 1;
 
-        if (tile->renderer()->objectsFrustumCullTest() > 1)
-        {
-          instances.reserve(instances.size() + pair.second.size());
-        }
-        else
-        {
-          instances.reserve(instances.size() + pair.second.size() / 2);
-        }
+      if (draw_models)
+      {
+        _model_cull_tiles.push_back({tile, tile_in_frustum});
+      }
 
+      // M2 instances are culled from the model cull list
+      for (auto& pair : tile->getObjectInstances())
+      {
+        if (!pair.first->finishedLoading())
+          continue;
 
-        for (auto& instance : pair.second)
+        if (pair.second[0]->which() == eWMO)
         {
-          instance->_rendered_last_frame = false;
-
-          // do not render twice the cross-referenced objects twice
-          if (instance->frame == frame)
+          if (!render_settings.draw_wmo)
           {
-            instance->_rendered_last_frame = true;
+            for (auto& instance : pair.second)
+            {
+              instance->_rendered_last_frame = false;
+            }
             continue;
           }
 
-          auto m2_instance = static_cast<ModelInstance*>(instance);
-
-          if (!render_settings.draw_hidden_models && m2_instance->model->is_hidden())
-            continue;
-
-          instance->frame = frame;
-
-          bool render = false;
-          // experimental : if camera and object haven't moved/changed since last frame, we don't need to do frustum culling again
-          if (!render_settings.camera_moved && !m2_instance->extentsDirty()/* && not_moved*/)
+          for (auto& instance : pair.second)
           {
-            if (m2_instance->_rendered_last_frame)
+            // do not render twice the cross-referenced objects twice,
+            // their state is the one of their first occurrence
+            if (instance->frame == frame)
             {
-              render = true; // skip frustum check
+              continue;
             }
-          }
-          if (!render && m2_instance->isInRenderDist(_cull_distance, camera_pos, render_settings.display_mode)
-            && (tile->renderer()->objectsFrustumCullTest() > 1 || m2_instance->isInFrustum(frustum)))
-          {
-            render = true;
-          }
-
-          if (!render)
-            continue;
-
-          instances.emplace_back(m2_instance->transformMatrix());
-          m2_instance->_rendered_last_frame = true;
-
-
-          // if (render && !draw_models_with_box /* && !m2_instance->model->is_hidden()*/)
-          // {
-          //   // model box wasn't set in model draw(), add selection boxes
-          //   if (_world->selected_uids.contains(m2_instance->uid))
-          //     model_boxes_to_draw.emplace(m2_instance->model, instances.size());
-          // }
-
-        }
 
-      }
-      else if (pair.second[0]->which() == eWMO)
-      {
-        if (!render_settings.draw_wmo)
-        {
-          for (auto& instance : pair.second)
-          {
+            bool const rendered_last_frame = instance->_rendered_last_frame;
             instance->_rendered_last_frame = false;
-          }
-          continue;
-        }
 
-        // memory allocation heuristic. all objects will pass if tile is entirely in frustum.
-        // otherwise we only allocate for a half
+            auto wmo_instance = static_cast<WMOInstance*>(instance);
 
-        if (tile->renderer()->objectsFrustumCullTest() > 1)
-        {
-          wmos_to_draw.reserve(wmos_to_draw.size() + pair.second.size());
-        }
-        else
-        {
-          wmos_to_draw.reserve(wmos_to_draw.size() + pair.second.size() / 2);
-        }
-
-        for (auto& instance : pair.second)
-        {
-          instance->_rendered_last_frame = false;
-
-          // do not render twice the cross-referenced objects twice
-          if (instance->frame == frame)
-          {
-            instance->_rendered_last_frame = true;
-            continue;
-          }
-
-          auto wmo_instance = static_cast<WMOInstance*>(instance);
-
-          if (!render_settings.draw_hidden_models && wmo_instance->wmo->is_hidden())
-            continue;
+            if (!render_settings.draw_hidden_models && wmo_instance->wmo->is_hidden())
+              continue;
 
-          instance->frame = frame;
+            instance->frame = frame;
 
-          // experimental : if camera and object haven't moved/changed since last frame, we don't need to do frustum culling again
-          bool render = false;
-          if (!render_settings.camera_moved && !wmo_instance->extentsDirty()/* && not_moved*/)
-          {
-            if (wmo_instance->_rendered_last_frame)
+            // experimental : if camera and object haven't moved/changed since last frame, we don't need to do frustum culling again
+            bool render = false;
+            if (!render_settings.camera_moved && !wmo_instance->extentsDirty()/* && not_moved*/)
             {
-              render = true; // skip visibility checks
+              if (rendered_last_frame)
+              {
+                render = true; // skip visibility checks
+              }
+            }
+            if (!render && (tile_in_frustum || frustum.intersects(wmo_instance->getExtents()[1], wmo_instance->getExtents()[0])))
+            {
+              render = true;
             }
-          }
-          if (!render && tile->renderer()->objectsFrustumCullTest() > 1 || frustum.intersects(wmo_instance->getExtents()[1], wmo_instance->getExtents()[0]))
-          {
-            render = true;
-          }
-
-          if (render)
-          {
-            wmos_to_draw.emplace_back(wmo_instance);
-            wmo_instance->_rendered_last_frame = true;
 
-            if (render_settings.draw_wmo_doodads)
+            if (render)
             {
-              // auto doodads = wmo_instance->get_visible_doodads(frustum, _cull_distance, camera_pos, draw_hidden_models, display);
-              // 
-              // for (auto& doodad : doodads)
-              // {
-              //     if (doodad->frame == frame)
-              //         continue;
-              //     doodad->frame = frame;
-              // 
-              //     auto& instances = models_to_draw[doodad->model.get()];
-              // 
-              //     instances.emplace_back(doodad->transformMatrix());
-              // }
-
-              // doodad->isInFrustum(frustum);
-
-              std::map<uint32_t, std::vector<wmo_doodad_instance>>* doodads = wmo_instance->get_doodads(render_settings.draw_hidden_models);
+              wmos_to_draw.emplace_back(wmo_instance);
+              wmo_instance->_rendered_last_frame = true;
+
+              if (render_settings.draw_wmo_doodads)
+              {
+                // auto doodads = wmo_instance->get_visible_doodads(frustum, _cull_distance, camera_pos, draw_hidden_models, display);
+                // 
+                // for (auto& doodad : doodads)
+                // {
+                //     if (doodad->frame == frame)
+                //         continue;
+                //     doodad->frame = frame;
+                // 
+                //     auto& instances = models_to_draw[doodad->model.get()];
+                // 
+                //     instances.emplace_back(doodad->transformMatrix());
+                // }
+
+                // doodad->isInFrustum(frustum);
+
+                std::map<uint32_t, std::vector<wmo_doodad_instance>>* doodads = wmo_instance->get_doodads(render_settings.draw_hidden_models);
               
-              if (!doodads)
-                continue;
+                if (!doodads)
+                  continue;
               
-              for (auto& pair : *doodads)
-              {
-                for (auto& doodad : pair.second)
+                for (auto& pair : *doodads)
                 {
-                    if (doodad.frame == frame)
-                        continue;
-                    doodad.frame = frame;
+                  for (auto& doodad : pair.second)
+                  {
+                      if (doodad.frame == frame)
+                          continue;
+                      doodad.frame = frame;
 
-                    // skip no geometry boxes for WMO doodads
-                    if (doodad.model->use_fake_geometry())
-                      continue;
+                      // skip no geometry boxes for WMO doodads
+                      if (doodad.model->use_fake_geometry())
+                        continue;
 
-                    // apply size culling to wmo doodads?
-                    float dist = glm::distance(camera_pos, doodad.world_pos) - (doodad.model->bounding_box_radius * doodad.scale);
+                      // apply size culling to wmo doodads?
+                      float dist = glm::distance(camera_pos, doodad.world_pos) - (doodad.model->bounding_box_radius * doodad.scale);
 
-                    if (!doodad.isInRenderDist(_cull_distance, camera_pos, render_settings.display_mode))
-                      continue;
-                    // TODO can check if in indoor group & exterior not hidden for further optimization. possibly check portals relations
+                      if (!doodad.isInRenderDist(_cull_distance, camera_pos, render_settings.display_mode))
+                        continue;
+                      // TODO can check if in indoor group & exterior not hidden for further optimization. possibly check portals relations
               
-                    auto& instances = models_to_draw[doodad.model.get()];
+                      auto& instances = models_to_draw[doodad.model.get()];
               
-                    instances.emplace_back(doodad.transformMatrix());
+                      instances.emplace_back(doodad.transformMatrix());
+                  }
                 }
               }
             }
@@ -623,6 +570,16 @@ void WorldRender::draw (glm::mat4x4 const& model_view
     }
   }
 
+  _model_cull_list.cull ( _model_cull_tiles
+                        , frustum
+                        , camera_pos
+                        , _cull_distance
+                        , render_settings.display_mode
+                        , render_settings.camera_moved
+                        , render_settings.draw_hidden_models
+                        , models_to_draw
+                        );
+
   // WMOs / map objects
   if (render_settings.draw_wmo || _world->mapIndex.hasAGlobalWMO())
   {
@@ -820,6 +777,10 @@ void WorldRender::draw (glm::mat4x4 const& model_view
 
         for (auto const& pair : models_to_draw)
         {
+          // kept from a previous frame, the model may not exist anymore
+          if (pair.second.empty())
+            continue;
+
           bool is_inclusion_filtered = false;
 
           // minimap render inclusion filters
@@ -939,7 +900,6 @@ void WorldRender::draw (glm::mat4x4 const& model_view
     // unsigned int models_todraw_count = models_to_draw.size();
     _world->_n_rendered_objects += wmos_to_draw.size();
 
-    models_to_draw.clear();
     wmos_to_draw.clear();
 
     // draw model boxes with m2 box shader
@@ -1544,6 +1504,7 @@ void WorldRender::unload()
   _wirebox_render.unload();
 
   _horizon_render.reset();
+  _minimap_pipeline.reset();
 
   _liquid_texture_manager.unload();
 
@@ -1553,8 +1514,12 @@ void WorldRender::unload()
   _vertex_arrays.unload();
 
   Noggit::Rendering::Primitives::WireBox::getInstance(_world->_context).unload();
-}
 
+  _models_to_draw.clear();
+  _wmos_to_draw.clear();
+  _model_cull_tiles.clear();
+  _model_cull_list.clear();
+}
 
 void WorldRender::updateMVPUniformBlock(const glm::mat4x4& model_view, const glm::mat4x4& projection)
 {
@@ -1968,14 +1933,13 @@ void WorldRender::drawMinimap ( MapTile *tile
 bool WorldRender::saveMinimap(TileIndex const& tile_idx, MinimapRenderSettings* settings, std::optional<QImage>& combined_image)
 {
   ZoneScoped;
-  // Setup framebuffer
-  QOpenGLFramebufferObjectFormat fmt;
-  fmt.setSamples(0);
-  fmt.setInternalTextureFormat(GL_RGBA8);
-  fmt.setAttachment(QOpenGLFramebufferObject::Depth);
 
-  QOpenGLFramebufferObject pixel_buffer(settings->resolution, settings->resolution, fmt);
-  pixel_buffer.bind();
+  if (!_minimap_pipeline)
+  {
+    _minimap_pipeline = std::make_unique<MinimapPipeline>(_world);
+  }
+
+  _minimap_pipeline->bindFramebuffer(settings->resolution);
 
   gl.viewport(0, 0, settings->resolution, settings->resolution);
   gl.clearColor(.0f, .0f, .0f, 1.f);
@@ -1984,29 +1948,14 @@ bool WorldRender::saveMinimap(TileIndex const& tile_idx, MinimapRenderSettings*
   // Load tile
   bool unload = !_world->mapIndex.has_unsaved_changes(tile_idx);
 
-  if (!_world->mapIndex.tileLoaded(tile_idx) && !_world->mapIndex.tileAwaitingLoading(tile_idx))
-  {
-    MapTile* tile = _world->mapIndex.loadTile(tile_idx);
-    tile->wait_until_loaded();
-    _world->wait_for_all_tile_updates();
-    tile->waitForChildrenLoaded();
-  }
-
-  MapTile* mTile = _world->mapIndex.getTile(tile_idx);
+  MapTile* mTile = _world->mapIndex.loadTile(tile_idx);
 
   if (mTile)
   {
-    unsigned counter = 0;
-    constexpr unsigned TIMEOUT = 5000;
-
-    while (AsyncLoader::instance->is_loading() || !mTile->finishedLoading())
-    {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-      counter++;
-
-      if (counter >= TIMEOUT)
-        break;
-    }
+    // the tile may have been prefetched and still be loading
+    mTile->wait_until_loaded();
+    _world->wait_for_all_tile_updates();
+    mTile->waitForChildrenLoaded();
 
     float max_height = std::max(_world->getMaxTileHeight(tile_idx), 200.f);
 
@@ -2027,8 +1976,6 @@ bool WorldRender::saveMinimap(TileIndex const& tile_idx, MinimapRenderSettings*
         , 0.f, 0.f, 0.f, 1.f
     ));
 
-    glFinish();
-
     drawMinimap(mTile
         , look_at
         , projection
@@ -2042,118 +1989,48 @@ bool WorldRender::saveMinimap(TileIndex const& tile_idx, MinimapRenderSettings*
     gl.clear(GL_COLOR_BUFFER_BIT);
     gl.colorMask(true, true, true, true);
 
-    assert(pixel_buffer.isValid() && pixel_buffer.isBound());
-
-    QImage image = pixel_buffer.toImage();
-
-    image = image.convertToFormat(QImage::Format_RGBA8888);
-
-    QString str = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-    if (!(str.endsWith('\\') || str.endsWith('/')))
-    {
-      str += "/";
-    }
-
-    QString target_dir = QString("/textures/minimap/");
-    if(settings->export_mode == MinimapGenMode::LOD_MAPTEXTURES || settings->export_mode == MinimapGenMode::LOD_MAPTEXTURES_N)
-	{
-	  target_dir = QString("/textures/maptextures/");
-	}
-
-    QDir dir(str + target_dir);
-    if (!dir.exists())
-      dir.mkpath(".");
-
-    std::string tex_name = std::string(_world->basename + "_" + std::to_string(tile_idx.x) + "_" + std::to_string(tile_idx.z) + ".blp");
-    if (settings->export_mode == MinimapGenMode::LOD_MAPTEXTURES_N)
-    {
-        tex_name = std::string(_world->basename + "_" + std::to_string(tile_idx.x) + "_" + std::to_string(tile_idx.z) + "_n.blp");
-    }
-
-    if (settings->file_format == ".png")
-    {
-      image.save(dir.filePath(std::string(_world->basename + "_" + std::to_string(tile_idx.x) + "_" + std::to_string(tile_idx.z) + ".png").c_str()));
-    }
-    else if (settings->file_format == ".blp (DXT1)" || settings->file_format == ".blp (DXT5)")
-    {
-      QByteArray bytes;
-      QBuffer buffer( &bytes );
-      buffer.open( QIODevice::WriteOnly );
-
-      image.save( &buffer, "PNG" );
-
-      auto blp = Png2Blp();
-      blp.load(reinterpret_cast<const void*>(bytes.constData()), bytes.size());
-
-      uint32_t file_size;
-      // void* blp_image = blp.createBlpDxtInMemory(true, FORMAT_DXT5, file_size);
-      // this mirrors blizzards : dxt1, no mipmap
-      void* blp_image = blp.createBlpDxtInMemory(settings->file_format == ".blp (DXT5)" ? true : false, settings->file_format == ".blp (DXT5)" ? FORMAT_DXT5 : FORMAT_DXT1, file_size);
-
-      // converts the texture name to an md5 hash like blizzard, this is used to avoid duplicates textures for ocean
-      // downside is that if the file gets updated regularly there will be a lot of duplicates in the project folder
-      // probably should be a patching option when deploying
-      bool use_md5 = false;
-      if (use_md5)
-      {
-          QCryptographicHash md5_hash(QCryptographicHash::Md5);
-          // auto data = reinterpret_cast<char*>(blp_image);
-          md5_hash.addData(reinterpret_cast<char*>(blp_image), file_size);
-          auto resulthex = md5_hash.result().toHex().toStdString() + ".blp";
-          tex_name = resulthex;
-      }
-
-
-      QFile file(dir.filePath(tex_name.c_str()));
-      file.open(QIODevice::WriteOnly);
-
-      QDataStream out(&file);
-      out.writeRawData(reinterpret_cast<char*>(blp_image), file_size);
+    _minimap_pipeline->readBack(tile_idx, unload, *settings, combined_image);
+  }
 
-      file.close();
-    }
+  _minimap_pipeline->releaseFramebuffer();
 
-    // Write combined file
-    if (settings->combined_minimap && combined_image.has_value())
-    {
-      QImage scaled_image = image.scaled(128, 128,  Qt::KeepAspectRatio);
+  return true;
+}
 
-      for (int i = 0; i < 128; ++i)
-      {
-        for (int j = 0; j < 128; ++j)
-        {
-          combined_image->setPixelColor(static_cast<int>(tile_idx.x) * 128 + j, static_cast<int>(tile_idx.z) * 128 + i, scaled_image.pixelColor(j, i));
-        }
-      }
+void WorldRender::prefetchMinimapTiles(std::vector<TileIndex> const& tiles)
+{
+  if (!_minimap_pipeline)
+  {
+    _minimap_pipeline = std::make_unique<MinimapPipeline>(_world);
+  }
 
-    }
+  _minimap_pipeline->prefetch(tiles);
+}
 
-    // Register in md5translate.trs
-    try
-    {
-        std::string map_name = gMapDB.getByID(_world->mapIndex._map_id).getString(MapDB::InternalName);
-        auto sstream = std::stringstream();
-        sstream << map_name << "\\map" << tile_idx.x << "_" << std::setfill('0') << std::setw(2) << tile_idx.z << ".blp";
-        std::string tilename_left = sstream.str();
-        auto& minimap_md5translate = Noggit::Application::NoggitApplication::instance()->clientData()->_minimap_md5translate;
-        minimap_md5translate[map_name][tilename_left] = tex_name;
-    }
-    catch(MapDB::NotFound)
-    {
-        LogError << "SaveMinimap : Couldn't find entry " << _world->mapIndex._map_id << std::endl;
-        assert(false);
-    }
+void WorldRender::finishMinimaps(std::optional<QImage>& combined_image)
+{
+  ZoneScoped;
 
-    if (unload)
-    {
-      _world->mapIndex.unloadTile(tile_idx);
-    }
+  if (_minimap_pipeline)
+  {
+    _minimap_pipeline->finish(combined_image);
+  }
+}
 
+void WorldRender::saveCombinedMinimap(QImage const& combined_image)
+{
+  QString image_path = QString(std::string(_world->basename + "_combined_minimap.png").c_str());
+  QString str = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
+  if (!(str.endsWith('\\') || str.endsWith('/')))
+  {
+    str += "/";
   }
 
-  pixel_buffer.release();
+  QDir dir(str + "/textures/minimap/");
+  if (!dir.exists())
+    dir.mkpath(".");
 
-  return true;
+  combined_image.save(dir.filePath(image_path));
 }
 
 [[nodiscard]]
@@ -10,12 +10,17 @@
 #include <noggit/tool_enums.hpp>
 #include <noggit/rendering/CursorRender.hpp>
 #include <noggit/rendering/LiquidTextureManager.hpp>
+#include <noggit/rendering/MinimapPipeline.hpp>
+#include <noggit/rendering/ModelCullList.hpp>
 #include <noggit/map_horizon.h>
 #include <noggit/Sky.h>
 
 #include <noggit/rendering/Primitives.hpp>
 
+#include <external/tsl/robin_map.h>
+
 #include <memory>
+#include <vector>
 
 namespace OpenGL
 {
@@ -23,7 +28,9 @@ namespace OpenGL
 }
 
 struct TileIndex;
+class Model;
 class World;
+class WMOInstance;
 struct MinimapRenderSettings;
 
 
@@ -89,9 +96,16 @@ namespace Noggit::Rendering
         , WorldRenderParams const& render_settings
     );
 
+    //! renders the tile, the files are written asynchronously, see finishMinimaps
     bool saveMinimap (TileIndex const& tile_idx
                       , MinimapRenderSettings* settings
                       , std::optional<QImage>& combined_image);
+    //! starts loading the tiles the next saveMinimap calls will render
+    void prefetchMinimapTiles(std::vector<TileIndex> const& tiles);
+    //! waits for every tile passed to saveMinimap to be written and added to combined_image,
+    //! to call before saving md5translate or the combined image
+    void finishMinimaps(std::optional<QImage>& combined_image);
+    void saveCombinedMinimap(QImage const& combined_image);
 
     [[nodiscard]]
     OpenGL::TerrainParamsUniformBlock* getTerrainParamsUniformBlock();;
@@ -180,7 +194,15 @@ namespace Noggit::Rendering
 
     LiquidTextureManager _liquid_texture_manager;
 
+    std::unique_ptr<MinimapPipeline> _minimap_pipeline;
+
     bool _need_terrain_params_ubo_update = false;
+
+    // draw lists, kept from one frame to the next so that their memory is reused
+    tsl::robin_map<Model*, std::vector<glm::mat4x4>> _models_to_draw;
+    std::vector<WMOInstance*> _wmos_to_draw;
+    std::vector<ModelCullList::visible_tile> _model_cull_tiles;
+    ModelCullList _model_cull_list;
   };
 }
 
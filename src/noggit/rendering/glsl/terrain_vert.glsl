@@ -40,7 +40,9 @@ layout (std140) uniform chunk_instances
   ChunkInstanceData instances[256];
 };
 
-uniform sampler2D heightmap;
+// r: bits of the height, g: normal as signed bytes x, y, z scaled by 127
+uniform usampler2D heightmap;
+// MCCV scale, 127 is neutral
 uniform sampler2D mccv;
 uniform int base_instance;
 uniform int animtime;
@@ -150,6 +152,14 @@ float makeNaN(float nonneg)
   return sqrt(-nonneg-1.0);
 }
 
+vec3 unpackNormal(uint bits)
+{
+  return vec3( float(int(bits << 24) >> 24)
+             , float(int(bits << 16) >> 24)
+             , float(int(bits << 8) >> 24)
+             ) / 127.0;
+}
+
 vec2 animUVOffset(int do_animate, int spd, int dir)
 {
   const float texanimxtab[8] = float[8]( 0, 1, 1, 1, 0, -1, -1, -1 );
@@ -168,12 +178,13 @@ void main()
   int t_z = gl_InstanceID % 16;
 
   instanceID = base_instance + (t_x * 16 + t_z);
-  vec4 normal_pos = texelFetch(heightmap, ivec2(gl_VertexID, instanceID), 0);
+  uvec2 height_normal = texelFetch(heightmap, ivec2(gl_VertexID, instanceID), 0).rg;
+  vec3 normal = unpackNormal(height_normal.g);
 
   vec3 pos = vec3(instances[instanceID].ChunkXZ_TileXZ.z * TILESIZE
                       + instances[instanceID].ChunkXZ_TileXZ.x * CHUNKSIZE
                       + position.x
-                    , normal_pos.a
+                    , uintBitsToFloat(height_normal.r)
                     , instances[instanceID].ChunkXZ_TileXZ.w * TILESIZE
                       + instances[instanceID].ChunkXZ_TileXZ.y * CHUNKSIZE
                       + position.y
@@ -186,10 +197,10 @@ void main()
   vec4 pos_after_holecheck = (is_hole ? vec4(NaN, NaN, NaN, 1.0) : vec4(pos, 1.0));
   gl_Position = projection * model_view * pos_after_holecheck;
 
-  vary_normal = normal_pos.rgb;
-  triangle_normal = normal_pos.rgb;
+  vary_normal = normal;
+  triangle_normal = normal;
   vary_position = pos;
-  vary_mccv = texelFetch(mccv, ivec2(gl_VertexID, instanceID), 0).rgb;
+  vary_mccv = texelFetch(mccv, ivec2(gl_VertexID, instanceID), 0).rgb * (255.0 / 127.0);
 
   vary_t0_uv = texcoord + animUVOffset(instances[instanceID].ChunkTexDoAnim.r,
     instances[instanceID].ChunkTexAnimSpeed.r, instances[instanceID].ChunkTexAnimDir.r);
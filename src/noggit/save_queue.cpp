@@ -0,0 +1,246 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/save_queue.hpp>
+#include <noggit/Log.h>
+#include <noggit/project/CurrentProject.hpp>
+
+#include <external/tracy/Tracy.hpp>
+
+#include <ClientData.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+
+namespace Noggit
+{
+  save_queue& save_queue::instance()
+  {
+    static save_queue queue;
+    return queue;
+  }
+
+  save_queue::save_queue()
+    : _thread([this] { process(); })
+  {
+  }
+
+  save_queue::~save_queue()
+  {
+    {
+      std::lock_guard<std::mutex> const lock (_guard);
+      _stop = true;
+    }
+
+    _state_changed.notify_all();
+    _thread.join();
+  }
+
+  std::string save_queue::key_of(std::string const& client_path)
+  {
+    return BlizzardArchive::ClientData::normalizeFilenameInternal(client_path);
+  }
+
+  save_queue::ticket save_queue::write(std::string const& client_path, std::vector<char> data)
+  {
+    return push(client_path, std::make_shared<std::vector<char> const>(std::move(data)));
+  }
+
+  save_queue::ticket save_queue::remove(std::string const& client_path)
+  {
+    return push(client_path, nullptr);
+  }
+
+  std::optional<bool> save_queue::result(ticket operation) const
+  {
+    std::lock_guard<std::mutex> const lock (_guard);
+
+    if (operation > _done_through)
+    {
+      return std::nullopt;
+    }
+
+    return !_failed_tickets.count(operation);
+  }
+
+  save_queue::ticket save_queue::push(std::string const& client_path, std::shared_ptr<std::vector<char> const> data)
+  {
+    ticket queued;
+
+    std::string key = key_of(client_path);
+    // resolved now, the project can't be looked up from the writing thread
+    std::filesystem::path path = std::filesystem::path(Noggit::Project::CurrentProject::get()->ProjectPath) / key;
+
+    {
+      std::lock_guard<std::mutex> const lock (_guard);
+
+      if (_operations.empty() && !_busy)
+      {
+        _batch_start = clock::now();
+      }
+
+      pending_file& pending = _pending[key];
+      pending.operations++;
+      pending.data = data;
+
+      queued = _next_ticket++;
+      _operations.push_back({std::move(key), std::move(path), std::move(data), clock::now(), queued});
+      _batch_total++;
+    }
+
+    _state_changed.notify_all();
+
+    return queued;
+  }
+
+  std::shared_ptr<std::vector<char> const> save_queue::pending(std::string const& client_path) const
+  {
+    std::lock_guard<std::mutex> const lock (_guard);
+
+    auto it = _pending.find(key_of(client_path));
+    return it == _pending.end() ? nullptr : it->second.data;
+  }
+
+  void save_queue::wait_for(std::string const& client_path)
+  {
+    std::string const key = key_of(client_path);
+
+    std::unique_lock<std::mutex> lock (_guard);
+    _state_changed.wait(lock, [&] { return !_pending.count(key); });
+  }
+
+  void save_queue::flush()
+  {
+    std::unique_lock<std::mutex> lock (_guard);
+    _state_changed.wait(lock, [&] { return _operations.empty() && !_busy; });
+  }
+
+  bool save_queue::write_file(operation const& op)
+  {
+    ZoneScoped;
+
+    QString const path = QString::fromStdString(op.path.string());
+
+    if (!QDir().mkpath(QString::fromStdString(op.path.parent_path().string())))
+    {
+      LogError << "Failed to create the directory of " << op.path.string() << std::endl;
+      return false;
+    }
+
+    // QSaveFile writes next to the file and only renames it over the old one on commit
+    QSaveFile file(path);
+
+    if ( !file.open(QIODevice::WriteOnly)
+      || file.write(op.data->data(), static_cast<qint64>(op.data->size())) != static_cast<qint64>(op.data->size())
+      || !file.commit()
+       )
+    {
+      LogError << "Failed to write " << op.path.string() << ": " << file.errorString().toStdString() << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  bool save_queue::remove_file(operation const& op)
+  {
+    QFile file(QString::fromStdString(op.path.string()));
+
+    if (file.exists() && !file.remove())
+    {
+      LogError << "Failed to remove " << op.path.string() << ": " << file.errorString().toStdString() << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  void save_queue::process()
+  {
+    for (;;)
+    {
+      operation op;
+
+      {
+        std::unique_lock<std::mutex> lock (_guard);
+        _state_changed.wait(lock, [&] { return _stop || !_operations.empty(); });
+
+        // the queue is drained even when stopping, nothing queued is lost
+        if (_operations.empty())
+        {
+          return;
+        }
+
+        op = std::move(_operations.front());
+        _operations.pop_front();
+        _busy = true;
+      }
+
+      bool const written = op.data ? write_file(op) : remove_file(op);
+
+      int done, total, failed;
+      std::uint64_t bytes;
+      clock::duration duration, latency;
+      bool idle;
+
+      {
+        std::lock_guard<std::mutex> const lock (_guard);
+
+        auto it = _pending.find(op.key);
+        if (--it->second.operations == 0)
+        {
+          _pending.erase(it);
+        }
+
+        _done_through = op.ticket;
+
+        if (!written)
+        {
+          _failed_tickets.insert(op.ticket);
+        }
+
+        _batch_done++;
+        _batch_failed += !written;
+        _batch_bytes += written && op.data ? op.data->size() : 0;
+        _batch_latency = std::max(_batch_latency, clock::now() - op.queued);
+
+        done = _batch_done;
+        total = _batch_total;
+        failed = _batch_failed;
+        bytes = _batch_bytes;
+        duration = clock::now() - _batch_start;
+        latency = _batch_latency;
+        idle = _operations.empty();
+
+        if (idle)
+        {
+          _batch_total = _batch_done = _batch_failed = 0;
+          _batch_bytes = 0;
+          _batch_latency = clock::duration::zero();
+        }
+
+        _busy = false;
+      }
+
+      _state_changed.notify_all();
+
+      emit progress(done, total);
+
+      if (idle)
+      {
+        auto const to_ms = [] (clock::duration d)
+        {
+          return static_cast<qint64>(std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+        };
+
+        Log << "Saved " << done - failed << " files (" << bytes / 1024 << " KiB) in " << to_ms(duration)
+            << " ms, slowest file took " << to_ms(latency) << " ms from queuing to disk"
+            << (failed ? ", " + std::to_string(failed) + " failed" : "") << "." << std::endl;
+
+        emit finished(done, failed, static_cast<qint64>(bytes), to_ms(duration), to_ms(latency));
+      }
+    }
+  }
+}
@@ -0,0 +1,119 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <QtCore/QObject>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Noggit
+{
+  //! Writes the map files of the project on a background thread once they are
+  //! serialized, so that editing can go on while they hit the disk. Serializing
+  //! them is up to the callers. Every file is
+  //! written to a temporary file next to it and renamed over the old one when
+  //! complete, a crash mid-save leaves the previous version in place.
+  //! Operations on the same file happen in the order they were queued.
+  class save_queue : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    static save_queue& instance();
+
+    save_queue();
+    //! writes everything still queued before returning
+    ~save_queue();
+
+    save_queue(save_queue const&) = delete;
+    save_queue& operator= (save_queue const&) = delete;
+
+    //! identifies a queued operation, they are numbered in the order they were queued
+    using ticket = std::uint64_t;
+
+    //! \a client_path as given to BlizzardArchive::ClientFile, the file is written in the project
+    ticket write(std::string const& client_path, std::vector<char> data);
+    ticket remove(std::string const& client_path);
+
+    //! Nothing while the operation is queued or being done, whether it succeeded
+    //! once done. Callers which consider their data saved on queuing check it to
+    //! flag it again when the write fails.
+    std::optional<bool> result(ticket operation) const;
+
+    //! Content of the last write queued for the file when it isn't on disk yet,
+    //! null otherwise. Meant for readers which can't wait for it.
+    std::shared_ptr<std::vector<char> const> pending(std::string const& client_path) const;
+    //! blocks until the queued operations on the file are done
+    void wait_for(std::string const& client_path);
+    //! blocks until the queue is empty
+    void flush();
+
+  signals:
+    //! \a done files out of the \a total queued since the queue was last empty
+    void progress(int done, int total);
+    //! emitted when the queue becomes empty, \a latency_ms is the longest time
+    //! a file spent between being queued and being on disk
+    void finished(int files, int failed, qint64 bytes, qint64 duration_ms, qint64 latency_ms);
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    struct operation
+    {
+      std::string key;
+      std::filesystem::path path;
+      std::shared_ptr<std::vector<char> const> data; //!< null to remove the file
+      clock::time_point queued;
+      save_queue::ticket ticket;
+    };
+
+    struct pending_file
+    {
+      std::size_t operations = 0;
+      std::shared_ptr<std::vector<char> const> data;
+    };
+
+    ticket push(std::string const& client_path, std::shared_ptr<std::vector<char> const> data);
+    void process();
+
+    static std::string key_of(std::string const& client_path);
+    static bool write_file(operation const& op);
+    static bool remove_file(operation const& op);
+
+    std::mutex mutable _guard;
+    std::condition_variable _state_changed;
+    std::deque<operation> _operations;
+    std::unordered_map<std::string, pending_file> _pending;
+    bool _busy = false;
+    bool _stop = false;
+
+    ticket _next_ticket = 1;
+    //! operations are done one at a time in order, every ticket up to this one is done
+    ticket _done_through = 0;
+    //! failures are rare, they are kept for as long as the queue lives
+    std::unordered_set<ticket> _failed_tickets;
+
+    // statistics of the current batch, reset when the queue runs empty
+    int _batch_total = 0;
+    int _batch_done = 0;
+    int _batch_failed = 0;
+    std::uint64_t _batch_bytes = 0;
+    clock::time_point _batch_start;
+    clock::duration _batch_latency = clock::duration::zero();
+
+    std::thread _thread;
+  };
+}
@@ -3,20 +3,27 @@
 #include <noggit/TextureManager.h>
 
 scoped_blp_texture_reference::scoped_blp_texture_reference(std::string const& filename, Noggit::NoggitRenderContext context)
-  : _blp_texture(TextureManager::_.emplace(filename, context))
+  : scoped_blp_texture_reference(Noggit::file_key_interner::instance().intern(filename), context)
+{
+}
+
+scoped_blp_texture_reference::scoped_blp_texture_reference(Noggit::file_key_id file_key, Noggit::NoggitRenderContext context)
+  : _blp_texture(TextureManager::_.emplace(file_key, context), Deleter{file_key, context})
   , _context(context)
 {
 }
 
 scoped_blp_texture_reference::scoped_blp_texture_reference(scoped_blp_texture_reference const& other)
-  : _blp_texture(other._blp_texture ? TextureManager::_.emplace(other._blp_texture->file_key().filepath(), other._context) : nullptr)
+  : _blp_texture ( other._blp_texture ? TextureManager::_.emplace(other._blp_texture.get_deleter().file_key, other._context) : nullptr
+                 , other._blp_texture.get_deleter()
+                 )
   , _context(other._context)
 {
 }
 
-void scoped_blp_texture_reference::Deleter::operator() (blp_texture* texture) const
+void scoped_blp_texture_reference::Deleter::operator() (blp_texture*) const
 {
-  TextureManager::_.erase(texture->file_key().filepath(), texture->getContext());
+  TextureManager::_.erase(file_key, context);
 }
 
 blp_texture* scoped_blp_texture_reference::operator->() const
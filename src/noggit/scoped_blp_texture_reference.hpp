@@ -3,6 +3,7 @@
 #pragma once
 
 #include <noggit/ContextObject.hpp>
+#include <noggit/file_key_interner.hpp>
 
 #include <memory>
 #include <string>
@@ -26,8 +27,13 @@ struct scoped_blp_texture_reference
 
   bool use_cubemap = false;
 private:
+  scoped_blp_texture_reference(Noggit::file_key_id file_key, Noggit::NoggitRenderContext context);
+
   struct Deleter
   {
+    Noggit::file_key_id file_key;
+    Noggit::NoggitRenderContext context;
+
     void operator() (blp_texture*) const;
   };
   std::unique_ptr<blp_texture, Deleter> _blp_texture;
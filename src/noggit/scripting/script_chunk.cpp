@@ -135,9 +135,10 @@ namespace Noggit
 
     void chunk::clear_colors()
     {
+      glm::vec3* colors = _chunk->getVertexColors();
       std::fill (
-        _chunk->mccv,
-        _chunk->mccv + mapbufsize,
+        colors,
+        colors + mapbufsize,
         glm::vec3 (1.f, 1.f, 1.f)
       );
     }
@@ -7,6 +7,7 @@
 
 #include <noggit/MapView.h>
 #include <noggit/World.h>
+#include <util/thread_pool.hpp>
 
 #include <vector>
 namespace Noggit
@@ -169,6 +170,20 @@ namespace Noggit
       return (std::filesystem::path("scripts") / std::filesystem::path(mod + ".lua")).string();
     }
 
+    std::vector<std::unique_ptr<sol::state>>& script_context::workers()
+    {
+      if (_workers.empty())
+      {
+        // the calling thread takes part in parallel_for too
+        for (std::size_t i = 0; i < util::thread_pool::instance().size() + 1; ++i)
+        {
+          auto& worker = _workers.emplace_back(std::make_unique<sol::state>());
+          worker->open_libraries(sol::lib::base, sol::lib::table, sol::lib::string, sol::lib::math);
+        }
+      }
+      return _workers;
+    }
+
     void script_context::execute_file(std::string const& file)
     {
       auto mod = file_to_module(file);
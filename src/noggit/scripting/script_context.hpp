@@ -7,7 +7,9 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
 
 class World;
 
@@ -32,11 +34,17 @@ namespace Noggit
       void execute_file(std::string const& filename);
       std::string file_to_module(std::string const& file);
       std::string module_to_file(std::string const& module);
+
+      //! Bare states with only the Lua standard libraries, one per thread that can
+      //! take part in a parallel_for, used to evaluate pure functions of the scripts
+      //! in parallel. Created on first use.
+      std::vector<std::unique_ptr<sol::state>>& workers();
     private:
       scripting_tool * _tool;
       std::vector<std::shared_ptr<script_brush>> _scripts;
       std::map<std::string, sol::table> _modules;
       std::vector<std::string> _file_stack;
+      std::vector<std::unique_ptr<sol::state>> _workers;
       int _selected = -1;
     };
 
@@ -75,6 +75,19 @@ namespace Noggit
       get_map()[index] = value;
     }
 
+    sol::as_table_t<std::vector<float>> noisemap::sample(selection& sel, float scale)
+    {
+      static std::string const caller = "noisemap::sample";
+
+      std::vector<float> values;
+      sel.for_each_vert([&](MapChunk* chnk, int index)
+      {
+        glm::vec3 const& pos = chnk->mVertices[index];
+        values.push_back(scale * get_index(caller, std::round(pos.x) - _start_x, std::round(pos.z) - _start_y));
+      });
+      return sol::as_table(std::move(values));
+    }
+
     noisemap::noisemap(
         script_context * ctx
       , unsigned start_x
@@ -189,6 +202,10 @@ namespace Noggit
         , "get", &noisemap::get
         , "is_highest", &noisemap::is_highest
         , "set", &noisemap::set
+        , "sample", sol::overload(
+            &noisemap::sample
+          , &noisemap::sample_1
+          )
         , "start", &noisemap::start
         , "width", &noisemap::width
         , "height", &noisemap::height
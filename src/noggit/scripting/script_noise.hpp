@@ -27,6 +27,11 @@ namespace Noggit
       float get(glm::vec3 &pos);
       bool is_highest(glm::vec3 &pos, int check_radius);
       void set(int x, int y, float value);
+      // values at every vertex of the selection in the order of
+      // selection::heights(), multiplied by scale
+      sol::as_table_t<std::vector<float>> sample(selection& sel, float scale);
+      sol::as_table_t<std::vector<float>> sample_1(selection& sel)
+      { return sample(sel, 1.f); }
       glm::vec3 start();
       unsigned width();
       unsigned height();
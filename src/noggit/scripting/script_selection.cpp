@@ -6,7 +6,12 @@
 #include <noggit/scripting/script_noise.hpp>
 #include <noggit/scripting/scripting_tool.hpp>
 #include <noggit/MapView.h>
+#include <noggit/texture_set.hpp>
 #include <noggit/World.h>
+#include <noggit/World.inl>
+#include <util/thread_pool.hpp>
+
+#include <algorithm>
 
 namespace Noggit
 {
@@ -65,10 +70,28 @@ namespace Noggit
         );
     }
 
-    std::vector<chunk> selection::chunks_raw()
+    std::vector<MapChunk*> selection::map_chunks()
     {
       std::vector<MapChunk*> mapChunks;
-      //_world->select_all_chunks_between(_min, _max, mapChunks); // todo
+      _world->for_all_chunks_in_rect(
+          glm::vec3(_center.x, 0, _center.z)
+        , std::max(_size.x, _size.z) / 2
+        , [&](MapChunk* chnk)
+          {
+            if ( chnk->xbase <= _max.x && chnk->xbase + CHUNKSIZE >= _min.x
+              && chnk->zbase <= _max.z && chnk->zbase + CHUNKSIZE >= _min.z
+               )
+            {
+              mapChunks.push_back(chnk);
+            }
+            return false;
+          });
+      return mapChunks;
+    }
+
+    std::vector<chunk> selection::chunks_raw()
+    {
+      std::vector<MapChunk*> mapChunks = map_chunks();
       std::vector<chunk> chunks;
       chunks.reserve(mapChunks.size());
       for (auto& chnk : mapChunks) chunks.emplace_back(state(), chnk);
@@ -78,18 +101,10 @@ namespace Noggit
     std::vector<vert> selection::verts_raw()
     {
       std::vector<vert> verts;
-      for (auto chunk : chunks_raw())
+      for_each_vert([&](MapChunk* chnk, int index)
       {
-        for (int i = 0; i < mapbufsize; ++i)
-        {
-          auto& v = chunk._chunk->mVertices[i];
-          if (v.x >= _min.x && v.x <= _max.x &&
-            v.z >= _min.z && v.z <= _max.z)
-          {
-            verts.emplace_back(state(),chunk._chunk,i);
-          }
-        }
-      }
+        verts.emplace_back(state(), chnk, index);
+      });
       return verts;
     }
 
@@ -130,6 +145,206 @@ namespace Noggit
       return sol::as_table(models_raw());
     }
 
+    namespace
+    {
+      void check_size(std::string const& caller, sol::table const& values, std::size_t expected)
+      {
+        if (values.size() != expected)
+        {
+          throw script_exception(
+              caller
+            , "expected " + std::to_string(expected)
+            + " values, got " + std::to_string(values.size()));
+        }
+      }
+
+      void check_layer(std::string const& caller, int layer)
+      {
+        if (layer < 0 || layer > 3)
+        {
+          throw script_exception(
+              caller
+            , "invalid texture layer: " + std::to_string(layer));
+        }
+      }
+    }
+
+    sol::as_table_t<std::vector<float>> selection::heights()
+    {
+      std::vector<float> values;
+      for_each_vert([&](MapChunk* chnk, int index)
+      {
+        values.push_back(chnk->mVertices[index].y);
+      });
+      return sol::as_table(std::move(values));
+    }
+
+    void selection::set_heights(sol::table const& values)
+    {
+      std::vector<std::pair<MapChunk*, int>> verts;
+      for_each_vert([&](MapChunk* chnk, int index) { verts.emplace_back(chnk, index); });
+
+      check_size("selection::set_heights", values, verts.size());
+
+      for (std::size_t i = 0; i < verts.size(); ++i)
+      {
+        verts[i].first->mVertices[verts[i].second].y = values.raw_get<float>(i + 1);
+      }
+    }
+
+    sol::as_table_t<std::vector<float>> selection::colors()
+    {
+      std::vector<float> values;
+      for_each_vert([&](MapChunk* chnk, int index)
+      {
+        glm::vec3 const color = chnk->hasColors() ? chnk->getVertexColors()[index] : glm::vec3(1, 1, 1);
+        values.insert(values.end(), {color.r, color.g, color.b});
+      });
+      return sol::as_table(std::move(values));
+    }
+
+    void selection::set_colors(sol::table const& values)
+    {
+      std::vector<std::pair<MapChunk*, int>> verts;
+      for_each_vert([&](MapChunk* chnk, int index) { verts.emplace_back(chnk, index); });
+
+      check_size("selection::set_colors", values, verts.size() * 3);
+
+      for (std::size_t i = 0; i < verts.size(); ++i)
+      {
+        // todo create MCCV
+        verts[i].first->getVertexColors()[verts[i].second] = glm::vec3(
+            values.raw_get<float>(i * 3 + 1)
+          , values.raw_get<float>(i * 3 + 2)
+          , values.raw_get<float>(i * 3 + 3));
+      }
+    }
+
+    sol::as_table_t<std::vector<float>> selection::alphas(int layer)
+    {
+      check_layer("selection::alphas", layer);
+
+      std::vector<float> values;
+      for (MapChunk* chnk : map_chunks())
+      {
+        auto& ts = chnk->texture_set;
+        ts->create_temporary_alphamaps_if_needed();
+        auto const& alphamap = ts->getTempAlphamaps()->map[layer];
+
+        for (int index : texel_indices(chnk, _min, _max))
+        {
+          values.push_back(alphamap[index]);
+        }
+      }
+      return sol::as_table(std::move(values));
+    }
+
+    void selection::set_alphas(int layer, sol::table const& values)
+    {
+      check_layer("selection::set_alphas", layer);
+
+      std::vector<std::pair<MapChunk*, std::vector<int>>> texels;
+      std::size_t count = 0;
+      for (MapChunk* chnk : map_chunks())
+      {
+        auto& indices = texels.emplace_back(chnk, texel_indices(chnk, _min, _max)).second;
+        count += indices.size();
+      }
+
+      check_size("selection::set_alphas", values, count);
+
+      std::size_t i = 1;
+      for (auto& [chnk, indices] : texels)
+      {
+        auto& ts = chnk->texture_set;
+        ts->create_temporary_alphamaps_if_needed();
+        auto& alphamap = ts->getTempAlphamaps()->map[layer];
+
+        for (int index : indices)
+        {
+          alphamap[index] = values.raw_get<float>(i++);
+        }
+      }
+    }
+
+    void selection::transform_heights(sol::protected_function const& fun)
+    {
+      lua_State* L = fun.lua_state();
+      fun.push();
+      if (lua_iscfunction(L, -1))
+      {
+        lua_pop(L, 1);
+        throw script_exception("selection::transform_heights", "expected a lua function");
+      }
+
+      // the first upvalue of a function using globals is the global table,
+      // a loaded chunk gets the one of the worker instead
+      for (int n = 1; char const* name = lua_getupvalue(L, -1, n); ++n)
+      {
+        lua_pop(L, 1);
+        if (n != 1 || std::string(name) != "_ENV")
+        {
+          lua_pop(L, 1);
+          throw script_exception(
+              "selection::transform_heights"
+            , std::string("the function can't use local variables from outside of it: ") + name);
+        }
+      }
+      lua_pop(L, 1);
+
+      sol::bytecode const code = fun.dump();
+      std::vector<MapChunk*> const mapChunks = map_chunks();
+      auto& workers = state()->workers();
+      std::size_t const groups = std::min(mapChunks.size(), workers.size());
+
+      util::thread_pool::instance().parallel_for(groups, [&](std::size_t group)
+      {
+        sol::state& lua = *workers[group];
+        sol::load_result loaded = lua.load(code.as_string_view());
+        if (!loaded.valid())
+        {
+          sol::error err = loaded;
+          throw script_exception("selection::transform_heights", err.what());
+        }
+        sol::protected_function worker_fun = loaded;
+
+        for (std::size_t c = group; c < mapChunks.size(); c += groups)
+        {
+          MapChunk* chnk = mapChunks[c];
+          std::vector<int> const indices = vert_indices(chnk, _min, _max);
+          if (indices.empty())
+          {
+            continue;
+          }
+
+          sol::table heights = lua.create_table(static_cast<int>(indices.size()), 0);
+          sol::table xs = lua.create_table(static_cast<int>(indices.size()), 0);
+          sol::table zs = lua.create_table(static_cast<int>(indices.size()), 0);
+          for (std::size_t i = 0; i < indices.size(); ++i)
+          {
+            glm::vec3 const& v = chnk->mVertices[indices[i]];
+            heights.raw_set(i + 1, v.y);
+            xs.raw_set(i + 1, v.x);
+            zs.raw_set(i + 1, v.z);
+          }
+
+          auto result = worker_fun(heights, xs, zs);
+          if (!result.valid())
+          {
+            sol::error err = result;
+            throw script_exception("selection::transform_heights", err.what());
+          }
+
+          for (std::size_t i = 0; i < indices.size(); ++i)
+          {
+            chnk->mVertices[indices[i]].y = heights.raw_get<float>(i + 1);
+          }
+        }
+
+        lua.collect_garbage();
+      });
+    }
+
     void selection::apply()
     {
       for (auto& chnk : chunks_raw())
@@ -151,6 +366,13 @@ namespace Noggit
         , "models", &selection::models
         , "chunks", &selection::chunks
         , "make_noise", &selection::make_noise
+        , "heights", &selection::heights
+        , "set_heights", &selection::set_heights
+        , "colors", &selection::colors
+        , "set_colors", &selection::set_colors
+        , "alphas", &selection::alphas
+        , "set_alphas", &selection::set_alphas
+        , "transform_heights", &selection::transform_heights
         );
 
       state->set_function("select_origin", [state](
@@ -50,9 +50,38 @@ namespace Noggit
       sol::as_table_t<std::vector<tex>> textures();
       sol::as_table_t<std::vector<model>> models();
 
+      // Bulk views, one value per vertex (three for colors) or texture unit
+      // in the order of verts() and tex(), read or written in a single call.
+      sol::as_table_t<std::vector<float>> heights();
+      void set_heights(sol::table const& values);
+      sol::as_table_t<std::vector<float>> colors();
+      void set_colors(sol::table const& values);
+      sol::as_table_t<std::vector<float>> alphas(int layer);
+      void set_alphas(int layer, sol::table const& values);
+
+      // Calls fun(heights, xs, zs) once per chunk of the selection on the script
+      // workers in parallel, fun edits the heights table in place. fun can only
+      // use the Lua standard library and can't have upvalues.
+      void transform_heights(sol::protected_function const& fun);
+
+      // Calls fun(chunk, vertex index) for each vertex, in the order of verts()
+      template<typename Fun>
+      void for_each_vert(Fun&& fun)
+      {
+        for (MapChunk* chunk : map_chunks())
+        {
+          for (int index : vert_indices(chunk, _min, _max))
+          {
+            fun(chunk, index);
+          }
+        }
+      }
+
       void apply();
     
     private:
+      std::vector<MapChunk*> map_chunks();
+
       World* _world;
       glm::vec3 _center;
       glm::vec3 _min;
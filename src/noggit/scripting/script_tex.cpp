@@ -61,22 +61,36 @@ namespace Noggit {
       return tex_location(_chunk, _index);
     }
 
-    void collect_textures(
-        script_context * ctx
-      , MapChunk* chnk
-      , std::vector<tex>& vec
+    std::vector<int> texel_indices(
+        MapChunk* chnk
       , glm::vec3 const& min
       , glm::vec3 const& max
     )
     {
+      std::vector<int> indices;
       for (int i = 0; i < TEXTURE_UNITS_PER_CHUNK; ++i)
       {
         glm::vec3 loc = tex_location(chnk, i);
         if (loc.x >= min.x && loc.x <= max.x && loc.z >= min.z && loc.z <= max.z)
         {
-          vec.emplace_back(ctx, chnk, i);
+          indices.push_back(i);
         }
       }
+      return indices;
+    }
+
+    void collect_textures(
+        script_context * ctx
+      , MapChunk* chnk
+      , std::vector<tex>& vec
+      , glm::vec3 const& min
+      , glm::vec3 const& max
+    )
+    {
+      for (int i : texel_indices(chnk, min, max))
+      {
+        vec.emplace_back(ctx, chnk, i);
+      }
     }
     
     void register_tex(script_context * state)
@@ -24,6 +24,13 @@ namespace Noggit {
       int _index;
     };
 
+    //! indices of the texture units of the chunk inside min and max on x and z
+    std::vector<int> texel_indices(
+        MapChunk* chnk
+      , glm::vec3 const& min
+      , glm::vec3 const& max
+    );
+
     void collect_textures(
         script_context* ctx
       , MapChunk* chnk
@@ -48,7 +48,7 @@ namespace Noggit
     void vert::set_color(float r, float g, float b)
     {
       // todo create MCCV
-      _chunk->mccv[_index] = glm::vec3(r, g, b);
+      _chunk->getVertexColors()[_index] = glm::vec3(r, g, b);
     }
 
     glm::vec3 vert::get_color()
@@ -59,7 +59,7 @@ namespace Noggit
       }
       else
       {
-        return glm::vec3(_chunk->mccv[_index]);
+        return glm::vec3(_chunk->getVertexColors()[_index]);
       }
     }
 
@@ -161,6 +161,21 @@ namespace Noggit
       return sol::as_table(texVec);
     }
 
+    std::vector<int> vert_indices(MapChunk* chunk, glm::vec3 const& min, glm::vec3 const& max)
+    {
+      std::vector<int> indices;
+      for (int i = 0; i < mapbufsize; ++i)
+      {
+        auto& v = chunk->mVertices[i];
+        if (v.x >= min.x && v.x <= max.x &&
+          v.z >= min.z && v.z <= max.z)
+        {
+          indices.push_back(i);
+        }
+      }
+      return indices;
+    }
+
     void register_vert(script_context * state)
     {
       state->new_usertype<vert>("vert"
@@ -34,6 +34,9 @@ namespace Noggit
       int _index;
     };
 
+    //! indices of the vertices of the chunk inside min and max on x and z
+    std::vector<int> vert_indices(MapChunk* chunk, glm::vec3 const& min, glm::vec3 const& max);
+
     void register_vert(script_context * state);
   } // namespace Scripting
 } // namespace Noggit
@@ -0,0 +1,30 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class MapChunk;
+
+namespace Noggit
+{
+  //! Vertices of one chunk a terrain brush changes and the height they get, kept as
+  //! two parallel arrays. Brush kernels fill it without touching the chunk so the
+  //! kernels of every chunk in range can run concurrently before anything is written.
+  struct terrain_edit_batch
+  {
+    MapChunk* chunk = nullptr;
+    std::vector<std::uint8_t> vertices;
+    std::vector<float> heights;
+
+    void add(int vertex, float height)
+    {
+      vertices.push_back(static_cast<std::uint8_t>(vertex));
+      heights.push_back(height);
+    }
+
+    [[nodiscard]]
+    bool empty() const { return vertices.empty(); }
+  };
+}
@@ -0,0 +1,258 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/texture_brush_kernels.hpp>
+#include <noggit/Brush.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/texture_set.hpp>
+
+#include <cmath>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOGGIT_TEXTURE_BRUSH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Noggit::texture_brush
+{
+  texel_row texel_positions(float base)
+  {
+    texel_row positions;
+    float pos = base;
+
+    for (int i = 0; i < 64; ++i)
+    {
+      positions[i] = pos;
+      pos += TEXDETAILSIZE;
+    }
+
+    return positions;
+  }
+
+  void row_distances(float x, float z, texel_row const& px, float pz, texel_row& distances)
+  {
+    float const zdiff = pz - z;
+    float const zdiff_sq = zdiff * zdiff;
+
+#ifdef NOGGIT_TEXTURE_BRUSH_SSE2
+    __m128 const x4 = _mm_set1_ps(x);
+    __m128 const zdiff_sq4 = _mm_set1_ps(zdiff_sq);
+
+    for (int i = 0; i < 64; i += 4)
+    {
+      __m128 const xdiff = _mm_sub_ps(_mm_loadu_ps(px.data() + i), x4);
+      __m128 const sum = _mm_add_ps(_mm_mul_ps(xdiff, xdiff), zdiff_sq4);
+      _mm_storeu_ps(distances.data() + i, _mm_sqrt_ps(sum));
+    }
+#else
+    for (int i = 0; i < 64; ++i)
+    {
+      float const xdiff = px[i] - x;
+      distances[i] = std::sqrt(xdiff * xdiff + zdiff_sq);
+    }
+#endif
+  }
+
+  void row_shortest_distances(float x, float z, texel_row const& x_positions, float z_pos, texel_row& distances)
+  {
+    // closest point of each texel, same selection as misc::getShortestDist.
+    // when the point is inside the texel the distance formula gives 0 as well
+    float pz;
+    if (z >= z_pos && z < z_pos + TEXDETAILSIZE)
+    {
+      pz = z;
+    }
+    else
+    {
+      pz = (z_pos < z) ? z_pos + TEXDETAILSIZE : z_pos;
+    }
+
+    texel_row px;
+
+#ifdef NOGGIT_TEXTURE_BRUSH_SSE2
+    __m128 const x4 = _mm_set1_ps(x);
+    __m128 const size4 = _mm_set1_ps(TEXDETAILSIZE);
+
+    for (int i = 0; i < 64; i += 4)
+    {
+      __m128 const square_min = _mm_loadu_ps(x_positions.data() + i);
+      __m128 const square_max = _mm_add_ps(square_min, size4);
+      __m128 const inside = _mm_and_ps(_mm_cmpge_ps(x4, square_min), _mm_cmplt_ps(x4, square_max));
+      __m128 const outside = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(square_min, x4), square_max)
+                                      , _mm_andnot_ps(_mm_cmplt_ps(square_min, x4), square_min)
+                                      );
+      _mm_storeu_ps(px.data() + i, _mm_or_ps(_mm_and_ps(inside, x4), _mm_andnot_ps(inside, outside)));
+    }
+#else
+    for (int i = 0; i < 64; ++i)
+    {
+      if (x >= x_positions[i] && x < x_positions[i] + TEXDETAILSIZE)
+      {
+        px[i] = x;
+      }
+      else
+      {
+        px[i] = (x_positions[i] < x) ? x_positions[i] + TEXDETAILSIZE : x_positions[i];
+      }
+    }
+#endif
+
+    row_distances(x, z, px, pz, distances);
+  }
+
+  void row_brush_values(Brush const& brush, texel_row const& distances, texel_row& values)
+  {
+    // same inner and outer radius as Brush::setRadius and Brush::setHardness compute
+    float const radius = brush.getRadius();
+    float const iradius = brush.getHardness() * radius;
+    float const oradius = radius - iradius;
+
+#ifdef NOGGIT_TEXTURE_BRUSH_SSE2
+    __m128 const radius4 = _mm_set1_ps(radius);
+    __m128 const iradius4 = _mm_set1_ps(iradius);
+    __m128 const oradius4 = _mm_set1_ps(oradius);
+    __m128 const one4 = _mm_set1_ps(1.0f);
+
+    for (int i = 0; i < 64; i += 4)
+    {
+      __m128 const dist = _mm_loadu_ps(distances.data() + i);
+      // the falloff is computed for every lane and masked, a division by 0 with
+      // a hardness of 1 only ends up in lanes the scalar code divides as well
+      __m128 const falloff = _mm_sub_ps(one4, _mm_div_ps(_mm_sub_ps(dist, iradius4), oradius4));
+      __m128 const inner = _mm_cmplt_ps(dist, iradius4);
+      __m128 const value = _mm_or_ps(_mm_and_ps(inner, one4), _mm_andnot_ps(inner, falloff));
+      _mm_storeu_ps(values.data() + i, _mm_andnot_ps(_mm_cmpgt_ps(dist, radius4), value));
+    }
+#else
+    for (int i = 0; i < 64; ++i)
+    {
+      values[i] = brush.getValue(distances[i]);
+    }
+#endif
+  }
+
+  bool row_move_alpha(texel_row const& distances, float radius, float* from, float* to)
+  {
+    bool moved = false;
+
+#ifdef NOGGIT_TEXTURE_BRUSH_SSE2
+    __m128 const radius4 = _mm_set1_ps(radius);
+
+    for (int i = 0; i < 64; i += 4)
+    {
+      __m128 const in_brush = _mm_cmple_ps(_mm_loadu_ps(distances.data() + i), radius4);
+
+      if (!_mm_movemask_ps(in_brush))
+      {
+        continue;
+      }
+
+      __m128 const from4 = _mm_loadu_ps(from + i);
+      __m128 const to4 = _mm_loadu_ps(to + i);
+      _mm_storeu_ps(to + i, _mm_or_ps(_mm_and_ps(in_brush, _mm_add_ps(to4, from4)), _mm_andnot_ps(in_brush, to4)));
+      _mm_storeu_ps(from + i, _mm_andnot_ps(in_brush, from4));
+
+      moved = true;
+    }
+#else
+    for (int i = 0; i < 64; ++i)
+    {
+      if (distances[i] <= radius)
+      {
+        to[i] += from[i];
+        from[i] = 0.f;
+
+        moved = true;
+      }
+    }
+#endif
+
+    return moved;
+  }
+
+  void apply_alpha_change( tmp_edit_alpha_values& amaps
+                         , std::size_t offset
+                         , std::array<double, 4>& alpha_values
+                         , double sum_other_alphas
+                         , double alpha_change
+                         , int tex_layer
+                         , std::size_t n_textures
+                         )
+  {
+    if (sum_other_alphas < 1.)
+    {
+      // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
+      if (alpha_change > 0.f)
+      {
+        for (int layer = 0; layer < n_textures; ++layer)
+        {
+          alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
+        }
+      }
+      // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
+      else
+      {
+        bool change_applied = false;
+
+        for (int layer = 0; layer < n_textures; ++layer)
+        {
+          if (layer == tex_layer)
+          {
+            alpha_values[layer] += alpha_change;
+          }
+          else
+          {
+            if (!change_applied)
+            {
+              alpha_values[layer] -= alpha_change;
+            }
+            else
+            {
+              alpha_values[tex_layer] += alpha_values[layer];
+              alpha_values[layer] = 0.;
+            }
+
+            change_applied = true;
+          }
+        }
+      }
+    }
+    else
+    {
+      for (int layer = 0; layer < n_textures; ++layer)
+      {
+        if (layer == tex_layer)
+        {
+          alpha_values[layer] += alpha_change;
+        }
+        else
+        {
+          alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
+
+          // clear values too low to be visible
+          if (alpha_values[layer] < 1.)
+          {
+            alpha_values[tex_layer] += alpha_values[layer];
+            alpha_values[layer] = 0.f;
+          }
+        }
+      }
+    }
+
+    double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
+
+    // failsafe in case the sum of all alpha values deviate
+    if (std::abs(total_final - 255.) > 0.001)
+    {
+      for (double& d : alpha_values)
+      {
+        d = d * 255. / total_final;
+      }
+    }
+
+    for (int n = 0; n < 4; ++n)
+    {
+      amaps[n][offset] = static_cast<float>(alpha_values[n]);
+    }
+  }
+}
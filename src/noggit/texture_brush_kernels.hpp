@@ -0,0 +1,45 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+class Brush;
+struct tmp_edit_alpha_values;
+
+//! Per-row kernels of the texture brushes over the 64x64 texels of a chunk. The SSE2
+//! versions only use IEEE operations in the order of the scalar code they replace
+//! (misc::dist, misc::getShortestDist, Brush::getValue), the results are bit identical.
+namespace Noggit::texture_brush
+{
+  using texel_row = std::array<float, 64>;
+
+  //! texel corners along one axis, accumulated the way the brushes always did
+  texel_row texel_positions(float base);
+
+  //! misc::dist(x, z, px[i], pz) for every texel of a row
+  void row_distances(float x, float z, texel_row const& px, float pz, texel_row& distances);
+
+  //! misc::getShortestDist(x, z, x_positions[i], z_pos, TEXDETAILSIZE) for every texel of a row
+  void row_shortest_distances(float x, float z, texel_row const& x_positions, float z_pos, texel_row& distances);
+
+  //! brush.getValue(distances[i]) for every texel of a row
+  void row_brush_values(Brush const& brush, texel_row const& distances, texel_row& values);
+
+  //! Moves the alpha of every texel of the row within radius from one layer to the other.
+  //! \returns whether any texel was in range
+  bool row_move_alpha(texel_row const& distances, float radius, float* from, float* to);
+
+  //! Moves alpha_change into tex_layer and takes it from the other layers, in double
+  //! for more precision, then writes the 4 layers of the texel at offset. Stays scalar:
+  //! it's a chain of branches over 4 values, SSE2 made the paint loop slower.
+  void apply_alpha_change( tmp_edit_alpha_values& amaps
+                         , std::size_t offset
+                         , std::array<double, 4>& alpha_values
+                         , double sum_other_alphas
+                         , double alpha_change
+                         , int tex_layer
+                         , std::size_t n_textures
+                         );
+}
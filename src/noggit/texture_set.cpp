@@ -5,6 +5,7 @@
 #include <noggit/MapHeaders.h>
 #include <noggit/MapTile.h>
 #include <noggit/Misc.h>
+#include <noggit/texture_brush_kernels.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 
@@ -13,6 +14,7 @@
 #include <QSettings>
 
 #include <algorithm>    // std::min
+#include <cmath>
 #include <sstream>
 
 TextureSet::TextureSet (MapChunk* chunk, BlizzardArchive::ClientFile* f, size_t base
@@ -61,7 +63,8 @@ TextureSet::TextureSet (MapChunk* chunk, BlizzardArchive::ClientFile* f, size_t
       }
     }
 
-    // always use big alpha for editing / rendering
+    // always use big alpha for editing / rendering, the conversion needs every
+    // layer so their values are decoded right away instead of on first use
     if (!use_big_alphamaps && !_do_not_convert_alphamaps)
     {
       convertToBigAlpha();
@@ -513,7 +516,7 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
 
   bool changed = false;
 
-  float zPos, xPos, dist, radius;
+  float zPos, xPos, radius;
 
   int tex_layer = get_texture_index_or_add (std::move (texture), strength);
 
@@ -527,21 +530,34 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
   create_temporary_alphamaps_if_needed();
   auto& amaps = *tmp_edit_values;
 
+  // the bounds test doesn't depend on the other axis, do it once per column and per row
+  std::array<bool, 64> column_in_range;
+  xPos = xbase;
+  for (int i = 0; i < 64; ++i)
+  {
+    column_in_range[i] = !(std::abs(x - (xPos + TEXDETAILSIZE / 2.0)) > radius);
+    xPos += TEXDETAILSIZE;
+  }
+
   zPos = zbase;
 
   for (int j = 0; j < 64; j++)
   {
+    if (std::abs(z - (zPos + TEXDETAILSIZE / 2.0f)) > radius)
+    {
+      zPos += TEXDETAILSIZE;
+      continue;
+    }
+
     xPos = xbase;
     for (int i = 0; i < 64; ++i)
     {
-      if(std::abs(x - (xPos + TEXDETAILSIZE / 2.0)) > radius || std::abs(z - (zPos + TEXDETAILSIZE / 2.0f)) > radius)
+      if (!column_in_range[i])
       {
         xPos += TEXDETAILSIZE;
         continue;
       }
 
-      dist = misc::dist(x, z, xPos + TEXDETAILSIZE / 2.0f, zPos + TEXDETAILSIZE / 2.0f);
-
       glm::vec3 const diff{glm::vec3{xPos + TEXDETAILSIZE / 2.0f, 0.f, zPos + TEXDETAILSIZE / 2.0f} - glm::vec3{x, 0.f, z}};
 
       int pixel_x = std::round(((diff.x + radius) / (2.f * radius)) * image->width());
@@ -566,7 +582,7 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
 
       for (int n = 0; n < 4; ++n)
       {
-        total += alpha_values[n] = amaps[n][i + 64 * j];
+        total += alpha_values[n] = amaps[n][offset];
       }
 
       double current_alpha = alpha_values[tex_layer];
@@ -585,85 +601,9 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
         continue;
       }
 
-      if (sum_other_alphas < 1.)
-      {
-        // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
-        if (alpha_change > 0.f)
-        {
-          for (int layer = 0; layer < nTextures; ++layer)
-          {
-            alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
-          }
-        }
-          // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
-        else
-        {
-          bool change_applied = false;
-
-          for (int layer = 0; layer < nTextures; ++layer)
-          {
-            if (layer == tex_layer)
-            {
-              alpha_values[layer] += alpha_change;
-            }
-            else
-            {
-              if (!change_applied)
-              {
-                alpha_values[layer] -= alpha_change;
-              }
-              else
-              {
-                alpha_values[tex_layer] += alpha_values[layer];
-                alpha_values[layer] = 0.;
-              }
-
-              change_applied = true;
-            }
-          }
-        }
-      }
-      else
-      {
-        for (int layer = 0; layer < nTextures; ++layer)
-        {
-          if (layer == tex_layer)
-          {
-            alpha_values[layer] += alpha_change;
-          }
-          else
-          {
-            alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
-
-            // clear values too low to be visible
-            if (alpha_values[layer] < 1.)
-            {
-              alpha_values[tex_layer] += alpha_values[layer];
-              alpha_values[layer] = 0.f;
-            }
-          }
-        }
-      }
-
-      double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
-
-      // failsafe in case the sum of all alpha values deviate
-      if (std::abs(total_final - 255.) > 0.001)
-      {
-        for (double& d : alpha_values)
-        {
-          d = d * 255. / total_final;
-        }
-      }
-
-      for (int n = 0; n < 4; ++n)
-      {
-        amaps[n][i + 64 * j] = static_cast<float>(alpha_values[n]);
-      }
-
+      Noggit::texture_brush::apply_alpha_change(amaps, offset, alpha_values, sum_other_alphas, alpha_change, tex_layer, nTextures);
       changed = true;
 
-
       xPos += TEXDETAILSIZE;
     }
     zPos += TEXDETAILSIZE;
@@ -800,7 +740,7 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
 {
   bool changed = false;
 
-  float zPos, xPos, dist, radius;
+  float zPos, radius;
 
   // todo: investigate the root cause
   // shift brush origin to avoid disconnects at the chunks' borders
@@ -842,16 +782,19 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
   create_temporary_alphamaps_if_needed();
   auto& amaps = *tmp_edit_values;
 
+  auto const x_positions = Noggit::texture_brush::texel_positions(xbase);
+  Noggit::texture_brush::texel_row distances, brush_values;
+
   zPos = zbase;
 
   for (int j = 0; j < 64; j++)
   {
-    xPos = xbase;
+    Noggit::texture_brush::row_shortest_distances(x, z, x_positions, zPos, distances);
+    Noggit::texture_brush::row_brush_values(*brush, distances, brush_values);
+
     for (int i = 0; i < 64; ++i)
     {
-      dist = misc::getShortestDist(x, z, xPos, zPos, TEXDETAILSIZE);
-
-      if (dist <= radius)
+      if (distances[i] <= radius)
       {
         std::size_t offset = i + 64 * j;
         // use double for more precision
@@ -860,12 +803,12 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
 
         for (int n = 0; n < 4; ++n)
         {
-          total += alpha_values[n] = amaps[n][i + 64 * j];
+          total += alpha_values[n] = amaps[n][offset];
         }
 
         double current_alpha = alpha_values[tex_layer];
         double sum_other_alphas = (total - current_alpha);
-        double alpha_change = (strength - current_alpha) * pressure * brush->getValue(dist);
+        double alpha_change = (strength - current_alpha) * pressure * brush_values[i];
 
         // alpha too low, set it to 0 directly
         if (alpha_change < 0. && current_alpha + alpha_change < 1.)
@@ -875,87 +818,10 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
 
         if (!misc::float_equals(current_alpha, strength))
         {
-          if (sum_other_alphas < 1.)
-          {
-            // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
-            if (alpha_change > 0.f)
-            {
-              for (int layer = 0; layer < nTextures; ++layer)
-              {
-                alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
-              }
-            }
-            // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
-            else
-            {
-              bool change_applied = false;
-
-              for (int layer = 0; layer < nTextures; ++layer)
-              {
-                if (layer == tex_layer)
-                {
-                  alpha_values[layer] += alpha_change;
-                }
-                else
-                {
-                  if (!change_applied)
-                  {
-                    alpha_values[layer] -= alpha_change;
-                  }
-                  else
-                  {
-                    alpha_values[tex_layer] += alpha_values[layer];
-                    alpha_values[layer] = 0.;
-                  }
-
-                  change_applied = true;
-                }
-              }
-            }
-          }
-          else
-          {
-            for (int layer = 0; layer < nTextures; ++layer)
-            {
-              if (layer == tex_layer)
-              {
-                alpha_values[layer] += alpha_change;
-              }
-              else
-              {
-                alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
-
-                // clear values too low to be visible
-                if (alpha_values[layer] < 1.)
-                {
-                  alpha_values[tex_layer] += alpha_values[layer];
-                  alpha_values[layer] = 0.f;
-                }
-              }
-            }
-          }
-
-          double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
-
-          // failsafe in case the sum of all alpha values deviate
-          if (std::abs(total_final - 255.) > 0.001)
-          {
-            for (double& d : alpha_values)
-            {
-              d = d * 255. / total_final;
-            }
-          }
-
-          for (int n = 0; n < 4; ++n)
-          {
-            amaps[n][i + 64 * j] = static_cast<float>(alpha_values[n]);
-          }
-
+          Noggit::texture_brush::apply_alpha_change(amaps, offset, alpha_values, sum_other_alphas, alpha_change, tex_layer, nTextures);
           changed = true;
         }
       }
-
-      xPos += TEXDETAILSIZE;
     }
     zPos += TEXDETAILSIZE;
   }
@@ -1008,7 +874,7 @@ bool TextureSet::replace_texture( float xbase
 
   bool changed = false;
   int old_tex_level = -1, new_tex_level = -1;
-  float x_pos, z_pos = zbase;
+  float z_pos = zbase;
 
   for (int i=0; i<nTextures; ++i)
   {
@@ -1040,25 +906,21 @@ bool TextureSet::replace_texture( float xbase
   create_temporary_alphamaps_if_needed();
   auto& amap = *tmp_edit_values;
 
-  for (int j = 0; j < 64; j++)
+  Noggit::texture_brush::texel_row x_centers = Noggit::texture_brush::texel_positions(xbase);
+  for (float& x_center : x_centers)
   {
-    x_pos = xbase;
-    for (int i = 0; i < 64; ++i)
-    {
-      dist = misc::dist(x, z, x_pos + TEXDETAILSIZE / 2.0f, z_pos + TEXDETAILSIZE / 2.0f);
-
-      if (dist <= radius)
-      {
-        int offset = j * 64 + i;
+    x_center += TEXDETAILSIZE / 2.0f;
+  }
 
-        amap[new_tex_level][offset] += amap[old_tex_level][offset];
-        amap[old_tex_level][offset] = 0.f;
+  Noggit::texture_brush::texel_row distances;
 
-        changed = true;
-      }
+  for (int j = 0; j < 64; j++)
+  {
+    Noggit::texture_brush::row_distances(x, z, x_centers, z_pos + TEXDETAILSIZE / 2.0f, distances);
 
-      x_pos += TEXDETAILSIZE;
-    }
+    float* old_values = amap[old_tex_level].data() + j * 64;
+    float* new_values = amap[new_tex_level].data() + j * 64;
+    changed |= Noggit::texture_brush::row_move_alpha(distances, radius, old_values, new_values);
 
     z_pos += TEXDETAILSIZE;
   }
@@ -1345,6 +1207,18 @@ bool TextureSet::removeDuplicate()
   return changed;
 }
 
+std::size_t TextureSet::memoryUsage() const
+{
+  std::size_t usage = tmp_edit_values ? sizeof(tmp_edit_alpha_values) : 0;
+
+  for (auto const& alphamap : alphamaps)
+  {
+    usage += alphamap ? alphamap->memoryUsage() : 0;
+  }
+
+  return usage;
+}
+
 void TextureSet::uploadAlphamapData()
 {
   // This method assumes tile's alphamap storage is currently bound to the current texture unit
@@ -1352,8 +1226,8 @@ void TextureSet::uploadAlphamapData()
   if (!(_chunk->getUpdateFlags() & ChunkUpdateFlags::ALPHAMAP) || !nTextures)
     return;
 
-  static std::array<float, 3 * 64 * 64> amap{};
-  std::fill(amap.begin(), amap.end(), 0.0f);
+  // uploaded as bytes, the texture holds 8 bits per layer anyway
+  std::array<std::uint8_t, 3 * 64 * 64> amap{};
 
   if (tmp_edit_values)
   {
@@ -1363,9 +1237,8 @@ void TextureSet::uploadAlphamapData()
     {
       for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
       {
-        // amap[i * 3 + alpha_id] = (alpha_id < nTextures - 1) ? tmp_amaps[alpha_id + 1][i] / 255.f : 0.f;
         if (alpha_id < nTextures - 1)
-          amap[i * 3 + alpha_id] = tmp_amaps[alpha_id + 1][i] / 255.f;
+          amap[i * 3 + alpha_id] = static_cast<std::uint8_t>(std::lround(std::clamp(tmp_amaps[alpha_id + 1][i], 0.f, 255.f)));
       }
     }
   }
@@ -1384,7 +1257,7 @@ void TextureSet::uploadAlphamapData()
       {
           if (alpha_id < nTextures - 1)
           {
-              amap[i * 3 + alpha_id] = static_cast<float>(*(alpha_ptr[alpha_id]++)) / 255.0f;
+              amap[i * 3 + alpha_id] = *(alpha_ptr[alpha_id]++);
           }
           // else
           // {
@@ -1396,7 +1269,7 @@ void TextureSet::uploadAlphamapData()
   }
 
   gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, _chunk->px * 16 + _chunk->py,
-                   64, 64, 1, GL_RGB, GL_FLOAT, amap.data());
+                   64, 64, 1, GL_RGB, GL_UNSIGNED_BYTE, amap.data());
 
 }
 
@@ -1649,27 +1522,13 @@ bool TextureSet::apply_alpha_changes()
     return false;
   }
 
-  auto& new_amaps = *tmp_edit_values;
   std::array<std::uint16_t, 64 * 64> totals;
   totals.fill(0);
 
   for (int alpha_layer = 0; alpha_layer < nTextures - 1; ++alpha_layer)
   {
     std::array<std::uint8_t, 64 * 64> values;
-
-    for (int i = 0; i < 64 * 64; ++i)
-    {
-      values[i] = float_alpha_to_uint8(new_amaps[alpha_layer + 1][i]);
-      totals[i] += values[i];
-
-      // remove the possible overflow with rounding
-      // max 2 if all 4 values round up so it won't change the layer's alpha much
-      if (totals[i] > 255)
-      {
-        values[i] -= static_cast<std::uint8_t>(totals[i] - 255);
-      }
-    }
-
+    round_pending_alpha(alpha_layer, values, totals);
     alphamaps[alpha_layer]->setAlpha(values.data());
   }
 
@@ -1681,6 +1540,56 @@ bool TextureSet::apply_alpha_changes()
   return true;
 }
 
+void TextureSet::round_pending_alpha(std::size_t alpha_layer, std::array<std::uint8_t, 64 * 64>& values, std::array<std::uint16_t, 64 * 64>& totals) const
+{
+  auto const& new_amaps = tmp_edit_values->map;
+
+  for (int i = 0; i < 64 * 64; ++i)
+  {
+    values[i] = float_alpha_to_uint8(new_amaps[alpha_layer + 1][i]);
+    totals[i] += values[i];
+
+    // remove the possible overflow with rounding
+    // max 2 if all 4 values round up so it won't change the layer's alpha much
+    if (totals[i] > 255)
+    {
+      values[i] -= static_cast<std::uint8_t>(totals[i] - 255);
+    }
+  }
+}
+
+std::array<std::array<std::uint8_t, 64 * 64>, 3> TextureSet::alphamap_values() const
+{
+  std::array<std::array<std::uint8_t, 64 * 64>, 3> values;
+  std::array<std::uint16_t, 64 * 64> totals;
+  totals.fill(0);
+
+  bool const pending = tmp_edit_values && nTextures >= 2;
+
+  for (std::size_t alpha_layer = 0; alpha_layer < values.size(); ++alpha_layer)
+  {
+    auto& layer = values[alpha_layer];
+
+    if (pending && alpha_layer + 1 < nTextures)
+    {
+      round_pending_alpha(alpha_layer, layer, totals);
+    }
+    else if (alphamaps[alpha_layer])
+    {
+      for (int i = 0; i < 64 * 64; ++i)
+      {
+        layer[i] = alphamaps[alpha_layer]->getAlpha(i);
+      }
+    }
+    else
+    {
+      layer.fill(0);
+    }
+  }
+
+  return values;
+}
+
 void TextureSet::create_temporary_alphamaps_if_needed()
 {
   if (tmp_edit_values || nTextures < 2)
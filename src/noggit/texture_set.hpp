@@ -88,8 +88,13 @@ public:
   int texture_id(scoped_blp_texture_reference const& texture);
 
   void uploadAlphamapData();
+  //! bytes of the alphamaps and of their temporary editing copy
+  std::size_t memoryUsage() const;
 
   bool apply_alpha_changes();
+  //! the 3 alphamaps as apply_alpha_changes would leave them, without modifying the set.
+  //! Layers the chunk doesn't have are 0. Safe to call from other threads while the chunk isn't edited.
+  std::array<std::array<std::uint8_t, 64 * 64>, 3> alphamap_values() const;
 
   void create_temporary_alphamaps_if_needed();
 
@@ -130,6 +135,8 @@ public:
 private:
 
   uint8_t sum_alpha(size_t offset) const;
+  //! rounds the pending values of an alpha layer, the layers have to be rounded in order
+  void round_pending_alpha(std::size_t alpha_layer, std::array<std::uint8_t, 64 * 64>& values, std::array<std::uint16_t, 64 * 64>& totals) const;
 
   void alphas_to_big_alpha(uint8_t* dest);
   void alphas_to_old_alpha(uint8_t* dest);
@@ -20,6 +20,12 @@
 
 namespace Noggit
 {
+    namespace
+    {
+        // tiles loading in the background while one renders
+        constexpr std::size_t minimap_prefetch_count = 4;
+    }
+
     MinimapTool::MinimapTool(MapView* mapView)
         : Tool{ mapView }
     {
@@ -112,6 +118,13 @@ namespace Noggit
             QObject::connect(cancel_btn, &QPushButton::clicked,
                 [=]
                 {
+                    {
+                        // let the tiles already rendered be written
+                        OpenGL::context::scoped_setter const _(::gl, mv->context());
+                        mv->makeCurrent();
+                        world->renderer()->finishMinimaps(_mmap_combined_image);
+                    }
+
                     _mmap_async_index = 0;
                     _mmap_render_index = 0;
                     saving_minimap = false;
@@ -153,6 +166,24 @@ namespace Noggit
                 {
                     OpenGL::context::scoped_setter const _(::gl, mv->context());
                     mv->makeCurrent();
+
+                    // load the next tiles while this one renders
+                    std::vector<TileIndex> next_tiles;
+                    bool const selected_only = settings->export_mode == MinimapGenMode::SELECTED_ADTS;
+                    auto selected_tiles = _minimapTool->getSelectedTiles();
+
+                    for (unsigned i = _mmap_async_index + 1; i < 4096 && next_tiles.size() < minimap_prefetch_count; ++i)
+                    {
+                        TileIndex const next_tile (i / 64, i % 64);
+
+                        if (world->mapIndex.hasTile(next_tile) && (!selected_only || selected_tiles->at(i)))
+                        {
+                            next_tiles.push_back(next_tile);
+                        }
+                    }
+
+                    world->renderer()->prefetchMinimapTiles(next_tiles);
+
                     mmap_render_success = world->renderer()->saveMinimap(tile, settings, _mmap_combined_image);
 
                     _mmap_render_index++;
@@ -175,6 +206,7 @@ namespace Noggit
             if (world->mapIndex.hasTile(tile))
             {
                 mmap_render_success = world->renderer()->saveMinimap(tile, settings, _mmap_combined_image);
+                world->renderer()->finishMinimaps(_mmap_combined_image);
             }
 
             if (mmap_render_success)
@@ -292,6 +324,8 @@ namespace Noggit
 
     void MinimapTool::finishSaving(QProgressBar* progress, QPushButton* cancel_btn, World* world, MinimapRenderSettings* settings)
     {
+        world->renderer()->finishMinimaps(_mmap_combined_image);
+
         _mmap_async_index = 0;
         _mmap_render_index = 0;
         saving_minimap = false;
@@ -302,18 +336,7 @@ namespace Noggit
         // save combined minimap
         if (settings->combined_minimap)
         {
-            QString image_path = QString(std::string(world->basename + "_combined_minimap.png").c_str());
-            QString str = QString(Noggit::Project::CurrentProject::get()->ProjectPath.c_str());
-            if (!(str.endsWith('\\') || str.endsWith('/')))
-            {
-                str += "/";
-            }
-
-            QDir dir(str + "/textures/minimap/");
-            if (!dir.exists())
-                dir.mkpath(".");
-
-            _mmap_combined_image->save(dir.filePath(image_path));
+            world->renderer()->saveCombinedMinimap(*_mmap_combined_image);
             _mmap_combined_image.reset();
         }
     }
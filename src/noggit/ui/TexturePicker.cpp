@@ -229,6 +229,7 @@ namespace Noggit
 
       if (set_changed)
       {
+        _chunk->markDirty(ChunkUpdateFlags::ALPHAMAP | ChunkUpdateFlags::FLAGS);
         _chunk->mt->changed = true;
       }
 
@@ -33,12 +33,28 @@ namespace Noggit
       {
         if (role == Qt::DecorationRole)
         {
-          if (!_rendered)
+          if (!_rendered && model())
           {
             //! \note The one time Qt is const correct and we don't want that.
             auto that (const_cast<model_item*> (this));
             that->_rendered = true;
-            that->_pixmap = *BLPRenderer::getInstance().render_blp_to_pixmap (data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString(), 256, 256);
+
+            // filled in once decoded, through the model in case the item is gone
+            auto const set_pixmap = [item_model = model(), index = QPersistentModelIndex (index())] (QPixmap const& pixmap)
+            {
+              if (index.isValid())
+              {
+                auto item (static_cast<model_item*> (item_model->itemFromIndex (index)));
+                item->_pixmap = pixmap;
+                item->emitDataChanged();
+              }
+            };
+
+            if (auto pixmap = BLPRenderer::getInstance().request_blp_pixmap
+                  (data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString(), 256, 256, model(), set_pixmap))
+            {
+              that->_pixmap = *pixmap;
+            }
           }
           return QIcon(_pixmap);
         }
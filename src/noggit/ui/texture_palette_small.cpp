@@ -173,8 +173,25 @@ namespace Noggit
       _texture_paths.emplace(display_name.toStdString());
 
       QListWidgetItem* list_item = new QListWidgetItem(_texture_list);
-      list_item->setIcon(*BLPRenderer::getInstance().render_blp_to_pixmap(filename, _texture_list->iconSize().width(), _texture_list->iconSize().height()));
       list_item->setToolTip(display_name);
+
+      auto set_icon = [list = _texture_list, display_name] (QPixmap const& pixmap)
+      {
+        // the item may have been removed meanwhile
+        for (int i = 0; i < list->count(); ++i)
+        {
+          if (list->item(i)->toolTip() == display_name)
+          {
+            list->item(i)->setIcon(pixmap);
+          }
+        }
+      };
+
+      if (auto pixmap = BLPRenderer::getInstance().request_blp_pixmap
+            (filename, _texture_list->iconSize().width(), _texture_list->iconSize().height(), _texture_list, set_icon))
+      {
+        list_item->setIcon(*pixmap);
+      }
       list_item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled);
 
       _texture_list->addItem(list_item);
@@ -24,7 +24,6 @@ ActionHistoryNavigator::ActionHistoryNavigator(QWidget* parent)
 
   auto layout = new QVBoxLayout(this);
 
-  unsigned int limit = action_mgr->limit();
   _stack_size_label = new QLabel(this);
 
   layout->addWidget(_stack_size_label);
@@ -207,9 +206,11 @@ void ActionHistoryNavigator::changeCurrentAction(unsigned index)
 void Noggit::Ui::Tools::ActionHistoryNavigator::updateStackSizeLabel()
 {
     auto action_mgr = NOGGIT_ACTION_MGR;
-    unsigned int limit = action_mgr->limit();
     auto stack_size = _action_stack->count(); // action_mgr->_action_stack.size()
 
-    QString labelText = QString("Action stack size : %1/%2").arg(stack_size).arg(limit);
+    QString labelText = QString("Action stack size : %1 (%2/%3 MB)")
+      .arg(stack_size)
+      .arg(action_mgr->memoryUsage() / (1024.0 * 1024.0), 0, 'f', 1)
+      .arg(action_mgr->memoryBudget() / (1024 * 1024));
     _stack_size_label->setText(labelText);
 }
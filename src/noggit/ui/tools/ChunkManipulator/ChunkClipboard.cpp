@@ -150,13 +150,13 @@ void ChunkClipboard::copySelected(glm::vec3 const& pos, ChunkCopyFlags flags)
     if (static_cast<unsigned>(flags) & static_cast<unsigned>(ChunkCopyFlags::VERTEX_COLORS))
     {
       chunk_cache.vertex_colors = std::array<char, 145 * 3 * sizeof(float)>{};
-      std::memcpy(chunk_cache.vertex_colors->data(), &chunk->mccv, 145 * 3 * sizeof(float));
+      std::memcpy(chunk_cache.vertex_colors->data(), chunk->getVertexColors(), 145 * 3 * sizeof(float));
     }
 
     if (static_cast<unsigned>(flags) & static_cast<unsigned>(ChunkCopyFlags::SHADOWS))
     {
       chunk_cache.shadows = std::array<std::uint8_t, 64 * 64>{};
-      std::memcpy(chunk_cache.shadows->data(), &chunk->_shadow_map, 64 * 64 * sizeof(std::uint8_t));
+      std::memcpy(chunk_cache.shadows->data(), chunk->shadow_map(), 64 * 64 * sizeof(std::uint8_t));
     }
 
     if (static_cast<unsigned>(flags) & static_cast<unsigned>(ChunkCopyFlags::LIQUID))
@@ -7,6 +7,7 @@
 #include <noggit/ui/tools/NodeEditor/Nodes/Scene/NodesContext.hpp>
 #include <noggit/ActionManager.hpp>
 #include <noggit/Action.hpp>
+#include <noggit/World.h>
 
 #include <external/NodeEditor/include/nodes/Node>
 
@@ -28,10 +29,12 @@ ObjectInstanceSetPositionNode::ObjectInstanceSetPositionNode()
 
 void ObjectInstanceSetPositionNode::compute()
 {
+  World* world = gCurrentContext->getWorld();
   gCurrentContext->getViewport()->makeCurrent();
   OpenGL::context::scoped_setter const _ (::gl, gCurrentContext->getViewport()->context());
 
   SceneObject* obj = defaultPortData<ObjectInstanceData>(PortType::In, 1)->value();
+  world->updateTilesEntry(obj, model_update::remove);
   NOGGIT_CUR_ACTION->registerObjectTransformed(obj);
 
   auto pos_data = defaultPortData<Vector3DData>(PortType::In, 2);
@@ -42,6 +45,7 @@ void ObjectInstanceSetPositionNode::compute()
   obj->pos.z = position.z;
 
   obj->recalcExtents();
+  world->updateTilesEntry(obj, model_update::add);
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
@@ -7,6 +7,7 @@
 #include <noggit/ui/tools/NodeEditor/Nodes/Scene/NodesContext.hpp>
 #include <noggit/ActionManager.hpp>
 #include <noggit/Action.hpp>
+#include <noggit/World.h>
 
 #include <external/NodeEditor/include/nodes/Node>
 
@@ -33,6 +34,7 @@ void ObjectInstanceSetRotationNode::compute()
   OpenGL::context::scoped_setter const _ (::gl, gCurrentContext->getViewport()->context());
 
   SceneObject* obj = defaultPortData<ObjectInstanceData>(PortType::In, 1)->value();
+  world->updateTilesEntry(obj, model_update::remove);
   NOGGIT_CUR_ACTION->registerObjectTransformed(obj);
   auto rot_data = defaultPortData<Vector3DData>(PortType::In, 2);
   glm::vec3 const& rotation = rot_data->value();
@@ -42,6 +44,7 @@ void ObjectInstanceSetRotationNode::compute()
   obj->dir.z = math::degrees(rotation.z)._;
 
   obj->recalcExtents();
+  world->updateTilesEntry(obj, model_update::add);
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
@@ -7,6 +7,7 @@
 #include <noggit/ui/tools/NodeEditor/Nodes/Scene/NodesContext.hpp>
 #include <noggit/ActionManager.hpp>
 #include <noggit/Action.hpp>
+#include <noggit/World.h>
 #include <noggit/application/NoggitApplication.hpp>
 
 #include <external/NodeEditor/include/nodes/Node>
@@ -43,6 +44,8 @@ void ObjectInstanceSetScaleNode::compute()
     return;
   }
 
+  world->updateTilesEntry(obj, model_update::remove);
+
   if (obj->which() == eWMO)
   {
       bool modern_features = Noggit::Application::NoggitApplication::instance()->getConfiguration()->modern_features;
@@ -60,6 +63,7 @@ void ObjectInstanceSetScaleNode::compute()
   }
 
   obj->recalcExtents();
+  world->updateTilesEntry(obj, model_update::add);
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
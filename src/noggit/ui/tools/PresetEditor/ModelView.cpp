@@ -176,6 +176,7 @@ void ModelViewer::tick(float dt)
   {
     _world->mapIndex.enterTile (TileIndex (_world_camera.position));
     _world->mapIndex.unloadTiles (TileIndex (_world_camera.position));
+    _world->mapIndex.releaseRetiredTiles();
   }
 
   AssetBrowser::ModelViewer::tick(dt);
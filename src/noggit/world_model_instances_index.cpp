@@ -0,0 +1,385 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/world_model_instances_index.hpp>
+#include <noggit/AsyncObject.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/SceneObject.hpp>
+#include <math/frustum.hpp>
+#include <math/ray.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace Noggit
+{
+  namespace
+  {
+    constexpr float cell_size = TILESIZE / 4.f;
+  }
+
+  void world_model_instances_index::bounds::add(std::array<glm::vec3, 2> const& other)
+  {
+    if (empty)
+    {
+      extents = other;
+      empty = false;
+    }
+    else
+    {
+      extents[0] = glm::min(extents[0], other[0]);
+      extents[1] = glm::max(extents[1], other[1]);
+    }
+  }
+
+  world_model_instances_index::world_model_instances_index()
+    : _cells(cells_per_side * cells_per_side)
+    , _blocks(blocks_per_side * blocks_per_side)
+  {
+    static_assert(cells_per_side * cell_size > 64 * TILESIZE - 1.f, "the grid must cover the whole map");
+  }
+
+  int world_model_instances_index::cell_coord(float pos)
+  {
+    return std::clamp(static_cast<int>(std::floor(pos / cell_size)), 0, cells_per_side - 1);
+  }
+
+  int world_model_instances_index::block_of(int cell_index)
+  {
+    int const cell_x = cell_index % cells_per_side;
+    int const cell_z = cell_index / cells_per_side;
+    return (cell_z / cells_per_block) * blocks_per_side + cell_x / cells_per_block;
+  }
+
+  void world_model_instances_index::insert(SceneObject* instance)
+  {
+    assert(!_locations.count(instance));
+
+    if (instance->finishedLoading())
+    {
+      place(instance);
+    }
+    else
+    {
+      _locations[instance] = {pending, static_cast<std::uint32_t>(_pending.size())};
+      _pending.push_back({instance, {}});
+    }
+  }
+
+  void world_model_instances_index::place(SceneObject* instance)
+  {
+    if (instance->instance_model()->loading_failed())
+    {
+      // can't be hit by anything, only reachable through its position
+      _locations[instance] = {large, static_cast<std::uint32_t>(_large.size())};
+      _large.push_back({instance, {instance->pos, instance->pos}});
+      return;
+    }
+
+    std::array<glm::vec3, 2> const extents = instance->getExtents();
+
+    int const cell_x = cell_coord(instance->pos.x);
+    int const cell_z = cell_coord(instance->pos.z);
+
+    // the extents of the instances stored in a cell must not go further than the
+    // neighbouring cells, that's what allows box queries to only look around them
+    float const min_x = (cell_x - 1) * cell_size;
+    float const min_z = (cell_z - 1) * cell_size;
+    float const max_x = (cell_x + 2) * cell_size;
+    float const max_z = (cell_z + 2) * cell_size;
+
+    if (extents[0].x < min_x || extents[0].z < min_z || extents[1].x > max_x || extents[1].z > max_z)
+    {
+      _locations[instance] = {large, static_cast<std::uint32_t>(_large.size())};
+      _large.push_back({instance, extents});
+      return;
+    }
+
+    int const cell_index = cell_z * cells_per_side + cell_x;
+    auto& cell = _cells[cell_index];
+    auto& block = _blocks[block_of(cell_index)];
+
+    _locations[instance] = {cell_index, static_cast<std::uint32_t>(cell.instances.size())};
+    cell.instances.push_back({instance, extents});
+    cell.extents.add(extents);
+    block.count++;
+    block.extents.add(extents);
+  }
+
+  void world_model_instances_index::remove(SceneObject* instance)
+  {
+    auto it = _locations.find(instance);
+
+    if (it == _locations.end())
+    {
+      return;
+    }
+
+    location const loc = it->second;
+    _locations.erase(it);
+
+    if (loc.cell == pending)
+    {
+      erase_from(_pending, loc.index);
+    }
+    else if (loc.cell == large)
+    {
+      erase_from(_large, loc.index);
+    }
+    else
+    {
+      erase_from(_cells[loc.cell].instances, loc.index);
+      _blocks[block_of(loc.cell)].count--;
+      recompute_bounds(loc.cell);
+    }
+  }
+
+  void world_model_instances_index::update(SceneObject* instance)
+  {
+    if (_locations.count(instance))
+    {
+      remove(instance);
+      insert(instance);
+    }
+  }
+
+  void world_model_instances_index::clear()
+  {
+    for (auto& cell : _cells)
+    {
+      cell.instances.clear();
+      cell.extents.reset();
+    }
+    for (auto& block : _blocks)
+    {
+      block.count = 0;
+      block.extents.reset();
+    }
+
+    _large.clear();
+    _pending.clear();
+    _locations.clear();
+  }
+
+  void world_model_instances_index::erase_from(std::vector<entry>& entries, std::uint32_t index)
+  {
+    if (index + 1 != entries.size())
+    {
+      entries[index] = entries.back();
+      _locations.at(entries[index].instance).index = index;
+    }
+
+    entries.pop_back();
+  }
+
+  void world_model_instances_index::recompute_bounds(int cell_index)
+  {
+    auto& cell = _cells[cell_index];
+
+    cell.extents.reset();
+    for (auto const& entry : cell.instances)
+    {
+      cell.extents.add(entry.extents);
+    }
+
+    int const block_index = block_of(cell_index);
+    int const block_x = block_index % blocks_per_side;
+    int const block_z = block_index / blocks_per_side;
+    auto& block = _blocks[block_index];
+
+    block.extents.reset();
+
+    for (int z = 0; z < cells_per_block; ++z)
+    {
+      for (int x = 0; x < cells_per_block; ++x)
+      {
+        auto const& other = _cells[(block_z * cells_per_block + z) * cells_per_side + block_x * cells_per_block + x];
+
+        if (!other.extents.empty)
+        {
+          block.extents.add(other.extents.extents);
+        }
+      }
+    }
+  }
+
+  void world_model_instances_index::place_pending()
+  {
+    for (std::size_t i = 0; i < _pending.size();)
+    {
+      SceneObject* instance = _pending[i].instance;
+
+      if (instance->finishedLoading())
+      {
+        _locations.erase(instance);
+        erase_from(_pending, static_cast<std::uint32_t>(i));
+        place(instance);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+  }
+
+  template<typename Test>
+    void world_model_instances_index::add_unsorted(Test&& test, std::vector<SceneObject*>& result)
+  {
+    for (auto const& entry : _large)
+    {
+      if (test(entry.extents))
+      {
+        result.push_back(entry.instance);
+      }
+    }
+
+    // extents unknown, let the caller decide
+    for (auto const& entry : _pending)
+    {
+      result.push_back(entry.instance);
+    }
+  }
+
+  template<typename Test>
+    void world_model_instances_index::query(Test&& test, std::vector<SceneObject*>& result)
+  {
+    place_pending();
+
+    for (int block_z = 0; block_z < blocks_per_side; ++block_z)
+    {
+      for (int block_x = 0; block_x < blocks_per_side; ++block_x)
+      {
+        auto const& block = _blocks[block_z * blocks_per_side + block_x];
+
+        if (!block.count || !test(block.extents.extents))
+        {
+          continue;
+        }
+
+        for (int z = 0; z < cells_per_block; ++z)
+        {
+          for (int x = 0; x < cells_per_block; ++x)
+          {
+            auto const& cell = _cells[(block_z * cells_per_block + z) * cells_per_side + block_x * cells_per_block + x];
+
+            if (cell.extents.empty || !test(cell.extents.extents))
+            {
+              continue;
+            }
+
+            for (auto const& entry : cell.instances)
+            {
+              if (test(entry.extents))
+              {
+                result.push_back(entry.instance);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    add_unsorted(test, result);
+  }
+
+  void world_model_instances_index::query_range(glm::vec3 const& pos, float radius, bool ignore_height, std::vector<SceneObject*>& result)
+  {
+    auto in_range = [&] (SceneObject* instance)
+    {
+      glm::vec3 const instance_pos = ignore_height ? glm::vec3(instance->pos.x, pos.y, instance->pos.z) : instance->pos;
+      return glm::distance(instance_pos, pos) <= radius;
+    };
+
+    int const min_x = cell_coord(pos.x - radius);
+    int const max_x = cell_coord(pos.x + radius);
+    int const min_z = cell_coord(pos.z - radius);
+    int const max_z = cell_coord(pos.z + radius);
+
+    for (int z = min_z; z <= max_z; ++z)
+    {
+      for (int x = min_x; x <= max_x; ++x)
+      {
+        for (auto const& entry : _cells[z * cells_per_side + x].instances)
+        {
+          if (in_range(entry.instance))
+          {
+            result.push_back(entry.instance);
+          }
+        }
+      }
+    }
+
+    for (auto const* entries : {&_large, &_pending})
+    {
+      for (auto const& entry : *entries)
+      {
+        if (in_range(entry.instance))
+        {
+          result.push_back(entry.instance);
+        }
+      }
+    }
+  }
+
+  void world_model_instances_index::query_box(glm::vec3 const& min, glm::vec3 const& max, std::vector<SceneObject*>& result)
+  {
+    auto overlaps = [&] (std::array<glm::vec3, 2> const& extents)
+    {
+      return extents[1].x >= min.x && extents[1].y >= min.y && extents[1].z >= min.z
+          && max.x >= extents[0].x && max.y >= extents[0].y && max.z >= extents[0].z;
+    };
+
+    place_pending();
+
+    // instances of a cell never reach further than the neighbouring cells
+    int const min_x = cell_coord(min.x - cell_size);
+    int const max_x = cell_coord(max.x + cell_size);
+    int const min_z = cell_coord(min.z - cell_size);
+    int const max_z = cell_coord(max.z + cell_size);
+
+    for (int z = min_z; z <= max_z; ++z)
+    {
+      for (int x = min_x; x <= max_x; ++x)
+      {
+        auto const& cell = _cells[z * cells_per_side + x];
+
+        if (cell.extents.empty || !overlaps(cell.extents.extents))
+        {
+          continue;
+        }
+
+        for (auto const& entry : cell.instances)
+        {
+          if (overlaps(entry.extents))
+          {
+            result.push_back(entry.instance);
+          }
+        }
+      }
+    }
+
+    add_unsorted(overlaps, result);
+  }
+
+  void world_model_instances_index::query_ray(math::ray const& ray, std::vector<SceneObject*>& result)
+  {
+    query([&] (std::array<glm::vec3, 2> const& extents)
+          {
+            return ray.intersect_bounds(extents[0], extents[1]).has_value();
+          }
+        , result
+        );
+  }
+
+  void world_model_instances_index::query_frustum(math::frustum const& frustum, std::vector<SceneObject*>& result)
+  {
+    query([&] (std::array<glm::vec3, 2> const& extents)
+          {
+            return frustum.intersects(extents[1], extents[0]);
+          }
+        , result
+        );
+  }
+}
@@ -0,0 +1,116 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class SceneObject;
+
+namespace math
+{
+  class frustum;
+  struct ray;
+}
+
+namespace Noggit
+{
+  //! Two level grid over the map (one block per ADT, 4x4 cells per block) used to
+  //! answer spatial queries on model instances without visiting all of them.
+  //! Instances are binned by their position, cells and blocks keep the union of
+  //! the extents of their instances so ray and frustum queries can skip them.
+  //! Instances whose extents aren't known yet (model still loading) or reach
+  //! further than a cell away from their position are kept aside and returned
+  //! by every extents based query, callers are expected to do the precise test.
+  //! Not thread safe, world_model_instances_storage guards it with its mutex.
+  class world_model_instances_index
+  {
+  public:
+    world_model_instances_index();
+
+    void insert(SceneObject* instance);
+    void remove(SceneObject* instance);
+    //! to call once the instance was moved, rotated or scaled
+    void update(SceneObject* instance);
+    void clear();
+
+    //! instances whose position is within radius of pos
+    void query_range(glm::vec3 const& pos, float radius, bool ignore_height, std::vector<SceneObject*>& result);
+    //! instances whose extents may overlap the box
+    void query_box(glm::vec3 const& min, glm::vec3 const& max, std::vector<SceneObject*>& result);
+    //! instances whose extents may be hit by the ray
+    void query_ray(math::ray const& ray, std::vector<SceneObject*>& result);
+    //! instances whose extents may be inside the frustum
+    void query_frustum(math::frustum const& frustum, std::vector<SceneObject*>& result);
+
+    [[nodiscard]]
+    std::size_t size() const { return _locations.size(); }
+
+  private:
+    static constexpr int cells_per_block = 4;
+    static constexpr int blocks_per_side = 64;
+    static constexpr int cells_per_side = blocks_per_side * cells_per_block;
+    static constexpr int large = -1;
+    static constexpr int pending = -2;
+
+    struct bounds
+    {
+      std::array<glm::vec3, 2> extents;
+      bool empty = true;
+
+      void reset() { empty = true; }
+      void add(std::array<glm::vec3, 2> const& other);
+    };
+
+    //! extents as they were when the instance was (re)inserted
+    struct entry
+    {
+      SceneObject* instance;
+      std::array<glm::vec3, 2> extents;
+    };
+
+    struct cell
+    {
+      std::vector<entry> instances;
+      bounds extents;
+    };
+
+    struct block
+    {
+      std::uint32_t count = 0;
+      bounds extents;
+    };
+
+    struct location
+    {
+      int cell;
+      std::uint32_t index;
+    };
+
+    static int cell_coord(float pos);
+    static int block_of(int cell_index);
+
+    //! moves the instances whose model finished loading into their cell
+    void place_pending();
+    void place(SceneObject* instance);
+    void erase_from(std::vector<entry>& entries, std::uint32_t index);
+    void recompute_bounds(int cell_index);
+
+    //! walks blocks, cells then instances, skipping everything failing test(extents)
+    template<typename Test>
+      void query(Test&& test, std::vector<SceneObject*>& result);
+    //! adds the large instances passing test(extents) and every pending instance
+    template<typename Test>
+      void add_unsorted(Test&& test, std::vector<SceneObject*>& result);
+
+    std::vector<cell> _cells;
+    std::vector<block> _blocks;
+    std::vector<entry> _large;
+    std::vector<entry> _pending;
+    std::unordered_map<SceneObject*, location> _locations;
+  };
+}
@@ -5,6 +5,7 @@
 #include <noggit/ActionManager.hpp>
 #include <noggit/Action.hpp>
 #include <noggit/TileIndex.hpp>
+#include <noggit/duplicate_instance_finder.hpp>
 
 namespace Noggit
 {
@@ -50,7 +51,8 @@ namespace Noggit
       // This causes a crash when undoing while loading a tile, those objects get registered to the action stack
       if (action && NOGGIT_CUR_ACTION)
         NOGGIT_CUR_ACTION->registerObjectAdded(&instance);
-      _m2s.emplace(uid, instance);
+      _index.insert(&_m2s.emplace(uid, instance).first->second);
+      _world->markModelInstancesDirty();
       _instance_count_per_uid[uid] = 1;
       return uid;
     }
@@ -99,7 +101,8 @@ namespace Noggit
     {
       if (action && NOGGIT_CUR_ACTION)
         NOGGIT_CUR_ACTION->registerObjectAdded(&instance);
-      _wmos.emplace(uid, instance);
+      _index.insert(&_wmos.emplace(uid, instance).first->second);
+      _world->markModelInstancesDirty();
       _instance_count_per_uid[uid] = 1;
       return uid;
     }
@@ -181,9 +184,7 @@ namespace Noggit
       }
     }
 
-    _instance_count_per_uid.erase(uid);
-    _m2s.erase(uid);
-    _wmos.erase(uid);
+    unsafe_erase_instance(uid);
   }
 
   void world_model_instances_storage::unload_instance_and_remove_from_selection_if_necessary(std::uint32_t uid)
@@ -200,21 +201,46 @@ namespace Noggit
     {
       _world->remove_from_selection(uid, false, false);
 
-      _instance_count_per_uid.erase(uid);
-      _m2s.erase(uid);
-      _wmos.erase(uid);
+      unsafe_erase_instance(uid);
     }
   }
 
+  void world_model_instances_storage::unsafe_erase_instance(std::uint32_t uid)
+  {
+    if (auto instance = unsafe_get_model_instance(uid))
+    {
+      _index.remove(instance.value());
+      _world->markModelInstancesDirty();
+    }
+    if (auto instance = unsafe_get_wmo_instance(uid))
+    {
+      _index.remove(instance.value());
+      _world->markModelInstancesDirty();
+    }
+
+    _instance_count_per_uid.erase(uid);
+    _m2s.erase(uid);
+    _wmos.erase(uid);
+  }
+
   void world_model_instances_storage::clear()
   {
     std::unique_lock<std::mutex> const lock (_mutex);
 
+    _index.clear();
+    _world->markModelInstancesDirty();
     _instance_count_per_uid.clear();
     _m2s.clear();
     _wmos.clear();
   }
 
+  void world_model_instances_storage::update_instance_extents(SceneObject* instance)
+  {
+    std::unique_lock<std::mutex> const lock (_mutex);
+    _index.update(instance);
+    _world->markModelInstancesDirty();
+  }
+
   std::optional<ModelInstance*> world_model_instances_storage::get_model_instance(std::uint32_t uid)
   {
     std::unique_lock<std::mutex> const lock (_mutex);
@@ -308,60 +334,70 @@ namespace Noggit
     return _instance_count_per_uid.find(uid) != _instance_count_per_uid.end();
   }
 
-  void world_model_instances_storage::clear_duplicates(bool action)
+  std::size_t world_model_instances_storage::clear_duplicates(bool action)
   {
     std::unique_lock<std::mutex> const lock (_mutex);
 
-    int deleted_uids = 0;
+    std::size_t deleted_uids = 0;
 
-    for (auto lhs(_wmos.begin()); lhs != _wmos.end(); ++lhs)
     {
-      for (auto rhs(std::next(lhs)); rhs != _wmos.end();)
+      duplicate_instance_finder<AsyncObject*, WMOInstance*> finder;
+
+      for (auto it(_wmos.begin()); it != _wmos.end();)
       {
-        assert(lhs->first != rhs->first);
+        auto& instance = it->second;
+        auto const is_duplicate = [&] (WMOInstance* other) { return other->isDuplicateOf(instance); };
 
-        if (lhs->second.isDuplicateOf(rhs->second))
+        if (finder.find_or_insert(instance.instance_model(), instance.pos, &instance, is_duplicate))
         {
-          _world->updateTilesWMO(&rhs->second, model_update::remove);
+          _world->updateTilesWMO(&instance, model_update::remove);
 
-          _instance_count_per_uid.erase(rhs->second.uid);
+          _instance_count_per_uid.erase(instance.uid);
           if (action && NOGGIT_CUR_ACTION)
-            NOGGIT_CUR_ACTION->registerObjectRemoved(&rhs->second);
-          rhs = _wmos.erase(rhs);
+            NOGGIT_CUR_ACTION->registerObjectRemoved(&instance);
+          _index.remove(&instance);
+          _world->markModelInstancesDirty();
+          it = _wmos.erase(it);
           deleted_uids++;
         }
         else
         {
-          rhs++;
+          it++;
         }
       }
     }
 
-    for (auto lhs(_m2s.begin()); lhs != _m2s.end(); ++lhs)
     {
-      for (auto rhs(std::next(lhs)); rhs != _m2s.end();)
+      duplicate_instance_finder<AsyncObject*, ModelInstance*> finder;
+
+      for (auto it(_m2s.begin()); it != _m2s.end();)
       {
-        assert(lhs->first != rhs->first);
+        auto& instance = it->second;
+        auto const is_duplicate = [&] (ModelInstance* other) { return other->isDuplicateOf(instance); };
 
-        if (lhs->second.isDuplicateOf(rhs->second))
+        if (finder.find_or_insert(instance.instance_model(), instance.pos, &instance, is_duplicate))
         {
-          _world->updateTilesModel(&rhs->second, model_update::remove);
+          _world->updateTilesModel(&instance, model_update::remove);
 
-          _instance_count_per_uid.erase(rhs->second.uid);
+          _instance_count_per_uid.erase(instance.uid);
 
           if (action && NOGGIT_CUR_ACTION)
-            NOGGIT_CUR_ACTION->registerObjectRemoved(&rhs->second);
-          rhs = _m2s.erase(rhs);
+            NOGGIT_CUR_ACTION->registerObjectRemoved(&instance);
+          _index.remove(&instance);
+          _world->markModelInstancesDirty();
+          it = _m2s.erase(it);
           deleted_uids++;
         }
         else
         {
-          rhs++;
+          it++;
         }
       }
     }
 
     Log << "Deleted " << deleted_uids << " duplicate Model/WMO" << std::endl;
+
+    return deleted_uids;
   }
 
   bool world_model_instances_storage::uid_duplicates_found() const
@@ -4,6 +4,7 @@
 #include <noggit/ModelInstance.h>
 #include <noggit/Selection.h>
 #include <noggit/WMOInstance.h>
+#include <noggit/world_model_instances_index.hpp>
 #include <opengl/scoped.hpp>
 #include <atomic>
 #include <mutex>
@@ -45,7 +46,11 @@ namespace Noggit
 
     void clear();
 
-    void clear_duplicates(bool action);
+    //! to call after moving, rotating or scaling an instance so the spatial queries see it
+    void update_instance_extents(SceneObject* instance);
+
+    //! \returns the number of deleted instances
+    std::size_t clear_duplicates(bool action);
 
     bool uid_duplicates_found() const;
 
@@ -61,6 +66,7 @@ namespace Noggit
     std::uint32_t unsafe_add_wmo_instance_no_world_upd(WMOInstance instance, bool action);
     std::optional<ModelInstance*> unsafe_get_model_instance(std::uint32_t uid);
     std::optional<WMOInstance*> unsafe_get_wmo_instance(std::uint32_t uid);
+    void unsafe_erase_instance(std::uint32_t uid);
 
   public:
     template<typename Fun>
@@ -101,6 +107,66 @@ namespace Noggit
       }
     }
 
+    //! instances whose position is within radius of pos
+    template<typename Fun>
+      void for_each_instance_in_range(glm::vec3 const& pos, float radius, bool ignore_height, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      std::vector<SceneObject*> instances;
+      _index.query_range(pos, radius, ignore_height, instances);
+
+      for (auto* instance : instances)
+      {
+        function(instance);
+      }
+    }
+
+    //! instances whose extents may overlap the box, it's up to the caller to do the precise test
+    template<typename Fun>
+      void for_each_instance_in_box(glm::vec3 const& min, glm::vec3 const& max, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      std::vector<SceneObject*> instances;
+      _index.query_box(min, max, instances);
+
+      for (auto* instance : instances)
+      {
+        function(instance);
+      }
+    }
+
+    //! instances whose extents may be hit by the ray, it's up to the caller to do the precise test
+    template<typename Fun>
+      void for_each_instance_on_ray(math::ray const& ray, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      std::vector<SceneObject*> instances;
+      _index.query_ray(ray, instances);
+
+      for (auto* instance : instances)
+      {
+        function(instance);
+      }
+    }
+
+    //! instances whose extents may be inside the frustum, it's up to the caller to do the precise test
+    template<typename Fun>
+      void for_each_instance_in_frustum(math::frustum const& frustum, Fun&& function)
+    {
+      std::unique_lock<std::mutex> const lock (_mutex);
+
+      std::vector<SceneObject*> instances;
+      _index.query_frustum(frustum, instances);
+
+      for (auto* instance : instances)
+      {
+        function(instance);
+      }
+    }
+
   private:
     World* _world;
     std::mutex _mutex;
@@ -108,6 +174,7 @@ namespace Noggit
 
     m2_instance_umap _m2s;
     wmo_instance_umap _wmos;
+    world_model_instances_index _index;
 
     OpenGL::Scoped::deferred_upload_buffers<1> _buffers;
     GLuint const& _m2_instances_transform_buf = _buffers[0];
@@ -0,0 +1,27 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace util
+{
+  //! Mixes the hash of value into seed (boost::hash_combine). Unlike a plain XOR,
+  //! equal or swapped members don't cancel each other out.
+  template<typename T>
+    void hash_combine(std::size_t& seed, T const& value)
+  {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+
+  //! Spreads the bits of an integer key (splitmix64 finalizer), for keys built from
+  //! small ids where std::hash is the identity.
+  inline std::size_t hash_integer(std::uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::size_t>(x ^ (x >> 31));
+  }
+}
@@ -0,0 +1,146 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <util/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace util
+{
+  thread_pool& thread_pool::instance()
+  {
+    // keep one core for the UI thread
+    static thread_pool pool (std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+  }
+
+  thread_pool::thread_pool(std::size_t n_threads)
+  {
+    for (std::size_t i = 0; i < n_threads; ++i)
+    {
+      _threads.emplace_back(&thread_pool::process, this);
+    }
+  }
+
+  thread_pool::~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> const lock (_guard);
+      _stop = true;
+    }
+    _state_changed.notify_all();
+
+    for (auto& thread : _threads)
+    {
+      thread.join();
+    }
+  }
+
+  void thread_pool::push(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> const lock (_guard);
+      _tasks.emplace_back(std::move(task));
+    }
+    _state_changed.notify_one();
+  }
+
+  void thread_pool::process()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+
+      {
+        std::unique_lock<std::mutex> lock (_guard);
+        _state_changed.wait(lock, [&] { return _stop || !_tasks.empty(); });
+
+        if (_stop && _tasks.empty())
+        {
+          return;
+        }
+
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+
+      task();
+    }
+  }
+
+  void thread_pool::parallel_for(std::size_t count, std::function<void (std::size_t)> const& fun)
+  {
+    if (!count)
+    {
+      return;
+    }
+
+    if (count == 1 || _threads.empty())
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        fun(i);
+      }
+      return;
+    }
+
+    // helpers may start after the caller already returned, everything they touch is shared
+    struct state
+    {
+      std::function<void (std::size_t)> fun;
+      std::size_t count;
+      std::atomic<std::size_t> next = 0;
+      std::atomic<std::size_t> done = 0;
+      std::mutex error_guard;
+      std::exception_ptr error;
+
+      void run()
+      {
+        for (std::size_t i = next++; i < count; i = next++)
+        {
+          try
+          {
+            fun(i);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> const lock (error_guard);
+            if (!error)
+            {
+              error = std::current_exception();
+            }
+          }
+
+          if (++done == count)
+          {
+            done.notify_all();
+          }
+        }
+      }
+    };
+
+    auto shared = std::make_shared<state>();
+    shared->fun = fun;
+    shared->count = count;
+
+    std::size_t const helpers = std::min(_threads.size(), count - 1);
+
+    for (std::size_t i = 0; i < helpers; ++i)
+    {
+      push([shared] { shared->run(); });
+    }
+
+    shared->run();
+
+    for (std::size_t done = shared->done.load(); done != count; done = shared->done.load())
+    {
+      shared->done.wait(done);
+    }
+
+    if (shared->error)
+    {
+      std::rethrow_exception(shared->error);
+    }
+  }
+}
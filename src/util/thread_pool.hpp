@@ -0,0 +1,60 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+  //! Shared pool of CPU workers for data-parallel work (saving, brushes, exports...).
+  //! Not to be confused with AsyncLoader, which only loads AsyncObjects.
+  class thread_pool
+  {
+  public:
+    static thread_pool& instance();
+
+    explicit thread_pool(std::size_t n_threads);
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator= (thread_pool const&) = delete;
+
+    [[nodiscard]]
+    std::size_t size() const { return _threads.size(); }
+
+    template<typename Fun>
+      auto submit(Fun&& fun) -> std::future<decltype(fun())>
+    {
+      using result_type = decltype(fun());
+
+      auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Fun>(fun));
+      std::future<result_type> result = task->get_future();
+      push([task] { (*task)(); });
+
+      return result;
+    }
+
+    //! Calls fun(i) for every i in [0, count). The calling thread takes part in the
+    //! work so it is safe to nest calls. The first exception thrown is rethrown here
+    //! once every index has been processed.
+    void parallel_for(std::size_t count, std::function<void (std::size_t)> const& fun);
+
+  private:
+    void push(std::function<void()> task);
+    void process();
+
+    std::mutex _guard;
+    std::condition_variable _state_changed;
+    std::deque<std::function<void()>> _tasks;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+  };
+}